@@ -0,0 +1,169 @@
+#ifndef __NEURODIDACTIC__BENCH__REPORT_HPP__
+#define __NEURODIDACTIC__BENCH__REPORT_HPP__
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <string.h>
+
+namespace neurodidactic {
+  namespace bench {
+
+    // Collects benchmark measurements and prints them as an aligned
+    // table for people or as CSV or JSON for scripts.  Each measurement
+    // is one operation at one problem size and batch size, with the
+    // FLOPs and bytes of memory traffic of one call, from which the
+    // report derives GFLOP/s and GB/s.
+    class Report {
+    public:
+      enum class Format {
+	TABLE,
+	CSV,
+	JSON
+      };
+
+      struct Measurement {
+	std::string operation;
+	size_t size;
+	size_t batchSize;
+	double seconds;
+	double flops;
+	double bytes;
+
+	double gflopsPerSecond() const {
+	  return (seconds > 0.0) ? flops / seconds * 1e-9 : 0.0;
+	}
+	double gbytesPerSecond() const {
+	  return (seconds > 0.0) ? bytes / seconds * 1e-9 : 0.0;
+	}
+      };
+
+    public:
+      explicit Report(const std::string& benchmark,
+		      Format format = Format::TABLE):
+	  benchmark_(benchmark), format_(format), measurements_() {
+      }
+
+      // Removes a "--format=table|csv|json" option from the command line,
+      // so the remaining arguments can be read by position, and returns
+      // the format it names
+      static Format parseFormat(int& argc, char** argv) {
+	static const char OPTION[] = "--format=";
+	Format format = Format::TABLE;
+	int n = 1;
+	for (int i = 1; i < argc; ++i) {
+	  if (!strncmp(argv[i], OPTION, sizeof(OPTION) - 1)) {
+	    const char* name = argv[i] + sizeof(OPTION) - 1;
+	    if (!strcmp(name, "csv")) {
+	      format = Format::CSV;
+	    } else if (!strcmp(name, "json")) {
+	      format = Format::JSON;
+	    } else if (strcmp(name, "table")) {
+	      std::cerr << "Unknown format \"" << name
+			<< "\"; using \"table\"" << std::endl;
+	    }
+	  } else {
+	    argv[n++] = argv[i];
+	  }
+	}
+	argc = n;
+	return format;
+      }
+
+      const std::string& benchmark() const { return benchmark_; }
+      Format format() const { return format_; }
+      const std::vector<Measurement>& measurements() const {
+	return measurements_;
+      }
+
+      void add(const std::string& operation, size_t size, size_t batchSize,
+	       double seconds, double flops, double bytes) {
+	measurements_.push_back(Measurement{ operation, size, batchSize,
+					     seconds, flops, bytes });
+	if (format_ == Format::TABLE) {
+	  if (measurements_.size() == 1) {
+	    writeTableHeader_(std::cout);
+	  }
+	  writeTableRow_(std::cout, measurements_.back());
+	}
+      }
+
+      // Table rows are printed as they are added, so a long run shows
+      // progress.  CSV and JSON are printed in one piece by write().
+      void write(std::ostream& out = std::cout) const {
+	if (format_ == Format::CSV) {
+	  writeCsv_(out);
+	} else if (format_ == Format::JSON) {
+	  writeJson_(out);
+	}
+	out.flush();
+      }
+
+    private:
+      std::string benchmark_;
+      Format format_;
+      std::vector<Measurement> measurements_;
+
+      static void writeTableHeader_(std::ostream& out) {
+	out << std::left << std::setw(36) << "operation" << std::right
+	    << std::setw(8) << "size" << std::setw(8) << "batch"
+	    << std::setw(14) << "usec/call" << std::setw(12) << "GFLOP/s"
+	    << std::setw(12) << "GB/s" << std::endl;
+      }
+
+      static void writeTableRow_(std::ostream& out, const Measurement& m) {
+	out << std::left << std::setw(36) << m.operation << std::right
+	    << std::setw(8) << m.size << std::setw(8) << m.batchSize
+	    << std::fixed << std::setprecision(2)
+	    << std::setw(14) << (m.seconds * 1e6)
+	    << std::setw(12) << m.gflopsPerSecond()
+	    << std::setw(12) << m.gbytesPerSecond() << std::endl;
+      }
+
+      void writeCsv_(std::ostream& out) const {
+	out << "benchmark,operation,size,batch,seconds,flops,bytes,"
+	    << "gflops_per_second,gbytes_per_second\n";
+	out << std::setprecision(6);
+	for (const Measurement& m : measurements_) {
+	  out << benchmark_ << "," << m.operation << "," << m.size << ","
+	      << m.batchSize << "," << m.seconds << "," << m.flops << ","
+	      << m.bytes << "," << m.gflopsPerSecond() << ","
+	      << m.gbytesPerSecond() << "\n";
+	}
+      }
+
+      void writeJson_(std::ostream& out) const {
+	out << "{\"benchmark\": \"" << benchmark_ << "\", "
+	    << "\"measurements\": [";
+	out << std::setprecision(6);
+	for (size_t i = 0; i < measurements_.size(); ++i) {
+	  const Measurement& m = measurements_[i];
+	  out << (i ? ",\n  " : "\n  ")
+	      << "{\"operation\": \"" << m.operation << "\", "
+	      << "\"size\": " << m.size << ", "
+	      << "\"batch\": " << m.batchSize << ", "
+	      << "\"seconds\": " << m.seconds << ", "
+	      << "\"flops\": " << m.flops << ", "
+	      << "\"bytes\": " << m.bytes << ", "
+	      << "\"gflops_per_second\": " << m.gflopsPerSecond() << ", "
+	      << "\"gbytes_per_second\": " << m.gbytesPerSecond() << "}";
+	}
+	out << "\n]}" << std::endl;
+      }
+    };
+
+    // Returns minimum, minimum * factor, ... up to maximum
+    inline std::vector<size_t> geometricSweep(size_t minimum, size_t maximum,
+					      size_t factor) {
+      std::vector<size_t> values;
+      for (size_t v = minimum; v <= maximum; v *= factor) {
+	values.push_back(v);
+      }
+      return values;
+    }
+
+  }
+}
+#endif
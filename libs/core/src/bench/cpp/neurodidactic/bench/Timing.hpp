@@ -0,0 +1,60 @@
+#ifndef __NEURODIDACTIC__BENCH__TIMING_HPP__
+#define __NEURODIDACTIC__BENCH__TIMING_HPP__
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <stddef.h>
+
+namespace neurodidactic {
+  namespace bench {
+
+    // Runs f() "warmup" times untimed, then "repetitions" times, and
+    // returns the median time for one call in seconds
+    template <typename Function>
+    double medianSeconds(Function f, size_t warmup, size_t repetitions) {
+      typedef std::chrono::steady_clock Clock;
+      std::vector<double> times;
+
+      for (size_t i = 0; i < warmup; ++i) {
+	f();
+      }
+      times.reserve(repetitions);
+      for (size_t i = 0; i < repetitions; ++i) {
+	const Clock::time_point start = Clock::now();
+	f();
+	times.push_back(
+	    std::chrono::duration<double>(Clock::now() - start).count()
+	);
+      }
+      if (times.empty()) {
+	return 0.0;
+      }
+      std::nth_element(times.begin(), times.begin() + times.size() / 2,
+		       times.end());
+      return times[times.size() / 2];
+    }
+
+    // Like medianSeconds(), but times one warmup call and picks the
+    // number of repetitions so the timed calls take "targetSeconds" in
+    // total, within [minRepetitions, maxRepetitions]
+    template <typename Function>
+    double adaptiveMedianSeconds(Function f, double targetSeconds = 0.1,
+				 size_t minRepetitions = 3,
+				 size_t maxRepetitions = 1000) {
+      typedef std::chrono::steady_clock Clock;
+      const Clock::time_point start = Clock::now();
+      f();
+      const double seconds =
+	  std::chrono::duration<double>(Clock::now() - start).count();
+      const size_t repetitions =
+	  (seconds > 0.0) ? size_t(targetSeconds / seconds) : maxRepetitions;
+      return medianSeconds(
+	  f, 0,
+	  std::min(std::max(repetitions, minRepetitions), maxRepetitions)
+      );
+    }
+
+  }
+}
+#endif
@@ -0,0 +1,52 @@
+#include <neurodidactic/bench/Timing.hpp>
+#include <neurodidactic/core/arrays/HugePageAllocator.hpp>
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/arrays/MklAllocator.hpp>
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <stdlib.h>
+
+using namespace neurodidactic::core::arrays;
+
+// Times a matrix-vector product over a large weight matrix allocated with
+// 4 KB pages (MklAllocator) and with 2 MB pages (HugePageAllocator).
+//
+// Usage: HugePageAllocatorBenchmark [rows [columns [repetitions]]]
+
+namespace {
+  template <typename Allocator>
+  void measure(const std::string& name, uint32_t rows, uint32_t columns,
+	       size_t repetitions) {
+    typedef MdArray<2, float, Allocator> Matrix;
+    typedef MdArray<1, float, Allocator> Vector;
+    Matrix weights({ rows, columns }, 0.5f);
+    Vector x({ columns }, 1.0f);
+    Vector y({ rows }, 0.0f);
+
+    const double seconds = neurodidactic::bench::medianSeconds(
+	[&]() { weights.innerProduct(x, y); }, 2, repetitions
+    );
+    std::cout << std::setw(12) << name << std::setw(14) << std::fixed
+	      << std::setprecision(3) << (seconds * 1e3)
+	      << std::setw(14) << std::setprecision(2)
+	      << (weights.size() * sizeof(float) / seconds / 1e9)
+	      << std::endl;
+  }
+}
+
+int main(int argc, char** argv) {
+  const uint32_t rows = (argc > 1) ? atoi(argv[1]) : 16384;
+  const uint32_t columns = (argc > 2) ? atoi(argv[2]) : 8192;
+  const size_t repetitions = (argc > 3) ? atoi(argv[3]) : 20;
+
+  std::cout << "weights=" << rows << "x" << columns << " ("
+	    << (size_t(rows) * columns * sizeof(float) >> 20) << "MB)"
+	    << std::endl;
+  std::cout << std::setw(12) << "pages" << std::setw(14) << "ms/sgemv"
+	    << std::setw(14) << "GB/s" << std::endl;
+  measure< MklAllocator<float> >("4KB", rows, columns, repetitions);
+  measure< HugePageAllocator<float> >("2MB", rows, columns, repetitions);
+  return 0;
+}
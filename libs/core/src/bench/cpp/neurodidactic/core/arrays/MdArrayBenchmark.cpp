@@ -0,0 +1,135 @@
+#include <neurodidactic/bench/Report.hpp>
+#include <neurodidactic/bench/Timing.hpp>
+#include <neurodidactic/core/arrays/MdArray.hpp>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <stdlib.h>
+
+using namespace neurodidactic::core::arrays;
+using neurodidactic::bench::Report;
+using neurodidactic::bench::adaptiveMedianSeconds;
+using neurodidactic::bench::geometricSweep;
+
+// Times the MdArray operations in MdArrayCommon on [batch, size]
+// matrices, including the cost of allocating the arrays that the
+// operations which return a new array create.  Comparing an operation
+// that returns a new array with the same operation writing into an
+// existing one shows what the allocation costs.
+//
+// Usage: MdArrayBenchmark [--format=table|csv|json]
+//                         [minSize [maxSize [maxBatch [maxElements]]]]
+//
+// maxSize defaults to 4096.  The [size, size] matrix products of larger
+// sizes need gigabytes, so they only run when asked for.
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<2, float> FloatMatrix;
+
+  FloatMatrix randomMatrix(std::mt19937& rng, uint32_t rows,
+			   uint32_t columns) {
+    std::uniform_real_distribution<float> value(0.5f, 1.5f);
+    FloatMatrix m(FloatMatrix::DimensionListType({ rows, columns }));
+    std::generate(m.begin(), m.end(), [&]() { return value(rng); });
+    return std::move(m);
+  }
+
+  void benchmarkElementwiseOps(Report& report, std::mt19937& rng,
+			       uint32_t size, uint32_t batch) {
+    const FloatMatrix x = randomMatrix(rng, batch, size);
+    const FloatMatrix y = randomMatrix(rng, batch, size);
+    const FloatMatrix ones(x.dimensions(), 1.0f);
+    FloatMatrix z = randomMatrix(rng, batch, size);
+    const double f = double(x.size());
+    const double b = double(x.size() * sizeof(float));
+    auto add = [&](const std::string& operation, double flops,
+		   double bytes, auto op) {
+      report.add(operation, size, batch, adaptiveMedianSeconds(op), flops,
+		 bytes);
+    };
+
+    // In-place multiplication and division use arguments that leave "z"
+    // unchanged, so repeating them cannot overflow or produce denormals
+
+    add("allocate", 0, 0, [&]() { FloatMatrix m(x.dimensions()); });
+    add("allocate and fill", 0, b, [&]() {
+	FloatMatrix m(x.dimensions(), 0.0f);
+    });
+    add("copy", 0, 2 * b, [&]() { FloatMatrix m(x); });
+    add("add", f, 3 * b, [&]() { x.add(y); });
+    add("add (into result)", f, 3 * b, [&]() { x.add(y, z); });
+    add("addInPlace", f, 3 * b, [&]() { z.addInPlace(y); });
+    add("subtract", f, 3 * b, [&]() { x.subtract(y); });
+    add("subtractInPlace", f, 3 * b, [&]() { z.subtractInPlace(y); });
+    add("multiply", f, 3 * b, [&]() { x.multiply(y); });
+    add("multiplyInPlace", f, 3 * b, [&]() { z.multiplyInPlace(ones); });
+    add("divide", f, 3 * b, [&]() { x.divide(y); });
+    add("divideInPlace", f, 3 * b, [&]() { z.divideInPlace(ones); });
+    add("multiply (scalar)", f, 2 * b, [&]() { x.multiply(0.5f); });
+    add("multiplyInPlace (scalar)", f, 2 * b, [&]() {
+	z.multiplyInPlace(0.999f);
+    });
+    add("scaleAndAdd", 2 * f, 3 * b, [&]() { x.scaleAndAdd(0.5f, y); });
+    add("scaleAndAddInPlace", 2 * f, 3 * b, [&]() {
+	z.scaleAndAddInPlace(1e-6f, y);
+    });
+    add("map", f, 2 * b, [&]() {
+	x.map([](float v) { return v > 1.0f ? v : 0.0f; });
+    });
+    add("mapInPlace", f, 2 * b, [&]() {
+	z.mapInPlace([](float v) { return v > 1.0f ? v : 0.0f; });
+    });
+  }
+
+  void benchmarkProducts(Report& report, std::mt19937& rng, uint32_t size,
+			 uint32_t batch, size_t maxElements) {
+    const FloatMatrix x = randomMatrix(rng, batch, size);
+    const FloatVector v({ size }, 1.0f);
+    const FloatVector g({ batch }, 1.0f);
+    const double matrixBytes = double(x.size() * sizeof(float));
+
+    report.add("innerProduct", size, batch, adaptiveMedianSeconds([&]() {
+	x.innerProduct(v);
+    }), 2.0 * x.size(), matrixBytes + (size + batch) * sizeof(float));
+    report.add("transposeInnerProduct", size, batch,
+	       adaptiveMedianSeconds([&]() { x.transposeInnerProduct(g); }),
+	       2.0 * x.size(),
+	       matrixBytes + (size + batch) * sizeof(float));
+    if (size_t(size) * size > maxElements) {
+      return;
+    }
+
+    const FloatMatrix w = randomMatrix(rng, size, size);
+    report.add("matrixProduct", size, batch, adaptiveMedianSeconds([&]() {
+	x.matrixProduct(w);
+    }), 2.0 * x.size() * size,
+	       2 * matrixBytes + double(w.size() * sizeof(float)));
+    if (batch == 1) {
+      report.add("outerProduct", size, size, adaptiveMedianSeconds([&]() {
+	  v.outerProduct(v);
+      }), double(size) * size, double(size) * size * sizeof(float));
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  Report report("MdArrayBenchmark", Report::parseFormat(argc, argv));
+  const size_t minSize = (argc > 1) ? atoi(argv[1]) : 64;
+  const size_t maxSize = (argc > 2) ? atoi(argv[2]) : 4096;
+  const size_t maxBatch = (argc > 3) ? atoi(argv[3]) : 1024;
+  const size_t maxElements = (argc > 4) ? atoi(argv[4]) : 1 << 24;
+  std::mt19937 rng(1234);
+
+  for (size_t size : geometricSweep(minSize, maxSize, 4)) {
+    for (size_t batch : geometricSweep(1, maxBatch, 4)) {
+      if (size * batch <= maxElements) {
+	benchmarkElementwiseOps(report, rng, size, batch);
+	benchmarkProducts(report, rng, size, batch, maxElements);
+      }
+    }
+  }
+  report.write();
+  return 0;
+}
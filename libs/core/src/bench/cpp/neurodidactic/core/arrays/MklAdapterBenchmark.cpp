@@ -0,0 +1,219 @@
+#include <neurodidactic/bench/Report.hpp>
+#include <neurodidactic/bench/Timing.hpp>
+#include <neurodidactic/core/arrays/HalfPrecision.hpp>
+#include <neurodidactic/core/arrays/detail/MklAdapter.hpp>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+#include <stdint.h>
+#include <stdlib.h>
+
+using namespace neurodidactic::core::arrays;
+using neurodidactic::bench::Report;
+using neurodidactic::bench::adaptiveMedianSeconds;
+using neurodidactic::bench::geometricSweep;
+
+// Times every MklAdapter entry point.  Vector operations run on vectors
+// of "size" elements, matrix-vector products on [size, size] matrices,
+// and matrix-matrix products on the shapes a FullyConnectedLayer with
+// "size" inputs and outputs sees for a minibatch of "batch" rows.
+//
+// Usage: MklAdapterBenchmark [--format=table|csv|json]
+//                            [minSize [maxSize [maxBatch]]]
+//
+// maxSize defaults to 4096, where a [size, size] matrix takes 64 MB.
+// Larger sizes are opt-in, since each factor of 4 takes 16 times more.
+
+namespace {
+  typedef detail::MklAdapter<float, float> FloatAdapter;
+  typedef detail::MklAdapter<BFloat16, BFloat16> BFloat16Adapter;
+  typedef detail::MklAdapter<Float16, Float16> Float16Adapter;
+  typedef detail::MklAdapter<int8_t, uint8_t> Int8Adapter;
+
+  std::vector<float> randomFloats(std::mt19937& rng, size_t n) {
+    std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+    std::vector<float> v(n);
+    std::generate(v.begin(), v.end(), [&]() { return value(rng); });
+    return v;
+  }
+
+  template <typename Half>
+  std::vector<Half> toHalf(const std::vector<float>& v) {
+    return std::vector<Half>(v.begin(), v.end());
+  }
+
+  void benchmarkVectorOps(Report& report, std::mt19937& rng, size_t n) {
+    const std::vector<float> x = randomFloats(rng, n);
+    const std::vector<float> y = randomFloats(rng, n);
+    std::vector<float> z(n);
+    const double f = double(n);
+    const double b = double(n * sizeof(float));
+
+    report.add("add", n, 1, adaptiveMedianSeconds([&]() {
+	FloatAdapter::add(n, x.data(), y.data(), z.data());
+    }), f, 3 * b);
+    report.add("subtract", n, 1, adaptiveMedianSeconds([&]() {
+	FloatAdapter::subtract(n, x.data(), y.data(), z.data());
+    }), f, 3 * b);
+    report.add("multiply", n, 1, adaptiveMedianSeconds([&]() {
+	FloatAdapter::multiply(n, x.data(), y.data(), z.data());
+    }), f, 3 * b);
+    report.add("divide", n, 1, adaptiveMedianSeconds([&]() {
+	FloatAdapter::divide(n, x.data(), y.data(), z.data());
+    }), f, 3 * b);
+    report.add("scale (in place)", n, 1, adaptiveMedianSeconds([&]() {
+	FloatAdapter::scale(n, 0.999f, z.data());
+    }), f, 2 * b);
+    report.add("scale", n, 1, adaptiveMedianSeconds([&]() {
+	FloatAdapter::scale(n, 0.5f, x.data(), z.data());
+    }), f, 2 * b);
+    report.add("scaleAndAdd", n, 1, adaptiveMedianSeconds([&]() {
+	FloatAdapter::scaleAndAdd(n, 1e-6f, x.data(), z.data());
+    }), 2 * f, 3 * b);
+    report.add("scaleAndAdd (two scales)", n, 1,
+	       adaptiveMedianSeconds([&]() {
+		   FloatAdapter::scaleAndAdd(n, 0.5f, x.data(), 0.5f,
+					     z.data());
+	       }),
+	       3 * f, 3 * b);
+    report.add("exp", n, 1, adaptiveMedianSeconds([&]() {
+	FloatAdapter::exp(n, x.data(), z.data());
+    }), f, 2 * b);
+
+    volatile float sink = 0.0f;
+    report.add("innerProduct", n, 1, adaptiveMedianSeconds([&]() {
+	sink = FloatAdapter::innerProduct(n, x.data(), y.data());
+    }), 2 * f, 2 * b);
+  }
+
+  void benchmarkMatrixVectorOps(Report& report, std::mt19937& rng,
+				size_t n) {
+    const std::vector<float> m = randomFloats(rng, n * n);
+    const std::vector<float> v = randomFloats(rng, n);
+    const std::vector<BFloat16> mb = toHalf<BFloat16>(m);
+    const std::vector<BFloat16> vb = toHalf<BFloat16>(v);
+    const std::vector<Float16> mh = toHalf<Float16>(m);
+    const std::vector<Float16> vh = toHalf<Float16>(v);
+    std::vector<float> y(n);
+    std::vector<float> outer(n * n);
+    const double f = 2.0 * n * n;
+    const double b = double(n * n * sizeof(float));
+    const double vectorBytes = 2.0 * n * sizeof(float);
+
+    report.add("outerProduct", n, 1, adaptiveMedianSeconds([&]() {
+	FloatAdapter::outerProduct(n, n, v.data(), v.data(), outer.data());
+    }), f / 2, b + vectorBytes);
+    report.add("multiplyMatrixByVector", n, 1, adaptiveMedianSeconds([&]() {
+	FloatAdapter::multiplyMatrixByVector(n, n, m.data(), v.data(),
+					     y.data());
+    }), f, b + vectorBytes);
+    report.add("multiplyMatrixTransposeByVector", n, 1,
+	       adaptiveMedianSeconds([&]() {
+		   FloatAdapter::multiplyMatrixTransposeByVector(
+		       n, n, m.data(), v.data(), y.data()
+		   );
+	       }),
+	       f, b + vectorBytes);
+    report.add("multiplyMatrixByVector (bf16)", n, 1,
+	       adaptiveMedianSeconds([&]() {
+		   BFloat16Adapter::multiplyMatrixByVector(
+		       n, n, mb.data(), vb.data(), y.data()
+		   );
+	       }),
+	       f, b / 2 + vectorBytes);
+    report.add("multiplyMatrixByVector (fp16)", n, 1,
+	       adaptiveMedianSeconds([&]() {
+		   Float16Adapter::multiplyMatrixByVector(
+		       n, n, mh.data(), vh.data(), y.data()
+		   );
+	       }),
+	       f, b / 2 + vectorBytes);
+  }
+
+  // Products for a minibatch x[batch, n] through weights w[n, n]:
+  // the forward pass x * w^T, the backward pass for the inputs g * w,
+  // and the weight gradient g^T * x
+  void benchmarkMatrixMatrixOps(Report& report, std::mt19937& rng,
+				size_t n, size_t batch) {
+    const std::vector<float> w = randomFloats(rng, n * n);
+    const std::vector<float> x = randomFloats(rng, batch * n);
+    const std::vector<BFloat16> wb = toHalf<BFloat16>(w);
+    const std::vector<BFloat16> xb = toHalf<BFloat16>(x);
+    const std::vector<Float16> wh = toHalf<Float16>(w);
+    const std::vector<Float16> xh = toHalf<Float16>(x);
+    const std::vector<int8_t> wi(n * n, int8_t(3));
+    const std::vector<uint8_t> xi(batch * n, uint8_t(130));
+    std::vector<float> y(batch * n);
+    std::vector<float> gradient(n * n);
+    std::vector<int32_t> yi(batch * n);
+    const double f = 2.0 * batch * n * n;
+    const double weightBytes = double(n * n * sizeof(float));
+    const double batchBytes = double(batch * n * sizeof(float));
+
+    report.add("multiplyMatrixByMatrixTranspose", n, batch,
+	       adaptiveMedianSeconds([&]() {
+		   FloatAdapter::multiplyMatrixByMatrixTranspose(
+		       batch, n, n, x.data(), w.data(), y.data()
+		   );
+	       }),
+	       f, weightBytes + 2 * batchBytes);
+    report.add("multiplyMatrixByMatrix", n, batch,
+	       adaptiveMedianSeconds([&]() {
+		   FloatAdapter::multiplyMatrixByMatrix(
+		       batch, n, n, x.data(), w.data(), y.data()
+		   );
+	       }),
+	       f, weightBytes + 2 * batchBytes);
+    report.add("multiplyMatrixTransposeByMatrix", n, batch,
+	       adaptiveMedianSeconds([&]() {
+		   FloatAdapter::multiplyMatrixTransposeByMatrix(
+		       n, n, batch, x.data(), x.data(), gradient.data()
+		   );
+	       }),
+	       f, weightBytes + 2 * batchBytes);
+    report.add("multiplyMatrixByMatrixTranspose (bf16)", n, batch,
+	       adaptiveMedianSeconds([&]() {
+		   BFloat16Adapter::multiplyMatrixByMatrixTranspose(
+		       batch, n, n, xb.data(), wb.data(), y.data()
+		   );
+	       }),
+	       f, (weightBytes + batchBytes) / 2 + batchBytes);
+    report.add("multiplyMatrixByMatrixTranspose (fp16)", n, batch,
+	       adaptiveMedianSeconds([&]() {
+		   Float16Adapter::multiplyMatrixByMatrixTranspose(
+		       batch, n, n, xh.data(), wh.data(), y.data()
+		   );
+	       }),
+	       f, (weightBytes + batchBytes) / 2 + batchBytes);
+    report.add("multiplyMatrixByMatrixTranspose (int8)", n, batch,
+	       adaptiveMedianSeconds([&]() {
+		   Int8Adapter::multiplyMatrixByMatrixTranspose(
+		       batch, n, n, xi.data(), wi.data(), yi.data()
+		   );
+	       }),
+	       f, (weightBytes + batchBytes) / 4 + batchBytes);
+  }
+}
+
+int main(int argc, char** argv) {
+  Report report("MklAdapterBenchmark", Report::parseFormat(argc, argv));
+  const size_t minSize = (argc > 1) ? atoi(argv[1]) : 64;
+  const size_t maxSize = (argc > 2) ? atoi(argv[2]) : 4096;
+  const size_t maxBatch = (argc > 3) ? atoi(argv[3]) : 1024;
+  std::mt19937 rng(1234);
+
+  for (size_t n : geometricSweep(minSize, maxSize, 4)) {
+    benchmarkVectorOps(report, rng, n);
+  }
+  for (size_t n : geometricSweep(minSize, maxSize, 4)) {
+    benchmarkMatrixVectorOps(report, rng, n);
+  }
+  for (size_t n : geometricSweep(minSize, maxSize, 4)) {
+    for (size_t batch : geometricSweep(1, maxBatch, 4)) {
+      benchmarkMatrixMatrixOps(report, rng, n, batch);
+    }
+  }
+  report.write();
+  return 0;
+}
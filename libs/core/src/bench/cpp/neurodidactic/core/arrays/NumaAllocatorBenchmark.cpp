@@ -0,0 +1,79 @@
+#include <neurodidactic/bench/Timing.hpp>
+#include <neurodidactic/core/arrays/MklAllocator.hpp>
+#include <neurodidactic/core/arrays/NumaAllocator.hpp>
+#include <neurodidactic/core/parallel/ThreadPool.hpp>
+
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <stdlib.h>
+
+using namespace neurodidactic::core::arrays;
+using neurodidactic::core::parallel::ThreadPool;
+
+// Measures the read bandwidth all threads of the default ThreadPool get
+// from one large array allocated with each placement policy.  The array
+// is filled by the main thread, as weights loaded from a file would be,
+// so with plain mkl_malloc all of its pages end up on the main thread's
+// node.
+//
+// Usage: NumaAllocatorBenchmark [megabytes [repetitions]]
+
+namespace {
+  double sumInParallel(const float* data, size_t n) {
+    std::atomic<double> total(0.0);
+    ThreadPool::defaultPool().parallelFor(
+	0, n, 1 << 20,
+	[data, &total](size_t begin, size_t end) {
+	  float sum = 0.0f;
+	  for (size_t i = begin; i < end; ++i) {
+	    sum += data[i];
+	  }
+	  double t = total.load();
+	  while (!total.compare_exchange_weak(t, t + sum)) { }
+	},
+	16
+    );
+    return total.load();
+  }
+
+  template <typename Allocator>
+  void measure(const std::string& name, Allocator allocator, size_t n,
+	       size_t repetitions) {
+    float* data = allocator.allocate(n);
+    for (size_t i = 0; i < n; ++i) {
+      data[i] = 1.0f;
+    }
+
+    volatile double sink = 0.0;
+    const double seconds = neurodidactic::bench::medianSeconds(
+	[&]() { sink = sumInParallel(data, n); }, 1, repetitions
+    );
+    std::cout << std::setw(22) << name << std::setw(14) << std::fixed
+	      << std::setprecision(2)
+	      << (n * sizeof(float) / seconds / 1e9) << std::endl;
+    allocator.deallocate(data, n);
+  }
+}
+
+int main(int argc, char** argv) {
+  const size_t megabytes = (argc > 1) ? atoi(argv[1]) : 1024;
+  const size_t repetitions = (argc > 2) ? atoi(argv[2]) : 10;
+  const size_t n = megabytes * 1024 * 1024 / sizeof(float);
+
+  std::cout << "nodes=" << detail::numNumaNodes()
+	    << " threads=" << ThreadPool::defaultPool().numThreads()
+	    << " size=" << megabytes << "MB" << std::endl;
+  std::cout << std::setw(22) << "placement" << std::setw(14) << "GB/s"
+	    << std::endl;
+  measure("mkl_malloc", MklAllocator<float>(), n, repetitions);
+  measure("node-local (node 0)",
+	  NumaAllocator<float, numa::NodeLocal>(numa::NodeLocal(0)), n,
+	  repetitions);
+  measure("interleaved", NumaAllocator<float, numa::Interleaved>(), n,
+	  repetitions);
+  measure("first-touch-by-worker",
+	  NumaAllocator<float, numa::FirstTouchByWorker>(), n, repetitions);
+  return 0;
+}
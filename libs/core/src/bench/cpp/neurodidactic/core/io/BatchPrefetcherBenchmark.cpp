@@ -0,0 +1,126 @@
+#include <neurodidactic/core/io/BatchPrefetcher.hpp>
+#include <neurodidactic/core/io/DatasetWriter.hpp>
+#include <neurodidactic/core/layers/FullyConnectedLayer.hpp>
+#include <neurodidactic/core/layers/Nonlinearities.hpp>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::io;
+using namespace neurodidactic::core::layers;
+namespace nl = neurodidactic::core::layers::nonlinearities;
+
+// Reads shuffled minibatches from a dataset file and runs them through a
+// FullyConnectedLayer, first gathering each batch on the training thread
+// and then with a BatchPrefetcher using 1, 2, 4, ... workers.  Reports
+// batches per second and how long the training thread waited for data.
+//
+// Usage: BatchPrefetcherBenchmark [numExamples [numFeatures [batchSize
+//                                 [maxWorkers]]]]
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<2, float> FloatMatrix;
+  typedef FullyConnectedLayer<float, nl::ReLU> Layer;
+  typedef MappedDataset<float> Dataset;
+
+  const uint32_t NUM_OUTPUTS = 256;
+
+  void writeDataset(const std::string& filename, uint32_t numExamples,
+		    uint32_t numFeatures, std::mt19937& rng) {
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    DatasetWriter<float> writer(filename, numFeatures);
+    FloatVector example({ numFeatures }, 0.0f);
+    for (uint32_t i = 0; i < numExamples; ++i) {
+      for (size_t j = 0; j < example.size(); ++j) {
+	example.data()[j] = normal(rng);
+      }
+      writer.append(example);
+    }
+  }
+
+  void report(const std::string& name, size_t numBatches, double seconds,
+	      double waitSeconds) {
+    std::cout << std::setw(12) << name
+	      << std::setw(16) << std::fixed << std::setprecision(1)
+	      << (numBatches / seconds)
+	      << std::setw(14) << std::setprecision(1)
+	      << (100.0 * waitSeconds / seconds) << std::endl;
+  }
+}
+
+int main(int argc, char** argv) {
+  typedef std::chrono::steady_clock Clock;
+  const uint32_t numExamples = (argc > 1) ? atoi(argv[1]) : 65536;
+  const uint32_t numFeatures = (argc > 2) ? atoi(argv[2]) : 512;
+  const size_t batchSize = (argc > 3) ? atoi(argv[3]) : 128;
+  const size_t maxWorkers = (argc > 4) ? atoi(argv[4]) : 4;
+  std::mt19937 rng(1234);
+
+  std::string inputFile("/tmp/neurodidactic-bench-XXXXXX");
+  std::string targetFile("/tmp/neurodidactic-bench-XXXXXX");
+  close(mkstemp(&inputFile[0]));
+  close(mkstemp(&targetFile[0]));
+  writeDataset(inputFile, numExamples, numFeatures, rng);
+  writeDataset(targetFile, numExamples, NUM_OUTPUTS, rng);
+
+  const Dataset inputs(inputFile, Dataset::AccessPattern::RANDOM);
+  const Dataset targets(targetFile, Dataset::AccessPattern::RANDOM);
+  const Layer layer(0, FloatMatrix({ NUM_OUTPUTS, numFeatures }, 0.01f),
+		    FloatVector({ NUM_OUTPUTS }, 0.0f));
+  const size_t numBatches = numExamples / batchSize;
+
+  std::cout << "numExamples=" << numExamples << " numFeatures="
+	    << numFeatures << " batchSize=" << batchSize << std::endl;
+  std::cout << std::setw(12) << "workers" << std::setw(16) << "batches/sec"
+	    << std::setw(14) << "% waiting" << std::endl;
+
+  {
+    std::vector<uint32_t> order(numExamples);
+    std::iota(order.begin(), order.end(), uint32_t(0));
+    std::shuffle(order.begin(), order.end(), rng);
+    FloatMatrix batchInputs({ uint32_t(batchSize), numFeatures }, 0.0f);
+    FloatMatrix batchTargets({ uint32_t(batchSize), NUM_OUTPUTS }, 0.0f);
+    double waitSeconds = 0.0;
+
+    const Clock::time_point start = Clock::now();
+    for (size_t b = 0; b < numBatches; ++b) {
+      const Clock::time_point gatherStart = Clock::now();
+      auto begin = order.begin() + b * batchSize;
+      inputs.gather(begin, begin + batchSize, batchInputs);
+      targets.gather(begin, begin + batchSize, batchTargets);
+      waitSeconds += std::chrono::duration<double>(
+	  Clock::now() - gatherStart
+      ).count();
+      layer.forward(batchInputs);
+    }
+    report("none", numBatches,
+	   std::chrono::duration<double>(Clock::now() - start).count(),
+	   waitSeconds);
+  }
+
+  for (size_t numWorkers = 1; numWorkers <= maxWorkers; numWorkers *= 2) {
+    BatchPrefetcher<float> prefetcher(inputs, targets, batchSize,
+				      numWorkers);
+    const Clock::time_point start = Clock::now();
+    for (size_t b = 0; b < numBatches; ++b) {
+      layer.forward(prefetcher.next().inputs);
+    }
+    report(std::to_string(numWorkers), numBatches,
+	   std::chrono::duration<double>(Clock::now() - start).count(),
+	   prefetcher.stats().totalWaitSeconds);
+  }
+
+  unlink(inputFile.c_str());
+  unlink(targetFile.c_str());
+  return 0;
+}
@@ -0,0 +1,98 @@
+#include <neurodidactic/bench/Report.hpp>
+#include <neurodidactic/bench/Timing.hpp>
+#include <neurodidactic/core/layers/BatchNormLayer.hpp>
+#include <neurodidactic/core/layers/FullyConnectedLayer.hpp>
+#include <neurodidactic/core/layers/Nonlinearities.hpp>
+#include <neurodidactic/core/optimizers/ForwardStateMap.hpp>
+#include <neurodidactic/core/optimizers/SgdOptimizer.hpp>
+
+#include <algorithm>
+#include <random>
+#include <stdlib.h>
+
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::layers;
+using namespace neurodidactic::core::optimizers;
+using neurodidactic::bench::Report;
+using neurodidactic::bench::adaptiveMedianSeconds;
+using neurodidactic::bench::geometricSweep;
+namespace nl = neurodidactic::core::layers::nonlinearities;
+
+// Times a BatchNormLayer with "size" features on its own (training
+// forward, inference forward and backward with the SGD update of the
+// scale and shift), then the inference cost of a square
+// FullyConnectedLayer followed by the batch norm against the same
+// FullyConnectedLayer with the batch norm folded into it.
+//
+// Usage: BatchNormLayerBenchmark [--format=table|csv|json]
+//                                [minSize [maxSize [maxBatch]]]
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<2, float> FloatMatrix;
+  typedef BatchNormLayer<float, nl::ReLU> BatchNorm;
+  typedef FullyConnectedLayer<float, nl::Identity> Linear;
+
+  template <typename Array>
+  Array randomArray(std::mt19937& rng,
+		    const typename Array::DimensionListType& dimensions) {
+    std::normal_distribution<float> normal(0.0f, 0.1f);
+    Array a(dimensions);
+    std::generate(a.begin(), a.end(), [&]() { return normal(rng); });
+    return std::move(a);
+  }
+
+  void benchmark(Report& report, std::mt19937& rng, uint32_t size,
+		 uint32_t batch) {
+    const FloatMatrix input = randomArray<FloatMatrix>(rng, { batch, size });
+    const FloatMatrix lossGradient =
+	randomArray<FloatMatrix>(rng, { batch, size });
+    BatchNorm batchNorm(1, size);
+    ForwardStateMap<float, FloatVector::AllocatorType> forwardState;
+    SgdOptimizer<float> optimizer(0.0f);
+    const double n = double(size) * batch;
+    const double batchBytes = n * sizeof(float);
+
+    report.add("bn train forward", size, batch, adaptiveMedianSeconds([&]() {
+	batchNorm.forward(input, forwardState);
+    }), 6.0 * n, 3 * batchBytes);
+    report.add("bn forward", size, batch, adaptiveMedianSeconds([&]() {
+	batchNorm.forward(input);
+    }), 3.0 * n, 2 * batchBytes);
+
+    batchNorm.forward(input, forwardState);
+    report.add("bn backward", size, batch, adaptiveMedianSeconds([&]() {
+	batchNorm.backward(lossGradient, forwardState, optimizer);
+    }), 12.0 * n, 5 * batchBytes);
+
+    const Linear linear(0, randomArray<FloatMatrix>(rng, { size, size }),
+			randomArray<FloatVector>(rng, { size }));
+    const FullyConnectedLayer<float, nl::ReLU> folded =
+	foldBatchNorm(linear, batchNorm);
+    const double macs = double(size) * size * batch;
+    const double weightBytes = double(size) * size * sizeof(float);
+
+    report.add("fc+bn forward", size, batch, adaptiveMedianSeconds([&]() {
+	batchNorm.forward(linear.forward(input));
+    }), 2.0 * macs + 3.0 * n, weightBytes + 4 * batchBytes);
+    report.add("folded forward", size, batch, adaptiveMedianSeconds([&]() {
+	folded.forward(input);
+    }), 2.0 * macs, weightBytes + 2 * batchBytes);
+  }
+}
+
+int main(int argc, char** argv) {
+  Report report("BatchNormLayerBenchmark", Report::parseFormat(argc, argv));
+  const size_t minSize = (argc > 1) ? atoi(argv[1]) : 64;
+  const size_t maxSize = (argc > 2) ? atoi(argv[2]) : 4096;
+  const size_t maxBatch = (argc > 3) ? atoi(argv[3]) : 1024;
+  std::mt19937 rng(1234);
+
+  for (size_t size : geometricSweep(minSize, maxSize, 4)) {
+    for (size_t batch : geometricSweep(16, maxBatch, 4)) {
+      benchmark(report, rng, size, batch);
+    }
+  }
+  report.write();
+  return 0;
+}
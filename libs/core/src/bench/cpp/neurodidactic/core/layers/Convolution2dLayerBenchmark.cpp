@@ -0,0 +1,120 @@
+#include <neurodidactic/bench/Report.hpp>
+#include <neurodidactic/bench/Timing.hpp>
+#include <neurodidactic/core/layers/Convolution2dLayer.hpp>
+#include <neurodidactic/core/layers/Nonlinearities.hpp>
+#include <neurodidactic/core/optimizers/ForwardStateMap.hpp>
+#include <neurodidactic/core/optimizers/SgdOptimizer.hpp>
+
+#include <algorithm>
+#include <random>
+#include <stdlib.h>
+
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::layers;
+using namespace neurodidactic::core::optimizers;
+using neurodidactic::bench::Report;
+using neurodidactic::bench::adaptiveMedianSeconds;
+using neurodidactic::bench::geometricSweep;
+namespace nl = neurodidactic::core::layers::nonlinearities;
+
+// Times forward and backward propagation through a Convolution2dLayer
+// with 3x3 kernels, stride 1 and padding 1 over square "size" x "size"
+// images, with "channels" input and output channels.  Backward
+// propagation includes the SGD update of the weights.  "forward+pool"
+// is forward propagation followed by a separate 2x2 max pooling pass,
+// and "fused pool" is the same computation done by forwardAndPool().
+//
+// Usage: Convolution2dLayerBenchmark [--format=table|csv|json]
+//                                    [minSize [maxSize [maxBatch
+//                                    [channels]]]]
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<4, float> FloatArray4;
+  typedef Convolution2dLayer<float, nl::ReLU> Layer;
+
+  const uint32_t KERNEL_SIZE = 3;
+
+  template <typename Array>
+  Array randomArray(std::mt19937& rng,
+		    const typename Array::DimensionListType& dimensions) {
+    std::normal_distribution<float> normal(0.0f, 0.1f);
+    Array a(dimensions);
+    std::generate(a.begin(), a.end(), [&]() { return normal(rng); });
+    return std::move(a);
+  }
+
+  FloatArray4 maxPool2x2(const FloatArray4& a) {
+    const uint32_t h = a.dimensions()[2], w = a.dimensions()[3];
+    const size_t planes = size_t(a.dimensions()[0]) * a.dimensions()[1];
+    FloatArray4 pooled({ a.dimensions()[0], a.dimensions()[1], h / 2,
+			 w / 2 });
+    float* dest = pooled.data();
+    for (size_t plane = 0; plane < planes; ++plane) {
+      const float* src = a.data() + plane * h * w;
+      for (uint32_t p = 0; p < h / 2; ++p) {
+	for (uint32_t q = 0; q < w / 2; ++q) {
+	  const float* x = src + 2 * p * w + 2 * q;
+	  *dest++ = std::max(std::max(x[0], x[1]),
+			     std::max(x[w], x[w + 1]));
+	}
+      }
+    }
+    return std::move(pooled);
+  }
+
+  void benchmark(Report& report, Layer& layer, const FloatArray4& input,
+		 const FloatArray4& lossGradient, uint32_t size,
+		 uint32_t batch) {
+    ForwardStateMap<float, FloatVector::AllocatorType> forwardState;
+    SgdOptimizer<float> optimizer(0.0f);
+    const double macs = double(batch) * layer.outputChannels() *
+			    layer.inputChannels() * KERNEL_SIZE *
+			    KERNEL_SIZE * size * size;
+    const double weightBytes = layer.weights().size() * sizeof(float);
+    const double imageBytes = input.size() * sizeof(float);
+
+    report.add("forward", size, batch, adaptiveMedianSeconds([&]() {
+	layer.forward(input);
+    }), 2.0 * macs, weightBytes + 2 * imageBytes);
+
+    report.add("forward+pool", size, batch, adaptiveMedianSeconds([&]() {
+	maxPool2x2(layer.forward(input));
+    }), 2.0 * macs, weightBytes + 3.25 * imageBytes);
+
+    report.add("fused pool", size, batch, adaptiveMedianSeconds([&]() {
+	layer.forwardAndPool(input);
+    }), 2.0 * macs, weightBytes + 1.25 * imageBytes);
+
+    layer.forward(input, forwardState);
+    report.add("backward", size, batch, adaptiveMedianSeconds([&]() {
+	layer.backward(lossGradient, forwardState, optimizer);
+    }), 4.0 * macs, 4 * weightBytes + 4 * imageBytes);
+  }
+}
+
+int main(int argc, char** argv) {
+  Report report("Convolution2dLayerBenchmark",
+		Report::parseFormat(argc, argv));
+  const size_t minSize = (argc > 1) ? atoi(argv[1]) : 8;
+  const size_t maxSize = (argc > 2) ? atoi(argv[2]) : 128;
+  const size_t maxBatch = (argc > 3) ? atoi(argv[3]) : 64;
+  const uint32_t channels = (argc > 4) ? atoi(argv[4]) : 32;
+  std::mt19937 rng(1234);
+
+  Layer layer(0, randomArray<FloatArray4>(
+		     rng, { channels, channels, KERNEL_SIZE, KERNEL_SIZE }
+		 ),
+	      randomArray<FloatVector>(rng, { channels }), 1, 1);
+  for (size_t size : geometricSweep(minSize, maxSize, 2)) {
+    for (size_t batch : geometricSweep(1, maxBatch, 4)) {
+      const uint32_t n = size;
+      const uint32_t b = batch;
+      benchmark(report, layer,
+		randomArray<FloatArray4>(rng, { b, channels, n, n }),
+		randomArray<FloatArray4>(rng, { b, channels, n, n }), n, b);
+    }
+  }
+  report.write();
+  return 0;
+}
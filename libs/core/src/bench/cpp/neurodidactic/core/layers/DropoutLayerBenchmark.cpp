@@ -0,0 +1,81 @@
+#include <neurodidactic/bench/Report.hpp>
+#include <neurodidactic/bench/Timing.hpp>
+#include <neurodidactic/core/layers/DropoutLayer.hpp>
+#include <neurodidactic/core/optimizers/ForwardStateMap.hpp>
+#include <neurodidactic/core/optimizers/SgdOptimizer.hpp>
+
+#include <algorithm>
+#include <random>
+#include <stdlib.h>
+
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::layers;
+using namespace neurodidactic::core::optimizers;
+using neurodidactic::bench::Report;
+using neurodidactic::bench::adaptiveMedianSeconds;
+using neurodidactic::bench::geometricSweep;
+
+// Times training forward and backward propagation through a
+// DropoutLayer over a [batch, size] matrix, against a scalar dropout
+// that draws each element from std::mt19937 and keeps a mask of floats.
+//
+// Usage: DropoutLayerBenchmark [--format=table|csv|json]
+//                              [minSize [maxSize [maxBatch]]]
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<2, float> FloatMatrix;
+
+  FloatMatrix randomMatrix(std::mt19937& rng, uint32_t rows,
+			   uint32_t columns) {
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    FloatMatrix a(FloatMatrix::DimensionListType({ rows, columns }));
+    std::generate(a.begin(), a.end(), [&]() { return normal(rng); });
+    return std::move(a);
+  }
+
+  void benchmark(Report& report, std::mt19937& rng, uint32_t size,
+		 uint32_t batch) {
+    const FloatMatrix input = randomMatrix(rng, batch, size);
+    const FloatMatrix lossGradient = randomMatrix(rng, batch, size);
+    DropoutLayer<float> layer(0, 0.5f, 1234);
+    ForwardStateMap<float, FloatVector::AllocatorType> forwardState;
+    SgdOptimizer<float> optimizer(0.0f);
+    const double n = double(size) * batch;
+    const double bytes = 2 * n * sizeof(float) + n / 8;
+
+    report.add("forward", size, batch, adaptiveMedianSeconds([&]() {
+	layer.forward(input, forwardState);
+    }), n, bytes);
+    report.add("backward", size, batch, adaptiveMedianSeconds([&]() {
+	layer.backward(lossGradient, forwardState, optimizer);
+    }), n, bytes);
+
+    std::mt19937 scalarRng(1234);
+    std::bernoulli_distribution keep(0.5);
+    FloatMatrix mask(input.dimensions());
+    FloatMatrix output(input.dimensions());
+    report.add("scalar forward", size, batch, adaptiveMedianSeconds([&]() {
+	for (size_t i = 0; i < input.size(); ++i) {
+	  mask.data()[i] = keep(scalarRng) ? 2.0f : 0.0f;
+	  output.data()[i] = input.data()[i] * mask.data()[i];
+	}
+    }), n, 3 * n * sizeof(float));
+  }
+}
+
+int main(int argc, char** argv) {
+  Report report("DropoutLayerBenchmark", Report::parseFormat(argc, argv));
+  const size_t minSize = (argc > 1) ? atoi(argv[1]) : 256;
+  const size_t maxSize = (argc > 2) ? atoi(argv[2]) : 16384;
+  const size_t maxBatch = (argc > 3) ? atoi(argv[3]) : 1024;
+  std::mt19937 rng(1234);
+
+  for (size_t size : geometricSweep(minSize, maxSize, 4)) {
+    for (size_t batch : geometricSweep(16, maxBatch, 4)) {
+      benchmark(report, rng, size, batch);
+    }
+  }
+  report.write();
+  return 0;
+}
@@ -0,0 +1,101 @@
+#include <neurodidactic/bench/Report.hpp>
+#include <neurodidactic/bench/Timing.hpp>
+#include <neurodidactic/core/layers/FullyConnectedLayer.hpp>
+#include <neurodidactic/core/layers/Nonlinearities.hpp>
+#include <neurodidactic/core/optimizers/ForwardStateMap.hpp>
+#include <neurodidactic/core/optimizers/SgdOptimizer.hpp>
+#include <neurodidactic/core/profiling/KernelAccounting.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <stdlib.h>
+
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::layers;
+using namespace neurodidactic::core::optimizers;
+using namespace neurodidactic::core::profiling;
+using neurodidactic::bench::Report;
+using neurodidactic::bench::adaptiveMedianSeconds;
+using neurodidactic::bench::geometricSweep;
+namespace nl = neurodidactic::core::layers::nonlinearities;
+
+// Times forward and backward propagation through a square
+// FullyConnectedLayer with "size" inputs and outputs.  A batch size of 1
+// uses the single-vector methods; larger batches use the minibatch
+// methods.  Backward propagation includes the SGD update of the weights.
+// Built with NEURODIDACTIC_KERNEL_ACCOUNTING, it also writes the FLOPs,
+// bytes and achieved rates of the MklAdapter kernels to stderr.
+//
+// Usage: FullyConnectedLayerBenchmark [--format=table|csv|json]
+//                                     [minSize [maxSize [maxBatch]]]
+//
+// maxSize defaults to 4096.  A layer of size 16384 holds a 1 GB weight
+// matrix, so larger layers only run when maxSize asks for them.
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<2, float> FloatMatrix;
+  typedef FullyConnectedLayer<float, nl::ReLU> Layer;
+
+  template <typename Array>
+  Array randomArray(std::mt19937& rng,
+		    const typename Array::DimensionListType& dimensions) {
+    std::normal_distribution<float> normal(0.0f, 0.1f);
+    Array a(dimensions);
+    std::generate(a.begin(), a.end(), [&]() { return normal(rng); });
+    return std::move(a);
+  }
+
+  template <typename Input, typename Output>
+  void benchmark(Report& report, Layer& layer, const Input& input,
+		 const Output& lossGradient, uint32_t size, uint32_t batch) {
+    ForwardStateMap<float, FloatVector::AllocatorType> forwardState;
+    SgdOptimizer<float> optimizer(0.0f);
+    const double n = double(size);
+    const double weightBytes = n * n * sizeof(float);
+    const double batchBytes = batch * n * sizeof(float);
+
+    report.add("forward", size, batch, adaptiveMedianSeconds([&]() {
+	layer.forward(input);
+    }), 2.0 * batch * n * n, weightBytes + 2 * batchBytes);
+
+    layer.forward(input, forwardState);
+    report.add("backward", size, batch, adaptiveMedianSeconds([&]() {
+	layer.backward(lossGradient, forwardState, optimizer);
+    }), 4.0 * batch * n * n + 2.0 * n * n,
+	       4 * weightBytes + 4 * batchBytes);
+  }
+}
+
+int main(int argc, char** argv) {
+  Report report("FullyConnectedLayerBenchmark",
+		Report::parseFormat(argc, argv));
+  const size_t minSize = (argc > 1) ? atoi(argv[1]) : 64;
+  const size_t maxSize = (argc > 2) ? atoi(argv[2]) : 4096;
+  const size_t maxBatch = (argc > 3) ? atoi(argv[3]) : 1024;
+  std::mt19937 rng(1234);
+
+  for (size_t size : geometricSweep(minSize, maxSize, 4)) {
+    const uint32_t n = size;
+    Layer layer(0, randomArray<FloatMatrix>(rng, { n, n }),
+		randomArray<FloatVector>(rng, { n }));
+
+    for (size_t batch : geometricSweep(1, maxBatch, 4)) {
+      if (batch == 1) {
+	benchmark(report, layer, randomArray<FloatVector>(rng, { n }),
+		  randomArray<FloatVector>(rng, { n }), n, 1);
+      } else {
+	const uint32_t b = batch;
+	benchmark(report, layer, randomArray<FloatMatrix>(rng, { b, n }),
+		  randomArray<FloatMatrix>(rng, { b, n }), n, b);
+      }
+    }
+  }
+  report.write();
+  if (KernelAccounting::enabled()) {
+    KernelAccounting::write(std::cerr);
+    KernelAccounting::writeSizeHistograms(std::cerr);
+  }
+  return 0;
+}
@@ -0,0 +1,63 @@
+#include <neurodidactic/bench/Report.hpp>
+#include <neurodidactic/bench/Timing.hpp>
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/layers/Initializers.hpp>
+
+#include <algorithm>
+#include <random>
+#include <stdlib.h>
+
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::layers::initializers;
+using neurodidactic::bench::Report;
+using neurodidactic::bench::adaptiveMedianSeconds;
+using neurodidactic::bench::geometricSweep;
+
+// Times drawing a square [size, size] weight matrix with each
+// initializer, against filling it from std::mt19937 and
+// std::normal_distribution one element at a time.  The orthogonal
+// initializer, which needs a QR decomposition, only runs up to
+// maxOrthogonal.
+//
+// Usage: InitializersBenchmark [--format=table|csv|json]
+//                              [minSize [maxSize [maxOrthogonal]]]
+
+namespace {
+  typedef MdArray<2, float> FloatMatrix;
+
+  template <typename Initializer>
+  void benchmark(Report& report, const char* name, const Initializer& init,
+		 FloatMatrix& weights, size_t size, double flopsPerElement) {
+    report.add(name, size, 1, adaptiveMedianSeconds([&]() {
+	init(weights, 0);
+    }), flopsPerElement * weights.size(), weights.size() * sizeof(float));
+  }
+}
+
+int main(int argc, char** argv) {
+  Report report("InitializersBenchmark", Report::parseFormat(argc, argv));
+  const size_t minSize = (argc > 1) ? atoi(argv[1]) : 256;
+  const size_t maxSize = (argc > 2) ? atoi(argv[2]) : 8192;
+  const size_t maxOrthogonal = (argc > 3) ? atoi(argv[3]) : 2048;
+
+  for (size_t size : geometricSweep(minSize, maxSize, 2)) {
+    const uint32_t n = size;
+    FloatMatrix weights(FloatMatrix::DimensionListType({ n, n }));
+    std::mt19937 rng(1234);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+
+    report.add("scalar normal", size, 1, adaptiveMedianSeconds([&]() {
+	std::generate(weights.begin(), weights.end(),
+		      [&]() { return normal(rng); });
+    }), 0.0, weights.size() * sizeof(float));
+    benchmark(report, "xavier uniform", XavierUniform(1234), weights, size,
+	      2.0);
+    benchmark(report, "he normal", HeNormal(1234), weights, size, 0.0);
+    if (size <= maxOrthogonal) {
+      benchmark(report, "orthogonal", Orthogonal(1234), weights, size,
+		4.0 * size / 3.0);
+    }
+  }
+  report.write();
+  return 0;
+}
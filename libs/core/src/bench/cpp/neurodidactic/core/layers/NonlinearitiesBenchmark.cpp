@@ -0,0 +1,65 @@
+#include <neurodidactic/bench/Report.hpp>
+#include <neurodidactic/bench/Timing.hpp>
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/layers/Nonlinearities.hpp>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <stdlib.h>
+
+using namespace neurodidactic::core::arrays;
+using neurodidactic::bench::Report;
+using neurodidactic::bench::adaptiveMedianSeconds;
+using neurodidactic::bench::geometricSweep;
+namespace nl = neurodidactic::core::layers::nonlinearities;
+
+// Times each nonlinearity and its gradient on [batch, size] activations.
+// FLOPs are counted as one per element, so GFLOP/s is the number of
+// elements processed per nanosecond.  Identity is left out, since it
+// returns its argument without touching it.
+//
+// Usage: NonlinearitiesBenchmark [--format=table|csv|json]
+//                                [minSize [maxSize [maxBatch]]]
+//
+// maxSize defaults to 4096, like the rest of the benchmark suite.
+
+namespace {
+  typedef MdArray<2, float> FloatMatrix;
+
+  template <typename Nonlinearity>
+  void benchmark(Report& report, const std::string& name,
+		 const FloatMatrix& x, uint32_t size, uint32_t batch) {
+    const Nonlinearity f;
+    const double n = double(x.size());
+    const double b = double(x.size() * sizeof(float));
+
+    report.add(name, size, batch,
+	       adaptiveMedianSeconds([&]() { f(x); }), n, 2 * b);
+    report.add(name + " gradient", size, batch,
+	       adaptiveMedianSeconds([&]() { f.gradient(x); }), n, 2 * b);
+  }
+}
+
+int main(int argc, char** argv) {
+  Report report("NonlinearitiesBenchmark", Report::parseFormat(argc, argv));
+  const size_t minSize = (argc > 1) ? atoi(argv[1]) : 64;
+  const size_t maxSize = (argc > 2) ? atoi(argv[2]) : 4096;
+  const size_t maxBatch = (argc > 3) ? atoi(argv[3]) : 1024;
+  std::mt19937 rng(1234);
+  std::normal_distribution<float> normal(0.0f, 2.0f);
+
+  for (size_t size : geometricSweep(minSize, maxSize, 4)) {
+    for (size_t batch : geometricSweep(1, maxBatch, 4)) {
+      FloatMatrix x(FloatMatrix::DimensionListType({ uint32_t(batch),
+						     uint32_t(size) }));
+      std::generate(x.begin(), x.end(), [&]() { return normal(rng); });
+
+      benchmark<nl::ReLU>(report, "ReLU", x, size, batch);
+      benchmark<nl::Sigmoid>(report, "Sigmoid", x, size, batch);
+      benchmark<nl::TanH>(report, "TanH", x, size, batch);
+    }
+  }
+  report.write();
+  return 0;
+}
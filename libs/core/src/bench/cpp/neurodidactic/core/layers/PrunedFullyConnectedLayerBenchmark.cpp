@@ -0,0 +1,80 @@
+#include <neurodidactic/bench/Timing.hpp>
+#include <neurodidactic/core/layers/FullyConnectedLayer.hpp>
+#include <neurodidactic/core/layers/Nonlinearities.hpp>
+#include <neurodidactic/core/layers/PrunedFullyConnectedLayer.hpp>
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdlib.h>
+
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::layers;
+namespace nl = neurodidactic::core::layers::nonlinearities;
+
+// Compares inference throughput of a dense FullyConnectedLayer against
+// its compacted PrunedFullyConnectedLayer as the fraction of pruned
+// weights grows.
+//
+// Usage: PrunedFullyConnectedLayerBenchmark [width [batchSize]]
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<2, float> FloatMatrix;
+  typedef FullyConnectedLayer<float, nl::ReLU> DenseLayer;
+  typedef PrunedFullyConnectedLayer<float, nl::ReLU> PrunedLayer;
+
+  FloatMatrix randomMatrix(std::mt19937& rng, uint32_t rows,
+			   uint32_t columns, double sparsity) {
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::bernoulli_distribution pruned(sparsity);
+    FloatMatrix m({ rows, columns }, 0.0f);
+    for (size_t i = 0; i < m.size(); ++i) {
+      m.data()[i] = pruned(rng) ? 0.0f : dist(rng);
+    }
+    return std::move(m);
+  }
+
+  template <typename Layer>
+  void measure(const Layer& layer, const FloatMatrix& inputs,
+	       double& vectorsPerSecond, double& rowsPerSecond) {
+    FloatVector x({ inputs.dimensions()[1] }, inputs.data());
+    vectorsPerSecond = 1.0 / neurodidactic::bench::medianSeconds(
+	[&]() { layer.forward(x); }, 2, 20
+    );
+    rowsPerSecond = inputs.dimensions()[0] /
+	neurodidactic::bench::medianSeconds(
+	    [&]() { layer.forward(inputs); }, 2, 10
+	);
+  }
+}
+
+int main(int argc, char** argv) {
+  const uint32_t width = (argc > 1) ? atoi(argv[1]) : 4096;
+  const uint32_t batchSize = (argc > 2) ? atoi(argv[2]) : 64;
+  std::mt19937 rng(1234);
+  const FloatMatrix inputs = randomMatrix(rng, batchSize, width, 0.0);
+
+  std::cout << "width=" << width << " batchSize=" << batchSize << std::endl;
+  std::cout << std::setw(10) << "sparsity" << std::setw(16) << "dense vec/s"
+	    << std::setw(16) << "pruned vec/s" << std::setw(16)
+	    << "dense rows/s" << std::setw(16) << "pruned rows/s"
+	    << std::endl;
+  for (double sparsity : { 0.5, 0.8, 0.9, 0.95, 0.99 }) {
+    DenseLayer dense(1, randomMatrix(rng, width, width, sparsity),
+		     FloatVector({ width }, 0.0f));
+    PrunedLayer pruned(dense);
+    double denseVectors, denseRows, prunedVectors, prunedRows;
+
+    measure(dense, inputs, denseVectors, denseRows);
+    measure(pruned, inputs, prunedVectors, prunedRows);
+    std::cout << std::setw(10) << std::fixed << std::setprecision(2)
+	      << sparsity << std::setprecision(1)
+	      << std::setw(16) << denseVectors
+	      << std::setw(16) << prunedVectors
+	      << std::setw(16) << denseRows
+	      << std::setw(16) << prunedRows << std::endl;
+  }
+  return 0;
+}
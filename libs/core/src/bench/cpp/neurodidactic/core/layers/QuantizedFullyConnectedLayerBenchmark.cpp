@@ -0,0 +1,86 @@
+#include <neurodidactic/bench/Timing.hpp>
+#include <neurodidactic/core/layers/FullyConnectedLayer.hpp>
+#include <neurodidactic/core/layers/Nonlinearities.hpp>
+#include <neurodidactic/core/layers/QuantizedFullyConnectedLayer.hpp>
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <stdlib.h>
+
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::layers;
+namespace nl = neurodidactic::core::layers::nonlinearities;
+
+// Compares inference throughput and output error of a float
+// FullyConnectedLayer against the same layer quantized to int8.
+//
+// Usage: QuantizedFullyConnectedLayerBenchmark [width [batchSize]]
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<2, float> FloatMatrix;
+  typedef FullyConnectedLayer<float, nl::ReLU> FloatLayer;
+
+  FloatMatrix randomMatrix(std::mt19937& rng, uint32_t rows,
+			   uint32_t columns, float scale) {
+    std::uniform_real_distribution<float> dist(-scale, scale);
+    FloatMatrix m({ rows, columns }, 0.0f);
+    for (size_t i = 0; i < m.size(); ++i) {
+      m.data()[i] = dist(rng);
+    }
+    return std::move(m);
+  }
+
+  template <typename Layer>
+  void measure(const std::string& name, const Layer& layer,
+	       const FloatMatrix& inputs, const FloatMatrix& expected) {
+    const uint32_t batchSize = inputs.dimensions()[0];
+    FloatVector x({ inputs.dimensions()[1] }, inputs.data());
+    const double gemvSeconds = neurodidactic::bench::medianSeconds(
+	[&]() { layer.forward(x); }, 2, 20
+    );
+    const double gemmSeconds = neurodidactic::bench::medianSeconds(
+	[&]() { layer.forward(inputs); }, 2, 10
+    );
+    const FloatMatrix actual = layer.forward(inputs);
+    float maxError = 0.0f;
+    double totalError = 0.0;
+    for (size_t i = 0; i < expected.size(); ++i) {
+      const float error = std::fabs(expected.data()[i] - actual.data()[i]);
+      maxError = std::max(maxError, error);
+      totalError += error;
+    }
+
+    std::cout << std::setw(8) << name
+	      << std::setw(16) << std::fixed << std::setprecision(1)
+	      << (1.0 / gemvSeconds)
+	      << std::setw(16) << (batchSize / gemmSeconds)
+	      << std::setw(14) << std::scientific << std::setprecision(2)
+	      << maxError << std::setw(14) << (totalError / expected.size())
+	      << std::endl;
+  }
+}
+
+int main(int argc, char** argv) {
+  const uint32_t width = (argc > 1) ? atoi(argv[1]) : 4096;
+  const uint32_t batchSize = (argc > 2) ? atoi(argv[2]) : 64;
+  std::mt19937 rng(1234);
+
+  FloatLayer layer(1, randomMatrix(rng, width, width,
+				   1.0f / std::sqrt(float(width))),
+		   FloatVector({ width }, 0.0f));
+  FloatMatrix inputs = randomMatrix(rng, batchSize, width, 1.0f);
+  FloatMatrix expected = layer.forward(inputs);
+
+  std::cout << "width=" << width << " batchSize=" << batchSize << std::endl;
+  std::cout << std::setw(8) << "weights" << std::setw(16) << "vectors/sec"
+	    << std::setw(16) << "batch rows/sec" << std::setw(14)
+	    << "max error" << std::setw(14) << "mean error" << std::endl;
+  measure("fp32", layer, inputs, expected);
+  measure("int8", QuantizedFullyConnectedLayer<nl::ReLU>(layer), inputs,
+	  expected);
+  return 0;
+}
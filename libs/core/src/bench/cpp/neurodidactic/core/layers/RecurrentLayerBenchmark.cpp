@@ -0,0 +1,88 @@
+#include <neurodidactic/bench/Report.hpp>
+#include <neurodidactic/bench/Timing.hpp>
+#include <neurodidactic/core/layers/RecurrentLayer.hpp>
+#include <neurodidactic/core/optimizers/ForwardStateMap.hpp>
+#include <neurodidactic/core/optimizers/SgdOptimizer.hpp>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <stdlib.h>
+
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::layers;
+using namespace neurodidactic::core::optimizers;
+using neurodidactic::bench::Report;
+using neurodidactic::bench::adaptiveMedianSeconds;
+using neurodidactic::bench::geometricSweep;
+
+// Times forward and backward propagation through LSTM and GRU layers
+// over "steps" timesteps, with as many inputs as hidden units.
+// Backward propagation includes the SGD update of the weights.
+//
+// Usage: RecurrentLayerBenchmark [--format=table|csv|json]
+//                                [minHidden [maxHidden [maxBatch [steps]]]]
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<2, float> FloatMatrix;
+  typedef MdArray<3, float> FloatArray3;
+
+  template <typename Array>
+  Array randomArray(std::mt19937& rng,
+		    const typename Array::DimensionListType& dimensions) {
+    std::normal_distribution<float> normal(0.0f, 0.1f);
+    Array a(dimensions);
+    std::generate(a.begin(), a.end(), [&]() { return normal(rng); });
+    return std::move(a);
+  }
+
+  template <typename Layer>
+  void benchmark(Report& report, const std::string& name,
+		 std::mt19937& rng, uint32_t hidden, uint32_t batch,
+		 uint32_t steps) {
+    const uint32_t width = Layer::CellType::GATES * hidden;
+    Layer layer(0, randomArray<FloatMatrix>(rng, { width, hidden }),
+		randomArray<FloatMatrix>(rng, { width, hidden }),
+		randomArray<FloatVector>(rng, { width }));
+    const FloatArray3 input =
+	randomArray<FloatArray3>(rng, { steps, batch, hidden });
+    const FloatArray3 lossGradient =
+	randomArray<FloatArray3>(rng, { steps, batch, hidden });
+    ForwardStateMap<float, FloatVector::AllocatorType> forwardState;
+    SgdOptimizer<float> optimizer(0.0f);
+    const double macs = 2.0 * steps * batch * width * hidden;
+    const double weightBytes = 2.0 * width * hidden * sizeof(float);
+    const double sequenceBytes = input.size() * sizeof(float);
+
+    report.add(name + " forward", hidden, batch,
+	       adaptiveMedianSeconds([&]() { layer.forward(input); }),
+	       2.0 * macs, weightBytes + 2 * sequenceBytes);
+
+    layer.forward(input, forwardState);
+    report.add(name + " backward", hidden, batch,
+	       adaptiveMedianSeconds([&]() {
+		   layer.backward(lossGradient, forwardState, optimizer);
+	       }),
+	       4.0 * macs, 4 * weightBytes + 4 * sequenceBytes);
+  }
+}
+
+int main(int argc, char** argv) {
+  Report report("RecurrentLayerBenchmark", Report::parseFormat(argc, argv));
+  const size_t minHidden = (argc > 1) ? atoi(argv[1]) : 64;
+  const size_t maxHidden = (argc > 2) ? atoi(argv[2]) : 1024;
+  const size_t maxBatch = (argc > 3) ? atoi(argv[3]) : 64;
+  const uint32_t steps = (argc > 4) ? atoi(argv[4]) : 32;
+  std::mt19937 rng(1234);
+
+  for (size_t hidden : geometricSweep(minHidden, maxHidden, 4)) {
+    for (size_t batch : geometricSweep(1, maxBatch, 8)) {
+      benchmark<LstmLayer<float> >(report, "lstm", rng, hidden, batch,
+				   steps);
+      benchmark<GruLayer<float> >(report, "gru", rng, hidden, batch, steps);
+    }
+  }
+  report.write();
+  return 0;
+}
@@ -0,0 +1,82 @@
+#include <neurodidactic/bench/Timing.hpp>
+#include <neurodidactic/core/arrays/SparseVector.hpp>
+#include <neurodidactic/core/layers/FullyConnectedLayer.hpp>
+#include <neurodidactic/core/layers/Nonlinearities.hpp>
+#include <neurodidactic/core/optimizers/ForwardStateMap.hpp>
+#include <neurodidactic/core/optimizers/SgdOptimizer.hpp>
+
+#include <iostream>
+#include <random>
+#include <set>
+#include <stdlib.h>
+
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::layers;
+using namespace neurodidactic::core::optimizers;
+namespace nl = neurodidactic::core::layers::nonlinearities;
+
+// Times forward and backward propagation through a FullyConnectedLayer
+// with a wide, sparse input, fed as a dense vector and as a SparseVector.
+//
+// Usage: SparseInputBenchmark [numInputs [numOutputs [numNonZeros]]]
+
+int main(int argc, char** argv) {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<2, float> FloatMatrix;
+  typedef FullyConnectedLayer<float, nl::ReLU> Layer;
+
+  const uint32_t numInputs = (argc > 1) ? atoi(argv[1]) : 1000000;
+  const uint32_t numOutputs = (argc > 2) ? atoi(argv[2]) : 64;
+  const uint32_t numNonZeros = (argc > 3) ? atoi(argv[3]) : 50;
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<uint32_t> feature(0, numInputs - 1);
+  std::set<uint32_t> features;
+
+  while (features.size() < numNonZeros) {
+    features.insert(feature(rng));
+  }
+
+  SparseVector<float> sparseInput(numInputs);
+  for (uint32_t i : features) {
+    sparseInput.append(i, 1.0f);
+  }
+  const FloatVector denseInput = sparseInput.toDense();
+  const FloatVector lossGradient({ numOutputs }, 1.0f);
+  Layer layer(1, FloatMatrix({ numOutputs, numInputs }, 0.01f),
+	      FloatVector({ numOutputs }, 0.1f));
+  ForwardStateMap<float, FloatVector::AllocatorType> forwardState;
+  SgdOptimizer<float> optimizer(1e-6f);
+
+  const double denseForward = neurodidactic::bench::medianSeconds(
+      [&]() { layer.forward(denseInput); }, 2, 10
+  );
+  const double sparseForward = neurodidactic::bench::medianSeconds(
+      [&]() { layer.forward(sparseInput); }, 2, 10
+  );
+  const double denseStep = neurodidactic::bench::medianSeconds(
+      [&]() {
+	layer.forward(denseInput, forwardState);
+	layer.backward(lossGradient, forwardState, optimizer);
+      },
+      1, 5
+  );
+  const double sparseStep = neurodidactic::bench::medianSeconds(
+      [&]() {
+	layer.forward(sparseInput, forwardState);
+	layer.backward(lossGradient, forwardState, optimizer, sparseInput);
+      },
+      1, 5
+  );
+
+  std::cout << "numInputs=" << numInputs << " numOutputs=" << numOutputs
+	    << " numNonZeros=" << numNonZeros << std::endl;
+  std::cout << "dense forward:  " << (denseForward * 1e6) << " us"
+	    << std::endl;
+  std::cout << "sparse forward: " << (sparseForward * 1e6) << " us"
+	    << std::endl;
+  std::cout << "dense step:     " << (denseStep * 1e6) << " us"
+	    << std::endl;
+  std::cout << "sparse step:    " << (sparseStep * 1e6) << " us"
+	    << std::endl;
+  return 0;
+}
@@ -0,0 +1,48 @@
+#include <neurodidactic/bench/Timing.hpp>
+#include <neurodidactic/core/profiling/Tracer.hpp>
+
+#include <iomanip>
+#include <iostream>
+#include <stdlib.h>
+
+using namespace neurodidactic::core::profiling;
+
+// Measures the cost of one TraceScope with tracing disabled and enabled,
+// in nanoseconds per span.  The disabled cost is what every hook adds
+// to a build with NEURODIDACTIC_TRACING defined when nobody is tracing.
+//
+// Usage: TracerBenchmark [spansPerRepetition]
+
+namespace {
+  void report(const char* name, double seconds, size_t numSpans) {
+    std::cout << std::setw(12) << name << std::setw(14) << std::fixed
+	      << std::setprecision(2) << (seconds * 1e9 / numSpans)
+	      << std::endl;
+  }
+}
+
+int main(int argc, char** argv) {
+  const size_t numSpans = (argc > 1) ? atoi(argv[1]) : 100000;
+  volatile uint32_t layerId = 0;
+  auto traceSpans = [numSpans, &layerId]() {
+    for (size_t i = 0; i < numSpans; ++i) {
+      TraceScope scope("span", layerId);
+    }
+  };
+
+  std::cout << std::setw(12) << "tracing" << std::setw(14) << "ns/span"
+	    << std::endl;
+
+  Tracer::disable();
+  report("disabled",
+	 neurodidactic::bench::medianSeconds(traceSpans, 3, 21), numSpans);
+
+  Tracer::enable();
+  report("enabled",
+	 neurodidactic::bench::medianSeconds(
+	     [&traceSpans]() { traceSpans(); Tracer::clear(); }, 3, 21
+	 ),
+	 numSpans);
+  Tracer::disable();
+  return 0;
+}
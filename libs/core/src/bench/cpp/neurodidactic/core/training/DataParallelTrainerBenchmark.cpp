@@ -0,0 +1,104 @@
+#include <neurodidactic/bench/Timing.hpp>
+#include <neurodidactic/core/layers/FullyConnectedLayer.hpp>
+#include <neurodidactic/core/layers/Nonlinearities.hpp>
+#include <neurodidactic/core/optimizers/SgdOptimizer.hpp>
+#include <neurodidactic/core/training/DataParallelTrainer.hpp>
+
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <stdlib.h>
+
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::layers;
+using namespace neurodidactic::core::optimizers;
+using namespace neurodidactic::core::training;
+namespace nl = neurodidactic::core::layers::nonlinearities;
+
+// Trains a two-layer perceptron on random data with 1, 2, 4, ... threads
+// and reports throughput and scaling efficiency relative to one thread.
+//
+// Usage: DataParallelTrainerBenchmark [width [batchSize [maxThreads]]]
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<2, float> FloatMatrix;
+  typedef FullyConnectedLayer<float, nl::ReLU> HiddenLayer;
+  typedef FullyConnectedLayer<float, nl::Identity> OutputLayer;
+  typedef DataParallelTrainer<float> FloatTrainer;
+
+  FloatMatrix randomMatrix(std::mt19937& rng, uint32_t rows,
+			   uint32_t columns, float scale) {
+    std::uniform_real_distribution<float> dist(-scale, scale);
+    FloatMatrix m({ rows, columns }, 0.0f);
+    for (size_t i = 0; i < m.size(); ++i) {
+      m.data()[i] = dist(rng);
+    }
+    return std::move(m);
+  }
+
+  struct MlpStep {
+    HiddenLayer& hidden;
+    OutputLayer& output;
+
+    float operator()(const FloatMatrix& inputs, const FloatMatrix& targets,
+		     FloatTrainer::ForwardStateType& forwardState,
+		     FloatTrainer::AccumulatorType& gradients) const {
+      FloatMatrix error = output.forward(hidden.forward(inputs, forwardState),
+					 forwardState).subtract(targets);
+      float loss = 0.0f;
+      for (size_t i = 0; i < error.size(); ++i) {
+	loss += error.data()[i] * error.data()[i];
+      }
+      hidden.backward(output.backward(error, forwardState, gradients),
+		      forwardState, gradients);
+      return 0.5f * loss;
+    }
+  };
+}
+
+int main(int argc, char** argv) {
+  const uint32_t width = (argc > 1) ? atoi(argv[1]) : 1024;
+  const uint32_t batchSize = (argc > 2) ? atoi(argv[2]) : 256;
+  const size_t maxThreads =
+      (argc > 3) ? atoi(argv[3]) : std::thread::hardware_concurrency();
+  std::mt19937 rng(1234);
+  const float scale = 1.0f / std::sqrt(float(width));
+
+  HiddenLayer hidden(1, randomMatrix(rng, width, width, scale),
+		     FloatVector({ width }, 0.0f));
+  OutputLayer output(2, randomMatrix(rng, width, width, scale),
+		     FloatVector({ width }, 0.0f));
+  FloatMatrix inputs = randomMatrix(rng, batchSize, width, 1.0f);
+  FloatMatrix targets = randomMatrix(rng, batchSize, width, 1.0f);
+  SgdOptimizer<float> optimizer(0.001f);
+  double baseline = 0.0;
+
+  std::cout << "width=" << width << " batchSize=" << batchSize << std::endl;
+  std::cout << std::setw(8) << "threads" << std::setw(16) << "samples/sec"
+	    << std::setw(12) << "speedup" << std::setw(12) << "efficiency"
+	    << std::endl;
+  for (size_t numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+    FloatTrainer trainer(numThreads);
+    const double seconds = neurodidactic::bench::medianSeconds(
+	[&]() {
+	  trainer.step(inputs, targets, MlpStep{ hidden, output }, optimizer);
+	},
+	2, 10
+    );
+    const double throughput = batchSize / seconds;
+    if (numThreads == 1) {
+      baseline = throughput;
+    }
+    std::cout << std::setw(8) << numThreads
+	      << std::setw(16) << std::fixed << std::setprecision(1)
+	      << throughput
+	      << std::setw(12) << std::setprecision(2)
+	      << (throughput / baseline)
+	      << std::setw(12) << std::setprecision(2)
+	      << (throughput / baseline / numThreads) << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,125 @@
+#include <neurodidactic/core/layers/FullyConnectedLayer.hpp>
+#include <neurodidactic/core/layers/Nonlinearities.hpp>
+#include <neurodidactic/core/optimizers/HogwildSgdOptimizer.hpp>
+#include <neurodidactic/core/training/HogwildTrainer.hpp>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <stdlib.h>
+
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::layers;
+using namespace neurodidactic::core::optimizers;
+using namespace neurodidactic::core::training;
+namespace nl = neurodidactic::core::layers::nonlinearities;
+
+// Fits a wide linear model to sparse random inputs with 1, 2, 4, ...
+// Hogwild threads.  For each thread count, reports training throughput and
+// the loss after a fixed number of epochs, which shows how much the
+// lost and stale updates of asynchronous training slow convergence.
+//
+// Usage: HogwildTrainerBenchmark [numInputs [density [epochs [maxThreads]]]]
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<2, float> FloatMatrix;
+  typedef FullyConnectedLayer<float, nl::Identity> LinearLayer;
+  typedef HogwildTrainer<float> FloatTrainer;
+
+  const uint32_t NUM_OUTPUTS = 16;
+  const uint32_t NUM_SAMPLES = 4096;
+
+  FloatMatrix sparseInputs(std::mt19937& rng, uint32_t numInputs,
+			   float density) {
+    std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+    std::bernoulli_distribution present(density);
+    FloatMatrix m({ NUM_SAMPLES, numInputs }, 0.0f);
+    for (size_t i = 0; i < m.size(); ++i) {
+      if (present(rng)) {
+	m.data()[i] = value(rng);
+      }
+    }
+    return std::move(m);
+  }
+
+  struct SquaredErrorStep {
+    LinearLayer& layer;
+
+    float operator()(const FloatMatrix& inputs, const FloatMatrix& targets,
+		     FloatTrainer::ForwardStateType& forwardState,
+		     HogwildSgdOptimizer<float>& optimizer) const {
+      FloatMatrix error =
+	  layer.forward(inputs, forwardState).subtract(targets);
+      float loss = 0.0f;
+      for (size_t i = 0; i < error.size(); ++i) {
+	loss += error.data()[i] * error.data()[i];
+      }
+      layer.backward(error, forwardState, optimizer);
+      return 0.5f * loss;
+    }
+  };
+}
+
+int main(int argc, char** argv) {
+  typedef std::chrono::steady_clock Clock;
+  const uint32_t numInputs = (argc > 1) ? atoi(argv[1]) : 8192;
+  const float density = (argc > 2) ? atof(argv[2]) : 0.01f;
+  const size_t numEpochs = (argc > 3) ? atoi(argv[3]) : 5;
+  const size_t maxThreads =
+      (argc > 4) ? atoi(argv[4]) : std::thread::hardware_concurrency();
+  std::mt19937 rng(1234);
+  std::normal_distribution<float> normal(0.0f, 1.0f);
+
+  FloatMatrix trueWeights({ NUM_OUTPUTS, numInputs }, 0.0f);
+  for (size_t i = 0; i < trueWeights.size(); ++i) {
+    trueWeights.data()[i] = normal(rng);
+  }
+  LinearLayer truth(0, trueWeights, FloatVector({ NUM_OUTPUTS }, 0.0f));
+  FloatMatrix inputs = sparseInputs(rng, numInputs, density);
+  FloatMatrix targets = truth.forward(inputs);
+  const float initialLoss = [&]() {
+    float total = 0.0f;
+    for (size_t i = 0; i < targets.size(); ++i) {
+      total += targets.data()[i] * targets.data()[i];
+    }
+    return 0.5f * total / NUM_SAMPLES;
+  }();
+
+  std::cout << "numInputs=" << numInputs << " density=" << density
+	    << " epochs=" << numEpochs << " initialLoss=" << initialLoss
+	    << std::endl;
+  std::cout << std::setw(8) << "threads" << std::setw(16) << "samples/sec"
+	    << std::setw(12) << "speedup" << std::setw(14) << "final loss"
+	    << std::endl;
+
+  double baseline = 0.0;
+  for (size_t numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+    LinearLayer layer(1, FloatMatrix({ NUM_OUTPUTS, numInputs }, 0.0f),
+		      FloatVector({ NUM_OUTPUTS }, 0.0f));
+    HogwildSgdOptimizer<float> optimizer(0.1f);
+    FloatTrainer trainer(numThreads);
+    float loss = 0.0f;
+
+    const Clock::time_point start = Clock::now();
+    for (size_t e = 0; e < numEpochs; ++e) {
+      loss = trainer.epoch(inputs, targets, SquaredErrorStep{ layer },
+			   optimizer);
+    }
+    const double seconds =
+	std::chrono::duration<double>(Clock::now() - start).count();
+    const double throughput = numEpochs * NUM_SAMPLES / seconds;
+    if (numThreads == 1) {
+      baseline = throughput;
+    }
+    std::cout << std::setw(8) << numThreads
+	      << std::setw(16) << std::fixed << std::setprecision(1)
+	      << throughput
+	      << std::setw(12) << std::setprecision(2)
+	      << (throughput / baseline)
+	      << std::setw(14) << std::setprecision(5) << loss << std::endl;
+  }
+  return 0;
+}
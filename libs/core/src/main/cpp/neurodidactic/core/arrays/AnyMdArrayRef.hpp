@@ -25,6 +25,11 @@ namespace neurodidactic {
 	AnyMdArrayRef(const AnyMdArrayRef&) = default;
 	AnyMdArrayRef(AnyMdArrayRef&&) = default;
 
+	size_t order() const { return p_->dimensions().size(); }
+	size_t size() const { return p_->size(); }
+	const Field* data() const { return p_->data(); }
+	Field* data() { return p_->data(); }
+
 	template <size_t ARRAY_ORDER>
 	MdArrayRef<ARRAY_ORDER, Field, Allocator> cast() const {
 	  if (p_->dimensions().size() != ARRAY_ORDER) {
@@ -0,0 +1,214 @@
+#ifndef __NEURODIDACTIC__CORE__ARRAYS__CSRMATRIX_HPP__
+#define __NEURODIDACTIC__CORE__ARRAYS__CSRMATRIX_HPP__
+
+#include <neurodidactic/core/arrays/AnyMdArray.hpp>
+#include <neurodidactic/core/arrays/DimensionList.hpp>
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/arrays/MklAllocator.hpp>
+#include <neurodidactic/core/arrays/detail/SparseKernels.hpp>
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <cmath>
+#include <memory>
+#include <sstream>
+#include <type_traits>
+#include <vector>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace arrays {
+
+      // Sparse matrix in compressed sparse row (CSR) form.  Dimensions
+      // follow MdArray: [ numRows, numColumns ].  The nonzeros of row i
+      // are values()[k] at columns()[k] for
+      // k in [ rowOffsets()[i], rowOffsets()[i + 1] ), with columns
+      // increasing within each row.
+      template <typename Field,
+		typename Allocator = MklAllocator<Field, 64> >
+      class CsrMatrix {
+      public:
+	typedef Field FieldType;
+	typedef Allocator AllocatorType;
+	typedef typename std::allocator_traits<Allocator>
+			    ::template rebind_alloc<uint32_t>
+		IndexAllocator;
+	typedef typename std::allocator_traits<Allocator>
+			    ::template rebind_alloc<uint64_t>
+		OffsetAllocator;
+	typedef DimensionList<IndexAllocator> DimensionListType;
+	typedef MdArray<1, Field, Allocator> VectorType;
+	typedef MdArray<2, Field, Allocator> DenseMatrixType;
+
+      public:
+	// All-zero matrix
+	explicit CsrMatrix(const DimensionListType& dimensions,
+			   const Allocator& allocator = Allocator()):
+	    dimensions_(validDimensions_(dimensions)),
+	    rowOffsets_(dimensions_[0] + 1, 0, OffsetAllocator(allocator)),
+	    columns_(IndexAllocator(allocator)), values_(allocator) {
+	}
+
+	// Keeps the elements of "dense" whose magnitude exceeds "threshold"
+	template <typename Array,
+		  typename Enabled =
+		      typename std::enable_if<IsMdArray<Array>::value,
+					      int>::type>
+	explicit CsrMatrix(const Array& dense, Field threshold = Field(0),
+			   const Allocator& allocator = Allocator(),
+			   Enabled = 0):
+	    dimensions_(validDimensions_(dense.dimensions())),
+	    rowOffsets_(OffsetAllocator(allocator)),
+	    columns_(IndexAllocator(allocator)), values_(allocator) {
+	  const size_t n = numColumns();
+	  const Field* p = dense.data();
+	  const uint64_t nnz = countAbove_(dense.size(), p, threshold);
+
+	  rowOffsets_.reserve(numRows() + 1);
+	  columns_.reserve(nnz);
+	  values_.reserve(nnz);
+	  rowOffsets_.push_back(0);
+	  for (size_t i = 0; i < numRows(); ++i, p += n) {
+	    for (size_t j = 0; j < n; ++j) {
+	      if (std::abs(p[j]) > threshold) {
+		columns_.push_back(j);
+		values_.push_back(p[j]);
+	      }
+	    }
+	    rowOffsets_.push_back(values_.size());
+	  }
+	}
+
+	CsrMatrix(const CsrMatrix&) = default;
+	CsrMatrix(CsrMatrix&&) = default;
+
+	Allocator allocator() const { return values_.get_allocator(); }
+	const DimensionListType& dimensions() const { return dimensions_; }
+	size_t numRows() const { return dimensions_[0]; }
+	size_t numColumns() const { return dimensions_[1]; }
+	size_t numNonZeros() const { return values_.size(); }
+
+	// Fraction of the elements that are zero
+	double sparsity() const {
+	  const uint64_t n = dimensions_.numElements();
+	  return n ? 1.0 - double(numNonZeros()) / double(n) : 0.0;
+	}
+
+	const uint64_t* rowOffsets() const { return rowOffsets_.data(); }
+	const uint32_t* columns() const { return columns_.data(); }
+	const Field* values() const { return values_.data(); }
+	Field* values() { return values_.data(); }
+
+	DenseMatrixType toDense() const {
+	  DenseMatrixType dense(dimensions_, Field(0), allocator());
+	  Field* p = dense.data();
+	  for (size_t i = 0; i < numRows(); ++i, p += numColumns()) {
+	    for (uint64_t k = rowOffsets_[i]; k < rowOffsets_[i + 1]; ++k) {
+	      p[columns_[k]] = values_[k];
+	    }
+	  }
+	  return dense;
+	}
+
+	template <typename Vector,
+		  typename Enabled =
+		      typename std::enable_if<IsMdArray<Vector>::value,
+					      int>::type>
+	VectorType innerProduct(const Vector& v, Enabled = 0) const {
+	  if ((v.dimensions().size() != 1) ||
+	      (v.dimensions()[0] != numColumns())) {
+	    std::ostringstream msg;
+	    msg << "Vector \"v\" has dimensions " << v.dimensions()
+		<< ", but it should have dimensions [ " << numColumns()
+		<< " ]";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+
+	  VectorType result({ (uint32_t)numRows() }, allocator());
+	  detail::CsrKernels::multiplyMatrixByVector(
+	      numRows(), rowOffsets(), columns(), values(), v.data(),
+	      result.data()
+	  );
+	  return result;
+	}
+
+	// Computes m * transpose(this), the sparse counterpart of
+	// multiplying a batch of row vectors by a weight matrix
+	template <typename Matrix,
+		  typename Enabled =
+		      typename std::enable_if<IsMdArray<Matrix>::value,
+					      int>::type>
+	DenseMatrixType transposeMatrixProduct(const Matrix& m,
+					       Enabled = 0) const {
+	  if ((m.dimensions().size() != 2) ||
+	      (m.dimensions()[1] != numColumns())) {
+	    std::ostringstream msg;
+	    msg << "Matrix \"m\" has dimensions " << m.dimensions()
+		<< ", but it should have dimensions [ *, " << numColumns()
+		<< " ]";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+
+	  const uint32_t numVectors = m.dimensions()[0];
+	  DenseMatrixType result({ numVectors, (uint32_t)numRows() },
+				 allocator());
+	  detail::CsrKernels::multiplyMatrixByMatrixTranspose(
+	      numVectors, numRows(), numColumns(), m.data(), rowOffsets(),
+	      columns(), values(), result.data()
+	  );
+	  return result;
+	}
+
+	CsrMatrix& operator=(const CsrMatrix&) = default;
+	CsrMatrix& operator=(CsrMatrix&&) = default;
+
+      private:
+	DimensionListType dimensions_;
+	std::vector<uint64_t, OffsetAllocator> rowOffsets_;
+	std::vector<uint32_t, IndexAllocator> columns_;
+	std::vector<Field, Allocator> values_;
+
+	template <typename OtherDimensionList>
+	static DimensionListType validDimensions_(
+	    const OtherDimensionList& dimensions
+	) {
+	  if (dimensions.size() != 2) {
+	    std::ostringstream msg;
+	    msg << "CsrMatrix must have two dimensions, but dimensions "
+		<< dimensions << " were given";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	  return DimensionListType({ dimensions[0], dimensions[1] });
+	}
+
+	static uint64_t countAbove_(size_t n, const Field* p,
+				    Field threshold) {
+	  uint64_t count = 0;
+	  for (size_t i = 0; i < n; ++i) {
+	    count += (std::abs(p[i]) > threshold);
+	  }
+	  return count;
+	}
+      };
+
+      // Fraction of the elements of "array" that are zero
+      template <typename Array,
+		typename Enabled =
+		    typename std::enable_if<IsMdArray<Array>::value,
+					    int>::type>
+      double sparsity(const Array& array, Enabled = 0) {
+	const size_t n = array.size();
+	size_t numZeros = 0;
+	for (const auto* p = array.data(); p != array.data() + n; ++p) {
+	  numZeros += (*p == 0);
+	}
+	return n ? double(numZeros) / double(n) : 0.0;
+      }
+
+    }
+  }
+}
+#endif
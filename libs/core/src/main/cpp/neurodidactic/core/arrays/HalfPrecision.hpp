@@ -0,0 +1,170 @@
+#ifndef __NEURODIDACTIC__CORE__ARRAYS__HALFPRECISION_HPP__
+#define __NEURODIDACTIC__CORE__ARRAYS__HALFPRECISION_HPP__
+
+#include <neurodidactic/core/parallel/Elementwise.hpp>
+#include <ostream>
+#include <type_traits>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace arrays {
+
+      namespace detail {
+	inline uint32_t floatBits(float v) {
+	  uint32_t bits;
+	  memcpy(&bits, &v, sizeof(bits));
+	  return bits;
+	}
+
+	inline float floatFromBits(uint32_t bits) {
+	  float v;
+	  memcpy(&v, &bits, sizeof(v));
+	  return v;
+	}
+      }
+
+      // 16-bit "brain" floating point: the top half of an IEEE single,
+      // with the same range but only 8 bits of precision.  Used to store
+      // weights and activations; arithmetic happens in float.
+      class BFloat16 {
+      public:
+	BFloat16(): bits_(0) { }
+	BFloat16(float v): bits_(fromFloat_(v)) { }
+
+	uint16_t bits() const { return bits_; }
+	operator float() const {
+	  return detail::floatFromBits(uint32_t(bits_) << 16);
+	}
+
+	static BFloat16 fromBits(uint16_t bits) {
+	  BFloat16 v;
+	  v.bits_ = bits;
+	  return v;
+	}
+
+      private:
+	uint16_t bits_;
+
+	// Rounds to nearest, ties to even
+	static uint16_t fromFloat_(float v) {
+	  const uint32_t x = detail::floatBits(v);
+	  if ((x & 0x7FFFFFFF) > 0x7F800000) {
+	    return uint16_t((x >> 16) | 0x0040);  // Keep NaNs quiet
+	  }
+	  return uint16_t((x + 0x7FFF + ((x >> 16) & 1)) >> 16);
+	}
+      };
+
+      // IEEE 754 half precision: 5 exponent bits and 11 bits of precision,
+      // with a maximum of 65504.
+      class Float16 {
+      public:
+	Float16(): bits_(0) { }
+	Float16(float v): bits_(fromFloat_(v)) { }
+
+	uint16_t bits() const { return bits_; }
+	operator float() const { return toFloat_(bits_); }
+
+	static Float16 fromBits(uint16_t bits) {
+	  Float16 v;
+	  v.bits_ = bits;
+	  return v;
+	}
+
+      private:
+	uint16_t bits_;
+
+	// Rounds to nearest, ties to even.  Values too large for a half
+	// become infinity.
+	static uint16_t fromFloat_(float v) {
+	  static const uint32_t F32_INFINITY = 255 << 23;
+	  static const uint32_t F16_LIMIT = (127 + 16) << 23;
+	  static const uint32_t DENORMAL_MAGIC =
+	      ((127 - 15) + (23 - 10) + 1) << 23;
+	  uint32_t x = detail::floatBits(v);
+	  const uint32_t sign = x & 0x80000000;
+	  uint16_t result;
+
+	  x ^= sign;
+	  if (x >= F16_LIMIT) {
+	    result = (x > F32_INFINITY) ? 0x7E00 : 0x7C00;
+	  } else if (x < (113 << 23)) {
+	    // Result is zero or a denormal.  Adding the magic number lets
+	    // the FPU do the shift and the rounding.
+	    result = uint16_t(
+		detail::floatBits(detail::floatFromBits(x) +
+				  detail::floatFromBits(DENORMAL_MAGIC))
+		    - DENORMAL_MAGIC
+	    );
+	  } else {
+	    const uint32_t mantissaOdd = (x >> 13) & 1;
+	    x += (uint32_t(15 - 127) << 23) + 0xFFF;
+	    x += mantissaOdd;
+	    result = uint16_t(x >> 13);
+	  }
+	  return result | uint16_t(sign >> 16);
+	}
+
+	static float toFloat_(uint16_t h) {
+	  static const uint32_t SHIFTED_EXPONENT = 0x7C00 << 13;
+	  static const float DENORMAL_MAGIC = detail::floatFromBits(113 << 23);
+	  uint32_t x = uint32_t(h & 0x7FFF) << 13;
+	  const uint32_t exponent = x & SHIFTED_EXPONENT;
+
+	  x += (127 - 15) << 23;
+	  if (exponent == SHIFTED_EXPONENT) {
+	    x += (128 - 16) << 23;           // Infinity or NaN
+	  } else if (!exponent) {
+	    x += 1 << 23;                    // Zero or denormal
+	    x = detail::floatBits(detail::floatFromBits(x) - DENORMAL_MAGIC);
+	  }
+	  return detail::floatFromBits(x | (uint32_t(h & 0x8000) << 16));
+	}
+      };
+
+      inline std::ostream& operator<<(std::ostream& out, BFloat16 v) {
+	return out << float(v);
+      }
+
+      inline std::ostream& operator<<(std::ostream& out, Float16 v) {
+	return out << float(v);
+      }
+
+      template <typename T>
+      struct IsHalfPrecision : std::false_type { };
+
+      template <>
+      struct IsHalfPrecision<BFloat16> : std::true_type { };
+
+      template <>
+      struct IsHalfPrecision<Float16> : std::true_type { };
+
+      // Conversion kernels between float and the half-precision types.
+      // Large arrays are converted in parallel.
+      template <typename Half,
+		typename Enabled =
+		    typename std::enable_if<IsHalfPrecision<Half>::value,
+					    int>::type>
+      void convert(size_t n, const float* source, Half* target,
+		   Enabled = 0) {
+	parallel::elementwise(n, source, target,
+			      [](float x) { return Half(x); });
+      }
+
+      template <typename Half,
+		typename Enabled =
+		    typename std::enable_if<IsHalfPrecision<Half>::value,
+					    int>::type>
+      void convert(size_t n, const Half* source, float* target,
+		   Enabled = 0) {
+	parallel::elementwise(n, source, target,
+			      [](Half x) { return float(x); });
+      }
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,136 @@
+#ifndef __NEURODIDACTIC__CORE__ARRAYS__HUGEPAGEALLOCATOR_HPP__
+#define __NEURODIDACTIC__CORE__ARRAYS__HUGEPAGEALLOCATOR_HPP__
+
+#include <neurodidactic/core/arrays/detail/MappedMemory.hpp>
+#include <mkl.h>
+
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <stdint.h>
+#include <sys/mman.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace arrays {
+
+      // Allocator that backs large arrays with 2 MB pages to cut TLB
+      // misses when sgemv/sgemm stream through big weight matrices.
+      // Blocks of at least threshold() bytes are rounded up to a whole
+      // number of huge pages and taken from the explicit huge page pool
+      // (MAP_HUGETLB).  If the pool is empty or not configured, the block
+      // is mapped with 4 KB pages on a 2 MB boundary and marked with
+      // madvise(MADV_HUGEPAGE), so transparent huge pages can back it.
+      // Smaller blocks come from mkl_malloc, just like MklAllocator.
+      template <typename T, size_t ALIGNMENT = 64>
+      class HugePageAllocator {
+      public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef ssize_t difference_type;
+	typedef std::true_type propagate_on_container_move_assignment;
+
+	static constexpr const size_t MEMORY_ALIGNMENT = ALIGNMENT;
+	static constexpr const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+	static constexpr const size_t DEFAULT_THRESHOLD = 4 * 1024 * 1024;
+
+	template <typename U>
+	struct rebind { typedef HugePageAllocator<U, ALIGNMENT> other; };
+
+      public:
+	explicit HugePageAllocator(size_t threshold = DEFAULT_THRESHOLD)
+	    noexcept:
+	    threshold_(threshold) {
+	}
+
+	template <typename U>
+	HugePageAllocator(const HugePageAllocator<U, ALIGNMENT>& other)
+	    noexcept:
+	    threshold_(other.threshold()) {
+	}
+
+	size_t threshold() const noexcept { return threshold_; }
+
+	const T* address(const T& r) const noexcept { return &r; }
+	T* address(T& r) noexcept { return &r; }
+
+	T* allocate(size_t n, const void* hint = nullptr) {
+	  const size_t size = n * sizeof(T);
+	  if (size < threshold_) {
+	    T* p = (T*)mkl_malloc(size, ALIGNMENT);
+	    if (!p) {
+	      throw std::bad_alloc();
+	    }
+	    return p;
+	  }
+
+	  const size_t mappedSize =
+	      detail::roundUpToMultiple(size, HUGE_PAGE_SIZE);
+	  void* p = detail::mapMemory(mappedSize, MAP_HUGETLB);
+	  if (!p) {
+	    p = detail::mapAlignedMemory(mappedSize, HUGE_PAGE_SIZE);
+	    if (!p) {
+	      throw std::bad_alloc();
+	    }
+	    madvise(p, mappedSize, MADV_HUGEPAGE);
+	  }
+	  return (T*)p;
+	}
+
+	void deallocate(T* p, size_t n) noexcept {
+	  const size_t size = n * sizeof(T);
+	  if (size < threshold_) {
+	    mkl_free((void*)p);
+	  } else {
+	    detail::unmapMemory(
+		p, detail::roundUpToMultiple(size, HUGE_PAGE_SIZE)
+	    );
+	  }
+	}
+
+	size_t max_size() const noexcept { return size_t(-1); }
+
+	template <typename U, typename... Args>
+	void construct(U* p, Args&&... args) {
+	  ::new((void*) p) U(std::forward<Args>(args)...);
+	}
+
+	template <typename U>
+	void destroy(U* p) {
+	  p->~U();
+	}
+
+      private:
+	size_t threshold_;
+      };
+
+      template <typename T, size_t ALIGNMENT>
+      constexpr const size_t HugePageAllocator<T, ALIGNMENT>::MEMORY_ALIGNMENT;
+
+      template <typename T, size_t ALIGNMENT>
+      constexpr const size_t HugePageAllocator<T, ALIGNMENT>::HUGE_PAGE_SIZE;
+
+      template <typename T, size_t ALIGNMENT>
+      constexpr const size_t
+	  HugePageAllocator<T, ALIGNMENT>::DEFAULT_THRESHOLD;
+
+      template <typename T, typename U, size_t ALIGNMENT>
+      bool operator==(const HugePageAllocator<T, ALIGNMENT>& left,
+		      const HugePageAllocator<U, ALIGNMENT>& right) noexcept {
+	return left.threshold() == right.threshold();
+      }
+
+      template <typename T, typename U, size_t ALIGNMENT>
+      bool operator!=(const HugePageAllocator<T, ALIGNMENT>& left,
+		      const HugePageAllocator<U, ALIGNMENT>& right) noexcept {
+	return left.threshold() != right.threshold();
+      }
+
+    }
+  }
+}
+#endif
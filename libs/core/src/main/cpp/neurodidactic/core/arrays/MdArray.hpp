@@ -9,6 +9,7 @@
 #include <neurodidactic/core/arrays/detail/MdArrayBase.hpp>
 #include <neurodidactic/core/arrays/detail/MdArrayProperties.hpp>
 #include <algorithm>
+#include <functional>
 #include <memory>
 #include <type_traits>
 
@@ -100,6 +101,37 @@ namespace neurodidactic {
 
 	MdArray(MdArray&& other) = default;
 
+	explicit MdArray(DataPtr&& p): p_(std::move(p)) { }
+
+	// Creates an array over "data", which belongs to the caller,
+	// without copying it.  "release" is called on "data" once the last
+	// array referring to it is destroyed; if it is empty, the caller
+	// must keep "data" alive for as long as any such array exists.
+	// Operations that allocate new arrays, such as copying, use
+	// "allocator".
+	static MdArray wrap(
+	    const DimensionListType& dimensions, Field* data,
+	    const std::function<void (Field*)>& release =
+	        std::function<void (Field*)>(),
+	    const Allocator& allocator = Allocator()
+	) {
+	  return MdArray(DataPtr::wrapData(
+	      DimensionListType(dimensions), data, release, allocator
+	  ));
+	}
+
+	// As above, but keeps "data" alive by holding a reference to
+	// "owner" instead
+	static MdArray wrap(
+	    const DimensionListType& dimensions, Field* data,
+	    const std::shared_ptr<void>& owner,
+	    const Allocator& allocator = Allocator()
+	) {
+	  return MdArray(DataPtr::wrapData(
+	      DimensionListType(dimensions), data, owner, allocator
+	  ));
+	}
+
 	template <typename OtherArray,
 		  typename Enabler =
 		      typename std::enable_if<
@@ -115,6 +147,7 @@ namespace neurodidactic {
 	}
 
 	RefType ref() const { return RefType(p_); }
+	bool ownsData() const { return p_->ownsData(); }
 	
 	MdArray& operator=(const MdArray& other) {
 	  if (p_ != other.p_) {
@@ -8,6 +8,7 @@
 #include <neurodidactic/core/arrays/detail/MdArrayBase.hpp>
 #include <neurodidactic/core/arrays/detail/MdArrayProperties.hpp>
 #include <algorithm>
+#include <functional>
 #include <memory>
 #include <type_traits>
 
@@ -67,7 +68,30 @@ namespace neurodidactic {
 	MdArrayRef(const MdArrayRef&) = default;
 	MdArrayRef(MdArrayRef&&) = default;
 
+	// See MdArray::wrap()
+	static MdArrayRef wrap(
+	    const DimensionListType& dimensions, Field* data,
+	    const std::function<void (Field*)>& release =
+	        std::function<void (Field*)>(),
+	    const Allocator& allocator = Allocator()
+	) {
+	  return MdArrayRef(DataPtr::wrapData(
+	      DimensionListType(dimensions), data, release, allocator
+	  ));
+	}
+
+	static MdArrayRef wrap(
+	    const DimensionListType& dimensions, Field* data,
+	    const std::shared_ptr<void>& owner,
+	    const Allocator& allocator = Allocator()
+	) {
+	  return MdArrayRef(DataPtr::wrapData(
+	      DimensionListType(dimensions), data, owner, allocator
+	  ));
+	}
+
 	RefType ref() const { return *this; }
+	bool ownsData() const { return p_->ownsData(); }
 	bool refersTo(const ArrayType& array) const {
 	  return p_ == array.p_;
 	}
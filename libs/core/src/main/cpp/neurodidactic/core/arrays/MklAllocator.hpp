@@ -3,7 +3,9 @@
 
 #include <mkl.h>
 
+#include <new>
 #include <type_traits>
+#include <utility>
 #include <stdint.h>
 
 namespace neurodidactic {
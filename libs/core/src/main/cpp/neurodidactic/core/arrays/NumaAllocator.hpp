@@ -0,0 +1,196 @@
+#ifndef __NEURODIDACTIC__CORE__ARRAYS__NUMAALLOCATOR_HPP__
+#define __NEURODIDACTIC__CORE__ARRAYS__NUMAALLOCATOR_HPP__
+
+#include <neurodidactic/core/arrays/detail/MappedMemory.hpp>
+#include <neurodidactic/core/arrays/detail/NumaSupport.hpp>
+#include <mkl.h>
+
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace arrays {
+
+      // Placement policies for NumaAllocator.  A policy decides which
+      // node(s) the pages of a freshly-mapped block should live on.
+      namespace numa {
+
+	// All pages on one node.  A default-constructed policy picks the
+	// node of the CPU that constructs it.  place() throws
+	// IllegalValueError if the node does not exist.
+	class NodeLocal {
+	public:
+	  NodeLocal(): node_(detail::currentNumaNode()) { }
+	  explicit NodeLocal(int node): node_(node) { }
+
+	  int node() const { return node_; }
+
+	  void place(void* p, size_t size) const {
+	    detail::bindMemory(p, size, detail::NUMA_MPOL_PREFERRED,
+			       std::vector<int>(1, node_));
+	  }
+
+	  bool operator==(const NodeLocal& other) const {
+	    return node_ == other.node_;
+	  }
+	  bool operator!=(const NodeLocal& other) const {
+	    return node_ != other.node_;
+	  }
+
+	private:
+	  int node_;
+	};
+
+	// Pages spread round-robin across all online nodes, so every
+	// socket sees the same average bandwidth.  Best for weights read
+	// by all cores.
+	class Interleaved {
+	public:
+	  void place(void* p, size_t size) const {
+	    detail::bindMemory(p, size, detail::NUMA_MPOL_INTERLEAVE,
+			       detail::onlineNumaNodes());
+	  }
+
+	  bool operator==(const Interleaved&) const { return true; }
+	  bool operator!=(const Interleaved&) const { return false; }
+	};
+
+	// Pages are split into one contiguous range per online node, and
+	// each range is zeroed by a thread pinned to that node (see
+	// detail::NumaNodeWorkers).  Under the kernel's first-touch rule
+	// range i then lands on node i.  Best for arrays split into
+	// contiguous blocks of rows, one per node.
+	class FirstTouchByWorker {
+	public:
+	  void place(void* p, size_t size) const {
+	    detail::NumaNodeWorkers& workers =
+		detail::NumaNodeWorkers::instance();
+	    const size_t page = detail::pageSize();
+	    const size_t numPages = size / page;
+	    const size_t numNodes = workers.nodes().size();
+	    char* base = (char*)p;
+	    workers.run([base, page, numPages, numNodes](size_t i) {
+		for (size_t j = i * numPages / numNodes;
+		     j < (i + 1) * numPages / numNodes;
+		     ++j) {
+		  base[j * page] = 0;
+		}
+	    });
+	  }
+
+	  bool operator==(const FirstTouchByWorker&) const { return true; }
+	  bool operator!=(const FirstTouchByWorker&) const { return false; }
+	};
+
+      }
+
+      // Allocator that controls which NUMA nodes hold large arrays.
+      // Blocks of at least MAPPING_THRESHOLD bytes are mapped directly
+      // from the kernel and placed according to the Policy; smaller ones
+      // (array headers, dimension lists, small vectors) come from
+      // mkl_malloc and are not worth a system call.  Placement is a hint,
+      // and silently falls back to the kernel's default on machines
+      // without NUMA support.
+      template <typename T, typename Policy = numa::Interleaved,
+		size_t ALIGNMENT = 64>
+      class NumaAllocator {
+      public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef ssize_t difference_type;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef Policy PolicyType;
+
+	static constexpr const size_t MEMORY_ALIGNMENT = ALIGNMENT;
+	static constexpr const size_t MAPPING_THRESHOLD = 64 * 1024;
+
+	template <typename U>
+	struct rebind { typedef NumaAllocator<U, Policy, ALIGNMENT> other; };
+
+      public:
+	NumaAllocator(): policy_() { }
+	explicit NumaAllocator(const Policy& policy): policy_(policy) { }
+
+	template <typename U>
+	NumaAllocator(const NumaAllocator<U, Policy, ALIGNMENT>& other):
+	    policy_(other.policy()) {
+	}
+
+	const Policy& policy() const noexcept { return policy_; }
+
+	const T* address(const T& r) const noexcept { return &r; }
+	T* address(T& r) noexcept { return &r; }
+
+	T* allocate(size_t n, const void* hint = nullptr) {
+	  const size_t size = n * sizeof(T);
+	  if (size < MAPPING_THRESHOLD) {
+	    T* p = (T*)mkl_malloc(size, ALIGNMENT);
+	    if (!p) {
+	      throw std::bad_alloc();
+	    }
+	    return p;
+	  }
+
+	  const size_t mappedSize =
+	      detail::roundUpToMultiple(size, detail::pageSize());
+	  void* p = detail::mapMemoryOrThrow(mappedSize);
+	  try {
+	    policy_.place(p, mappedSize);
+	  } catch(...) {
+	    detail::unmapMemory(p, mappedSize);
+	    throw;
+	  }
+	  return (T*)p;
+	}
+
+	void deallocate(T* p, size_t n) noexcept {
+	  const size_t size = n * sizeof(T);
+	  if (size < MAPPING_THRESHOLD) {
+	    mkl_free((void*)p);
+	  } else {
+	    detail::unmapMemory(
+		p, detail::roundUpToMultiple(size, detail::pageSize())
+	    );
+	  }
+	}
+
+	size_t max_size() const noexcept { return size_t(-1); }
+
+	template <typename U, typename... Args>
+	void construct(U* p, Args&&... args) {
+	  ::new((void*) p) U(std::forward<Args>(args)...);
+	}
+
+	template <typename U>
+	void destroy(U* p) {
+	  p->~U();
+	}
+
+      private:
+	Policy policy_;
+      };
+
+      template <typename T, typename U, typename Policy, size_t ALIGNMENT>
+      bool operator==(const NumaAllocator<T, Policy, ALIGNMENT>& left,
+		      const NumaAllocator<U, Policy, ALIGNMENT>& right) {
+	return left.policy() == right.policy();
+      }
+
+      template <typename T, typename U, typename Policy, size_t ALIGNMENT>
+      bool operator!=(const NumaAllocator<T, Policy, ALIGNMENT>& left,
+		      const NumaAllocator<U, Policy, ALIGNMENT>& right) {
+	return left.policy() != right.policy();
+      }
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,133 @@
+#ifndef __NEURODIDACTIC__CORE__ARRAYS__SPARSEROWMATRIX_HPP__
+#define __NEURODIDACTIC__CORE__ARRAYS__SPARSEROWMATRIX_HPP__
+
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/arrays/MklAllocator.hpp>
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <type_traits>
+#include <vector>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace arrays {
+
+      // Matrix of numRows() x rowSize() that stores only its nonzero
+      // rows, as strictly increasing row indices and the rows themselves
+      // laid out back to back.  Meant for the gradient of an embedding
+      // table, where a batch touches a few rows out of millions.
+      template <typename Field,
+		typename Allocator = MklAllocator<Field, 64> >
+      class SparseRowMatrix {
+      public:
+	typedef Field FieldType;
+	typedef Allocator AllocatorType;
+	typedef typename std::allocator_traits<Allocator>
+			    ::template rebind_alloc<uint32_t>
+		IndexAllocator;
+	typedef MdArray<2, Field, Allocator> DenseMatrixType;
+
+      public:
+	// All-zero matrix
+	SparseRowMatrix(size_t numRows, size_t rowSize,
+			const Allocator& allocator = Allocator()):
+	    numRows_(numRows), rowSize_(rowSize),
+	    indices_(IndexAllocator(allocator)), values_(allocator) {
+	}
+
+	SparseRowMatrix(const SparseRowMatrix&) = default;
+	SparseRowMatrix(SparseRowMatrix&&) = default;
+
+	// Sums the "n" rows of "rows" that share each index in "indices,"
+	// which need not be sorted or distinct
+	static SparseRowMatrix sumRows(size_t numRows, size_t rowSize,
+				       size_t n, const uint32_t* indices,
+				       const Field* rows,
+				       const Allocator& allocator =
+					   Allocator()) {
+	  SparseRowMatrix result(numRows, rowSize, allocator);
+	  std::vector<uint32_t> order(n);
+	  std::iota(order.begin(), order.end(), uint32_t(0));
+	  std::stable_sort(order.begin(), order.end(),
+			   [indices](uint32_t i, uint32_t j) {
+			     return indices[i] < indices[j];
+			   });
+
+	  for (uint32_t i : order) {
+	    const Field* row = rows + i * rowSize;
+	    if (!result.indices_.empty() &&
+		(result.indices_.back() == indices[i])) {
+	      Field* sum = result.values_.data() + result.values_.size() -
+			   rowSize;
+	      for (size_t j = 0; j < rowSize; ++j) {
+		sum[j] += row[j];
+	      }
+	    } else {
+	      result.append(indices[i], row);
+	    }
+	  }
+	  return std::move(result);
+	}
+
+	Allocator allocator() const { return values_.get_allocator(); }
+	size_t numRows() const { return numRows_; }
+	size_t rowSize() const { return rowSize_; }
+	size_t numNonZeroRows() const { return indices_.size(); }
+	const uint32_t* indices() const { return indices_.data(); }
+	const Field* values() const { return values_.data(); }
+	Field* values() { return values_.data(); }
+	const Field* row(size_t k) const {
+	  return values_.data() + k * rowSize_;
+	}
+	Field* row(size_t k) { return values_.data() + k * rowSize_; }
+
+	void append(uint32_t index, const Field* row) {
+	  if ((index >= numRows_) ||
+	      (!indices_.empty() && (index <= indices_.back()))) {
+	    std::ostringstream msg;
+	    msg << "Cannot append row " << index << " to a SparseRowMatrix"
+		<< " with " << numRows_ << " rows";
+	    if (!indices_.empty()) {
+	      msg << " whose last row is " << indices_.back();
+	    }
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	  indices_.push_back(index);
+	  values_.insert(values_.end(), row, row + rowSize_);
+	}
+
+	void clear() {
+	  indices_.clear();
+	  values_.clear();
+	}
+
+	DenseMatrixType toDense() const {
+	  DenseMatrixType dense({ (uint32_t)numRows_, (uint32_t)rowSize_ },
+				Field(0), allocator());
+	  for (size_t k = 0; k < indices_.size(); ++k) {
+	    std::copy_n(row(k), rowSize_,
+			dense.data() + size_t(indices_[k]) * rowSize_);
+	  }
+	  return dense;
+	}
+
+	SparseRowMatrix& operator=(const SparseRowMatrix&) = default;
+	SparseRowMatrix& operator=(SparseRowMatrix&&) = default;
+
+      private:
+	size_t numRows_;
+	size_t rowSize_;
+	std::vector<uint32_t, IndexAllocator> indices_;
+	std::vector<Field, Allocator> values_;
+      };
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,158 @@
+#ifndef __NEURODIDACTIC__CORE__ARRAYS__SPARSEVECTOR_HPP__
+#define __NEURODIDACTIC__CORE__ARRAYS__SPARSEVECTOR_HPP__
+
+#include <neurodidactic/core/arrays/AnyMdArray.hpp>
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/arrays/MklAllocator.hpp>
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <initializer_list>
+#include <memory>
+#include <sstream>
+#include <type_traits>
+#include <vector>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace arrays {
+
+      // Vector of "size()" elements that stores only its nonzeros, as
+      // pairs of strictly increasing indices and their values.  Meant for
+      // one-hot and bag-of-words inputs, where a handful of features out
+      // of millions are set.
+      template <typename Field,
+		typename Allocator = MklAllocator<Field, 64> >
+      class SparseVector {
+      public:
+	typedef Field FieldType;
+	typedef Allocator AllocatorType;
+	typedef typename std::allocator_traits<Allocator>
+			    ::template rebind_alloc<uint32_t>
+		IndexAllocator;
+	typedef MdArray<1, Field, Allocator> DenseVectorType;
+
+      public:
+	// All-zero vector
+	explicit SparseVector(size_t size,
+			      const Allocator& allocator = Allocator()):
+	    size_(size), indices_(IndexAllocator(allocator)),
+	    values_(allocator) {
+	}
+
+	template <typename IndexIterator, typename ValueIterator>
+	SparseVector(size_t size, size_t numNonZeros, IndexIterator indices,
+		     ValueIterator values,
+		     const Allocator& allocator = Allocator()):
+	    size_(size), indices_(IndexAllocator(allocator)),
+	    values_(allocator) {
+	  indices_.reserve(numNonZeros);
+	  values_.reserve(numNonZeros);
+	  for (size_t i = 0; i < numNonZeros; ++i, ++indices, ++values) {
+	    append(*indices, *values);
+	  }
+	}
+
+	SparseVector(size_t size,
+		     const std::initializer_list<uint32_t>& indices,
+		     const std::initializer_list<Field>& values,
+		     const Allocator& allocator = Allocator()):
+	    SparseVector(size, checkNumNonZeros_(indices.size(),
+						 values.size()),
+			 indices.begin(), values.begin(), allocator) {
+	}
+
+	SparseVector(const SparseVector&) = default;
+	SparseVector(SparseVector&&) = default;
+
+	Allocator allocator() const { return values_.get_allocator(); }
+	size_t size() const { return size_; }
+	size_t numNonZeros() const { return values_.size(); }
+	const uint32_t* indices() const { return indices_.data(); }
+	const Field* values() const { return values_.data(); }
+	Field* values() { return values_.data(); }
+
+	void append(uint32_t index, Field value) {
+	  if ((index >= size_) ||
+	      (!indices_.empty() && (index <= indices_.back()))) {
+	    std::ostringstream msg;
+	    msg << "Cannot append index " << index << " to a SparseVector"
+		<< " of size " << size_;
+	    if (!indices_.empty()) {
+	      msg << " whose last index is " << indices_.back();
+	    }
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	  indices_.push_back(index);
+	  values_.push_back(value);
+	}
+
+	void clear() {
+	  indices_.clear();
+	  values_.clear();
+	}
+
+	template <typename Vector,
+		  typename Enabled =
+		      typename std::enable_if<IsMdArray<Vector>::value,
+					      int>::type>
+	Field innerProduct(const Vector& v, Enabled = 0) const {
+	  if ((v.dimensions().size() != 1) || (v.dimensions()[0] != size_)) {
+	    std::ostringstream msg;
+	    msg << "Vector \"v\" has dimensions " << v.dimensions()
+		<< ", but it should have dimensions [ " << size_ << " ]";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+
+	  const Field* p = v.data();
+	  Field sum(0);
+	  for (size_t i = 0; i < values_.size(); ++i) {
+	    sum += values_[i] * p[indices_[i]];
+	  }
+	  return sum;
+	}
+
+	DenseVectorType toDense() const {
+	  DenseVectorType dense({ (uint32_t)size_ }, Field(0), allocator());
+	  for (size_t i = 0; i < values_.size(); ++i) {
+	    dense.data()[indices_[i]] = values_[i];
+	  }
+	  return dense;
+	}
+
+	SparseVector& operator=(const SparseVector&) = default;
+	SparseVector& operator=(SparseVector&&) = default;
+
+      private:
+	// Checked before the delegating constructor reads the values
+	static size_t checkNumNonZeros_(size_t numIndices,
+					size_t numValues) {
+	  if (numIndices != numValues) {
+	    std::ostringstream msg;
+	    msg << "SparseVector given " << numIndices
+		<< " indices but " << numValues << " values";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	  return numIndices;
+	}
+
+	size_t size_;
+	std::vector<uint32_t, IndexAllocator> indices_;
+	std::vector<Field, Allocator> values_;
+      };
+
+      template <typename T>
+      struct IsSparseVector : public std::false_type { };
+
+      template <typename Field, typename Allocator>
+      struct IsSparseVector< SparseVector<Field, Allocator> > :
+	  public std::true_type {
+      };
+
+    }
+  }
+}
+#endif
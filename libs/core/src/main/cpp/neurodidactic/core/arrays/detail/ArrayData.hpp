@@ -27,13 +27,29 @@ namespace neurodidactic {
 	      Allocator(allocator), dimensions_(std::move(dimensions)),
 	      size_(dimensions_.numElements()),
 	      leadingDimension_(size_ / dimensions_[0]),
-  	      data_(this->allocate(size_)),
-	      refCnt_(0) {
+  	      data_(this->allocate(size_)), owner_(), ownsData_(true),
+	      allocationTag_(0), refCnt_(0) {
 	    // Intentionally left blank
 	  }
+
+	  // Refers to "data", which belongs to someone else.  "owner" keeps
+	  // the data alive and is released along with this ArrayData; it
+	  // may be empty if the data outlives all arrays that refer to it.
+	  ArrayData(DimensionListType&& dimensions, Field* data,
+		    std::shared_ptr<void>&& owner, const Allocator& allocator):
+	      Allocator(allocator), dimensions_(std::move(dimensions)),
+	      size_(dimensions_.numElements()),
+	      leadingDimension_(size_ / dimensions_[0]),
+	      data_(data), owner_(std::move(owner)), ownsData_(false),
+	      allocationTag_(0), refCnt_(0) {
+	    // Intentionally left blank
+	  }
+
 	  ArrayData(const ArrayData<Field, Allocator>&) = delete;
 	  ~ArrayData() noexcept {
-	    this->deallocate(data_, dimensions_.numElements());
+	    if (ownsData()) {
+	      this->deallocate(data_, dimensions_.numElements());
+	    }
 	  }
 
 	  const Allocator& allocator() const noexcept {
@@ -53,6 +69,13 @@ namespace neurodidactic {
 	  Field* data() noexcept { return data_; }
 	  const Field* end() const noexcept { return data_ + size(); }
 	  Field* end() noexcept { return data_ + size(); }
+	  bool ownsData() const noexcept { return ownsData_; }
+
+	  // Tag the data was allocated under, for AllocationTelemetry
+	  uint16_t allocationTag() const noexcept { return allocationTag_; }
+	  void setAllocationTag(uint16_t tag) noexcept {
+	    allocationTag_ = tag;
+	  }
 	  uint32_t refCnt() const noexcept {
 	    return refCnt_.load(std::memory_order_consume);
 	  }
@@ -68,6 +91,9 @@ namespace neurodidactic {
 	  uint64_t size_;
 	  uint64_t leadingDimension_;
 	  Field* data_;
+	  std::shared_ptr<void> owner_;
+	  bool ownsData_;
+	  uint16_t allocationTag_;
 	  std::atomic<uint32_t> refCnt_;
 	};							     
 	
@@ -2,6 +2,10 @@
 #define __NEURODIDACTIC__CORE__ARRAYS__DETAIL__ARRAYDATAPTR_HPP__
 
 #include <neurodidactic/core/arrays/detail/ArrayData.hpp>
+#include <neurodidactic/core/profiling/AllocationTelemetry.hpp>
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <functional>
 #include <memory>
 #include <utility>
 
@@ -116,10 +120,55 @@ namespace neurodidactic {
 	        new(tdAllocator.allocate(sizeof(ArrayDataType)))
 	        ArrayDataType(std::move(dimensions),
 			      ElementAllocator(allocator));
+#ifdef NEURODIDACTIC_ALLOCATION_TELEMETRY
+	    p->setAllocationTag(profiling::AllocationTelemetry::currentTag());
+	    profiling::AllocationTelemetry::recordAllocation(
+		p->allocationTag(), p->size() * sizeof(Field)
+	    );
+#endif
 	    return ArrayDataPtr<Field, Allocator>(p,
 						  ElementAllocator(allocator));
 	  }
 	  
+	  // Wraps "data" without copying it.  "owner" keeps "data" alive
+	  // until the last array referring to it is destroyed.
+	  static ArrayDataPtr<Field, Allocator> wrapData(
+	      typename ArrayDataType::DimensionListType&& dimensions,
+	      Field* data, std::shared_ptr<void> owner,
+	      const Allocator& allocator
+	  ) {
+	    if (!data && dimensions.numElements()) {
+	      throw pistis::exceptions::IllegalValueError(
+		  "Cannot wrap a null pointer", PISTIS_EX_HERE
+	      );
+	    }
+
+	    ArrayDataAllocator tdAllocator(allocator);
+	    ArrayDataType* p =
+	        new(tdAllocator.allocate(sizeof(ArrayDataType)))
+	        ArrayDataType(std::move(dimensions), data, std::move(owner),
+			      ElementAllocator(allocator));
+	    return ArrayDataPtr<Field, Allocator>(p,
+						  ElementAllocator(allocator));
+	  }
+
+	  // Wraps "data" without copying it, calling "release" on it when
+	  // the last array referring to it is destroyed.  An empty
+	  // "release" leaves the data alone.
+	  static ArrayDataPtr<Field, Allocator> wrapData(
+	      typename ArrayDataType::DimensionListType&& dimensions,
+	      Field* data, const std::function<void (Field*)>& release,
+	      const Allocator& allocator
+	  ) {
+	    std::shared_ptr<void> owner;
+	    if (release) {
+	      owner.reset((void*)data,
+			  [release](void* p) { release((Field*)p); });
+	    }
+	    return wrapData(std::move(dimensions), data, std::move(owner),
+			    allocator);
+	  }
+
 	private:
 	  ArrayDataType* p_;
 
@@ -144,6 +193,13 @@ namespace neurodidactic {
 	  static void removeRef_(ArrayDataAllocator& allocator,
 				 ArrayDataType* p) noexcept {
 	    if (p && !p->removeRef()) {
+#ifdef NEURODIDACTIC_ALLOCATION_TELEMETRY
+	      if (p->ownsData()) {
+		profiling::AllocationTelemetry::recordRelease(
+		    p->allocationTag(), p->size() * sizeof(Field)
+		);
+	      }
+#endif
 	      p->~ArrayData();
 	      allocator.deallocate(p, sizeof(ArrayDataType));
 	    }
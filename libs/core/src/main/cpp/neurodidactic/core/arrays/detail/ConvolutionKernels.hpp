@@ -0,0 +1,226 @@
+#ifndef __NEURODIDACTIC__CORE__ARRAYS__DETAIL__CONVOLUTIONKERNELS_HPP__
+#define __NEURODIDACTIC__CORE__ARRAYS__DETAIL__CONVOLUTIONKERNELS_HPP__
+
+#include <neurodidactic/core/parallel/Elementwise.hpp>
+#include <neurodidactic/core/parallel/ThreadPool.hpp>
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace arrays {
+      namespace detail {
+
+	// Shape of a 2D convolution of one [channels, height, width] image
+	// with kernels of kernelHeight x kernelWidth, moved "stride" pixels
+	// at a time over the image padded with "padding" zeros on every
+	// side.  The image must be at least as large as the kernel once
+	// padded.
+	struct Convolution2dGeometry {
+	  uint32_t channels;
+	  uint32_t height;
+	  uint32_t width;
+	  uint32_t kernelHeight;
+	  uint32_t kernelWidth;
+	  uint32_t stride;
+	  uint32_t padding;
+
+	  uint32_t outputHeight() const {
+	    return (height + 2 * padding - kernelHeight) / stride + 1;
+	  }
+
+	  uint32_t outputWidth() const {
+	    return (width + 2 * padding - kernelWidth) / stride + 1;
+	  }
+
+	  size_t imageSize() const {
+	    return size_t(channels) * height * width;
+	  }
+
+	  // The column matrix has one row per (channel, kernel row, kernel
+	  // column) and one column per output pixel
+	  size_t columnRows() const {
+	    return size_t(channels) * kernelHeight * kernelWidth;
+	  }
+
+	  size_t columnColumns() const {
+	    return size_t(outputHeight()) * outputWidth();
+	  }
+
+	  bool fits() const {
+	    return (stride > 0) && (kernelHeight > 0) && (kernelWidth > 0) &&
+		   (height + 2 * padding >= kernelHeight) &&
+		   (width + 2 * padding >= kernelWidth);
+	  }
+	};
+
+	// im2col and its adjoint.  Both split the work by channel, so each
+	// task reads (or writes) one image plane and a contiguous band of
+	// kernelHeight * kernelWidth column rows.  Column rows are written
+	// front to back from one image row at a time, so the source and
+	// destination of the innermost loop stay in L1.
+	struct ConvolutionKernels {
+	  // Fills columns[columnRows x columnColumns] with the image pixels
+	  // under each kernel position, and zeros for the padding
+	  template <typename Field>
+	  static void imageToColumns(const Convolution2dGeometry& g,
+				     const Field* image, Field* columns) {
+	    imageToColumns(g, image, 0, g.outputHeight(), columns);
+	  }
+
+	  // Same for output rows [rowBegin, rowEnd) only, so "columns" has
+	  // (rowEnd - rowBegin) * outputWidth columns
+	  template <typename Field>
+	  static void imageToColumns(const Convolution2dGeometry& g,
+				     const Field* image, uint32_t rowBegin,
+				     uint32_t rowEnd, Field* columns) {
+	    const size_t planeSize = size_t(g.height) * g.width;
+	    const size_t bandSize = size_t(g.kernelHeight) * g.kernelWidth *
+				    (rowEnd - rowBegin) * g.outputWidth();
+	    parallel::parallelFor(
+		0, g.channels, channelGrainSize(g),
+		[=, &g](size_t begin, size_t end) {
+		  for (size_t c = begin; c < end; ++c) {
+		    imageToColumns_(g, image + c * planeSize, rowBegin,
+				    rowEnd, columns + c * bandSize);
+		  }
+		}
+	    );
+	  }
+
+	  // Adds each element of columns[columnRows x columnColumns] to the
+	  // image pixel it was copied from by imageToColumns().  Elements
+	  // that came from the padding are dropped.
+	  template <typename Field>
+	  static void addColumnsToImage(const Convolution2dGeometry& g,
+					const Field* columns, Field* image) {
+	    const size_t planeSize = size_t(g.height) * g.width;
+	    const size_t bandSize =
+		size_t(g.kernelHeight) * g.kernelWidth * g.columnColumns();
+	    parallel::parallelFor(
+		0, g.channels, channelGrainSize(g),
+		[&g, image, columns, planeSize, bandSize](size_t begin,
+							  size_t end) {
+		  for (size_t c = begin; c < end; ++c) {
+		    addColumnsToImage_(g, columns + c * bandSize,
+				       image + c * planeSize);
+		  }
+		}
+	    );
+	  }
+
+	  // Takes the maximum of each 2x2 block of pixels in the first
+	  // 2 * pooledHeight rows and 2 * pooledWidth columns of each of
+	  // "planes" tiles[planes, rows, width], and writes it to
+	  // pooled[planes, pooledHeight, pooledWidth].  Tile planes are
+	  // "tileSize" elements apart and pooled planes "pooledSize" apart.
+	  template <typename Field>
+	  static void maxPool2x2(size_t planes, const Field* tiles,
+				 size_t tileSize, uint32_t width,
+				 uint32_t pooledHeight, uint32_t pooledWidth,
+				 Field* pooled, size_t pooledSize) {
+	    for (size_t c = 0; c < planes; ++c) {
+	      const Field* top = tiles + c * tileSize;
+	      Field* dest = pooled + c * pooledSize;
+	      for (uint32_t p = 0; p < pooledHeight; ++p) {
+		const Field* bottom = top + width;
+		for (uint32_t q = 0; q < pooledWidth; ++q) {
+		  const uint32_t x = 2 * q;
+		  dest[q] = std::max(std::max(top[x], top[x + 1]),
+				     std::max(bottom[x], bottom[x + 1]));
+		}
+		top += 2 * size_t(width);
+		dest += pooledWidth;
+	      }
+	    }
+	  }
+
+	  static size_t channelGrainSize(const Convolution2dGeometry& g) {
+	    const size_t perChannel =
+		size_t(g.kernelHeight) * g.kernelWidth * g.columnColumns();
+	    return std::max(size_t(1), parallel::DEFAULT_GRAIN_SIZE /
+					   std::max(perChannel, size_t(1)));
+	  }
+
+	  // Output columns [begin, end) of an output row whose kernel
+	  // column "s" lands inside the image
+	  static void validColumns(const Convolution2dGeometry& g, uint32_t s,
+				   uint32_t& begin, uint32_t& end) {
+	    const int64_t q = g.outputWidth();
+	    const int64_t offset = int64_t(s) - int64_t(g.padding);
+	    const int64_t first = (offset >= 0)
+		? 0 : (-offset + g.stride - 1) / g.stride;
+	    const int64_t last = (int64_t(g.width) - offset + g.stride - 1) /
+				     g.stride;
+	    begin = uint32_t(std::min(first, q));
+	    end = uint32_t(std::max(int64_t(begin), std::min(last, q)));
+	  }
+
+	private:
+	  template <typename Field>
+	  static void imageToColumns_(const Convolution2dGeometry& g,
+				      const Field* plane, uint32_t rowBegin,
+				      uint32_t rowEnd, Field* row) {
+	    const uint32_t outputWidth = g.outputWidth();
+
+	    for (uint32_t r = 0; r < g.kernelHeight; ++r) {
+	      for (uint32_t s = 0; s < g.kernelWidth; ++s) {
+		uint32_t begin, end;
+		validColumns(g, s, begin, end);
+		const int64_t x0 = int64_t(begin) * g.stride + s - g.padding;
+		for (uint32_t p = rowBegin; p < rowEnd; ++p) {
+		  const int64_t y = int64_t(p) * g.stride + r - g.padding;
+		  if ((y < 0) || (y >= int64_t(g.height)) || (begin == end)) {
+		    std::fill_n(row, outputWidth, Field(0));
+		  } else {
+		    const Field* src = plane + y * g.width + x0;
+		    std::fill_n(row, begin, Field(0));
+		    if (g.stride == 1) {
+		      std::copy_n(src, end - begin, row + begin);
+		    } else {
+		      for (uint32_t q = begin; q < end; ++q) {
+			row[q] = *src;
+			src += g.stride;
+		      }
+		    }
+		    std::fill(row + end, row + outputWidth, Field(0));
+		  }
+		  row += outputWidth;
+		}
+	      }
+	    }
+	  }
+
+	  template <typename Field>
+	  static void addColumnsToImage_(const Convolution2dGeometry& g,
+					 const Field* row, Field* plane) {
+	    const uint32_t outputHeight = g.outputHeight();
+	    const uint32_t outputWidth = g.outputWidth();
+
+	    for (uint32_t r = 0; r < g.kernelHeight; ++r) {
+	      for (uint32_t s = 0; s < g.kernelWidth; ++s) {
+		uint32_t begin, end;
+		validColumns(g, s, begin, end);
+		const int64_t x0 = int64_t(begin) * g.stride + s - g.padding;
+		for (uint32_t p = 0; p < outputHeight; ++p) {
+		  const int64_t y = int64_t(p) * g.stride + r - g.padding;
+		  if ((y >= 0) && (y < int64_t(g.height)) && (begin < end)) {
+		    Field* dest = plane + y * g.width + x0;
+		    for (uint32_t q = begin; q < end; ++q) {
+		      *dest += row[q];
+		      dest += g.stride;
+		    }
+		  }
+		  row += outputWidth;
+		}
+	      }
+	    }
+	  }
+	};
+
+      }
+    }
+  }
+}
+#endif
@@ -0,0 +1,87 @@
+#ifndef __NEURODIDACTIC__CORE__ARRAYS__DETAIL__DROPOUTKERNELS_HPP__
+#define __NEURODIDACTIC__CORE__ARRAYS__DETAIL__DROPOUTKERNELS_HPP__
+
+#include <neurodidactic/core/parallel/Elementwise.hpp>
+#include <neurodidactic/core/parallel/ThreadPool.hpp>
+#include <neurodidactic/core/random/Philox.hpp>
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace arrays {
+      namespace detail {
+
+	// Dropout with the mask packed 32 elements to a word, least
+	// significant bit first.  Both kernels split the work by mask word,
+	// so a task owns whole words and no two tasks write the same one.
+	// Element i is kept when word i of the random stream is at least
+	// "threshold," so the mask depends only on the generator, the
+	// stream and the threshold, not on the number of threads.
+	struct DropoutKernels {
+	  static constexpr const size_t BITS_PER_WORD = 32;
+
+	  static size_t numMaskWords(size_t n) {
+	    return (n + BITS_PER_WORD - 1) / BITS_PER_WORD;
+	  }
+
+	  // Draws the mask and writes y = mask ? x * scale : 0 in the same
+	  // pass, 32 random words at a time
+	  template <typename Field>
+	  static void dropout(const random::Philox4x32& rng, uint64_t stream,
+			      uint32_t threshold, Field scale, size_t n,
+			      const Field* x, uint32_t* mask, Field* y) {
+	    forWords_(n, [=, &rng](size_t begin, size_t end) {
+	      uint32_t r[BITS_PER_WORD];
+	      for (size_t w = begin; w < end; ++w) {
+		const size_t first = w * BITS_PER_WORD;
+		const size_t count =
+		    std::min(size_t(BITS_PER_WORD), n - first);
+		uint32_t bits = 0;
+		rng.generate(stream, first, count, r);
+		for (size_t k = 0; k < count; ++k) {
+		  const bool keep = r[k] >= threshold;
+		  bits |= uint32_t(keep) << k;
+		  y[first + k] = keep ? x[first + k] * scale : Field(0);
+		}
+		mask[w] = bits;
+	      }
+	    });
+	  }
+
+	  // y = mask ? x * scale : 0
+	  template <typename Field>
+	  static void applyMask(size_t n, const uint32_t* mask, Field scale,
+				const Field* x, Field* y) {
+	    forWords_(n, [=](size_t begin, size_t end) {
+	      for (size_t w = begin; w < end; ++w) {
+		const size_t first = w * BITS_PER_WORD;
+		const size_t count =
+		    std::min(size_t(BITS_PER_WORD), n - first);
+		const uint32_t bits = mask[w];
+		for (size_t k = 0; k < count; ++k) {
+		  y[first + k] =
+		      ((bits >> k) & 1) ? x[first + k] * scale : Field(0);
+		}
+	      }
+	    });
+	  }
+
+	private:
+	  template <typename Function>
+	  static void forWords_(size_t n, const Function& f) {
+	    parallel::parallelFor(
+		0, numMaskWords(n),
+		std::max(size_t(1),
+			 parallel::DEFAULT_GRAIN_SIZE / BITS_PER_WORD),
+		f
+	    );
+	  }
+	};
+
+      }
+    }
+  }
+}
+#endif
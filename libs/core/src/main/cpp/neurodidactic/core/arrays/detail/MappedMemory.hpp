@@ -0,0 +1,71 @@
+#ifndef __NEURODIDACTIC__CORE__ARRAYS__DETAIL__MAPPEDMEMORY_HPP__
+#define __NEURODIDACTIC__CORE__ARRAYS__DETAIL__MAPPEDMEMORY_HPP__
+
+#include <new>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace arrays {
+      namespace detail {
+
+	// Helpers for allocators that take large blocks straight from the
+	// kernel with mmap(), so they can control how the pages are placed
+	// and backed.  Mapped blocks are always page-aligned and
+	// zero-filled.
+
+	inline size_t pageSize() {
+	  static const size_t size = sysconf(_SC_PAGESIZE);
+	  return size;
+	}
+
+	inline size_t roundUpToMultiple(size_t n, size_t multiple) {
+	  return ((n + multiple - 1) / multiple) * multiple;
+	}
+
+	inline void* mapMemory(size_t size, int extraFlags = 0) {
+	  void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+			 MAP_PRIVATE | MAP_ANONYMOUS | extraFlags, -1, 0);
+	  return (p == MAP_FAILED) ? nullptr : p;
+	}
+
+	inline void* mapMemoryOrThrow(size_t size) {
+	  void* p = mapMemory(size);
+	  if (!p) {
+	    throw std::bad_alloc();
+	  }
+	  return p;
+	}
+
+	inline void unmapMemory(void* p, size_t size) noexcept {
+	  munmap(p, size);
+	}
+
+	// Maps "size" bytes starting at a multiple of "alignment" by mapping
+	// a larger block and unmapping the excess on both sides.  "size" and
+	// "alignment" must be multiples of the page size.
+	inline void* mapAlignedMemory(size_t size, size_t alignment) {
+	  char* p = (char*)mapMemory(size + alignment);
+	  if (!p) {
+	    return nullptr;
+	  }
+
+	  char* aligned =
+	      (char*)roundUpToMultiple((uintptr_t)p, alignment);
+	  if (aligned > p) {
+	    munmap(p, aligned - p);
+	  }
+	  if (aligned + size < p + size + alignment) {
+	    munmap(aligned + size, (p + size + alignment) - (aligned + size));
+	  }
+	  return aligned;
+	}
+
+      }
+    }
+  }
+}
+#endif
@@ -4,6 +4,7 @@
 #include <neurodidactic/core/arrays/DimensionList.hpp>
 #include <neurodidactic/core/arrays/AnyMdArray.hpp>
 #include <neurodidactic/core/arrays/detail/MklAdapter.hpp>
+#include <neurodidactic/core/parallel/Elementwise.hpp>
 #include <pistis/exceptions/ExceptionOrigin.hpp>
 #include <pistis/exceptions/IllegalValueError.hpp>
 
@@ -411,9 +412,11 @@ namespace neurodidactic {
 	  }
 
 	  template <typename Function>
-	  NewArray map(const Function& f) const {
+	  NewArray map(const Function& f,
+		       size_t grainSize =
+		           parallel::GrainSize<Function>::value) const {
 	    NewArray result(this->dimensions(), this->allocator());
-	    return std::move(this->map(f, result));
+	    return std::move(this->map(f, result, grainSize));
 	  }
 
 	  template <typename Function, typename ResultArray,
@@ -424,7 +427,9 @@ namespace neurodidactic {
 	                    ResultArray
 	                >::type
 		   >
-	  Enabled& map(const Function& f, ResultArray& result) const {
+	  Enabled& map(const Function& f, ResultArray& result,
+		       size_t grainSize =
+		           parallel::GrainSize<Function>::value) const {
 	    if (result.dimensions() != this->dimensions()) {
 	      std::ostringstream msg;
 	      msg << "Array \"result\" has incorrect dimensions "
@@ -434,21 +439,16 @@ namespace neurodidactic {
 							  PISTIS_EX_HERE);
 	    }
 
-	    auto p = this->data();
-	    auto q = result.data();
-#pragma omp parallel for
-	    {
-	      for (size_t i = 0; i < this->size(); ++i) {
-		q[i] = f(p[i]);
-	      }
-	    }
-
+	    parallel::elementwise(this->size(), this->data(), result.data(),
+				  f, grainSize);
 	    return result;
 	  }
 
 	  template <typename Function>
-	  DerivedArray& mapInPlace(Function f) {
-	    return this->map(f, this->self());
+	  DerivedArray& mapInPlace(Function f,
+				   size_t grainSize =
+				       parallel::GrainSize<Function>::value) {
+	    return this->map(f, this->self(), grainSize);
 	  }
 	  
 	//   const SliceType operator[](size_t n) const {
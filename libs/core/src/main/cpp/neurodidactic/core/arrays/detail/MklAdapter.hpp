@@ -1,7 +1,15 @@
 #ifndef __NEURODIDACTIC__CORE__ARRAYS__DETAIL__MKLADAPTER_HPP__
 #define __NEURODIDACTIC__CORE__ARRAYS__DETAIL__MKLADAPTER_HPP__
 
+#include <neurodidactic/core/arrays/HalfPrecision.hpp>
+#include <neurodidactic/core/profiling/KernelAccounting.hpp>
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalStateError.hpp>
+#include <algorithm>
+#include <sstream>
+#include <vector>
 #include <stddef.h>
+#include <stdint.h>
 #include <mkl.h>
 
 namespace neurodidactic {
@@ -17,54 +25,69 @@ namespace neurodidactic {
 
 	template<>
 	struct MklAdapter<float, float> {
+	  typedef profiling::KernelOp KernelOp;
+	  static constexpr const size_t BYTES = sizeof(float);
+
 	  static void add(size_t n, const float* x, const float* y,
 			  float* result) {
+	    NEURODIDACTIC_KERNEL_SCOPE(KernelOp::ADD, n, 3 * n * BYTES);
 	    vsAdd(n, x, y, result);
 	  }
 
 	  static void subtract(size_t n, const float* x, const float* y,
 			       float* result) {
+	    NEURODIDACTIC_KERNEL_SCOPE(KernelOp::SUBTRACT, n, 3 * n * BYTES);
 	    vsSub(n, x, y, result);
 	  }
 
 	  static void multiply(size_t n, const float* x, const float* y,
 			       float* result) {
+	    NEURODIDACTIC_KERNEL_SCOPE(KernelOp::MULTIPLY, n, 3 * n * BYTES);
 	    vsMul(n, x, y, result);
 	  }
 
 	  static void divide(size_t n, const float* x, const float* y,
 			     float* result) {
+	    NEURODIDACTIC_KERNEL_SCOPE(KernelOp::DIVIDE, n, 3 * n * BYTES);
 	    vsDiv(n, x, y, result);
 	  }
 
 	  static void scale(size_t n, float c, float* x) {
+	    NEURODIDACTIC_KERNEL_SCOPE(KernelOp::SCALE, n, 2 * n * BYTES);
 	    cblas_sscal(n, c, x, 1);
 	  }
 
 	  static void scale(size_t n, float c, const float* x, float* y) {
+	    NEURODIDACTIC_KERNEL_SCOPE(KernelOp::SCALE, n, 2 * n * BYTES);
 	    cblas_saxpby(n, c, x, 1, 0.0, y, 1);
 	  }
 
 	  static void scaleAndAdd(size_t n, float c, const float* x,
 				  float* y) {
+	    NEURODIDACTIC_KERNEL_SCOPE(KernelOp::AXPY, 2 * n, 3 * n * BYTES);
 	    cblas_saxpy(n, c, x, 1, y, 1);
 	  }
 
 	  static void scaleAndAdd(size_t n, float c1, const float* x,
 				  float c2, float* y) {
+	    NEURODIDACTIC_KERNEL_SCOPE(KernelOp::AXPBY, 3 * n, 3 * n * BYTES);
 	    cblas_saxpby(n, c1, x, 1, c2, y, 1);
 	  }
 
 	  static void exp(size_t n, const float* x, float* y) {
+	    NEURODIDACTIC_KERNEL_SCOPE(KernelOp::EXP, n, 2 * n * BYTES);
 	    vsExp(n, x, y);
 	  }
 
 	  static float innerProduct(size_t n, const float* x, const float* y) {
+	    NEURODIDACTIC_KERNEL_SCOPE(KernelOp::DOT, 2 * n, 2 * n * BYTES);
 	    return cblas_sdot(n, x, 1, y, 1);
 	  }
 
 	  static void outerProduct(size_t m, size_t n, const float* x,
 				   const float* v, float* y) {
+	    NEURODIDACTIC_KERNEL_SCOPE(KernelOp::OUTER, m * n,
+				       (m + n + m * n) * BYTES);
 	    float* p = y;
 	    for (size_t i = 0; i < m; ++i) {
 	      cblas_saxpby(n, x[i], v, 1, 0.0f, p, 1);
@@ -75,6 +98,8 @@ namespace neurodidactic {
 	  static void multiplyMatrixByVector(size_t m, size_t n,
 					     const float* x,
 					     const float* v, float *y) {
+	    NEURODIDACTIC_KERNEL_SCOPE(KernelOp::GEMV, 2 * m * n,
+				       (m * n + m + n) * BYTES);
 	    cblas_sgemv(CblasRowMajor, CblasNoTrans, m, n, 1.0f, x, n,
 			v, 1, 0.0f, y, 1);
 	  }
@@ -83,6 +108,8 @@ namespace neurodidactic {
 						      const float* x,
 						      const float* v,
 						      float* y) {
+	    NEURODIDACTIC_KERNEL_SCOPE(KernelOp::GEMV, 2 * m * n,
+				       (m * n + m + n) * BYTES);
 	    cblas_sgemv(CblasRowMajor, CblasTrans, m, n, 1.0f, x, n,
 			v, 1, 0.0f, y, 1);
 	  }
@@ -90,13 +117,356 @@ namespace neurodidactic {
 	  static void multiplyMatrixByMatrix(size_t m, size_t n, size_t k,
 					     const float* x, const float* u,
 					     float* y) {
+	    NEURODIDACTIC_KERNEL_SCOPE(KernelOp::GEMM, 2 * m * n * k,
+				       (m * k + k * n + m * n) * BYTES);
 	    cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, m, n, k,
 			1.0, x, k, u, n, 0.0, y, n);
 	  }
 
+	  static void multiplyMatrixByMatrixTranspose(size_t m, size_t n,
+						      size_t k,
+						      const float* x,
+						      const float* u,
+						      float* y) {
+	    NEURODIDACTIC_KERNEL_SCOPE(KernelOp::GEMM, 2 * m * n * k,
+				       (m * k + k * n + m * n) * BYTES);
+	    cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasTrans, m, n, k,
+			1.0, x, k, u, k, 0.0, y, n);
+	  }
+
+	  static void multiplyMatrixTransposeByMatrix(size_t m, size_t n,
+						      size_t k,
+						      const float* x,
+						      const float* u,
+						      float* y) {
+	    NEURODIDACTIC_KERNEL_SCOPE(KernelOp::GEMM, 2 * m * n * k,
+				       (m * k + k * n + m * n) * BYTES);
+	    cblas_sgemm(CblasRowMajor, CblasTrans, CblasNoTrans, m, n, k,
+			1.0, x, m, u, n, 0.0, y, n);
+	  }
+
+	  // Replaces the rows of the row-major matrix a[m, n] (its columns
+	  // if m > n) with the orthonormal factor of their QR
+	  // decomposition.  Each vector is multiplied by the sign of the
+	  // matching diagonal element of R, so a matrix of independent
+	  // normal samples becomes a uniformly distributed orthogonal one.
+	  //
+	  // sgeqrf wants the tall side down the columns of a column-major
+	  // matrix.  For m <= n that is a[m, n] as it lies in memory; for
+	  // m > n, a is transposed into scratch space first.
+	  static void orthonormalize(size_t m, size_t n, float* a) {
+	    const size_t tall = std::max(m, n);
+	    const size_t wide = std::min(m, n);
+	    NEURODIDACTIC_KERNEL_SCOPE(KernelOp::QR,
+				       4 * tall * wide * wide -
+				           4 * wide * wide * wide / 3,
+				       4 * tall * wide * BYTES);
+	    std::vector<float> transpose((m > n) ? m * n : 0);
+	    std::vector<float> tau(wide);
+	    std::vector<float> signs(wide);
+	    float* q = a;
+
+	    if (m > n) {
+	      q = transpose.data();
+	      for (size_t i = 0; i < m; ++i) {
+		for (size_t j = 0; j < n; ++j) {
+		  q[j * m + i] = a[i * n + j];
+		}
+	      }
+	    }
+	    checkLapack_("sgeqrf",
+			 LAPACKE_sgeqrf(LAPACK_COL_MAJOR, tall, wide, q, tall,
+					tau.data()));
+	    for (size_t k = 0; k < wide; ++k) {
+	      signs[k] = (q[k * tall + k] < 0.0f) ? -1.0f : 1.0f;
+	    }
+	    checkLapack_("sorgqr",
+			 LAPACKE_sorgqr(LAPACK_COL_MAJOR, tall, wide, wide, q,
+					tall, tau.data()));
+	    for (size_t k = 0; k < wide; ++k) {
+	      cblas_sscal(tall, signs[k], q + k * tall, 1);
+	    }
+	    if (m > n) {
+	      for (size_t i = 0; i < m; ++i) {
+		for (size_t j = 0; j < n; ++j) {
+		  a[i * n + j] = q[j * m + i];
+		}
+	      }
+	    }
+	  }
+
+	private:
+	  // LAPACKE returns a negative "info" for a bad argument and
+	  // LAPACK_WORK_MEMORY_ERROR when it cannot allocate workspace
+	  static void checkLapack_(const char* routine, lapack_int info) {
+	    if (info != 0) {
+	      std::ostringstream msg;
+	      msg << "LAPACKE_" << routine << " failed with info " << info;
+	      throw pistis::exceptions::IllegalStateError(msg.str(),
+							  PISTIS_EX_HERE);
+	    }
+	  }
+
+	};
+
+	// Portable kernels for half-precision weights with float results.
+	// The weights are converted to float one cache-sized panel of rows
+	// at a time, and each panel is multiplied with sgemv/sgemm, so the
+	// full-width copy of the matrix never exists in memory.  The other
+	// operand may be float, which is used as is, or half precision,
+	// which is converted to float first.
+	template <typename Half>
+	struct HalfPrecisionKernels {
+	  static constexpr const size_t PANEL_SIZE = 32768;
+
+	  static void multiplyMatrixByVector(size_t m, size_t n,
+					     const Half* x, const Half* v,
+					     float* y) {
+	    std::vector<float>& vector = scratch_(0);
+	    vector.resize(n);
+	    toFloat_(n, v, vector.data());
+	    multiplyMatrixByVector(m, n, x, vector.data(), y);
+	  }
+
+	  static void multiplyMatrixByVector(size_t m, size_t n,
+					     const Half* x, const float* v,
+					     float* y) {
+	    std::vector<float>& panel = scratch_(1);
+	    const size_t panelRows = std::max(PANEL_SIZE / n, size_t(1));
+
+	    panel.resize(panelRows * n);
+	    for (size_t r = 0; r < m; r += panelRows) {
+	      const size_t rows = std::min(panelRows, m - r);
+	      toFloat_(rows * n, x + r * n, panel.data());
+	      cblas_sgemv(CblasRowMajor, CblasNoTrans, rows, n, 1.0f,
+			  panel.data(), n, v, 1, 0.0f, y + r, 1);
+	    }
+	  }
+
+	  static void multiplyMatrixByMatrixTranspose(size_t m, size_t n,
+						      size_t k,
+						      const Half* x,
+						      const Half* u,
+						      float* y) {
+	    std::vector<float>& inputs = scratch_(0);
+	    inputs.resize(m * k);
+	    toFloat_(m * k, x, inputs.data());
+	    multiplyMatrixByMatrixTranspose(m, n, k, inputs.data(), u, y);
+	  }
+
+	  static void multiplyMatrixByMatrixTranspose(size_t m, size_t n,
+						      size_t k,
+						      const float* x,
+						      const Half* u,
+						      float* y) {
+	    std::vector<float>& panel = scratch_(1);
+	    const size_t panelRows = std::max(PANEL_SIZE / k, size_t(1));
+
+	    panel.resize(panelRows * k);
+	    for (size_t r = 0; r < n; r += panelRows) {
+	      const size_t rows = std::min(panelRows, n - r);
+	      toFloat_(rows * k, u + r * k, panel.data());
+	      cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasTrans, m, rows, k,
+			  1.0f, x, k, panel.data(), k, 0.0f, y + r, n);
+	    }
+	  }
+
+	private:
+	  static void toFloat_(size_t n, const Half* x, float* y) {
+	    for (size_t i = 0; i < n; ++i) {
+	      y[i] = float(x[i]);
+	    }
+	  }
+
+	  static std::vector<float>& scratch_(size_t n) {
+	    static thread_local std::vector<float> buffers[2];
+	    return buffers[n];
+	  }
+	};
+
+	// Mixed-precision products: bf16 operands, float accumulation and
+	// results.  Define NEURODIDACTIC_USE_MKL_BF16 when building against
+	// MKL 2020 or later to use its native bf16 gemm (AVX512-BF16/AMX on
+	// processors that have them).
+	template<>
+	struct MklAdapter<BFloat16, BFloat16> {
+	  static void multiplyMatrixByVector(size_t m, size_t n,
+					     const BFloat16* x,
+					     const BFloat16* v, float* y) {
+	    NEURODIDACTIC_KERNEL_SCOPE(
+		profiling::KernelOp::GEMV_BF16, 2 * m * n,
+		(m * n + n) * sizeof(BFloat16) + m * sizeof(float)
+	    );
+#ifdef NEURODIDACTIC_USE_MKL_BF16
+	    cblas_gemm_bf16bf16f32(CblasRowMajor, CblasNoTrans, CblasNoTrans,
+				   m, 1, n, 1.0f, (const MKL_BF16*)x, n,
+				   (const MKL_BF16*)v, 1, 0.0f, y, 1);
+#else
+	    HalfPrecisionKernels<BFloat16>::multiplyMatrixByVector(m, n, x,
+								   v, y);
+#endif
+	  }
+
+	  static void multiplyMatrixByMatrixTranspose(size_t m, size_t n,
+						      size_t k,
+						      const BFloat16* x,
+						      const BFloat16* u,
+						      float* y) {
+	    NEURODIDACTIC_KERNEL_SCOPE(
+		profiling::KernelOp::GEMM_BF16, 2 * m * n * k,
+		(m * k + n * k) * sizeof(BFloat16) + m * n * sizeof(float)
+	    );
+#ifdef NEURODIDACTIC_USE_MKL_BF16
+	    cblas_gemm_bf16bf16f32(CblasRowMajor, CblasNoTrans, CblasTrans,
+				   m, n, k, 1.0f, (const MKL_BF16*)x, k,
+				   (const MKL_BF16*)u, k, 0.0f, y, n);
+#else
+	    HalfPrecisionKernels<BFloat16>::multiplyMatrixByMatrixTranspose(
+		m, n, k, x, u, y
+	    );
+#endif
+	  }
+
+	  // Float activations times BFloat16 weights.  Only the weights are
+	  // converted, so the activations keep their full precision.
+	  static void multiplyMatrixByVector(size_t m, size_t n,
+					     const BFloat16* x,
+					     const float* v, float* y) {
+	    NEURODIDACTIC_KERNEL_SCOPE(
+		profiling::KernelOp::GEMV_BF16, 2 * m * n,
+		m * n * sizeof(BFloat16) + (n + m) * sizeof(float)
+	    );
+	    HalfPrecisionKernels<BFloat16>::multiplyMatrixByVector(m, n, x,
+								   v, y);
+	  }
+
+	  static void multiplyMatrixByMatrixTranspose(size_t m, size_t n,
+						      size_t k,
+						      const float* x,
+						      const BFloat16* u,
+						      float* y) {
+	    NEURODIDACTIC_KERNEL_SCOPE(
+		profiling::KernelOp::GEMM_BF16, 2 * m * n * k,
+		n * k * sizeof(BFloat16) + (m * k + m * n) * sizeof(float)
+	    );
+	    HalfPrecisionKernels<BFloat16>::multiplyMatrixByMatrixTranspose(
+		m, n, k, x, u, y
+	    );
+	  }
+	};
+
+	// Same for IEEE half precision.  NEURODIDACTIC_USE_MKL_F16 selects
+	// MKL's native fp16 gemm.
+	template<>
+	struct MklAdapter<Float16, Float16> {
+	  static void multiplyMatrixByVector(size_t m, size_t n,
+					     const Float16* x,
+					     const Float16* v, float* y) {
+	    NEURODIDACTIC_KERNEL_SCOPE(
+		profiling::KernelOp::GEMV_F16, 2 * m * n,
+		(m * n + n) * sizeof(Float16) + m * sizeof(float)
+	    );
+#ifdef NEURODIDACTIC_USE_MKL_F16
+	    cblas_gemm_f16f16f32(CblasRowMajor, CblasNoTrans, CblasNoTrans,
+				 m, 1, n, 1.0f, (const MKL_F16*)x, n,
+				 (const MKL_F16*)v, 1, 0.0f, y, 1);
+#else
+	    HalfPrecisionKernels<Float16>::multiplyMatrixByVector(m, n, x,
+								  v, y);
+#endif
+	  }
+
+	  static void multiplyMatrixByMatrixTranspose(size_t m, size_t n,
+						      size_t k,
+						      const Float16* x,
+						      const Float16* u,
+						      float* y) {
+	    NEURODIDACTIC_KERNEL_SCOPE(
+		profiling::KernelOp::GEMM_F16, 2 * m * n * k,
+		(m * k + n * k) * sizeof(Float16) + m * n * sizeof(float)
+	    );
+#ifdef NEURODIDACTIC_USE_MKL_F16
+	    cblas_gemm_f16f16f32(CblasRowMajor, CblasNoTrans, CblasTrans,
+				 m, n, k, 1.0f, (const MKL_F16*)x, k,
+				 (const MKL_F16*)u, k, 0.0f, y, n);
+#else
+	    HalfPrecisionKernels<Float16>::multiplyMatrixByMatrixTranspose(
+		m, n, k, x, u, y
+	    );
+#endif
+	  }
+
+	  // Float activations times Float16 weights.  Only the weights are
+	  // converted, so the activations keep their full precision.
+	  static void multiplyMatrixByVector(size_t m, size_t n,
+					     const Float16* x,
+					     const float* v, float* y) {
+	    NEURODIDACTIC_KERNEL_SCOPE(
+		profiling::KernelOp::GEMV_F16, 2 * m * n,
+		m * n * sizeof(Float16) + (n + m) * sizeof(float)
+	    );
+	    HalfPrecisionKernels<Float16>::multiplyMatrixByVector(m, n, x,
+								  v, y);
+	  }
+
+	  static void multiplyMatrixByMatrixTranspose(size_t m, size_t n,
+						      size_t k,
+						      const float* x,
+						      const Float16* u,
+						      float* y) {
+	    NEURODIDACTIC_KERNEL_SCOPE(
+		profiling::KernelOp::GEMM_F16, 2 * m * n * k,
+		n * k * sizeof(Float16) + (m * k + m * n) * sizeof(float)
+	    );
+	    HalfPrecisionKernels<Float16>::multiplyMatrixByMatrixTranspose(
+		m, n, k, x, u, y
+	    );
+	  }
+	};
+
+	// Integer products for quantized layers: signed 8-bit weights,
+	// unsigned 8-bit inputs with a zero point of 128 (so the stored value
+	// is the signed quantized input plus 128), and 32-bit accumulators.
+	// Computes y[m x n] = (x[m x k] - 128) * w[n x k]^T.  Uses MKL's
+	// integer gemm (VNNI on processors that have it) unless
+	// NEURODIDACTIC_NO_MKL_INT8_GEMM is defined.
+	template<>
+	struct MklAdapter<int8_t, uint8_t> {
+	  static constexpr const int32_t INPUT_ZERO_POINT = 128;
+
+	  static void multiplyMatrixByMatrixTranspose(size_t m, size_t n,
+						      size_t k,
+						      const uint8_t* x,
+						      const int8_t* w,
+						      int32_t* y) {
+	    NEURODIDACTIC_KERNEL_SCOPE(
+		profiling::KernelOp::GEMM_S8U8, 2 * m * n * k,
+		m * k + n * k + m * n * sizeof(int32_t)
+	    );
+#ifndef NEURODIDACTIC_NO_MKL_INT8_GEMM
+	    // In column-major terms, y^T[n x m] = w[n x k] * x^T[k x m]
+	    const MKL_INT32 noOffset = 0;
+	    cblas_gemm_s8u8s32(CblasColMajor, CblasTrans, CblasNoTrans,
+			       CblasFixOffset, n, m, k, 1.0f, w, k, 0, x, k,
+			       -INPUT_ZERO_POINT, 0.0f, (MKL_INT32*)y, n,
+			       &noOffset);
+#else
+	    for (size_t i = 0; i < m; ++i) {
+	      const uint8_t* row = x + i * k;
+	      for (size_t j = 0; j < n; ++j) {
+		const int8_t* weights = w + j * k;
+		int32_t sum = 0;
+		for (size_t l = 0; l < k; ++l) {
+		  sum += (int32_t(row[l]) - INPUT_ZERO_POINT) *
+			     int32_t(weights[l]);
+		}
+		y[i * n + j] = sum;
+	      }
+	    }
+#endif
+	  }
 	};
 
-	
       }
     }
   }
@@ -0,0 +1,143 @@
+#ifndef __NEURODIDACTIC__CORE__ARRAYS__DETAIL__NORMALIZATIONKERNELS_HPP__
+#define __NEURODIDACTIC__CORE__ARRAYS__DETAIL__NORMALIZATIONKERNELS_HPP__
+
+#include <neurodidactic/core/parallel/Elementwise.hpp>
+#include <neurodidactic/core/parallel/ThreadPool.hpp>
+#include <algorithm>
+#include <cmath>
+#include <stddef.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace arrays {
+      namespace detail {
+
+	// Per-feature kernels for batch normalization of a [rows, columns]
+	// matrix with one example per row.  Every kernel splits the work by
+	// column, so each task owns a band of features and walks down the
+	// rows of the batch.  The innermost loops run along a row, where
+	// the features are contiguous, and vectorize; the per-feature sums
+	// live in the caller's output vectors, so a band's accumulators
+	// stay in L1 for the whole pass.
+	struct BatchNormKernels {
+	  // Keeps a task's band of columns at about DEFAULT_GRAIN_SIZE
+	  // elements
+	  static size_t columnGrainSize(size_t numRows) {
+	    return std::max(size_t(1),
+			    parallel::DEFAULT_GRAIN_SIZE /
+				std::max(numRows, size_t(1)));
+	  }
+
+	  // Mean and (biased) variance of every column of x in one pass.
+	  // The sums are taken about the first row rather than about
+	  // zero, so features with a large mean and a small spread don't
+	  // lose their variance to cancellation.
+	  template <typename Field>
+	  static void moments(size_t numRows, size_t numColumns,
+			      const Field* x, Field* mean,
+			      Field* variance) {
+	    forColumns_(numRows, numColumns,
+			[=](size_t begin, size_t end) {
+	      const Field* origin = x;
+	      Field* sum = mean;
+	      Field* sumOfSquares = variance;
+	      std::fill(sum + begin, sum + end, Field(0));
+	      std::fill(sumOfSquares + begin, sumOfSquares + end, Field(0));
+	      for (size_t i = 1; i < numRows; ++i) {
+		const Field* row = x + i * numColumns;
+		for (size_t j = begin; j < end; ++j) {
+		  const Field d = row[j] - origin[j];
+		  sum[j] += d;
+		  sumOfSquares[j] += d * d;
+		}
+	      }
+	      const Field scale = Field(1) / Field(numRows);
+	      for (size_t j = begin; j < end; ++j) {
+		const Field m = sum[j] * scale;
+		sumOfSquares[j] =
+		    std::max(sumOfSquares[j] * scale - m * m, Field(0));
+		sum[j] = origin[j] + m;
+	      }
+	    });
+	  }
+
+	  // y[i, j] = f(x[i, j] * scale[j] + shift[j]), which is the whole
+	  // of normalization once the statistics and the learned scale
+	  // and shift are folded into one scale and shift per feature
+	  template <typename Field, typename Nonlinearity>
+	  static void scaleAndShift(size_t numRows, size_t numColumns,
+				    const Field* x, const Field* scale,
+				    const Field* shift,
+				    const Nonlinearity& f, Field* y) {
+	    forColumns_(numRows, numColumns,
+			[=, &f](size_t begin, size_t end) {
+	      for (size_t i = 0; i < numRows; ++i) {
+		const Field* in = x + i * numColumns;
+		Field* out = y + i * numColumns;
+		for (size_t j = begin; j < end; ++j) {
+		  out[j] = f.apply(in[j] * scale[j] + shift[j]);
+		}
+	      }
+	    });
+	  }
+
+	  // Gradients of sum(dy * y) for y = gamma * (x - mean) * invStd
+	  // + beta, where mean and invStd are the statistics of x itself.
+	  // The first pass sums dy and dy * xHat for each feature, which
+	  // are the gradients of beta and gamma; the second writes
+	  //
+	  //   dx = gamma * invStd * (dy - (sum(dy) + xHat * sum(dy * xHat))
+	  //                               / numRows)
+	  //
+	  // with xHat recomputed from x rather than read from memory.
+	  template <typename Field>
+	  static void backward(size_t numRows, size_t numColumns,
+			       const Field* x, const Field* mean,
+			       const Field* invStd, const Field* gamma,
+			       const Field* dy, Field* gammaGradient,
+			       Field* betaGradient, Field* dx) {
+	    forColumns_(numRows, numColumns,
+			[=](size_t begin, size_t end) {
+	      std::fill(gammaGradient + begin, gammaGradient + end,
+			Field(0));
+	      std::fill(betaGradient + begin, betaGradient + end, Field(0));
+	      for (size_t i = 0; i < numRows; ++i) {
+		const Field* in = x + i * numColumns;
+		const Field* g = dy + i * numColumns;
+		for (size_t j = begin; j < end; ++j) {
+		  const Field xHat = (in[j] - mean[j]) * invStd[j];
+		  gammaGradient[j] += g[j] * xHat;
+		  betaGradient[j] += g[j];
+		}
+	      }
+
+	      // dx = a * dy + b * x + c, with the constants per feature
+	      const Field scale = Field(1) / Field(numRows);
+	      for (size_t i = 0; i < numRows; ++i) {
+		const Field* in = x + i * numColumns;
+		const Field* g = dy + i * numColumns;
+		Field* out = dx + i * numColumns;
+		for (size_t j = begin; j < end; ++j) {
+		  const Field a = gamma[j] * invStd[j];
+		  const Field b = -a * invStd[j] * gammaGradient[j] * scale;
+		  const Field c = -a * betaGradient[j] * scale - b * mean[j];
+		  out[j] = a * g[j] + b * in[j] + c;
+		}
+	      }
+	    });
+	  }
+
+	private:
+	  template <typename Function>
+	  static void forColumns_(size_t numRows, size_t numColumns,
+				  const Function& f) {
+	    parallel::parallelFor(0, numColumns, columnGrainSize(numRows),
+				  f, parallel::ELEMENTWISE_ALIGNMENT);
+	  }
+	};
+
+      }
+    }
+  }
+}
+#endif
@@ -0,0 +1,258 @@
+#ifndef __NEURODIDACTIC__CORE__ARRAYS__DETAIL__NUMASUPPORT_HPP__
+#define __NEURODIDACTIC__CORE__ARRAYS__DETAIL__NUMASUPPORT_HPP__
+
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sched.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace arrays {
+      namespace detail {
+
+	// Minimal NUMA support made directly from system calls, so the
+	// library does not depend on libnuma.  Memory placement is only ever
+	// a hint: on machines or containers without NUMA support the calls
+	// fail and memory gets the kernel's default (first-touch) placement.
+
+	static constexpr const int NUMA_MPOL_PREFERRED = 1;
+	static constexpr const int NUMA_MPOL_INTERLEAVE = 3;
+	static constexpr const size_t MAX_NUMA_NODES = 1024;
+
+	// Reads a list of ids like "0-3,8,10-11" from a file under /sys,
+	// ignoring ids of MAX_NUMA_NODES or more.  Returns an empty list if
+	// the file cannot be read.
+	inline std::vector<int> readIdList(const std::string& path) {
+	  std::vector<int> result;
+	  std::ifstream input(path);
+	  std::string ranges;
+
+	  if (input && std::getline(input, ranges)) {
+	    const char* p = ranges.c_str();
+	    while (*p) {
+	      char* next;
+	      const long first = strtol(p, &next, 10);
+	      long last = first;
+	      if (next == p) {
+		break;
+	      }
+	      if (*next == '-') {
+		p = next + 1;
+		last = strtol(p, &next, 10);
+	      }
+	      for (long n = first; n <= last; ++n) {
+		if ((n >= 0) && (n < (long)MAX_NUMA_NODES)) {
+		  result.push_back((int)n);
+		}
+	      }
+	      p = (*next == ',') ? next + 1 : next;
+	    }
+	  }
+	  return result;
+	}
+
+	// Returns the ids of the nodes listed in
+	// /sys/devices/system/node/online, e.g. "0-1,4"
+	inline const std::vector<int>& onlineNumaNodes() {
+	  static const std::vector<int> nodes = []() {
+	    std::vector<int> result =
+	        readIdList("/sys/devices/system/node/online");
+	    if (result.empty()) {
+	      result.push_back(0);
+	    }
+	    return result;
+	  }();
+	  return nodes;
+	}
+
+	// Highest online node id, like numa_max_node() in libnuma
+	inline int maxNumaNode() {
+	  const std::vector<int>& nodes = onlineNumaNodes();
+	  return *std::max_element(nodes.begin(), nodes.end());
+	}
+
+	// Throws IllegalValueError unless 0 <= node <= maxNumaNode()
+	inline void checkNumaNode(int node) {
+	  if ((node < 0) || (node > maxNumaNode())) {
+	    std::ostringstream msg;
+	    msg << "NUMA node " << node << " does not exist (the highest "
+		<< "online node is " << maxNumaNode() << ")";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	}
+
+	inline size_t numNumaNodes() { return onlineNumaNodes().size(); }
+
+	// Node of the CPU the calling thread is running on right now
+	inline int currentNumaNode() {
+	  unsigned cpu = 0;
+	  unsigned node = 0;
+	  if (syscall(SYS_getcpu, &cpu, &node, nullptr)) {
+	    return 0;
+	  }
+	  return (int)node;
+	}
+
+	// Applies a memory policy to [p, p + size).  Returns true if the
+	// kernel accepted it.  Throws IllegalValueError if any of the nodes
+	// does not exist.
+	inline bool bindMemory(void* p, size_t size, int mode,
+			       const std::vector<int>& nodes) {
+	  static constexpr const size_t BITS = 8 * sizeof(unsigned long);
+	  unsigned long mask[MAX_NUMA_NODES / BITS] = { 0 };
+
+	  for (int n : nodes) {
+	    // maxNumaNode() is always less than MAX_NUMA_NODES, so this also
+	    // keeps the write inside the mask
+	    checkNumaNode(n);
+	    mask[n / BITS] |= 1UL << (n % BITS);
+	  }
+	  return !syscall(SYS_mbind, p, size, mode, mask, MAX_NUMA_NODES + 1,
+			  0);
+	}
+
+	// Restricts the calling thread to the CPUs of "node."  Returns true
+	// if the kernel accepted the new affinity.
+	inline bool pinToNumaNode(int node) {
+	  std::ostringstream path;
+	  path << "/sys/devices/system/node/node" << node << "/cpulist";
+	  const std::vector<int> cpus = readIdList(path.str());
+	  cpu_set_t cpuSet;
+
+	  CPU_ZERO(&cpuSet);
+	  for (int cpu : cpus) {
+	    if (cpu < CPU_SETSIZE) {
+	      CPU_SET(cpu, &cpuSet);
+	    }
+	  }
+	  return !cpus.empty() &&
+	         !sched_setaffinity(0, sizeof(cpuSet), &cpuSet);
+	}
+
+	// One persistent thread per online node, pinned to that node's CPUs,
+	// for work that has to happen on a particular node, like touching
+	// freshly-mapped pages so the kernel places them there.  Threads
+	// that cannot be pinned (no NUMA support) still run, unpinned.
+	class NumaNodeWorkers {
+	public:
+	  NumaNodeWorkers():
+	      nodes_(onlineNumaNodes()), runMutex_(), mutex_(), workReady_(),
+	      workDone_(), generation_(0), pending_(0), stop_(false), job_(),
+	      errors_(nodes_.size()), workers_() {
+	    for (size_t i = 0; i < nodes_.size(); ++i) {
+	      workers_.emplace_back([this, i]() { this->workerLoop_(i); });
+	    }
+	  }
+
+	  NumaNodeWorkers(const NumaNodeWorkers&) = delete;
+
+	  ~NumaNodeWorkers() noexcept {
+	    {
+	      std::unique_lock<std::mutex> lock(mutex_);
+	      stop_ = true;
+	      ++generation_;
+	    }
+	    workReady_.notify_all();
+	    for (auto& t : workers_) {
+	      t.join();
+	    }
+	  }
+
+	  // Same order as onlineNumaNodes()
+	  const std::vector<int>& nodes() const { return nodes_; }
+
+	  // Calls f(i) on the worker for node nodes()[i], for every i, and
+	  // waits for all of them.  The first exception thrown by f is
+	  // rethrown after every call returns.
+	  void run(const std::function<void (size_t)>& f) {
+	    std::unique_lock<std::mutex> running(runMutex_);
+	    {
+	      std::unique_lock<std::mutex> lock(mutex_);
+	      job_ = f;
+	      pending_ = workers_.size();
+	      ++generation_;
+	    }
+	    workReady_.notify_all();
+
+	    std::unique_lock<std::mutex> lock(mutex_);
+	    workDone_.wait(lock, [this]() { return !pending_; });
+	    job_ = nullptr;
+	    for (auto& error : errors_) {
+	      if (error) {
+		std::exception_ptr e = error;
+		std::fill(errors_.begin(), errors_.end(), nullptr);
+		std::rethrow_exception(e);
+	      }
+	    }
+	  }
+
+	  NumaNodeWorkers& operator=(const NumaNodeWorkers&) = delete;
+
+	  static NumaNodeWorkers& instance() {
+	    static NumaNodeWorkers workers;
+	    return workers;
+	  }
+
+	private:
+	  const std::vector<int> nodes_;
+	  std::mutex runMutex_;
+	  std::mutex mutex_;
+	  std::condition_variable workReady_;
+	  std::condition_variable workDone_;
+	  uint64_t generation_;
+	  size_t pending_;
+	  bool stop_;
+	  std::function<void (size_t)> job_;
+	  std::vector<std::exception_ptr> errors_;
+	  std::vector<std::thread> workers_;
+
+	  void workerLoop_(size_t i) {
+	    uint64_t lastGeneration = 0;
+	    pinToNumaNode(nodes_[i]);
+	    while (true) {
+	      {
+		std::unique_lock<std::mutex> lock(mutex_);
+		workReady_.wait(lock, [this, lastGeneration]() {
+		    return generation_ != lastGeneration;
+		});
+		lastGeneration = generation_;
+		if (stop_) {
+		  return;
+		}
+	      }
+	      try {
+		job_(i);
+	      } catch(...) {
+		errors_[i] = std::current_exception();
+	      }
+	      {
+		std::unique_lock<std::mutex> lock(mutex_);
+		--pending_;
+	      }
+	      workDone_.notify_all();
+	    }
+	  }
+	};
+
+      }
+    }
+  }
+}
+#endif
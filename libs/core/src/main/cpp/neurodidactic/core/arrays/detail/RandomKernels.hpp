@@ -0,0 +1,95 @@
+#ifndef __NEURODIDACTIC__CORE__ARRAYS__DETAIL__RANDOMKERNELS_HPP__
+#define __NEURODIDACTIC__CORE__ARRAYS__DETAIL__RANDOMKERNELS_HPP__
+
+#include <neurodidactic/core/parallel/Elementwise.hpp>
+#include <neurodidactic/core/parallel/ThreadPool.hpp>
+#include <neurodidactic/core/random/Philox.hpp>
+#include <algorithm>
+#include <cmath>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace arrays {
+      namespace detail {
+
+	// Fills arrays with random samples in parallel.  Element i is a
+	// function of word i of the stream (words i and i + 1 for the
+	// normal pairs, with i even), so the result depends on the seed and
+	// the stream but not on the number of threads.  Each task draws
+	// its words BUFFER_SIZE at a time into a buffer on its stack and
+	// transforms them in a second loop.
+	struct RandomKernels {
+	  static constexpr const size_t BUFFER_SIZE = 256;
+
+	  // The transforms cost far more than an elementwise add
+	  static constexpr const size_t GRAIN_SIZE =
+	      parallel::DEFAULT_GRAIN_SIZE / 8;
+
+	  // Uniform on [low, high)
+	  template <typename Field>
+	  static void uniform(const random::Philox4x32& rng,
+			      uint64_t stream, Field low, Field high,
+			      size_t n, Field* out) {
+	    typedef random::Philox4x32 Philox;
+	    const Field width = high - low;
+	    forChunks_(rng, stream, n,
+		       [=](const uint32_t* r, size_t count, Field* y) {
+	      for (size_t i = 0; i < count; ++i) {
+		y[i] = low + width * Field(Philox::toUniform(r[i]));
+	      }
+	    }, out);
+	  }
+
+	  // Normal with the given mean and standard deviation, by the
+	  // Box-Muller transform of successive pairs of words
+	  template <typename Field>
+	  static void normal(const random::Philox4x32& rng, uint64_t stream,
+			     Field mean, Field stddev, size_t n, Field* out) {
+	    typedef random::Philox4x32 Philox;
+	    const Field twoPi = Field(6.283185307179586);
+	    forChunks_(rng, stream, n,
+		       [=](const uint32_t* r, size_t count, Field* y) {
+	      for (size_t i = 0; i < count; i += 2) {
+		const Field radius = stddev * std::sqrt(
+		    Field(-2) * std::log(Field(Philox::toOpenUniform(r[i])))
+		);
+		const Field angle = twoPi * Field(Philox::toUniform(r[i + 1]));
+		y[i] = mean + radius * std::cos(angle);
+		if (i + 1 < count) {
+		  y[i + 1] = mean + radius * std::sin(angle);
+		}
+	      }
+	    }, out);
+	  }
+
+	private:
+	  // Calls f(words, count, y) for runs of up to BUFFER_SIZE
+	  // elements, with words[0..count) the words of the run's elements
+	  // and one more if count is odd.  Runs start at even positions.
+	  template <typename Field, typename Function>
+	  static void forChunks_(const random::Philox4x32& rng,
+				 uint64_t stream, size_t n, const Function& f,
+				 Field* out) {
+	    parallel::parallelFor(
+		0, n, GRAIN_SIZE,
+		[&rng, stream, &f, out](size_t begin, size_t end) {
+		  uint32_t r[BUFFER_SIZE + 1];
+		  for (size_t i = begin; i < end; i += BUFFER_SIZE) {
+		    const size_t count =
+			std::min(size_t(BUFFER_SIZE), end - i);
+		    rng.generate(stream, i, count + (count & 1), r);
+		    f(r, count, out + i);
+		  }
+		},
+		parallel::ELEMENTWISE_ALIGNMENT
+	    );
+	  }
+	};
+
+      }
+    }
+  }
+}
+#endif
@@ -0,0 +1,234 @@
+#ifndef __NEURODIDACTIC__CORE__ARRAYS__DETAIL__SPARSEKERNELS_HPP__
+#define __NEURODIDACTIC__CORE__ARRAYS__DETAIL__SPARSEKERNELS_HPP__
+
+#include <neurodidactic/core/parallel/Elementwise.hpp>
+#include <neurodidactic/core/parallel/ThreadPool.hpp>
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace arrays {
+      namespace detail {
+
+	// Kernels for matrices in compressed sparse row (CSR) form.  Row i
+	// of an m-row matrix holds the nonzeros values[k] at columns
+	// columns[k] for k in [rowOffsets[i], rowOffsets[i + 1]).
+	struct CsrKernels {
+	  // Rows of the input batch processed together, so that each
+	  // sparse row is read once per tile instead of once per batch row
+	  static constexpr const size_t BATCH_TILE_SIZE = 8;
+
+	  // Number of chunks of rows forRowChunks() splits a matrix into:
+	  // one per DEFAULT_GRAIN_SIZE units of work, but no more than one
+	  // per row.  "work" is the cost of one nonzero relative to one
+	  // elementwise operation.
+	  static size_t numRowChunks(size_t m, uint64_t numNonZeros,
+				     size_t work = 1) {
+	    return std::max(
+		uint64_t(1),
+		std::min(uint64_t(m),
+			 work * numNonZeros / parallel::DEFAULT_GRAIN_SIZE)
+	    );
+	  }
+
+	  // First row of chunk c of numChunks, found by a binary search of
+	  // rowOffsets (the prefix sums of the row lengths) for the first
+	  // row that starts at or after c / numChunks of the nonzeros.
+	  // Chunk numChunks starts at m.
+	  static size_t rowChunkBegin(size_t m, const uint64_t* rowOffsets,
+				      size_t c, size_t numChunks) {
+	    if (c >= numChunks) {
+	      return m;
+	    }
+	    const uint64_t offset = c * rowOffsets[m] / numChunks;
+	    return std::lower_bound(rowOffsets, rowOffsets + m, offset) -
+		       rowOffsets;
+	  }
+
+	  // Calls f(rowBegin, rowEnd) over [0, m) on the thread pool, in
+	  // chunks of rows that hold about the same number of nonzeros, so
+	  // a few dense rows don't leave one thread with most of the work
+	  template <typename Function>
+	  static void forRowChunks(size_t m, const uint64_t* rowOffsets,
+				   size_t work, const Function& f) {
+	    const size_t numChunks = numRowChunks(m, rowOffsets[m], work);
+	    parallel::parallelFor(
+		0, numChunks, 1,
+		[=, &f](size_t chunkBegin, size_t chunkEnd) {
+		  const size_t begin =
+		      rowChunkBegin(m, rowOffsets, chunkBegin, numChunks);
+		  const size_t end =
+		      rowChunkBegin(m, rowOffsets, chunkEnd, numChunks);
+		  if (begin < end) {
+		    f(begin, end);
+		  }
+		}
+	    );
+	  }
+
+	  // y = A x, where A is m x n
+	  template <typename Field>
+	  static void multiplyMatrixByVector(
+	      size_t m, const uint64_t* rowOffsets, const uint32_t* columns,
+	      const Field* values, const Field* x, Field* y
+	  ) {
+	    forRowChunks(
+		m, rowOffsets, 1,
+		[=](size_t begin, size_t end) {
+		  for (size_t i = begin; i < end; ++i) {
+		    Field sum(0);
+		    for (uint64_t k = rowOffsets[i]; k < rowOffsets[i + 1];
+			 ++k) {
+		      sum += values[k] * x[columns[k]];
+		    }
+		    y[i] = sum;
+		  }
+		}
+	    );
+	  }
+
+	  // y = x A^T, where x is k x n (row-major), A is m x n and y is
+	  // k x m (row-major)
+	  template <typename Field>
+	  static void multiplyMatrixByMatrixTranspose(
+	      size_t k, size_t m, size_t n, const Field* x,
+	      const uint64_t* rowOffsets, const uint32_t* columns,
+	      const Field* values, Field* y
+	  ) {
+	    forRowChunks(
+		m, rowOffsets, k,
+		[=](size_t begin, size_t end) {
+		  Field sums[BATCH_TILE_SIZE];
+		  for (size_t i = begin; i < end; ++i) {
+		    for (size_t b = 0; b < k; b += BATCH_TILE_SIZE) {
+		      const size_t tileSize =
+			  std::min(size_t(BATCH_TILE_SIZE), k - b);
+		      const Field* tile = x + b * n;
+		      std::fill_n(sums, tileSize, Field(0));
+		      for (uint64_t j = rowOffsets[i]; j < rowOffsets[i + 1];
+			   ++j) {
+			const Field v = values[j];
+			const Field* p = tile + columns[j];
+			for (size_t t = 0; t < tileSize; ++t, p += n) {
+			  sums[t] += v * *p;
+			}
+		      }
+		      for (size_t t = 0; t < tileSize; ++t) {
+			y[(b + t) * m + i] = sums[t];
+		      }
+		    }
+		  }
+		}
+	    );
+	  }
+	};
+
+	// Kernels for products of a dense row-major matrix with a sparse
+	// vector holding nnz nonzeros values[k] at indices[k].  Only the
+	// matrix columns at those indices are read or written.
+	struct SparseVectorKernels {
+	  static size_t rowGrainSize(size_t numNonZeros) {
+	    return std::max(
+		size_t(1),
+		size_t(parallel::DEFAULT_GRAIN_SIZE /
+		       std::max(numNonZeros, size_t(1)))
+	    );
+	  }
+
+	  // y = A x, where A is m x n
+	  template <typename Field>
+	  static void multiplyMatrixByVector(
+	      size_t m, size_t n, const Field* a, size_t nnz,
+	      const uint32_t* indices, const Field* values, Field* y
+	  ) {
+	    parallel::parallelFor(
+		0, m, rowGrainSize(nnz),
+		[=](size_t begin, size_t end) {
+		  const Field* row = a + begin * n;
+		  for (size_t i = begin; i < end; ++i, row += n) {
+		    Field sum(0);
+		    for (size_t k = 0; k < nnz; ++k) {
+		      sum += values[k] * row[indices[k]];
+		    }
+		    y[i] = sum;
+		  }
+		}
+	    );
+	  }
+
+	  // A += alpha * u x^T, where A is m x n and u has m elements
+	  template <typename Field>
+	  static void addOuterProduct(
+	      size_t m, size_t n, Field alpha, const Field* u, size_t nnz,
+	      const uint32_t* indices, const Field* values, Field* a
+	  ) {
+	    parallel::parallelFor(
+		0, m, rowGrainSize(nnz),
+		[=](size_t begin, size_t end) {
+		  Field* row = a + begin * n;
+		  for (size_t i = begin; i < end; ++i, row += n) {
+		    const Field c = alpha * u[i];
+		    for (size_t k = 0; k < nnz; ++k) {
+		      row[indices[k]] += c * values[k];
+		    }
+		  }
+		}
+	    );
+	  }
+	};
+
+	// Kernels for the rows of a dense row-major table picked out by a
+	// list of row indices, as in an embedding lookup
+	struct SparseRowKernels {
+	  static size_t rowGrainSize(size_t rowSize) {
+	    return std::max(
+		size_t(1),
+		size_t(parallel::DEFAULT_GRAIN_SIZE /
+		       std::max(rowSize, size_t(1)))
+	    );
+	  }
+
+	  // Copies row indices[k] of "table" to row k of "rows" for k in
+	  // [0, n)
+	  template <typename Field>
+	  static void gatherRows(size_t n, size_t rowSize, const Field* table,
+				 const uint32_t* indices, Field* rows) {
+	    parallel::parallelFor(
+		0, n, rowGrainSize(rowSize),
+		[=](size_t begin, size_t end) {
+		  for (size_t k = begin; k < end; ++k) {
+		    std::copy_n(table + size_t(indices[k]) * rowSize, rowSize,
+				rows + k * rowSize);
+		  }
+		}
+	    );
+	  }
+
+	  // Adds alpha times row k of "rows" to row indices[k] of "table"
+	  // for k in [0, n).  The indices must be distinct.
+	  template <typename Field>
+	  static void addRows(size_t n, size_t rowSize, Field alpha,
+			      const uint32_t* indices, const Field* rows,
+			      Field* table) {
+	    parallel::parallelFor(
+		0, n, rowGrainSize(rowSize),
+		[=](size_t begin, size_t end) {
+		  for (size_t k = begin; k < end; ++k) {
+		    const Field* src = rows + k * rowSize;
+		    Field* dest = table + size_t(indices[k]) * rowSize;
+		    for (size_t j = 0; j < rowSize; ++j) {
+		      dest[j] += alpha * src[j];
+		    }
+		  }
+		}
+	    );
+	  }
+	};
+
+      }
+    }
+  }
+}
+#endif
@@ -0,0 +1,311 @@
+#ifndef __NEURODIDACTIC__CORE__IO__BATCHPREFETCHER_HPP__
+#define __NEURODIDACTIC__CORE__IO__BATCHPREFETCHER_HPP__
+
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/arrays/MklAllocator.hpp>
+#include <neurodidactic/core/io/MappedDataset.hpp>
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace io {
+
+      // Assembles minibatches from a pair of MappedDatasets on background
+      // threads while the caller trains on earlier ones.  Batches are
+      // gathered into a ring of "ringSize" preallocated slots; workers
+      // run at most "ringSize" batches ahead of the caller and wait for
+      // it to release a slot before filling it again.  The batch returned
+      // by next() is valid until the following call to next(), which
+      // releases it.
+      //
+      // Each epoch visits the examples in a new random order (or in file
+      // order, if "shuffle" is false) and consists of numBatchesPerEpoch()
+      // full batches.  Examples left over at the end of an epoch are
+      // skipped.  The order depends only on the seed and the epoch, not
+      // on the number of workers.  Batches keep coming until the
+      // BatchPrefetcher is destroyed.
+      template <typename Field,
+		typename Allocator = arrays::MklAllocator<Field, 64> >
+      class BatchPrefetcher {
+      public:
+	typedef MappedDataset<Field, Allocator> DatasetType;
+	typedef arrays::MdArray<2, Field, Allocator> BatchType;
+
+	struct Batch {
+	  BatchType inputs;
+	  BatchType targets;
+	  uint64_t epoch;
+	  size_t index;
+
+	  Batch(BatchType&& inputs_, BatchType&& targets_):
+	      inputs(std::move(inputs_)), targets(std::move(targets_)),
+	      epoch(0), index(0) {
+	  }
+	};
+
+	// How long the caller has waited in next() for batches that
+	// were not ready yet
+	struct Stats {
+	  uint64_t numBatches;
+	  uint64_t numStalls;
+	  double totalWaitSeconds;
+	  double maxWaitSeconds;
+
+	  Stats():
+	      numBatches(0), numStalls(0), totalWaitSeconds(0.0),
+	      maxWaitSeconds(0.0) {
+	  }
+
+	  double meanWaitSeconds() const {
+	    return numBatches ? totalWaitSeconds / numBatches : 0.0;
+	  }
+	};
+
+	static constexpr const size_t DEFAULT_RING_SIZE = 3;
+
+      public:
+	BatchPrefetcher(const DatasetType& inputs,
+			const DatasetType& targets, size_t batchSize,
+			size_t numWorkers = 1,
+			size_t ringSize = DEFAULT_RING_SIZE,
+			bool shuffle = true, uint64_t seed = 0):
+	    inputs_(inputs), targets_(targets), batchSize_(batchSize),
+	    ringSize_(std::max(ringSize, size_t(1))),
+	    batchesPerEpoch_(batchSize ? inputs.numExamples() / batchSize
+				       : 0),
+	    shuffle_(shuffle), seed_(seed), slots_(), order_(),
+	    epoch_(0), nextIndex_(0), nextSequence_(0), released_(0),
+	    current_(NO_BATCH), shuffling_(false), stop_(false),
+	    stats_(), mutex_(), slotFilled_(), slotReleased_(),
+	    workers_() {
+	  if (targets.numExamples() != inputs.numExamples()) {
+	    std::ostringstream msg;
+	    msg << "Dataset \"" << targets.filename() << "\" has "
+		<< targets.numExamples() << " examples, but \""
+		<< inputs.filename() << "\" has " << inputs.numExamples();
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	  if (!batchesPerEpoch_) {
+	    std::ostringstream msg;
+	    msg << "Batch size " << batchSize << " must be between 1 and "
+		<< "the number of examples (" << inputs.numExamples()
+		<< ")";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+
+	  slots_.reserve(ringSize_);
+	  for (size_t i = 0; i < ringSize_; ++i) {
+	    slots_.emplace_back(new Slot(newBatch_(inputs_),
+					 newBatch_(targets_)));
+	  }
+	  order_ = newOrder_(0);
+
+	  numWorkers = std::max(numWorkers, size_t(1));
+	  workers_.reserve(numWorkers);
+	  for (size_t i = 0; i < numWorkers; ++i) {
+	    workers_.emplace_back([this]() { this->workerLoop_(); });
+	  }
+	}
+
+	BatchPrefetcher(const BatchPrefetcher&) = delete;
+
+	~BatchPrefetcher() noexcept {
+	  {
+	    std::unique_lock<std::mutex> lock(mutex_);
+	    stop_ = true;
+	  }
+	  slotReleased_.notify_all();
+	  slotFilled_.notify_all();
+	  for (auto& t : workers_) {
+	    t.join();
+	  }
+	}
+
+	size_t batchSize() const { return batchSize_; }
+	size_t ringSize() const { return ringSize_; }
+	size_t numWorkers() const { return workers_.size(); }
+	size_t numBatchesPerEpoch() const { return batchesPerEpoch_; }
+
+	Stats stats() const {
+	  std::unique_lock<std::mutex> lock(mutex_);
+	  return stats_;
+	}
+
+	// Releases the batch returned by the last call and waits for the
+	// one after it.  Rethrows any exception a worker raised while
+	// assembling that batch.
+	const Batch& next() {
+	  typedef std::chrono::steady_clock Clock;
+	  std::unique_lock<std::mutex> lock(mutex_);
+
+	  if (current_ != NO_BATCH) {
+	    slots_[current_ % ringSize_]->filled = false;
+	    ++released_;
+	    slotReleased_.notify_all();
+	  }
+
+	  current_ = released_;
+	  Slot& slot = *slots_[current_ % ringSize_];
+	  double waitSeconds = 0.0;
+	  if (!slot.filled) {
+	    const Clock::time_point start = Clock::now();
+	    slotFilled_.wait(lock, [&slot]() { return slot.filled; });
+	    waitSeconds =
+		std::chrono::duration<double>(Clock::now() - start).count();
+	    ++stats_.numStalls;
+	  }
+	  ++stats_.numBatches;
+	  stats_.totalWaitSeconds += waitSeconds;
+	  stats_.maxWaitSeconds = std::max(stats_.maxWaitSeconds,
+					   waitSeconds);
+
+	  if (slot.error) {
+	    std::rethrow_exception(slot.error);
+	  }
+	  return slot.batch;
+	}
+
+	BatchPrefetcher& operator=(const BatchPrefetcher&) = delete;
+
+      private:
+	static constexpr const uint64_t NO_BATCH = ~uint64_t(0);
+
+	struct Slot {
+	  Batch batch;
+	  std::exception_ptr error;
+	  bool filled;
+
+	  Slot(BatchType&& inputs, BatchType&& targets):
+	      batch(std::move(inputs), std::move(targets)), error(),
+	      filled(false) {
+	  }
+	};
+
+	typedef std::shared_ptr< const std::vector<uint64_t> > OrderPtr;
+
+	DatasetType inputs_;
+	DatasetType targets_;
+	const size_t batchSize_;
+	const size_t ringSize_;
+	const size_t batchesPerEpoch_;
+	const bool shuffle_;
+	const uint64_t seed_;
+	std::vector< std::unique_ptr<Slot> > slots_;
+
+	// Order of the examples in the epoch workers are filling
+	OrderPtr order_;
+	uint64_t epoch_;
+	size_t nextIndex_;
+	uint64_t nextSequence_;
+
+	// Number of batches the caller has released, and the sequence
+	// number of the batch it holds
+	uint64_t released_;
+	uint64_t current_;
+
+	bool shuffling_;
+	bool stop_;
+	Stats stats_;
+	mutable std::mutex mutex_;
+	std::condition_variable slotFilled_;
+	std::condition_variable slotReleased_;
+	std::vector<std::thread> workers_;
+
+	BatchType newBatch_(const DatasetType& dataset) const {
+	  return BatchType(
+	      typename BatchType::DimensionListType({
+		  uint32_t(batchSize_), uint32_t(dataset.numFeatures())
+	      }),
+	      dataset.allocator()
+	  );
+	}
+
+	OrderPtr newOrder_(uint64_t epoch) const {
+	  std::shared_ptr< std::vector<uint64_t> > order =
+	      std::make_shared< std::vector<uint64_t> >(
+		  inputs_.numExamples()
+	      );
+	  std::iota(order->begin(), order->end(), uint64_t(0));
+	  if (shuffle_) {
+	    std::mt19937_64 rng(seed_ + epoch);
+	    std::shuffle(order->begin(), order->end(), rng);
+	  }
+	  return order;
+	}
+
+	void workerLoop_() {
+	  std::unique_lock<std::mutex> lock(mutex_);
+	  while (true) {
+	    // Claim the next batch, shuffling the examples for a new
+	    // epoch outside the lock when the current one runs out
+	    slotReleased_.wait(lock, [this]() {
+		return stop_ ||
+		       (!shuffling_ &&
+			(nextSequence_ < released_ + ringSize_));
+	    });
+	    if (stop_) {
+	      return;
+	    }
+	    if (nextIndex_ == batchesPerEpoch_) {
+	      shuffling_ = true;
+	      lock.unlock();
+	      OrderPtr order = newOrder_(epoch_ + 1);
+	      lock.lock();
+	      order_ = order;
+	      ++epoch_;
+	      nextIndex_ = 0;
+	      shuffling_ = false;
+	      slotReleased_.notify_all();
+	      continue;
+	    }
+
+	    const uint64_t sequence = nextSequence_++;
+	    const uint64_t epoch = epoch_;
+	    const size_t index = nextIndex_++;
+	    OrderPtr order = order_;
+	    Slot& slot = *slots_[sequence % ringSize_];
+
+	    lock.unlock();
+	    fill_(slot, *order, epoch, index);
+	    lock.lock();
+
+	    slot.filled = true;
+	    slotFilled_.notify_all();
+	  }
+	}
+
+	void fill_(Slot& slot, const std::vector<uint64_t>& order,
+		   uint64_t epoch, size_t index) {
+	  auto begin = order.begin() + index * batchSize_;
+	  auto end = begin + batchSize_;
+	  slot.error = nullptr;
+	  slot.batch.epoch = epoch;
+	  slot.batch.index = index;
+	  try {
+	    inputs_.gather(begin, end, slot.batch.inputs);
+	    targets_.gather(begin, end, slot.batch.targets);
+	  } catch(...) {
+	    slot.error = std::current_exception();
+	  }
+	}
+      };
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,51 @@
+#ifndef __NEURODIDACTIC__CORE__IO__DATASETFORMAT_HPP__
+#define __NEURODIDACTIC__CORE__IO__DATASETFORMAT_HPP__
+
+#include <neurodidactic/core/io/ModelFormat.hpp>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace io {
+
+      // Layout of a dataset file, version 1.  A dataset file holds one
+      // [numExamples, numFeatures] matrix, stored raw and row-major after
+      // the header, so consecutive examples are contiguous and any run of
+      // them can be used in place as a minibatch.  Inputs and targets go
+      // in separate files that are read with the same example indices.
+      //
+      //   DatasetFileHeader                at offset 0
+      //   examples                         at offset dataOffset, a
+      //                                    multiple of
+      //                                    DATASET_DATA_ALIGNMENT
+      //
+      // Byte order and field types are handled as in model files.
+
+      static constexpr const char DATASET_FILE_MAGIC[8] = {
+	  'N', 'D', 'D', 'A', 'T', 'A', '\0', '\0'
+      };
+      static constexpr const uint32_t DATASET_FILE_BYTE_ORDER_MARK =
+	  0x01020304;
+      static constexpr const uint32_t DATASET_FILE_VERSION = 1;
+      static constexpr const size_t DATASET_DATA_ALIGNMENT = 64;
+
+      struct DatasetFileHeader {
+	char magic[8];
+	uint32_t byteOrderMark;
+	uint32_t version;
+	uint32_t fieldType;
+	uint32_t numFeatures;
+	uint64_t numExamples;
+	uint64_t dataOffset;
+	uint64_t fileSize;
+	uint8_t reserved[16];
+      };
+
+      static_assert(sizeof(DatasetFileHeader) == 64,
+		    "DatasetFileHeader must be 64 bytes");
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,156 @@
+#ifndef __NEURODIDACTIC__CORE__IO__DATASETWRITER_HPP__
+#define __NEURODIDACTIC__CORE__IO__DATASETWRITER_HPP__
+
+#include <neurodidactic/core/arrays/AnyMdArray.hpp>
+#include <neurodidactic/core/arrays/detail/MappedMemory.hpp>
+#include <neurodidactic/core/io/DatasetFormat.hpp>
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalStateError.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <pistis/exceptions/IOError.hpp>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <string.h>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace io {
+
+      // Writes a dataset file one or more examples at a time, so datasets
+      // larger than memory can be converted without holding them in
+      // memory.  The header is written by close(), which the destructor
+      // calls if it has not been called already.
+      template <typename Field>
+      class DatasetWriter {
+      public:
+	DatasetWriter(const std::string& filename, uint32_t numFeatures):
+	    filename_(filename), numFeatures_(numFeatures), numExamples_(0),
+	    out_(filename, std::ios::binary | std::ios::trunc) {
+	  if (!numFeatures) {
+	    throw pistis::exceptions::IllegalValueError(
+		"Examples must have at least one feature", PISTIS_EX_HERE
+	    );
+	  }
+	  if (!out_) {
+	    throw pistis::exceptions::IOError(
+		"Cannot open \"" + filename + "\" for writing",
+		PISTIS_EX_HERE
+	    );
+	  }
+
+	  // Placeholder until close() knows the number of examples
+	  DatasetFileHeader header;
+	  memset(&header, 0, sizeof(header));
+	  out_.write((const char*)&header, sizeof(header));
+	}
+
+	DatasetWriter(const DatasetWriter&) = delete;
+	DatasetWriter(DatasetWriter&&) = default;
+
+	~DatasetWriter() noexcept {
+	  try {
+	    close();
+	  } catch(...) {
+	  }
+	}
+
+	const std::string& filename() const { return filename_; }
+	uint32_t numFeatures() const { return numFeatures_; }
+	uint64_t numExamples() const { return numExamples_; }
+	bool isOpen() const { return out_.is_open(); }
+
+	// Appends one example, if "examples" is a vector, or one example
+	// per row, if it is a matrix
+	template <typename Array,
+		  typename Enabled =
+		      typename std::enable_if<arrays::IsMdArray<Array>::value,
+					      int>::type>
+	void append(const Array& examples, Enabled = 0) {
+	  static_assert(
+	      std::is_same<typename Array::FieldType, Field>::value,
+	      "Examples must have the same field type as the dataset"
+	  );
+	  static_assert((Array::ORDER == 1) || (Array::ORDER == 2),
+			"Examples must be a vector or a matrix");
+
+	  if (!isOpen()) {
+	    throw pistis::exceptions::IllegalStateError(
+		"Cannot append to \"" + filename_ + "\" after it has been "
+		"closed",
+		PISTIS_EX_HERE
+	    );
+	  }
+	  if (examples.dimensions()[Array::ORDER - 1] != numFeatures_) {
+	    std::ostringstream msg;
+	    msg << "Array \"examples\" has dimensions "
+		<< examples.dimensions() << ", but examples in \""
+		<< filename_ << "\" have " << numFeatures_ << " features";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+
+	  out_.write((const char*)examples.data(),
+		     examples.size() * sizeof(Field));
+	  numExamples_ += examples.size() / numFeatures_;
+	  checkStream_();
+	}
+
+	void close() {
+	  if (!isOpen()) {
+	    return;
+	  }
+
+	  static const char ZEROS[DATASET_DATA_ALIGNMENT] = { 0 };
+	  const uint64_t dataSize = numExamples_ * numFeatures_ *
+				    sizeof(Field);
+	  const uint64_t fileSize = arrays::detail::roundUpToMultiple(
+	      sizeof(DatasetFileHeader) + dataSize, DATASET_DATA_ALIGNMENT
+	  );
+	  DatasetFileHeader header;
+
+	  memset(&header, 0, sizeof(header));
+	  std::copy_n(DATASET_FILE_MAGIC, sizeof(header.magic),
+		      header.magic);
+	  header.byteOrderMark = DATASET_FILE_BYTE_ORDER_MARK;
+	  header.version = DATASET_FILE_VERSION;
+	  header.fieldType = ModelFieldType<Field>::value;
+	  header.numFeatures = numFeatures_;
+	  header.numExamples = numExamples_;
+	  header.dataOffset = sizeof(DatasetFileHeader);
+	  header.fileSize = fileSize;
+
+	  out_.write(ZEROS, fileSize - sizeof(DatasetFileHeader) - dataSize);
+	  out_.seekp(0);
+	  out_.write((const char*)&header, sizeof(header));
+	  out_.flush();
+	  checkStream_();
+	  out_.close();
+	}
+
+	DatasetWriter& operator=(const DatasetWriter&) = delete;
+	DatasetWriter& operator=(DatasetWriter&&) = default;
+
+      private:
+	std::string filename_;
+	uint32_t numFeatures_;
+	uint64_t numExamples_;
+	std::ofstream out_;
+
+	void checkStream_() {
+	  if (!out_) {
+	    out_.close();
+	    throw pistis::exceptions::IOError(
+		"Error writing \"" + filename_ + "\"", PISTIS_EX_HERE
+	    );
+	  }
+	}
+      };
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,65 @@
+#ifndef __NEURODIDACTIC__CORE__IO__FULLYCONNECTEDLAYERIO_HPP__
+#define __NEURODIDACTIC__CORE__IO__FULLYCONNECTEDLAYERIO_HPP__
+
+#include <neurodidactic/core/io/MappedModel.hpp>
+#include <neurodidactic/core/io/ModelWriter.hpp>
+#include <neurodidactic/core/layers/FullyConnectedLayer.hpp>
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <sstream>
+#include <string>
+
+namespace neurodidactic {
+  namespace core {
+    namespace io {
+
+      // A FullyConnectedLayer is stored as the tensors "<name>.weights"
+      // and "<name>.bias"
+      template <typename Field, typename Nonlinearity, typename Allocator>
+      void addLayer(
+	  ModelWriter& writer, const std::string& name,
+	  const layers::FullyConnectedLayer<Field, Nonlinearity, Allocator>&
+	      layer
+      ) {
+	writer.add(name + ".weights", layer.weights());
+	writer.add(name + ".bias", layer.bias());
+      }
+
+      // If "model" was mapped COPY_ON_WRITE, the layer's weights and bias
+      // share its pages, which are copied only as training writes them.
+      // A READ_ONLY model's tensors are copied, so the layer can always
+      // be trained.
+      template <typename Field, typename Nonlinearity,
+		typename Allocator = arrays::MklAllocator<Field, 64> >
+      layers::FullyConnectedLayer<Field, Nonlinearity, Allocator>
+	  loadFullyConnectedLayer(
+	      const MappedModel& model, const std::string& name, uint32_t id,
+	      const Nonlinearity& nonlinearity = Nonlinearity(),
+	      const Allocator& allocator = Allocator()
+	  ) {
+	typedef layers::FullyConnectedLayer<Field, Nonlinearity, Allocator>
+		LayerType;
+	auto weights = detail::MappedModelAccess::tensor<2, Field>(
+	    model, name + ".weights", allocator
+	);
+	auto bias = detail::MappedModelAccess::tensor<1, Field>(
+	    model, name + ".bias", allocator
+	);
+
+	if (weights.dimensions()[0] != bias.dimensions()[0]) {
+	  std::ostringstream msg;
+	  msg << "Layer \"" << name << "\" in \"" << model.filename()
+	      << "\" has weights with dimensions " << weights.dimensions()
+	      << " and bias with dimensions " << bias.dimensions()
+	      << ", which do not match";
+	  throw pistis::exceptions::IllegalValueError(msg.str(),
+						      PISTIS_EX_HERE);
+	}
+	return LayerType(id, std::move(weights), std::move(bias),
+			 nonlinearity);
+      }
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,274 @@
+#ifndef __NEURODIDACTIC__CORE__IO__MAPPEDDATASET_HPP__
+#define __NEURODIDACTIC__CORE__IO__MAPPEDDATASET_HPP__
+
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/arrays/MklAllocator.hpp>
+#include <neurodidactic/core/arrays/detail/MappedMemory.hpp>
+#include <neurodidactic/core/io/DatasetFormat.hpp>
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <pistis/exceptions/IOError.hpp>
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace io {
+
+      // Maps a dataset file into memory and hands out minibatches of its
+      // examples as [batchSize, numFeatures] MdArrays.  batch() returns a
+      // run of consecutive examples in place, without copying, so reading
+      // the dataset in order costs only the page faults.  gather()
+      // copies arbitrary examples into a batch for shuffled access.
+      //
+      // The file is mapped read-only, so batch() returns const arrays,
+      // which can be read in place or copied into arrays of their own.
+      // Batches keep the mapping alive after the MappedDataset is gone.
+      template <typename Field,
+		typename Allocator = arrays::MklAllocator<Field, 64> >
+      class MappedDataset {
+      public:
+	typedef arrays::MdArray<2, Field, Allocator> BatchType;
+
+	// How the examples will be read, which decides how the kernel
+	// reads ahead
+	enum class AccessPattern {
+	  SEQUENTIAL,
+	  RANDOM
+	};
+
+      public:
+	explicit MappedDataset(
+	    const std::string& filename,
+	    AccessPattern accessPattern = AccessPattern::SEQUENTIAL,
+	    const Allocator& allocator = Allocator()
+	):
+	    filename_(filename), mapping_(), base_(nullptr), size_(0),
+	    data_(nullptr), numExamples_(0), numFeatures_(0),
+	    accessPattern_(accessPattern), allocator_(allocator) {
+	  map_();
+	  validate_();
+	  setAccessPattern(accessPattern);
+	}
+
+	MappedDataset(const MappedDataset&) = default;
+	MappedDataset(MappedDataset&&) = default;
+
+	const std::string& filename() const { return filename_; }
+	size_t fileSize() const { return size_; }
+	size_t numExamples() const { return numExamples_; }
+	size_t numFeatures() const { return numFeatures_; }
+	size_t numBatches(size_t batchSize) const {
+	  validateBatchSize_(batchSize);
+	  return (numExamples_ + batchSize - 1) / batchSize;
+	}
+	const Field* data() const { return data_; }
+	const Allocator& allocator() const { return allocator_; }
+
+	AccessPattern accessPattern() const { return accessPattern_; }
+	void setAccessPattern(AccessPattern accessPattern) {
+	  accessPattern_ = accessPattern;
+	  madvise(mapping_.get(), size_,
+		  (accessPattern == AccessPattern::SEQUENTIAL) ?
+		      MADV_SEQUENTIAL : MADV_RANDOM);
+	}
+
+	// Asks the kernel to start reading examples [begin, end) in the
+	// background
+	void prefetch(size_t begin, size_t end) const {
+	  end = std::min(end, numExamples_);
+	  if (begin < end) {
+	    const uintptr_t first =
+		(uintptr_t)(data_ + begin * numFeatures_) /
+		    arrays::detail::pageSize() * arrays::detail::pageSize();
+	    const uintptr_t last = (uintptr_t)(data_ + end * numFeatures_);
+	    madvise((void*)first, last - first, MADV_WILLNEED);
+	  }
+	}
+
+	// Returns examples [begin, begin + batchSize) in place.  The last
+	// batch of the dataset may be shorter than "batchSize".  When
+	// reading sequentially, also starts reading the batch after it.
+	const BatchType batch(size_t begin, size_t batchSize) const {
+	  validateBatchSize_(batchSize);
+	  if (begin >= numExamples_) {
+	    std::ostringstream msg;
+	    msg << "Batch starts at example " << begin << ", but \""
+		<< filename_ << "\" has only " << numExamples_
+		<< " examples";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+
+	  const size_t n = std::min(batchSize, numExamples_ - begin);
+	  if (accessPattern_ == AccessPattern::SEQUENTIAL) {
+	    prefetch(begin + n, begin + n + batchSize);
+	  }
+	  return BatchType::wrap(
+	      typename BatchType::DimensionListType({ uint32_t(n),
+						      numFeatures_ }),
+	      const_cast<Field*>(data_ + begin * numFeatures_), mapping_,
+	      allocator_
+	  );
+	}
+
+	// Copies the examples at indices [indexBegin, indexEnd) into the
+	// rows of "batch", which must have one row per index
+	template <typename Iterator>
+	void gather(Iterator indexBegin, Iterator indexEnd,
+		    BatchType& batch) const {
+	  const size_t n = std::distance(indexBegin, indexEnd);
+	  if ((batch.dimensions()[0] != n) ||
+	      (batch.leadingDimension() != numFeatures_)) {
+	    std::ostringstream msg;
+	    msg << "Array \"batch\" has dimensions " << batch.dimensions()
+		<< ", but it should have dimensions [" << n << ", "
+		<< numFeatures_ << "]";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+
+	  Field* row = batch.data();
+	  for (Iterator i = indexBegin; i != indexEnd; ++i) {
+	    if (size_t(*i) >= numExamples_) {
+	      std::ostringstream msg;
+	      msg << "Index " << *i << " is out of range for \""
+		  << filename_ << "\", which has " << numExamples_
+		  << " examples";
+	      throw pistis::exceptions::IllegalValueError(msg.str(),
+							  PISTIS_EX_HERE);
+	    }
+	    std::copy_n(data_ + size_t(*i) * numFeatures_, numFeatures_,
+			row);
+	    row += numFeatures_;
+	  }
+	}
+
+	template <typename Index>
+	BatchType gather(const std::vector<Index>& indices) const {
+	  validateBatchSize_(indices.size());
+	  BatchType batch(
+	      typename BatchType::DimensionListType({
+		  uint32_t(indices.size()), numFeatures_
+	      }),
+	      allocator_
+	  );
+	  gather(indices.begin(), indices.end(), batch);
+	  return batch;
+	}
+
+	MappedDataset& operator=(const MappedDataset&) = default;
+	MappedDataset& operator=(MappedDataset&&) = default;
+
+      private:
+	std::string filename_;
+	std::shared_ptr<void> mapping_;
+	const char* base_;
+	size_t size_;
+	const Field* data_;
+	size_t numExamples_;
+	uint32_t numFeatures_;
+	AccessPattern accessPattern_;
+	Allocator allocator_;
+
+	void map_() {
+	  const int fd = open(filename_.c_str(), O_RDONLY);
+	  if (fd < 0) {
+	    throwSystemError_("Cannot open");
+	  }
+
+	  struct stat info;
+	  if (fstat(fd, &info) < 0) {
+	    close(fd);
+	    throwSystemError_("Cannot stat");
+	  }
+	  size_ = info.st_size;
+	  if (size_ < sizeof(DatasetFileHeader)) {
+	    close(fd);
+	    throwFormatError_("is too short to be a dataset file");
+	  }
+
+	  void* p = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+	  close(fd);
+	  if (p == MAP_FAILED) {
+	    throwSystemError_("Cannot map");
+	  }
+
+	  const size_t size = size_;
+	  mapping_.reset(p, [size](void* q) { munmap(q, size); });
+	  base_ = (const char*)p;
+	}
+
+	void validate_() {
+	  const DatasetFileHeader& header = *(const DatasetFileHeader*)base_;
+	  if (memcmp(header.magic, DATASET_FILE_MAGIC,
+		     sizeof(header.magic))) {
+	    throwFormatError_("is not a dataset file");
+	  }
+	  if (header.byteOrderMark != DATASET_FILE_BYTE_ORDER_MARK) {
+	    throwFormatError_("was written with a different byte order");
+	  }
+	  if (header.version != DATASET_FILE_VERSION) {
+	    std::ostringstream msg;
+	    msg << "has version " << header.version << ", but only version "
+		<< DATASET_FILE_VERSION << " is supported";
+	    throwFormatError_(msg.str());
+	  }
+	  if (header.fieldType != ModelFieldType<Field>::value) {
+	    std::ostringstream msg;
+	    msg << "has field type " << header.fieldType
+		<< ", but field type " << ModelFieldType<Field>::value
+		<< " was requested";
+	    throw pistis::exceptions::IllegalValueError(
+		"File \"" + filename_ + "\" " + msg.str(), PISTIS_EX_HERE
+	    );
+	  }
+	  if ((header.fileSize != size_) || !header.numFeatures ||
+	      (header.dataOffset % DATASET_DATA_ALIGNMENT) ||
+	      (header.dataOffset > size_) ||
+	      (header.numExamples >
+		   (size_ - header.dataOffset) / sizeof(Field) /
+		       header.numFeatures)) {
+	    throwFormatError_("is truncated or corrupt");
+	  }
+
+	  data_ = (const Field*)(base_ + header.dataOffset);
+	  numExamples_ = header.numExamples;
+	  numFeatures_ = header.numFeatures;
+	}
+
+	void validateBatchSize_(size_t batchSize) const {
+	  if (!batchSize) {
+	    throw pistis::exceptions::IllegalValueError(
+		"Batch size must be positive", PISTIS_EX_HERE
+	    );
+	  }
+	}
+
+	void throwSystemError_(const std::string& action) const {
+	  std::ostringstream msg;
+	  msg << action << " \"" << filename_ << "\": " << strerror(errno);
+	  throw pistis::exceptions::IOError(msg.str(), PISTIS_EX_HERE);
+	}
+
+	void throwFormatError_(const std::string& problem) const {
+	  throw pistis::exceptions::IOError(
+	      "File \"" + filename_ + "\" " + problem, PISTIS_EX_HERE
+	  );
+	}
+      };
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,286 @@
+#ifndef __NEURODIDACTIC__CORE__IO__MAPPEDMODEL_HPP__
+#define __NEURODIDACTIC__CORE__IO__MAPPEDMODEL_HPP__
+
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/arrays/MklAllocator.hpp>
+#include <neurodidactic/core/io/ModelFormat.hpp>
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalStateError.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <pistis/exceptions/IOError.hpp>
+#include <pistis/exceptions/NoSuchItem.hpp>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace io {
+      namespace detail {
+	struct MappedModelAccess;
+      }
+
+      // Maps a model file into memory and hands out its tensors as MdArrays
+      // that refer to the mapped pages instead of copying them.  Loading
+      // costs only the page faults for the parts of the model that are
+      // used, and processes that map the same file share its pages in the
+      // page cache.
+      //
+      // By default the file is mapped read-only, and tensor() returns
+      // const arrays, which can be read in place or copied into arrays of
+      // their own.  Mapping it copy-on-write also allows mutableTensor(),
+      // whose writes go to private copies of the pages and never reach the
+      // file.  Tensors keep the mapping alive after the MappedModel is
+      // gone.
+      class MappedModel {
+      public:
+	enum class Access {
+	  READ_ONLY,
+	  COPY_ON_WRITE
+	};
+
+      public:
+	explicit MappedModel(const std::string& filename,
+			     Access access = Access::READ_ONLY):
+	    filename_(filename), access_(access), mapping_(), base_(nullptr),
+	    size_(0), table_(nullptr), index_() {
+	  map_(access);
+	  validate_();
+	}
+
+	MappedModel(const MappedModel&) = default;
+	MappedModel(MappedModel&&) = default;
+
+	const std::string& filename() const { return filename_; }
+	Access access() const { return access_; }
+	size_t fileSize() const { return size_; }
+	size_t numTensors() const { return index_.size(); }
+	bool contains(const std::string& name) const {
+	  return index_.find(name) != index_.end();
+	}
+
+	std::vector<std::string> names() const {
+	  std::vector<std::string> result;
+	  result.reserve(numTensors());
+	  for (size_t i = 0; i < numTensors(); ++i) {
+	    result.push_back(table_[i].name);
+	  }
+	  return result;
+	}
+
+	// Asks the kernel to start reading the whole file in the background
+	void prefetch() const {
+	  madvise(mapping_.get(), size_, MADV_WILLNEED);
+	}
+
+	// The tensor as a const array over the mapped pages
+	template <size_t ORDER, typename Field,
+		  typename Allocator = arrays::MklAllocator<Field, 64> >
+	const arrays::MdArray<ORDER, Field, Allocator> tensor(
+	    const std::string& name, const Allocator& allocator = Allocator()
+	) const {
+	  return wrap_<ORDER, Field>(name, allocator);
+	}
+
+	// The tensor as an array that may be written, which requires the
+	// file to be mapped copy-on-write
+	template <size_t ORDER, typename Field,
+		  typename Allocator = arrays::MklAllocator<Field, 64> >
+	arrays::MdArray<ORDER, Field, Allocator> mutableTensor(
+	    const std::string& name, const Allocator& allocator = Allocator()
+	) const {
+	  if (access_ != Access::COPY_ON_WRITE) {
+	    std::ostringstream msg;
+	    msg << "Cannot write to tensor \"" << name << "\" because \""
+		<< filename_ << "\" is mapped read-only";
+	    throw pistis::exceptions::IllegalStateError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	  return wrap_<ORDER, Field>(name, allocator);
+	}
+
+	MappedModel& operator=(const MappedModel&) = default;
+	MappedModel& operator=(MappedModel&&) = default;
+
+      private:
+	std::string filename_;
+	Access access_;
+	std::shared_ptr<void> mapping_;
+	char* base_;
+	size_t size_;
+	const ModelTensorEntry* table_;
+	std::unordered_map<std::string, size_t> index_;
+
+	void map_(Access access) {
+	  const int fd = open(filename_.c_str(), O_RDONLY);
+	  if (fd < 0) {
+	    throwSystemError_("Cannot open");
+	  }
+
+	  struct stat info;
+	  if (fstat(fd, &info) < 0) {
+	    close(fd);
+	    throwSystemError_("Cannot stat");
+	  }
+	  size_ = info.st_size;
+	  if (size_ < sizeof(ModelFileHeader)) {
+	    close(fd);
+	    throwFormatError_("is too short to be a model file");
+	  }
+
+	  const int protection = (access == Access::COPY_ON_WRITE) ?
+	      (PROT_READ | PROT_WRITE) : PROT_READ;
+	  const int flags = (access == Access::COPY_ON_WRITE) ?
+	      MAP_PRIVATE : MAP_SHARED;
+	  void* p = mmap(nullptr, size_, protection, flags, fd, 0);
+	  close(fd);
+	  if (p == MAP_FAILED) {
+	    throwSystemError_("Cannot map");
+	  }
+
+	  const size_t size = size_;
+	  mapping_.reset(p, [size](void* q) { munmap(q, size); });
+	  base_ = (char*)p;
+	}
+
+	void validate_() {
+	  const ModelFileHeader& header = *(const ModelFileHeader*)base_;
+	  if (memcmp(header.magic, MODEL_FILE_MAGIC, sizeof(header.magic))) {
+	    throwFormatError_("is not a model file");
+	  }
+	  if (header.byteOrderMark != MODEL_FILE_BYTE_ORDER_MARK) {
+	    throwFormatError_("was written with a different byte order");
+	  }
+	  if (header.version != MODEL_FILE_VERSION) {
+	    std::ostringstream msg;
+	    msg << "has version " << header.version << ", but only version "
+		<< MODEL_FILE_VERSION << " is supported";
+	    throwFormatError_(msg.str());
+	  }
+	  if ((header.fileSize != size_) ||
+	      (header.tableOffset > size_) ||
+	      (header.numTensors >
+		   (size_ - header.tableOffset) / sizeof(ModelTensorEntry))) {
+	    throwFormatError_("is truncated or corrupt");
+	  }
+
+	  table_ = (const ModelTensorEntry*)(base_ + header.tableOffset);
+	  for (size_t i = 0; i < header.numTensors; ++i) {
+	    validateEntry_(table_[i]);
+	    if (!index_.insert(std::make_pair(table_[i].name, i)).second) {
+	      throwFormatError_(std::string("has two tensors named \"") +
+				table_[i].name + "\"");
+	    }
+	  }
+	}
+
+	// Every dimension must be nonzero, and the product of the
+	// dimensions and the field size must equal the tensor's size
+	// without overflowing
+	void validateEntry_(const ModelTensorEntry& entry) const {
+	  const size_t fieldSize = modelFieldSize(entry.fieldType);
+	  uint64_t numElements = 1;
+	  bool valid = !entry.name[MODEL_TENSOR_MAX_NAME_LENGTH] &&
+		       (fieldSize > 0) && (entry.order > 0) &&
+		       (entry.order <= MODEL_TENSOR_MAX_ORDER) &&
+		       !(entry.offset % MODEL_TENSOR_ALIGNMENT) &&
+		       (entry.offset <= size_) &&
+		       (entry.size <= size_ - entry.offset);
+
+	  for (uint32_t i = 0; valid && (i < entry.order); ++i) {
+	    const uint32_t n = entry.dimensions[i];
+	    valid = (n > 0) && (numElements <= entry.size / n);
+	    numElements *= n;
+	  }
+	  if (!valid || (numElements > entry.size / fieldSize) ||
+	      (numElements * fieldSize != entry.size)) {
+	    throwFormatError_("has a corrupt tensor table");
+	  }
+	}
+
+	template <size_t ORDER, typename Field, typename Allocator>
+	arrays::MdArray<ORDER, Field, Allocator> wrap_(
+	    const std::string& name, const Allocator& allocator
+	) const {
+	  typedef arrays::MdArray<ORDER, Field, Allocator> ArrayType;
+	  typedef typename ArrayType::DimensionListType DimensionListType;
+
+	  const ModelTensorEntry& entry = find_(name);
+	  if ((entry.fieldType != ModelFieldType<Field>::value) ||
+	      (entry.order != ORDER)) {
+	    std::ostringstream msg;
+	    msg << "Tensor \"" << name << "\" in \"" << filename_
+		<< "\" has field type " << entry.fieldType << " and order "
+		<< entry.order << ", but field type "
+		<< ModelFieldType<Field>::value << " and order " << ORDER
+		<< " were requested";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+
+	  return ArrayType::wrap(DimensionListType(ORDER, entry.dimensions),
+				 (Field*)(base_ + entry.offset), mapping_,
+				 allocator);
+	}
+
+	const ModelTensorEntry& find_(const std::string& name) const {
+	  auto i = index_.find(name);
+	  if (i == index_.end()) {
+	    std::ostringstream msg;
+	    msg << "Tensor \"" << name << "\" in \"" << filename_ << "\"";
+	    throw pistis::exceptions::NoSuchItem(msg.str(), PISTIS_EX_HERE);
+	  }
+	  return table_[i->second];
+	}
+
+	void throwSystemError_(const std::string& action) const {
+	  std::ostringstream msg;
+	  msg << action << " \"" << filename_ << "\": " << strerror(errno);
+	  throw pistis::exceptions::IOError(msg.str(), PISTIS_EX_HERE);
+	}
+
+	void throwFormatError_(const std::string& problem) const {
+	  throw pistis::exceptions::IOError(
+	      "File \"" + filename_ + "\" " + problem, PISTIS_EX_HERE
+	  );
+	}
+
+	friend struct detail::MappedModelAccess;
+      };
+
+      namespace detail {
+	// Gives the loaders of whole layers the tensors of a MappedModel
+	// as writable arrays.  A COPY_ON_WRITE model's tensors share its
+	// pages; a READ_ONLY model's pages cannot be written, so its tensors
+	// are copied.
+	struct MappedModelAccess {
+	  template <size_t ORDER, typename Field, typename Allocator>
+	  static arrays::MdArray<ORDER, Field, Allocator> tensor(
+	      const MappedModel& model, const std::string& name,
+	      const Allocator& allocator
+	  ) {
+	    arrays::MdArray<ORDER, Field, Allocator> t =
+		model.wrap_<ORDER, Field>(name, allocator);
+	    if (model.access() == MappedModel::Access::COPY_ON_WRITE) {
+	      return t;
+	    }
+	    return arrays::MdArray<ORDER, Field, Allocator>(
+		t.dimensions(), t.data(), allocator
+	    );
+	  }
+	};
+      }
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,107 @@
+#ifndef __NEURODIDACTIC__CORE__IO__MODELFORMAT_HPP__
+#define __NEURODIDACTIC__CORE__IO__MODELFORMAT_HPP__
+
+#include <neurodidactic/core/arrays/HalfPrecision.hpp>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace io {
+
+      // Layout of a model file, version 1.  All integers are in the byte
+      // order of the machine that wrote the file; readers check
+      // "byteOrderMark" and reject files written with the other order.
+      //
+      //   ModelFileHeader                  at offset 0
+      //   ModelTensorEntry[numTensors]     at offset tableOffset
+      //   tensor data                      each at a multiple of
+      //                                    MODEL_TENSOR_ALIGNMENT
+      //
+      // Tensor data is stored raw and row-major, so a reader can map the
+      // file and use the tensors where they lie.
+
+      static constexpr const char MODEL_FILE_MAGIC[8] = {
+	  'N', 'D', 'M', 'O', 'D', 'E', 'L', '\0'
+      };
+      static constexpr const uint32_t MODEL_FILE_BYTE_ORDER_MARK =
+	  0x01020304;
+      static constexpr const uint32_t MODEL_FILE_VERSION = 1;
+      static constexpr const size_t MODEL_TENSOR_ALIGNMENT = 64;
+      static constexpr const size_t MODEL_TENSOR_MAX_ORDER = 6;
+      static constexpr const size_t MODEL_TENSOR_MAX_NAME_LENGTH = 63;
+
+      struct ModelFileHeader {
+	char magic[8];
+	uint32_t byteOrderMark;
+	uint32_t version;
+	uint64_t numTensors;
+	uint64_t tableOffset;
+	uint64_t fileSize;
+	uint8_t reserved[24];
+      };
+
+      struct ModelTensorEntry {
+	char name[MODEL_TENSOR_MAX_NAME_LENGTH + 1];
+	uint32_t fieldType;
+	uint32_t order;
+	uint32_t dimensions[MODEL_TENSOR_MAX_ORDER];
+	uint64_t offset;
+	uint64_t size;
+	uint8_t reserved[16];
+      };
+
+      static_assert(sizeof(ModelFileHeader) == 64,
+		    "ModelFileHeader must be 64 bytes");
+      static_assert(sizeof(ModelTensorEntry) == 128,
+		    "ModelTensorEntry must be 128 bytes");
+
+      // Codes for the element types a model file can hold
+      template <typename Field>
+      struct ModelFieldType;
+
+      template <> struct ModelFieldType<float> {
+	static constexpr const uint32_t value = 1;
+      };
+
+      template <> struct ModelFieldType<double> {
+	static constexpr const uint32_t value = 2;
+      };
+
+      template <> struct ModelFieldType<int8_t> {
+	static constexpr const uint32_t value = 3;
+      };
+
+      template <> struct ModelFieldType<uint8_t> {
+	static constexpr const uint32_t value = 4;
+      };
+
+      template <> struct ModelFieldType<int32_t> {
+	static constexpr const uint32_t value = 5;
+      };
+
+      template <> struct ModelFieldType<arrays::BFloat16> {
+	static constexpr const uint32_t value = 6;
+      };
+
+      template <> struct ModelFieldType<arrays::Float16> {
+	static constexpr const uint32_t value = 7;
+      };
+
+      inline size_t modelFieldSize(uint32_t fieldType) {
+	switch (fieldType) {
+	  case 1: return sizeof(float);
+	  case 2: return sizeof(double);
+	  case 3: return sizeof(int8_t);
+	  case 4: return sizeof(uint8_t);
+	  case 5: return sizeof(int32_t);
+	  case 6: return sizeof(arrays::BFloat16);
+	  case 7: return sizeof(arrays::Float16);
+	  default: return 0;
+	}
+      }
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,164 @@
+#ifndef __NEURODIDACTIC__CORE__IO__MODELWRITER_HPP__
+#define __NEURODIDACTIC__CORE__IO__MODELWRITER_HPP__
+
+#include <neurodidactic/core/arrays/AnyMdArray.hpp>
+#include <neurodidactic/core/arrays/detail/MappedMemory.hpp>
+#include <neurodidactic/core/io/ModelFormat.hpp>
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <pistis/exceptions/IOError.hpp>
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+#include <string.h>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace io {
+
+      // Collects named tensors and writes them to a model file.  add()
+      // holds a reference to each tensor rather than copying it, so the
+      // tensors must not be modified until write() is called.
+      class ModelWriter {
+      public:
+	ModelWriter(): tensors_(), names_() { }
+	ModelWriter(const ModelWriter&) = delete;
+	ModelWriter(ModelWriter&&) = default;
+
+	size_t numTensors() const { return tensors_.size(); }
+
+	template <typename Array,
+		  typename Enabled =
+		      typename std::enable_if<arrays::IsMdArray<Array>::value,
+					      int>::type>
+	void add(const std::string& name, const Array& tensor,
+		 Enabled = 0) {
+	  typedef typename Array::FieldType Field;
+	  typedef typename Array::RefType RefType;
+
+	  if (name.empty() || (name.size() > MODEL_TENSOR_MAX_NAME_LENGTH)) {
+	    std::ostringstream msg;
+	    msg << "Tensor name \"" << name << "\" must have between 1 and "
+		<< MODEL_TENSOR_MAX_NAME_LENGTH << " characters";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	  if (tensor.dimensions().size() > MODEL_TENSOR_MAX_ORDER) {
+	    std::ostringstream msg;
+	    msg << "Tensor \"" << name << "\" has order "
+		<< tensor.dimensions().size() << ", but the maximum order "
+		<< "is " << MODEL_TENSOR_MAX_ORDER;
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	  if (tensor.dimensions().empty() ||
+	      (std::find(tensor.dimensions().begin(),
+			 tensor.dimensions().end(), 0) !=
+		   tensor.dimensions().end())) {
+	    std::ostringstream msg;
+	    msg << "Tensor \"" << name << "\" has dimensions "
+		<< tensor.dimensions() << ", but it must have at least one "
+		<< "dimension and no dimension may be zero";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	  if (!names_.insert(name).second) {
+	    std::ostringstream msg;
+	    msg << "Tensor \"" << name << "\" was already added";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+
+	  Tensor t;
+	  memset(&t.entry, 0, sizeof(t.entry));
+	  strncpy(t.entry.name, name.c_str(), MODEL_TENSOR_MAX_NAME_LENGTH);
+	  t.entry.fieldType = ModelFieldType<Field>::value;
+	  t.entry.order = tensor.dimensions().size();
+	  std::copy(tensor.dimensions().begin(), tensor.dimensions().end(),
+		    t.entry.dimensions);
+	  t.entry.size = tensor.size() * sizeof(Field);
+	  t.data = tensor.data();
+	  t.ref = std::make_shared<RefType>(tensor.ref());
+	  tensors_.push_back(std::move(t));
+	}
+
+	void write(const std::string& filename) const {
+	  std::vector<ModelTensorEntry> table;
+	  ModelFileHeader header;
+	  uint64_t offset = arrays::detail::roundUpToMultiple(
+	      sizeof(ModelFileHeader) +
+		  tensors_.size() * sizeof(ModelTensorEntry),
+	      MODEL_TENSOR_ALIGNMENT
+	  );
+
+	  table.reserve(tensors_.size());
+	  for (const Tensor& t : tensors_) {
+	    table.push_back(t.entry);
+	    table.back().offset = offset;
+	    offset = arrays::detail::roundUpToMultiple(
+		offset + t.entry.size, MODEL_TENSOR_ALIGNMENT
+	    );
+	  }
+
+	  memset(&header, 0, sizeof(header));
+	  std::copy_n(MODEL_FILE_MAGIC, sizeof(header.magic), header.magic);
+	  header.byteOrderMark = MODEL_FILE_BYTE_ORDER_MARK;
+	  header.version = MODEL_FILE_VERSION;
+	  header.numTensors = tensors_.size();
+	  header.tableOffset = sizeof(ModelFileHeader);
+	  header.fileSize = offset;
+
+	  std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+	  if (!out) {
+	    throw pistis::exceptions::IOError(
+		"Cannot open \"" + filename + "\" for writing",
+		PISTIS_EX_HERE
+	    );
+	  }
+
+	  out.write((const char*)&header, sizeof(header));
+	  out.write((const char*)table.data(),
+		    table.size() * sizeof(ModelTensorEntry));
+	  for (size_t i = 0; i < tensors_.size(); ++i) {
+	    pad_(out, table[i].offset);
+	    out.write((const char*)tensors_[i].data, table[i].size);
+	  }
+	  pad_(out, offset);
+	  out.flush();
+	  if (!out) {
+	    throw pistis::exceptions::IOError(
+		"Error writing \"" + filename + "\"", PISTIS_EX_HERE
+	    );
+	  }
+	}
+
+	ModelWriter& operator=(const ModelWriter&) = delete;
+	ModelWriter& operator=(ModelWriter&&) = default;
+
+      private:
+	struct Tensor {
+	  ModelTensorEntry entry;
+	  const void* data;
+	  std::shared_ptr<void> ref;
+	};
+
+	std::vector<Tensor> tensors_;
+	std::unordered_set<std::string> names_;
+
+	static void pad_(std::ofstream& out, uint64_t offset) {
+	  static const char ZEROS[MODEL_TENSOR_ALIGNMENT] = { 0 };
+	  const uint64_t position = out.tellp();
+	  out.write(ZEROS, offset - position);
+	}
+      };
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,414 @@
+#ifndef __NEURODIDACTIC__CORE__LAYERS__BATCHNORMLAYER_HPP__
+#define __NEURODIDACTIC__CORE__LAYERS__BATCHNORMLAYER_HPP__
+
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/arrays/MklAllocator.hpp>
+#include <neurodidactic/core/arrays/detail/MklAdapter.hpp>
+#include <neurodidactic/core/arrays/detail/NormalizationKernels.hpp>
+#include <neurodidactic/core/layers/FullyConnectedLayer.hpp>
+#include <neurodidactic/core/layers/Nonlinearities.hpp>
+#include <neurodidactic/core/profiling/AllocationTelemetry.hpp>
+#include <neurodidactic/core/profiling/Tracer.hpp>
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <cmath>
+#include <sstream>
+#include <type_traits>
+#include <vector>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace layers {
+
+      // Batch normalization (Ioffe and Szegedy, 2015) of a [batch,
+      // features] matrix, followed by a nonlinearity:
+      //
+      //   y = f(scale * (x - mean) / sqrt(variance + epsilon) + shift)
+      //
+      // forward(input, forwardState) trains: it normalizes with the mean
+      // and variance of the batch, found in one pass over the input, and
+      // folds them into the running averages used by forward(input),
+      // which is for inference.  Either way the statistics, scale and
+      // shift collapse into one scale and shift per feature, so
+      // normalization is a single fused pass that also applies f.
+      //
+      // Because it writes the running averages, forward(input,
+      // forwardState) is not safe for workers that share the layer, such
+      // as DataParallelTrainer's, to call concurrently.  Each of them
+      // calls forwardShard() instead, which leaves the layer alone, and
+      // once they are done, updateRunningStatistics() merges the
+      // statistics in all of their forward states into those of the
+      // whole batch and folds them in once.
+      //
+      // The forward state holds the input and the batch statistics.
+      // backward() recomputes the normalized input from them instead of
+      // keeping it, and needs two passes over the batch.
+      //
+      // For serving, foldBatchNorm() below absorbs the layer into the
+      // FullyConnectedLayer in front of it.
+      template <typename Field,
+		typename Nonlinearity = nonlinearities::Identity,
+		typename Allocator = arrays::MklAllocator<Field, 64> >
+      class BatchNormLayer {
+      public:
+	typedef arrays::MdArray<2, Field, Allocator> InputType;
+	typedef arrays::MdArray<2, Field, Allocator> OutputType;
+	typedef arrays::MdArray<1, Field, Allocator> ParameterVectorType;
+
+	static constexpr const uint32_t SCALE = 0;
+	static constexpr const uint32_t SHIFT = 1;
+
+      public:
+	// Starts out as the identity: unit scale and running variance,
+	// zero shift and running mean
+	BatchNormLayer(uint32_t id, size_t numFeatures,
+		       const Nonlinearity& nonlinearity = Nonlinearity(),
+		       Field momentum = Field(0.1),
+		       Field epsilon = Field(1e-5),
+		       const Allocator& allocator = Allocator()):
+	    id_(id),
+	    scale_({ (uint32_t)numFeatures }, Field(1), allocator),
+	    shift_({ (uint32_t)numFeatures }, Field(0), allocator),
+	    runningMean_({ (uint32_t)numFeatures }, Field(0), allocator),
+	    runningVariance_({ (uint32_t)numFeatures }, Field(1), allocator),
+	    f_(nonlinearity), momentum_(momentum), epsilon_(epsilon) {
+	}
+
+	BatchNormLayer(uint32_t id, const ParameterVectorType& scale,
+		       const ParameterVectorType& shift,
+		       const ParameterVectorType& runningMean,
+		       const ParameterVectorType& runningVariance,
+		       const Nonlinearity& nonlinearity = Nonlinearity(),
+		       Field momentum = Field(0.1),
+		       Field epsilon = Field(1e-5),
+		       const Allocator& allocator = Allocator()):
+	    id_(id), scale_(scale.dimensions(), scale.data(), allocator),
+	    shift_(shift.dimensions(), shift.data(), allocator),
+	    runningMean_(runningMean.dimensions(), runningMean.data(),
+			 allocator),
+	    runningVariance_(runningVariance.dimensions(),
+			     runningVariance.data(), allocator),
+	    f_(nonlinearity), momentum_(momentum), epsilon_(epsilon) {
+	  validateShape_();
+	}
+
+	BatchNormLayer(const BatchNormLayer&) = default;
+	BatchNormLayer(BatchNormLayer&&) = default;
+
+	uint32_t id() const { return id_; }
+	size_t numFeatures() const { return scale_.size(); }
+	const Nonlinearity& nonlinearity() const { return f_; }
+	Field momentum() const { return momentum_; }
+	Field epsilon() const { return epsilon_; }
+	const ParameterVectorType& scale() const { return scale_; }
+	ParameterVectorType& scale() { return scale_; }
+	const ParameterVectorType& shift() const { return shift_; }
+	ParameterVectorType& shift() { return shift_; }
+	const ParameterVectorType& runningMean() const { return runningMean_; }
+	ParameterVectorType& runningMean() { return runningMean_; }
+	const ParameterVectorType& runningVariance() const {
+	  return runningVariance_;
+	}
+	ParameterVectorType& runningVariance() { return runningVariance_; }
+
+	// Scale and shift that the layer applies at inference, before f:
+	// scale / sqrt(runningVariance + epsilon) and shift - runningMean
+	// times that
+	ParameterVectorType inferenceScale() const {
+	  ParameterVectorType a(scale_.dimensions(), scale_.allocator());
+	  for (size_t j = 0; j < numFeatures(); ++j) {
+	    a.data()[j] = scale_.data()[j] /
+			  std::sqrt(runningVariance_.data()[j] + epsilon_);
+	  }
+	  return std::move(a);
+	}
+
+	ParameterVectorType inferenceShift() const {
+	  const ParameterVectorType a = inferenceScale();
+	  ParameterVectorType b(shift_.dimensions(), shift_.allocator());
+	  for (size_t j = 0; j < numFeatures(); ++j) {
+	    b.data()[j] = shift_.data()[j] -
+			  runningMean_.data()[j] * a.data()[j];
+	  }
+	  return std::move(b);
+	}
+
+	OutputType forward(const InputType& input) const {
+	  NEURODIDACTIC_ALLOCATION_SCOPE("forward", id());
+	  NEURODIDACTIC_TRACE_SPAN("forward", id());
+	  validateInput_(input);
+	  return normalize_(input, inferenceScale(), inferenceShift(), f_);
+	}
+
+	// Updates the running averages, so unlike the other layers'
+	// forward(input, forwardState), this one is not const
+	template <typename ForwardState>
+	OutputType forward(const InputType& input,
+			   ForwardState& forwardState) {
+	  OutputType output = forwardShard(input, forwardState);
+	  const ForwardState* states[] = { &forwardState };
+	  updateRunningStatistics(states, states + 1);
+	  return std::move(output);
+	}
+
+	// Normalizes "input" with its own statistics, like forward(input,
+	// forwardState), but leaves the running averages alone
+	template <typename ForwardState>
+	OutputType forwardShard(const InputType& input,
+				ForwardState& forwardState) const {
+	  NEURODIDACTIC_ALLOCATION_SCOPE("forward", id());
+	  NEURODIDACTIC_TRACE_SPAN("forward", id());
+	  validateInput_(input);
+
+	  // Row 0 holds the batch mean, row 1 1 / sqrt(variance + epsilon)
+	  // and row 2 the (biased) batch variance
+	  const size_t batchSize = input.dimensions()[0];
+	  const size_t n = numFeatures();
+	  OutputType statistics({ 3, (uint32_t)n }, scale_.allocator());
+	  Field* mean = statistics.data();
+	  Field* invStd = statistics.data() + n;
+	  Field* variance = statistics.data() + 2 * n;
+	  ParameterVectorType a(scale_.dimensions(), scale_.allocator());
+	  ParameterVectorType b(shift_.dimensions(), shift_.allocator());
+
+	  arrays::detail::BatchNormKernels::moments(batchSize, n,
+						    input.data(), mean,
+						    variance);
+	  for (size_t j = 0; j < n; ++j) {
+	    invStd[j] = Field(1) / std::sqrt(variance[j] + epsilon_);
+	    a.data()[j] = scale_.data()[j] * invStd[j];
+	    b.data()[j] = shift_.data()[j] - mean[j] * a.data()[j];
+	  }
+
+	  forwardState.setInputs(id(), input);
+	  forwardState.setActivations(id(), statistics);
+	  return normalize_(input, a, b, f_);
+	}
+
+	// Moves the running averages toward the statistics of the batch
+	// that was split into shards across the forward states pointed to
+	// by [begin, end), each filled in by forwardShard().  The shards'
+	// means and variances are merged exactly, weighted by their sizes,
+	// so the result does not depend on how the batch was split.
+	template <typename Iterator>
+	void updateRunningStatistics(Iterator begin, Iterator end) {
+	  const size_t n = numFeatures();
+	  std::vector<double> mean(n, 0.0);
+	  std::vector<double> variance(n, 0.0);
+	  size_t batchSize = 0;
+
+	  for (Iterator i = begin; i != end; ++i) {
+	    const size_t count = shardSize_(**i);
+	    const Field* m = (*i)->activations(id()).data();
+	    for (size_t j = 0; j < n; ++j) {
+	      mean[j] += double(count) * m[j];
+	    }
+	    batchSize += count;
+	  }
+	  if (!batchSize) {
+	    return;
+	  }
+	  for (size_t j = 0; j < n; ++j) {
+	    mean[j] /= batchSize;
+	  }
+
+	  // Each shard adds its own spread plus that of its mean around the
+	  // mean of the batch
+	  for (Iterator i = begin; i != end; ++i) {
+	    const size_t count = shardSize_(**i);
+	    const Field* m = (*i)->activations(id()).data();
+	    const Field* v = m + 2 * n;
+	    for (size_t j = 0; j < n; ++j) {
+	      const double d = m[j] - mean[j];
+	      variance[j] += double(count) * (v[j] + d * d);
+	    }
+	  }
+
+	  // The running variance is unbiased
+	  const double divisor = (batchSize > 1) ? double(batchSize - 1)
+						: 1.0;
+	  for (size_t j = 0; j < n; ++j) {
+	    Field& m = runningMean_.data()[j];
+	    Field& v = runningVariance_.data()[j];
+	    m += momentum_ * (Field(mean[j]) - m);
+	    v += momentum_ * (Field(variance[j] / divisor) - v);
+	  }
+	}
+
+	template <typename ForwardState, typename Optimizer>
+	InputType backward(const OutputType& lossGradient,
+			   const ForwardState& forwardState,
+			   Optimizer& optimizer) {
+	  NEURODIDACTIC_ALLOCATION_SCOPE("backward", id());
+	  NEURODIDACTIC_TRACE_SPAN("backward", id());
+
+	  auto inputs = forwardState.inputs(id()).template cast<2>();
+	  auto statistics = forwardState.activations(id()).template cast<2>();
+	  if (lossGradient.dimensions() != inputs.dimensions()) {
+	    std::ostringstream msg;
+	    msg << "Array \"lossGradient\" has dimensions "
+		<< lossGradient.dimensions() << ", but it should have "
+		<< "dimensions " << inputs.dimensions();
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+
+	  if (std::is_same<Nonlinearity, nonlinearities::Identity>::value) {
+	    return backward_(inputs, statistics, lossGradient, optimizer);
+	  } else {
+	    return backward_(
+		inputs, statistics,
+		activationGradient_(inputs, statistics)
+		    .multiplyInPlace(lossGradient),
+		optimizer
+	    );
+	  }
+	}
+
+	BatchNormLayer& operator=(const BatchNormLayer&) = default;
+	BatchNormLayer& operator=(BatchNormLayer&&) = default;
+
+      private:
+	uint32_t id_;
+	ParameterVectorType scale_;
+	ParameterVectorType shift_;
+	ParameterVectorType runningMean_;
+	ParameterVectorType runningVariance_;
+	Nonlinearity f_;
+	Field momentum_;
+	Field epsilon_;
+
+	void validateShape_() const {
+	  const ParameterVectorType* vectors[] = {
+	    &shift_, &runningMean_, &runningVariance_
+	  };
+	  const char* names[] = { "shift", "runningMean", "runningVariance" };
+	  for (size_t i = 0; i < 3; ++i) {
+	    if (vectors[i]->dimensions() != scale_.dimensions()) {
+	      std::ostringstream msg;
+	      msg << "Array \"" << names[i] << "\" has dimensions "
+		  << vectors[i]->dimensions() << ", but it should have "
+		  << "dimensions " << scale_.dimensions();
+	      throw pistis::exceptions::IllegalValueError(msg.str(),
+							  PISTIS_EX_HERE);
+	    }
+	  }
+	}
+
+	template <typename ForwardState>
+	size_t shardSize_(const ForwardState& forwardState) const {
+	  return forwardState.inputs(id()).template cast<2>()
+	      .dimensions()[0];
+	}
+
+	void validateInput_(const InputType& input) const {
+	  if (input.dimensions()[1] != numFeatures()) {
+	    std::ostringstream msg;
+	    msg << "Array \"input\" has dimensions "
+		<< input.dimensions() << ", but it should have dimensions "
+		<< "[ *, " << numFeatures() << " ]";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	}
+
+	template <typename Array, typename Function>
+	OutputType normalize_(const Array& input,
+			      const ParameterVectorType& a,
+			      const ParameterVectorType& b,
+			      const Function& f) const {
+	  NEURODIDACTIC_TRACE_SPAN("normalize", id());
+	  OutputType output(input.dimensions(), scale_.allocator());
+	  arrays::detail::BatchNormKernels::scaleAndShift(
+	      input.dimensions()[0], numFeatures(), input.data(), a.data(),
+	      b.data(), f, output.data()
+	  );
+	  return std::move(output);
+	}
+
+	// f'(y) at the normalized input, before f, that forward() computed
+	template <typename Array>
+	OutputType activationGradient_(const Array& inputs,
+				       const Array& statistics) const {
+	  NEURODIDACTIC_TRACE_SPAN("nonlinearity gradient", id());
+	  const size_t n = numFeatures();
+	  ParameterVectorType a(scale_.dimensions(), scale_.allocator());
+	  ParameterVectorType b(shift_.dimensions(), shift_.allocator());
+	  for (size_t j = 0; j < n; ++j) {
+	    a.data()[j] = scale_.data()[j] * statistics.data()[n + j];
+	    b.data()[j] = shift_.data()[j] -
+			  statistics.data()[j] * a.data()[j];
+	  }
+	  return f_.gradient(
+	      normalize_(inputs, a, b, nonlinearities::Identity())
+	  );
+	}
+
+	template <typename Array, typename Optimizer>
+	InputType backward_(const Array& inputs, const Array& statistics,
+			    const OutputType& gradient,
+			    Optimizer& optimizer) {
+	  const size_t n = numFeatures();
+	  InputType inputGradient(inputs.dimensions(), scale_.allocator());
+	  ParameterVectorType scaleGradient(scale_.dimensions(),
+					    scale_.allocator());
+	  ParameterVectorType shiftGradient(shift_.dimensions(),
+					    shift_.allocator());
+
+	  arrays::detail::BatchNormKernels::backward(
+	      inputs.dimensions()[0], n, inputs.data(), statistics.data(),
+	      statistics.data() + n, scale_.data(), gradient.data(),
+	      scaleGradient.data(), shiftGradient.data(),
+	      inputGradient.data()
+	  );
+	  optimizer.update(id(), SCALE, scale_, scaleGradient);
+	  optimizer.update(id(), SHIFT, shift_, shiftGradient);
+	  return std::move(inputGradient);
+	}
+      };
+
+      // Folds a trained BatchNormLayer into the linear FullyConnectedLayer
+      // that feeds it, returning one FullyConnectedLayer with the batch
+      // norm's nonlinearity that computes the same function as the pair
+      // does at inference.  Row i of the weights and element i of the bias
+      // are multiplied by the batch norm's inference scale for feature i,
+      // and its inference shift is added to the bias.  The returned layer
+      // keeps the id of "layer" and takes over its weights and bias.
+      template <typename Field, typename Nonlinearity, typename Allocator>
+      FullyConnectedLayer<Field, Nonlinearity, Allocator> foldBatchNorm(
+	  FullyConnectedLayer<Field, nonlinearities::Identity, Allocator>
+	      layer,
+	  const BatchNormLayer<Field, Nonlinearity, Allocator>& batchNorm
+      ) {
+	typedef arrays::detail::MklAdapter<Field, Field> MklAdapter;
+
+	if (layer.numOutputs() != batchNorm.numFeatures()) {
+	  std::ostringstream msg;
+	  msg << "Cannot fold a BatchNormLayer of "
+	      << batchNorm.numFeatures() << " features into a "
+	      << "FullyConnectedLayer with " << layer.numOutputs()
+	      << " outputs";
+	  throw pistis::exceptions::IllegalValueError(msg.str(),
+						      PISTIS_EX_HERE);
+	}
+
+	const auto a = batchNorm.inferenceScale();
+	const auto b = batchNorm.inferenceShift();
+	const size_t numInputs = layer.numInputs();
+	Field* weights = layer.weights().data();
+	Field* bias = layer.bias().data();
+	for (size_t i = 0; i < layer.numOutputs(); ++i) {
+	  MklAdapter::scale(numInputs, a.data()[i], weights + i * numInputs);
+	  bias[i] = bias[i] * a.data()[i] + b.data()[i];
+	}
+	return FullyConnectedLayer<Field, Nonlinearity, Allocator>(
+	    layer.id(), std::move(layer.weights()), std::move(layer.bias()),
+	    batchNorm.nonlinearity()
+	);
+      }
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,369 @@
+#ifndef __NEURODIDACTIC__CORE__LAYERS__CONVOLUTION2DLAYER_HPP__
+#define __NEURODIDACTIC__CORE__LAYERS__CONVOLUTION2DLAYER_HPP__
+
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/arrays/MklAllocator.hpp>
+#include <neurodidactic/core/arrays/detail/ConvolutionKernels.hpp>
+#include <neurodidactic/core/arrays/detail/MklAdapter.hpp>
+#include <neurodidactic/core/layers/Nonlinearities.hpp>
+#include <neurodidactic/core/profiling/AllocationTelemetry.hpp>
+#include <neurodidactic/core/profiling/Tracer.hpp>
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <algorithm>
+#include <numeric>
+#include <sstream>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace layers {
+
+      // 2D convolution over a batch of images laid out as [batch,
+      // channels, height, width].  The weights are laid out as [output
+      // channels, input channels, kernel height, kernel width], and the
+      // same stride and zero padding apply to both image dimensions.
+      //
+      // Each image is unrolled with im2col into a column matrix of
+      // [input channels * kernel height * kernel width, output pixels],
+      // which is multiplied by the weights with a single sgemm.  The
+      // column matrix is allocated once per call with the layer's
+      // allocator and reused for every image, so a PlannedAllocator
+      // serves it from its arena.
+      template <typename Field,
+		typename Nonlinearity,
+		typename Allocator = arrays::MklAllocator<Field, 64> >
+      class Convolution2dLayer {
+      public:
+	typedef arrays::MdArray<4, Field, Allocator> InputType;
+	typedef arrays::MdArray<4, Field, Allocator> OutputType;
+	typedef arrays::MdArray<4, Field, Allocator> WeightArrayType;
+	typedef arrays::MdArray<1, Field, Allocator> BiasVectorType;
+	typedef arrays::detail::Convolution2dGeometry GeometryType;
+
+      public:
+	Convolution2dLayer(uint32_t id, size_t inputChannels,
+			   size_t outputChannels, size_t kernelHeight,
+			   size_t kernelWidth, uint32_t stride = 1,
+			   uint32_t padding = 0,
+			   const Nonlinearity& nonlinearity = Nonlinearity(),
+			   const Allocator& allocator = Allocator()):
+	    id_(id),
+	    weights_({ (uint32_t)outputChannels, (uint32_t)inputChannels,
+		       (uint32_t)kernelHeight, (uint32_t)kernelWidth },
+		     allocator),
+	    bias_({ (uint32_t)outputChannels }, allocator), stride_(stride),
+	    padding_(padding), f_(nonlinearity) {
+	  validateShape_();
+	}
+
+	Convolution2dLayer(uint32_t id, const WeightArrayType& weights,
+			   const BiasVectorType& bias, uint32_t stride = 1,
+			   uint32_t padding = 0,
+			   const Nonlinearity& nonlinearity = Nonlinearity(),
+			   const Allocator& allocator = Allocator()):
+	    id_(id), weights_(weights.dimensions(), weights.data(), allocator),
+	    bias_(bias.dimensions(), bias.data(), allocator), stride_(stride),
+	    padding_(padding), f_(nonlinearity) {
+	  validateShape_();
+	}
+
+	Convolution2dLayer(const Convolution2dLayer&) = default;
+	Convolution2dLayer(Convolution2dLayer&&) = default;
+
+	uint32_t id() const { return id_; }
+	size_t inputChannels() const { return weights_.dimensions()[1]; }
+	size_t outputChannels() const { return weights_.dimensions()[0]; }
+	size_t kernelHeight() const { return weights_.dimensions()[2]; }
+	size_t kernelWidth() const { return weights_.dimensions()[3]; }
+	uint32_t stride() const { return stride_; }
+	uint32_t padding() const { return padding_; }
+	const Nonlinearity& nonlinearity() const { return f_; }
+	const WeightArrayType& weights() const { return weights_; }
+	WeightArrayType& weights() { return weights_; }
+	const BiasVectorType& bias() const { return bias_; }
+	BiasVectorType& bias() { return bias_; }
+
+	// Geometry of the convolution of one image of the given height and
+	// width
+	GeometryType geometry(uint32_t height, uint32_t width) const {
+	  return GeometryType{ (uint32_t)inputChannels(), height, width,
+			       (uint32_t)kernelHeight(),
+			       (uint32_t)kernelWidth(), stride_, padding_ };
+	}
+
+	OutputType forward(const InputType& input) const {
+	  NEURODIDACTIC_ALLOCATION_SCOPE("forward", id());
+	  NEURODIDACTIC_TRACE_SPAN("forward", id());
+	  return activate_(convolve_(input));
+	}
+
+	// Inference-only forward propagation followed by 2x2 max pooling
+	// with stride 2.  Returns [batch, output channels, outputHeight / 2,
+	// outputWidth / 2]; an odd last output row or column is dropped.
+	//
+	// The convolution is computed a band of output rows at a time, sized
+	// so the band's column matrix and its sgemm result stay in L2, and
+	// each band is pooled before the next one overwrites it.  Only the
+	// pooled result is written to memory.  The bias is constant over a
+	// channel, so pooling commutes with adding it, and with the
+	// nonlinearity if that is nondecreasing (see IsNondecreasing).  Both
+	// are then applied after pooling to a quarter of the pixels; any
+	// other nonlinearity is applied to each band before pooling.
+	OutputType forwardAndPool(const InputType& input) const {
+	  NEURODIDACTIC_ALLOCATION_SCOPE("forward", id());
+	  NEURODIDACTIC_TRACE_SPAN("forward and pool", id());
+	  typedef arrays::detail::MklAdapter<Field, Field> MklAdapter;
+	  typedef arrays::detail::ConvolutionKernels ConvolutionKernels;
+	  const bool poolFirst =
+	      nonlinearities::IsNondecreasing<Nonlinearity>::value;
+
+	  validateInput_(input);
+	  const size_t batchSize = input.dimensions()[0];
+	  const GeometryType g =
+	      geometry(input.dimensions()[2], input.dimensions()[3]);
+	  const size_t m = outputChannels();
+	  const size_t k = g.columnRows();
+	  const uint32_t width = g.outputWidth();
+	  const uint32_t pooledHeight = g.outputHeight() / 2;
+	  const uint32_t pooledWidth = width / 2;
+	  const size_t pooledSize = size_t(pooledHeight) * pooledWidth;
+	  const uint32_t bandHeight = (uint32_t)std::max(
+	      std::min(size_t(pooledHeight),
+		       POOLING_TILE_SIZE / ((k + m) * 2 * width)),
+	      size_t(1)
+	  );
+	  const size_t n = size_t(2) * bandHeight * width;
+	  OutputType output(
+	      { (uint32_t)batchSize, (uint32_t)m, pooledHeight, pooledWidth },
+	      weights_.allocator()
+	  );
+	  arrays::MdArray<2, Field, Allocator> columns(
+	      { (uint32_t)k, (uint32_t)n }, weights_.allocator()
+	  );
+	  arrays::MdArray<2, Field, Allocator> tile(
+	      { (uint32_t)m, (uint32_t)n }, weights_.allocator()
+	  );
+
+	  for (size_t i = 0; i < batchSize; ++i) {
+	    const Field* image = input.data() + i * g.imageSize();
+	    Field* pooled = output.data() + i * m * pooledSize;
+	    for (uint32_t p = 0; p < pooledHeight; p += bandHeight) {
+	      const uint32_t rows = std::min(bandHeight, pooledHeight - p);
+	      const size_t bandSize = size_t(2) * rows * width;
+	      ConvolutionKernels::imageToColumns(g, image, 2 * p,
+						 2 * (p + rows),
+						 columns.data());
+	      MklAdapter::multiplyMatrixByMatrix(m, bandSize, k,
+						 weights_.data(),
+						 columns.data(), tile.data());
+	      if (!poolFirst) {
+		addBiasAndActivate_(bandSize, tile.data());
+	      }
+	      ConvolutionKernels::maxPool2x2(
+		  m, tile.data(), bandSize, width, rows, pooledWidth,
+		  pooled + size_t(p) * pooledWidth, pooledSize
+	      );
+	    }
+	    if (poolFirst) {
+	      addBiasAndActivate_(pooledSize, pooled);
+	    }
+	  }
+	  return std::move(output);
+	}
+
+	template <typename ForwardState>
+	OutputType forward(const InputType& input,
+			   ForwardState& forwardState) const {
+	  NEURODIDACTIC_ALLOCATION_SCOPE("forward", id());
+	  NEURODIDACTIC_TRACE_SPAN("forward", id());
+	  OutputType activations(convolve_(input));
+	  forwardState.setInputs(id(), input);
+	  forwardState.setActivations(id(), activations);
+	  return activate_(activations);
+	}
+
+	template <typename ForwardState, typename Optimizer>
+	InputType backward(const OutputType& lossGradient,
+			   const ForwardState& forwardState,
+			   Optimizer& optimizer) {
+	  NEURODIDACTIC_ALLOCATION_SCOPE("backward", id());
+	  NEURODIDACTIC_TRACE_SPAN("backward", id());
+	  typedef arrays::detail::MklAdapter<Field, Field> MklAdapter;
+	  typedef arrays::detail::ConvolutionKernels ConvolutionKernels;
+	  static const uint32_t WEIGHTS = 0;
+	  static const uint32_t BIAS = 1;
+
+	  auto inputs = forwardState.inputs(id()).template cast<4>();
+	  auto weightedLoss = activationGradient_(
+	      forwardState.activations(id()).template cast<4>()
+	  );
+	  if (weightedLoss.dimensions() != lossGradient.dimensions()) {
+	    std::ostringstream msg;
+	    msg << "Array \"lossGradient\" has dimensions "
+		<< lossGradient.dimensions() << ", but it should have "
+		<< "dimensions " << weightedLoss.dimensions();
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	  weightedLoss.multiplyInPlace(lossGradient);
+
+	  const size_t batchSize = inputs.dimensions()[0];
+	  const GeometryType g =
+	      geometry(inputs.dimensions()[2], inputs.dimensions()[3]);
+	  const size_t m = outputChannels();
+	  const size_t k = g.columnRows();
+	  const size_t n = g.columnColumns();
+	  WeightArrayType weightGradient(weights_.dimensions(), Field(0),
+					 weights_.allocator());
+	  WeightArrayType imageWeightGradient(weights_.dimensions(),
+					      weights_.allocator());
+	  BiasVectorType biasGradient(bias_.dimensions(), Field(0),
+				      bias_.allocator());
+	  InputType inputGradient(inputs.dimensions(), Field(0),
+				  weights_.allocator());
+	  arrays::MdArray<2, Field, Allocator> columns(
+	      { (uint32_t)k, (uint32_t)n }, weights_.allocator()
+	  );
+
+	  for (size_t i = 0; i < batchSize; ++i) {
+	    const Field* gradient = weightedLoss.data() + i * m * n;
+
+	    ConvolutionKernels::imageToColumns(
+		g, inputs.data() + i * g.imageSize(), columns.data()
+	    );
+	    MklAdapter::multiplyMatrixByMatrixTranspose(
+		m, k, n, gradient, columns.data(), imageWeightGradient.data()
+	    );
+	    MklAdapter::add(weightGradient.size(), weightGradient.data(),
+			    imageWeightGradient.data(), weightGradient.data());
+	    for (size_t c = 0; c < m; ++c) {
+	      const Field* p = gradient + c * n;
+	      biasGradient.data()[c] += std::accumulate(p, p + n, Field(0));
+	    }
+
+	    MklAdapter::multiplyMatrixTransposeByMatrix(
+		k, n, m, weights_.data(), gradient, columns.data()
+	    );
+	    ConvolutionKernels::addColumnsToImage(
+		g, columns.data(), inputGradient.data() + i * g.imageSize()
+	    );
+	  }
+
+	  optimizer.update(id(), WEIGHTS, weights_, weightGradient);
+	  optimizer.update(id(), BIAS, bias_, biasGradient);
+	  return std::move(inputGradient);
+	}
+
+	Convolution2dLayer& operator=(const Convolution2dLayer&) = default;
+	Convolution2dLayer& operator=(Convolution2dLayer&&) = default;
+
+      private:
+	// Number of elements in the column matrix and sgemm result of one
+	// band of forwardAndPool(), chosen to fit in L2
+	static constexpr const size_t POOLING_TILE_SIZE = 64 * 1024;
+
+	uint32_t id_;
+	WeightArrayType weights_;
+	BiasVectorType bias_;
+	uint32_t stride_;
+	uint32_t padding_;
+	Nonlinearity f_;
+
+	// Applies f_(x + bias) to the outputChannels() planes of "planeSize"
+	// pixels starting at "p"
+	void addBiasAndActivate_(size_t planeSize, Field* p) const {
+	  for (size_t c = 0; c < outputChannels(); ++c, p += planeSize) {
+	    const Field b = bias_.data()[c];
+	    for (size_t j = 0; j < planeSize; ++j) {
+	      p[j] = f_.apply(p[j] + b);
+	    }
+	  }
+	}
+
+	template <typename Array>
+	auto activate_(const Array& activations) const {
+	  NEURODIDACTIC_TRACE_SPAN("nonlinearity", id());
+	  return f_(activations);
+	}
+
+	template <typename Array>
+	auto activationGradient_(const Array& activations) const {
+	  NEURODIDACTIC_TRACE_SPAN("nonlinearity gradient", id());
+	  return f_.gradient(activations);
+	}
+
+	void validateShape_() const {
+	  if (!stride_) {
+	    throw pistis::exceptions::IllegalValueError(
+		"Stride must be positive", PISTIS_EX_HERE
+	    );
+	  }
+	  if (bias_.dimensions()[0] != weights_.dimensions()[0]) {
+	    std::ostringstream msg;
+	    msg << "Bias has dimensions " << bias_.dimensions()
+		<< ", but it should have dimensions [ "
+		<< weights_.dimensions()[0] << " ]";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	}
+
+	void validateInput_(const InputType& input) const {
+	  const GeometryType g =
+	      geometry(input.dimensions()[2], input.dimensions()[3]);
+	  if ((input.dimensions()[1] != inputChannels()) || !g.fits()) {
+	    std::ostringstream msg;
+	    msg << "Array \"input\" has dimensions " << input.dimensions()
+		<< ", but it should have dimensions [ *, " << inputChannels()
+		<< ", h, w ] with h + " << (2 * padding_) << " >= "
+		<< kernelHeight() << " and w + " << (2 * padding_) << " >= "
+		<< kernelWidth();
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	}
+
+	OutputType convolve_(const InputType& input) const {
+	  typedef arrays::detail::MklAdapter<Field, Field> MklAdapter;
+	  typedef arrays::detail::ConvolutionKernels ConvolutionKernels;
+
+	  validateInput_(input);
+	  const size_t batchSize = input.dimensions()[0];
+	  const GeometryType g =
+	      geometry(input.dimensions()[2], input.dimensions()[3]);
+	  const size_t m = outputChannels();
+	  const size_t k = g.columnRows();
+	  const size_t n = g.columnColumns();
+	  OutputType activations(
+	      { (uint32_t)batchSize, (uint32_t)m, g.outputHeight(),
+		g.outputWidth() },
+	      weights_.allocator()
+	  );
+	  arrays::MdArray<2, Field, Allocator> columns(
+	      { (uint32_t)k, (uint32_t)n }, weights_.allocator()
+	  );
+
+	  for (size_t i = 0; i < batchSize; ++i) {
+	    Field* output = activations.data() + i * m * n;
+	    ConvolutionKernels::imageToColumns(
+		g, input.data() + i * g.imageSize(), columns.data()
+	    );
+	    MklAdapter::multiplyMatrixByMatrix(m, n, k, weights_.data(),
+					       columns.data(), output);
+	    for (size_t c = 0; c < m; ++c) {
+	      const Field b = bias_.data()[c];
+	      Field* p = output + c * n;
+	      for (size_t j = 0; j < n; ++j) {
+		p[j] += b;
+	      }
+	    }
+	  }
+	  return std::move(activations);
+	}
+      };
+
+    }
+  }
+}
+#endif
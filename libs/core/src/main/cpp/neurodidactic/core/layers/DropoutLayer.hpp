@@ -0,0 +1,160 @@
+#ifndef __NEURODIDACTIC__CORE__LAYERS__DROPOUTLAYER_HPP__
+#define __NEURODIDACTIC__CORE__LAYERS__DROPOUTLAYER_HPP__
+
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/arrays/MklAllocator.hpp>
+#include <neurodidactic/core/arrays/detail/DropoutKernels.hpp>
+#include <neurodidactic/core/profiling/AllocationTelemetry.hpp>
+#include <neurodidactic/core/profiling/Tracer.hpp>
+#include <neurodidactic/core/random/Philox.hpp>
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace layers {
+
+      // Inverted dropout (Srivastava et al., 2014): in training, each
+      // element of the input is zeroed with probability rate() and the
+      // survivors are scaled by 1 / (1 - rate()), so inference is the
+      // identity.  Works on arrays of any order.
+      //
+      // The random numbers come from a Philox4x32 generator keyed by the
+      // seed.  Every call to forward(input, forwardState) takes a fresh
+      // stream, numbered by the layer's id and a count of such calls, and
+      // element i uses word i of it.  The mask is thus the same for a
+      // given seed however the work is split across threads, and
+      // concurrent calls from the trainers' worker threads get different
+      // masks without sharing generator state.
+      //
+      // The mask goes into the forward state packed one bit per element,
+      // 1/32 the size of a mask of floats.  Drawing it, applying it and
+      // scaling are one pass on the way forward, and applying it again
+      // to the loss gradient is one pass on the way back.
+      template <typename Field,
+		typename Allocator = arrays::MklAllocator<Field, 64> >
+      class DropoutLayer {
+      public:
+	template <size_t ARRAY_ORDER>
+	using ArrayType = arrays::MdArray<ARRAY_ORDER, Field, Allocator>;
+
+      public:
+	DropoutLayer(uint32_t id, Field rate, uint64_t seed):
+	    id_(id), rate_(rate), rng_(seed), numCalls_(0) {
+	  if (!((rate >= Field(0)) && (rate < Field(1)))) {
+	    std::ostringstream msg;
+	    msg << "Dropout rate is " << rate
+		<< ", but it must be in [0, 1)";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	}
+
+	DropoutLayer(const DropoutLayer& other):
+	    id_(other.id_), rate_(other.rate_), rng_(other.rng_),
+	    numCalls_(other.numCalls()) {
+	}
+
+	uint32_t id() const { return id_; }
+	Field rate() const { return rate_; }
+	uint64_t seed() const { return rng_.seed(); }
+
+	// Number of calls to forward(input, forwardState) so far
+	uint64_t numCalls() const {
+	  return numCalls_.load(std::memory_order_relaxed);
+	}
+
+	template <size_t ARRAY_ORDER>
+	ArrayType<ARRAY_ORDER> forward(
+	    const ArrayType<ARRAY_ORDER>& input
+	) const {
+	  NEURODIDACTIC_ALLOCATION_SCOPE("forward", id());
+	  NEURODIDACTIC_TRACE_SPAN("forward", id());
+	  return input;
+	}
+
+	template <size_t ARRAY_ORDER, typename ForwardState>
+	ArrayType<ARRAY_ORDER> forward(const ArrayType<ARRAY_ORDER>& input,
+				       ForwardState& forwardState) const {
+	  NEURODIDACTIC_ALLOCATION_SCOPE("forward", id());
+	  NEURODIDACTIC_TRACE_SPAN("forward", id());
+	  typedef arrays::detail::DropoutKernels DropoutKernels;
+	  typedef typename ForwardState::MaskType MaskType;
+
+	  const uint64_t stream =
+	      (uint64_t(id()) << 32) |
+	      uint32_t(numCalls_.fetch_add(1, std::memory_order_relaxed));
+	  ArrayType<ARRAY_ORDER> output(input.dimensions(), input.allocator());
+	  MaskType mask(
+	      { (uint32_t)DropoutKernels::numMaskWords(input.size()) },
+	      typename MaskType::AllocatorType(input.allocator())
+	  );
+	  DropoutKernels::dropout(rng_, stream, threshold_(), scale_(),
+				  input.size(), input.data(), mask.data(),
+				  output.data());
+	  forwardState.setMask(id(), std::move(mask));
+	  return std::move(output);
+	}
+
+	// The layer has no parameters, so "optimizer" goes unused
+	template <size_t ARRAY_ORDER, typename ForwardState,
+		  typename Optimizer>
+	ArrayType<ARRAY_ORDER> backward(
+	    const ArrayType<ARRAY_ORDER>& lossGradient,
+	    const ForwardState& forwardState,
+	    Optimizer& /*optimizer*/
+	) const {
+	  NEURODIDACTIC_ALLOCATION_SCOPE("backward", id());
+	  NEURODIDACTIC_TRACE_SPAN("backward", id());
+	  typedef arrays::detail::DropoutKernels DropoutKernels;
+
+	  const auto& mask = forwardState.mask(id());
+	  const size_t n = lossGradient.size();
+	  if (mask.size() != DropoutKernels::numMaskWords(n)) {
+	    std::ostringstream msg;
+	    msg << "Array \"lossGradient\" has " << n
+		<< " elements, but the mask from forward propagation has "
+		<< mask.size() << " words of "
+		<< DropoutKernels::BITS_PER_WORD << " bits";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+
+	  ArrayType<ARRAY_ORDER> inputGradient(lossGradient.dimensions(),
+					       lossGradient.allocator());
+	  DropoutKernels::applyMask(n, mask.data(), scale_(),
+				    lossGradient.data(), inputGradient.data());
+	  return std::move(inputGradient);
+	}
+
+	DropoutLayer& operator=(const DropoutLayer& other) {
+	  id_ = other.id_;
+	  rate_ = other.rate_;
+	  rng_ = other.rng_;
+	  numCalls_.store(other.numCalls(), std::memory_order_relaxed);
+	  return *this;
+	}
+
+      private:
+	uint32_t id_;
+	Field rate_;
+	random::Philox4x32 rng_;
+	mutable std::atomic<uint64_t> numCalls_;
+
+	Field scale_() const { return Field(1) / (Field(1) - rate_); }
+
+	// An element survives when its random word is at least this
+	uint32_t threshold_() const {
+	  return uint32_t(std::min(double(rate_) * 4294967296.0,
+				   4294967295.0));
+	}
+      };
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,154 @@
+#ifndef __NEURODIDACTIC__CORE__LAYERS__EMBEDDINGLAYER_HPP__
+#define __NEURODIDACTIC__CORE__LAYERS__EMBEDDINGLAYER_HPP__
+
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/arrays/MklAllocator.hpp>
+#include <neurodidactic/core/arrays/SparseRowMatrix.hpp>
+#include <neurodidactic/core/arrays/detail/SparseKernels.hpp>
+#include <neurodidactic/core/profiling/AllocationTelemetry.hpp>
+#include <neurodidactic/core/profiling/Tracer.hpp>
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <memory>
+#include <sstream>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace layers {
+
+      // Lookup table of numRows() embeddings of dimension() elements each.
+      // The input is a vector of row indices and the output holds the
+      // corresponding rows of the table, one per index.
+      //
+      // This is a FullyConnectedLayer over one-hot inputs with the matrix
+      // product replaced by a row gather.  The weight gradient is zero
+      // outside the rows that were looked up, so backward() hands it to
+      // the optimizer's updateRows() as a SparseRowMatrix (see
+      // RowUpdates.hpp) and never forms a dense gradient of the table.
+      template <typename Field,
+		typename Allocator = arrays::MklAllocator<Field, 64> >
+      class EmbeddingLayer {
+      public:
+	typedef typename std::allocator_traits<Allocator>
+			    ::template rebind_alloc<uint32_t>
+		IndexAllocator;
+	typedef arrays::MdArray<1, uint32_t, IndexAllocator> InputType;
+	typedef arrays::MdArray<2, Field, Allocator> OutputType;
+	typedef arrays::MdArray<2, Field, Allocator> WeightMatrixType;
+	typedef arrays::SparseRowMatrix<Field, Allocator> GradientType;
+
+	static constexpr const uint32_t WEIGHTS = 0;
+
+      public:
+	EmbeddingLayer(uint32_t id, size_t numRows, size_t dimension,
+		       const Allocator& allocator = Allocator()):
+	    id_(id),
+	    weights_({ (uint32_t)numRows, (uint32_t)dimension }, allocator) {
+	}
+
+	EmbeddingLayer(uint32_t id, const WeightMatrixType& weights,
+		       const Allocator& allocator = Allocator()):
+	    id_(id),
+	    weights_(weights.dimensions(), weights.data(), allocator) {
+	}
+
+	EmbeddingLayer(uint32_t id, WeightMatrixType&& weights):
+	    id_(id), weights_(std::move(weights)) {
+	}
+
+	EmbeddingLayer(const EmbeddingLayer&) = default;
+	EmbeddingLayer(EmbeddingLayer&&) = default;
+
+	uint32_t id() const { return id_; }
+	size_t numRows() const { return weights_.dimensions()[0]; }
+	size_t dimension() const { return weights_.dimensions()[1]; }
+	const WeightMatrixType& weights() const { return weights_; }
+	WeightMatrixType& weights() { return weights_; }
+
+	OutputType forward(const InputType& indices) const {
+	  NEURODIDACTIC_ALLOCATION_SCOPE("forward", id());
+	  NEURODIDACTIC_TRACE_SPAN("forward", id());
+	  validateIndices_(indices);
+	  OutputType output(
+	      { (uint32_t)indices.size(), (uint32_t)dimension() },
+	      weights_.allocator()
+	  );
+	  arrays::detail::SparseRowKernels::gatherRows(
+	      indices.size(), dimension(), weights_.data(), indices.data(),
+	      output.data()
+	  );
+	  return std::move(output);
+	}
+
+	// The lookup keeps no state for backward(), which is given the
+	// indices again.  This overload lets the layer be driven like the
+	// others.
+	template <typename ForwardState>
+	OutputType forward(const InputType& indices,
+			   ForwardState& /*forwardState*/) const {
+	  return forward(indices);
+	}
+
+	// Sums the rows of "lossGradient" that share an index
+	GradientType weightGradient(const InputType& indices,
+				    const OutputType& lossGradient) const {
+	  validateIndices_(indices);
+	  if (lossGradient.dimensions() !=
+	        typename OutputType::DimensionListType(
+		    { (uint32_t)indices.size(), (uint32_t)dimension() }
+		)) {
+	    std::ostringstream msg;
+	    msg << "Array \"lossGradient\" has dimensions "
+		<< lossGradient.dimensions() << ", but it should have "
+		<< "dimensions [ " << indices.size() << ", " << dimension()
+		<< " ]";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	  return GradientType::sumRows(numRows(), dimension(),
+				       indices.size(), indices.data(),
+				       lossGradient.data(),
+				       weights_.allocator());
+	}
+
+	// The indices are features rather than the outputs of an earlier
+	// layer, so no loss gradient is computed for them.  As with the
+	// sparse FullyConnectedLayer::backward(), they are passed last,
+	// after the arguments every layer's backward() takes.
+	template <typename ForwardState, typename Optimizer>
+	void backward(const OutputType& lossGradient,
+		      const ForwardState& /*forwardState*/,
+		      Optimizer& optimizer, const InputType& indices) {
+	  NEURODIDACTIC_ALLOCATION_SCOPE("backward", id());
+	  NEURODIDACTIC_TRACE_SPAN("backward", id());
+	  optimizer.updateRows(id(), WEIGHTS, weights_,
+			       weightGradient(indices, lossGradient));
+	}
+
+	EmbeddingLayer& operator=(const EmbeddingLayer&) = default;
+	EmbeddingLayer& operator=(EmbeddingLayer&&) = default;
+
+      private:
+	uint32_t id_;
+	WeightMatrixType weights_;
+
+	void validateIndices_(const InputType& indices) const {
+	  const uint32_t* p = indices.data();
+	  for (size_t i = 0; i < indices.size(); ++i) {
+	    if (p[i] >= numRows()) {
+	      std::ostringstream msg;
+	      msg << "Index " << p[i] << " at position " << i
+		  << " is out of range for a table of " << numRows()
+		  << " rows";
+	      throw pistis::exceptions::IllegalValueError(msg.str(),
+							  PISTIS_EX_HERE);
+	    }
+	  }
+	}
+      };
+
+    }
+  }
+}
+#endif
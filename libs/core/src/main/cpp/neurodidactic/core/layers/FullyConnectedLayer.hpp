@@ -2,28 +2,41 @@
 #define __NEURODIDACTIC__CORE__LAYERS__FULLYCONNECTED_HPP__
 
 #include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/arrays/SparseVector.hpp>
+#include <neurodidactic/core/arrays/detail/MklAdapter.hpp>
+#include <neurodidactic/core/arrays/detail/SparseKernels.hpp>
+#include <neurodidactic/core/profiling/AllocationTelemetry.hpp>
+#include <neurodidactic/core/profiling/Tracer.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <sstream>
 
 namespace neurodidactic {
   namespace core {
     namespace layers {
 
       template <typename Field,
-		typenmae Nonlinearity,
-		typename Allocator = MklAllocator<Field, 64> >
+		typename Nonlinearity,
+		typename Allocator = arrays::MklAllocator<Field, 64> >
       class FullyConnectedLayer {
       public:
 	typedef arrays::MdArray<1, Field, Allocator> InputType;
 	typedef arrays::MdArray<1, Field, Allocator> OutputType;
 	typedef arrays::MdArray<2, Field, Allocator> WeightMatrixType;
 	typedef arrays::MdArray<1, Field, Allocator> BiasVectorType;
+	typedef arrays::MdArray<2, Field, Allocator> BatchInputType;
+	typedef arrays::MdArray<2, Field, Allocator> BatchOutputType;
+	typedef arrays::SparseVector<Field, Allocator> SparseInputType;
 	
       public:
+	// Leaves the weights and bias uninitialized.  Use
+	// initializers::initialize() (see Initializers.hpp) to draw them.
 	FullyConnectedLayer(uint32_t id,
 			    size_t numInputs, size_t numOutputs,
 			    const Nonlinearity& nonlinearity = Nonlinearity(),
 			    const Allocator& allocator = Allocator()):
-	    id_(id), weights_({ numOutputs, numInputs }, allocator),
-	    bias_({ numOutputs }, allocator), f_(nonlinearity) {
+	    id_(id),
+	    weights_({ (uint32_t)numOutputs, (uint32_t)numInputs }, allocator),
+	    bias_({ (uint32_t)numOutputs }, allocator), f_(nonlinearity) {
 	}
 	
 	FullyConnectedLayer(uint32_t id,
@@ -40,7 +53,7 @@ namespace neurodidactic {
 			    WeightMatrixType&& weights,
 			    BiasVectorType&& bias,
 			    const Nonlinearity& nonlinearity = Nonlinearity()):
-	    id_(id), weights_(std::move(weights)), bias(std::move(bias_)),
+	    id_(id), weights_(std::move(weights)), bias_(std::move(bias)),
 	    f_(nonlinearity) {
 	  // TODO: Check dimensions of weights and bias
 	}
@@ -58,26 +71,31 @@ namespace neurodidactic {
 	BiasVectorType& bias() { return bias_; }
 
 	OutputType forward(const InputType& input) const {
-	  return f_(weights_.innerProduct(input).addInPlace(bias_));
+	  NEURODIDACTIC_ALLOCATION_SCOPE("forward", id());
+	  NEURODIDACTIC_TRACE_SPAN("forward", id());
+	  return activate_(weights_.innerProduct(input).addInPlace(bias_));
 	}
 
 	template <typename ForwardState>
 	OutputType forward(const InputType& input,
 			   ForwardState& forwardState) const {
+	  NEURODIDACTIC_ALLOCATION_SCOPE("forward", id());
+	  NEURODIDACTIC_TRACE_SPAN("forward", id());
 	  OutputType activations(
 	      weights_.innerProduct(input).addInPlace(bias_)
 	  );
 	  forwardState.setInputs(id(), input);
 	  forwardState.setActivations(id(), activations);
-	  return f_(activations);
+	  return activate_(activations);
 	}
 
 	template <typename ForwardState>
 	InputType lossGradient(const OutputType& lossGradient,
 			       const ForwardState& forwardState) const {
-	  return weights._transposeInnerProduct(
-	      f_.gradient(forwardState.activations(id()).cast<1>())
-	        .multiplyInPlace(lossGradient)
+	  return weights_.transposeInnerProduct(
+	      activationGradient_(
+		  forwardState.activations(id()).template cast<1>()
+	      ).multiplyInPlace(lossGradient)
 	  );
 	}
 
@@ -86,35 +104,138 @@ namespace neurodidactic {
 	    const OutputType& lossGradient,
 	    const ForwardState& forwardState
 	) const {
-	  return f_.gradient(forwardState.activations(id()).cast<1>())
-	           .multiplyInPlace(lossGradient)
-	           .outerProduct(forwardState.inputs(id()).cast<1>());
+	  return activationGradient_(
+	      forwardState.activations(id()).template cast<1>()
+	  ).multiplyInPlace(lossGradient)
+	   .outerProduct(forwardState.inputs(id()).template cast<1>());
 	}
 
 	template <typename ForwardState>
 	BiasVectorType biasGradient(const OutputType& lossGradient,
 				    const ForwardState& forwardState) {
-	  return f_.gradient(forwardState.activations(id()).cast<1>())
-	           .multiplyInPlace(lossGradient);
+	  return activationGradient_(
+	      forwardState.activations(id()).template cast<1>()
+	  ).multiplyInPlace(lossGradient);
 	}
 
 	template <typename ForwardState, typename Optimizer>
 	InputType backward(const OutputType& lossGradient,
 			   const ForwardState& forwardState,
 			   Optimizer& optimizer) {
+	  NEURODIDACTIC_ALLOCATION_SCOPE("backward", id());
+	  NEURODIDACTIC_TRACE_SPAN("backward", id());
 	  static const uint32_t WEIGHTS = 0;
 	  static const uint32_t BIAS = 1;
 	  
-	  auto weightedLoss =
-	      f_.gradient(forwardState.activations(id()).cast<1>())
-	        .multiplyInPlace(lossGradient);
-	  optimizer.update(id(), WEIGHTS, weights_,
-	      weightedLoss.outerProduct(forwardState.inputs(id()).cast<1>())
+	  auto weightedLoss = activationGradient_(
+	      forwardState.activations(id()).template cast<1>()
+	  );
+	  weightedLoss.multiplyInPlace(lossGradient);
+	  optimizer.update(
+	      id(), WEIGHTS, weights_,
+	      weightedLoss.outerProduct(
+		  forwardState.inputs(id()).template cast<1>()
+	      )
 	  );
 	  optimizer.update(id(), BIAS, bias_, weightedLoss);
 	  return weights_.transposeInnerProduct(weightedLoss);
 	}
 
+	BatchOutputType forward(const BatchInputType& input) const {
+	  NEURODIDACTIC_ALLOCATION_SCOPE("forward", id());
+	  NEURODIDACTIC_TRACE_SPAN("forward", id());
+	  return activate_(batchActivations_(input));
+	}
+
+	template <typename ForwardState>
+	BatchOutputType forward(const BatchInputType& input,
+				ForwardState& forwardState) const {
+	  NEURODIDACTIC_ALLOCATION_SCOPE("forward", id());
+	  NEURODIDACTIC_TRACE_SPAN("forward", id());
+	  BatchOutputType activations(batchActivations_(input));
+	  forwardState.setInputs(id(), input);
+	  forwardState.setActivations(id(), activations);
+	  return activate_(activations);
+	}
+
+	template <typename ForwardState, typename Optimizer>
+	BatchInputType backward(const BatchOutputType& lossGradient,
+				const ForwardState& forwardState,
+				Optimizer& optimizer) {
+	  NEURODIDACTIC_ALLOCATION_SCOPE("backward", id());
+	  NEURODIDACTIC_TRACE_SPAN("backward", id());
+	  typedef arrays::detail::MklAdapter<Field, Field> MklAdapter;
+	  static const uint32_t WEIGHTS = 0;
+	  static const uint32_t BIAS = 1;
+
+	  auto inputs = forwardState.inputs(id()).template cast<2>();
+	  auto weightedLoss = activationGradient_(
+	      forwardState.activations(id()).template cast<2>()
+	  );
+	  weightedLoss.multiplyInPlace(lossGradient);
+	  const size_t batchSize = weightedLoss.dimensions()[0];
+	  WeightMatrixType weightGradient(weights_.dimensions(),
+					  weights_.allocator());
+	  BiasVectorType biasGradient(bias_.dimensions(), Field(0),
+				      bias_.allocator());
+
+	  MklAdapter::multiplyMatrixTransposeByMatrix(
+	      numOutputs(), numInputs(), batchSize, weightedLoss.data(),
+	      inputs.data(), weightGradient.data()
+	  );
+	  for (const Field* p = weightedLoss.data();
+	       p != weightedLoss.end();
+	       p += numOutputs()) {
+	    MklAdapter::add(numOutputs(), biasGradient.data(), p,
+			    biasGradient.data());
+	  }
+	  optimizer.update(id(), WEIGHTS, weights_, weightGradient);
+	  optimizer.update(id(), BIAS, bias_, biasGradient);
+	  return weightedLoss.matrixProduct(weights_);
+	}
+
+	OutputType forward(const SparseInputType& input) const {
+	  NEURODIDACTIC_ALLOCATION_SCOPE("forward", id());
+	  NEURODIDACTIC_TRACE_SPAN("forward", id());
+	  return activate_(sparseActivations_(input));
+	}
+
+	template <typename ForwardState>
+	OutputType forward(const SparseInputType& input,
+			   ForwardState& forwardState) const {
+	  NEURODIDACTIC_ALLOCATION_SCOPE("forward", id());
+	  NEURODIDACTIC_TRACE_SPAN("forward", id());
+	  OutputType activations(sparseActivations_(input));
+	  forwardState.setActivations(id(), activations);
+	  return activate_(activations);
+	}
+
+	// Sparse inputs are features rather than the outputs of an earlier
+	// layer, so no loss gradient is computed for them.  The forward
+	// state only records activations for sparse inputs, so the input
+	// is passed again here, after the arguments the dense backward()
+	// takes.  The weight gradient touches only the columns of the
+	// input's nonzeros and is handed to the optimizer's updateColumns()
+	// as the two factors of its outer product.
+	template <typename ForwardState, typename Optimizer>
+	void backward(const OutputType& lossGradient,
+		      const ForwardState& forwardState, Optimizer& optimizer,
+		      const SparseInputType& input) {
+	  NEURODIDACTIC_ALLOCATION_SCOPE("backward", id());
+	  NEURODIDACTIC_TRACE_SPAN("backward", id());
+	  static const uint32_t WEIGHTS = 0;
+	  static const uint32_t BIAS = 1;
+
+	  validateSparseInput_(input);
+	  auto weightedLoss = activationGradient_(
+	      forwardState.activations(id()).template cast<1>()
+	  );
+	  weightedLoss.multiplyInPlace(lossGradient);
+	  optimizer.updateColumns(id(), WEIGHTS, weights_, weightedLoss,
+				  input);
+	  optimizer.update(id(), BIAS, bias_, weightedLoss);
+	}
+
 	FullyConnectedLayer& operator=(const FullyConnectedLayer&) = default;
 	FullyConnectedLayer& operator=(FullyConnectedLayer&&) = default;
 	
@@ -123,6 +244,70 @@ namespace neurodidactic {
 	WeightMatrixType weights_;
 	BiasVectorType bias_;
 	Nonlinearity f_;
+
+	template <typename Array>
+	auto activate_(const Array& activations) const {
+	  NEURODIDACTIC_TRACE_SPAN("nonlinearity", id());
+	  return f_(activations);
+	}
+
+	template <typename Array>
+	auto activationGradient_(const Array& activations) const {
+	  NEURODIDACTIC_TRACE_SPAN("nonlinearity gradient", id());
+	  return f_.gradient(activations);
+	}
+
+	void validateSparseInput_(const SparseInputType& input) const {
+	  if (input.size() != numInputs()) {
+	    std::ostringstream msg;
+	    msg << "Sparse input has size " << input.size()
+		<< ", but it should have size " << numInputs();
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	}
+
+	OutputType sparseActivations_(const SparseInputType& input) const {
+	  validateSparseInput_(input);
+	  OutputType activations(bias_.dimensions(), weights_.allocator());
+	  arrays::detail::SparseVectorKernels::multiplyMatrixByVector(
+	      numOutputs(), numInputs(), weights_.data(),
+	      input.numNonZeros(), input.indices(), input.values(),
+	      activations.data()
+	  );
+	  activations.addInPlace(bias_);
+	  return activations;
+	}
+
+	BatchOutputType batchActivations_(const BatchInputType& input) const {
+	  typedef arrays::detail::MklAdapter<Field, Field> MklAdapter;
+
+	  if ((input.dimensions().size() != 2) ||
+	      (input.dimensions()[1] != numInputs())) {
+	    std::ostringstream msg;
+	    msg << "Array \"input\" has dimensions " << input.dimensions()
+		<< ", but it should have dimensions [ *, " << numInputs()
+		<< " ]";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+
+	  const size_t batchSize = input.dimensions()[0];
+	  BatchOutputType activations(
+	      { (uint32_t)batchSize, (uint32_t)numOutputs() },
+	      weights_.allocator()
+	  );
+	  MklAdapter::multiplyMatrixByMatrixTranspose(
+	      batchSize, numOutputs(), numInputs(), input.data(),
+	      weights_.data(), activations.data()
+	  );
+	  for (Field* p = activations.data();
+	       p != activations.end();
+	       p += numOutputs()) {
+	    MklAdapter::add(numOutputs(), p, bias_.data(), p);
+	  }
+	  return std::move(activations);
+	}
       };
       
     }
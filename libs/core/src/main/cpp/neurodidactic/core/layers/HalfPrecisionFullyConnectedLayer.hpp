@@ -0,0 +1,171 @@
+#ifndef __NEURODIDACTIC__CORE__LAYERS__HALFPRECISIONFULLYCONNECTEDLAYER_HPP__
+#define __NEURODIDACTIC__CORE__LAYERS__HALFPRECISIONFULLYCONNECTEDLAYER_HPP__
+
+#include <neurodidactic/core/arrays/HalfPrecision.hpp>
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/arrays/MklAllocator.hpp>
+#include <neurodidactic/core/arrays/detail/MklAdapter.hpp>
+#include <neurodidactic/core/layers/FullyConnectedLayer.hpp>
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <memory>
+#include <sstream>
+
+namespace neurodidactic {
+  namespace core {
+    namespace layers {
+
+      // Inference-only version of FullyConnectedLayer that stores its
+      // weights as BFloat16 or Float16, halving the memory traffic of the
+      // matrix products.  Inputs may be float or Half.  Float inputs are
+      // used as they are, so only the weights lose precision.  Products
+      // accumulate in float, and the bias, nonlinearity and outputs are
+      // float.
+      template <typename Half,
+		typename Nonlinearity,
+		typename Allocator = arrays::MklAllocator<Half, 64> >
+      class HalfPrecisionFullyConnectedLayer {
+      public:
+	typedef typename std::allocator_traits<Allocator>
+			    ::template rebind_alloc<float>
+		FloatAllocator;
+	typedef arrays::MdArray<1, float, FloatAllocator> InputType;
+	typedef arrays::MdArray<1, float, FloatAllocator> OutputType;
+	typedef arrays::MdArray<2, float, FloatAllocator> BatchInputType;
+	typedef arrays::MdArray<2, float, FloatAllocator> BatchOutputType;
+	typedef arrays::MdArray<1, Half, Allocator> HalfInputType;
+	typedef arrays::MdArray<2, Half, Allocator> HalfBatchInputType;
+	typedef arrays::MdArray<2, Half, Allocator> WeightMatrixType;
+	typedef arrays::MdArray<1, float, FloatAllocator> BiasVectorType;
+
+      public:
+	template <typename OtherAllocator>
+	explicit HalfPrecisionFullyConnectedLayer(
+	    const FullyConnectedLayer<float, Nonlinearity, OtherAllocator>&
+		layer,
+	    const Allocator& allocator = Allocator()
+	):
+	    id_(layer.id()),
+	    weights_(layer.weights().dimensions(), allocator),
+	    bias_(layer.bias().dimensions(), layer.bias().data(),
+		  FloatAllocator(allocator)),
+	    f_(layer.nonlinearity()) {
+	  arrays::convert(weights_.size(), layer.weights().data(),
+			  weights_.data());
+	}
+
+	HalfPrecisionFullyConnectedLayer(
+	    uint32_t id, WeightMatrixType&& weights, BiasVectorType&& bias,
+	    const Nonlinearity& nonlinearity = Nonlinearity()
+	):
+	    id_(id), weights_(std::move(weights)), bias_(std::move(bias)),
+	    f_(nonlinearity) {
+	  if ((weights_.dimensions().size() != 2) ||
+	      (bias_.dimensions().size() != 1) ||
+	      (bias_.dimensions()[0] != weights_.dimensions()[0])) {
+	    std::ostringstream msg;
+	    msg << "Weights with dimensions " << weights_.dimensions()
+		<< " and bias with dimensions " << bias_.dimensions()
+		<< " do not match";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	}
+
+	HalfPrecisionFullyConnectedLayer(
+	    const HalfPrecisionFullyConnectedLayer&
+	) = default;
+	HalfPrecisionFullyConnectedLayer(
+	    HalfPrecisionFullyConnectedLayer&&
+	) = default;
+
+	uint32_t id() const { return id_; }
+	size_t numInputs() const { return weights_.dimensions()[1]; }
+	size_t numOutputs() const { return weights_.dimensions()[0]; }
+	const Nonlinearity& nonlinearity() const { return f_; }
+	const WeightMatrixType& weights() const { return weights_; }
+	const BiasVectorType& bias() const { return bias_; }
+
+	OutputType forward(const InputType& input) const {
+	  return forwardOne_(input);
+	}
+
+	OutputType forward(const HalfInputType& input) const {
+	  return forwardOne_(input);
+	}
+
+	BatchOutputType forward(const BatchInputType& input) const {
+	  return forwardBatch_(input);
+	}
+
+	BatchOutputType forward(const HalfBatchInputType& input) const {
+	  return forwardBatch_(input);
+	}
+
+	HalfPrecisionFullyConnectedLayer& operator=(
+	    const HalfPrecisionFullyConnectedLayer&
+	) = default;
+	HalfPrecisionFullyConnectedLayer& operator=(
+	    HalfPrecisionFullyConnectedLayer&&
+	) = default;
+
+      private:
+	uint32_t id_;
+	WeightMatrixType weights_;
+	BiasVectorType bias_;
+	Nonlinearity f_;
+
+	template <typename Vector>
+	OutputType forwardOne_(const Vector& input) const {
+	  typedef arrays::detail::MklAdapter<Half, Half> MklAdapter;
+
+	  validateInput_(input.dimensions(), 1);
+	  OutputType activations({ (uint32_t)numOutputs() },
+				 bias_.allocator());
+	  MklAdapter::multiplyMatrixByVector(numOutputs(), numInputs(),
+					     weights_.data(), input.data(),
+					     activations.data());
+	  return f_(activations.addInPlace(bias_));
+	}
+
+	template <typename Matrix>
+	BatchOutputType forwardBatch_(const Matrix& input) const {
+	  typedef arrays::detail::MklAdapter<Half, Half> MklAdapter;
+	  typedef arrays::detail::MklAdapter<float, float> FloatAdapter;
+
+	  validateInput_(input.dimensions(), 2);
+	  const size_t batchSize = input.dimensions()[0];
+	  BatchOutputType activations(
+	      { (uint32_t)batchSize, (uint32_t)numOutputs() },
+	      bias_.allocator()
+	  );
+	  MklAdapter::multiplyMatrixByMatrixTranspose(
+	      batchSize, numOutputs(), numInputs(), input.data(),
+	      weights_.data(), activations.data()
+	  );
+	  for (float* p = activations.data();
+	       p != activations.end();
+	       p += numOutputs()) {
+	    FloatAdapter::add(numOutputs(), p, bias_.data(), p);
+	  }
+	  return f_(activations);
+	}
+
+	template <typename DimensionList>
+	void validateInput_(const DimensionList& dimensions,
+			    size_t order) const {
+	  if ((dimensions.size() != order) ||
+	      (dimensions[order - 1] != numInputs())) {
+	    std::ostringstream msg;
+	    msg << "Array \"input\" has dimensions " << dimensions
+		<< ", but its last dimension should be " << numInputs();
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	}
+      };
+
+    }
+  }
+}
+#endif
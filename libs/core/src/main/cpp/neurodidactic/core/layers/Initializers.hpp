@@ -0,0 +1,128 @@
+#ifndef __NEURODIDACTIC__CORE__LAYERS__INITIALIZERS_HPP__
+#define __NEURODIDACTIC__CORE__LAYERS__INITIALIZERS_HPP__
+
+#include <neurodidactic/core/arrays/detail/MklAdapter.hpp>
+#include <neurodidactic/core/arrays/detail/RandomKernels.hpp>
+#include <neurodidactic/core/profiling/Tracer.hpp>
+#include <neurodidactic/core/random/Philox.hpp>
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace layers {
+
+      // Random initial weights.  Each initializer is a function object
+      // called as init(weights, stream) on a weight array whose first
+      // dimension is the number of outputs, like the [outputs, inputs]
+      // matrix of a FullyConnectedLayer; the fan-in is the number of
+      // elements per output.  The samples come from a Philox4x32
+      // generator keyed by the initializer's seed, using the given
+      // stream, and are drawn in parallel with a result that does not
+      // depend on the number of threads.  initialize() below uses the
+      // layer's id as the stream, so one initializer gives every layer
+      // of a model different weights.
+      namespace initializers {
+
+	// Uniform on [-limit, limit) with limit = gain * sqrt(6 / (fanIn +
+	// fanOut)) (Glorot and Bengio, 2010)
+	class XavierUniform {
+	public:
+	  explicit XavierUniform(uint64_t seed, double gain = 1.0):
+	      rng_(seed), gain_(gain) {
+	  }
+
+	  uint64_t seed() const { return rng_.seed(); }
+	  double gain() const { return gain_; }
+
+	  template <typename Array>
+	  void operator()(Array& weights, uint64_t stream) const {
+	    typedef typename Array::FieldType Field;
+	    const size_t fanOut = weights.dimensions()[0];
+	    const size_t fanIn = weights.size() / std::max(fanOut, size_t(1));
+	    const Field limit =
+		Field(gain_ * std::sqrt(6.0 / double(fanIn + fanOut)));
+	    arrays::detail::RandomKernels::uniform(
+		rng_, stream, -limit, limit, weights.size(), weights.data()
+	    );
+	  }
+
+	private:
+	  random::Philox4x32 rng_;
+	  double gain_;
+	};
+
+	// Normal with mean zero and standard deviation sqrt(2 / fanIn),
+	// for layers followed by a ReLU (He et al., 2015)
+	class HeNormal {
+	public:
+	  explicit HeNormal(uint64_t seed): rng_(seed) { }
+
+	  uint64_t seed() const { return rng_.seed(); }
+
+	  template <typename Array>
+	  void operator()(Array& weights, uint64_t stream) const {
+	    typedef typename Array::FieldType Field;
+	    const size_t fanOut = weights.dimensions()[0];
+	    const size_t fanIn = weights.size() / std::max(fanOut, size_t(1));
+	    arrays::detail::RandomKernels::normal(
+		rng_, stream, Field(0), Field(std::sqrt(2.0 / double(fanIn))),
+		weights.size(), weights.data()
+	    );
+	  }
+
+	private:
+	  random::Philox4x32 rng_;
+	};
+
+	// "gain" times a uniformly distributed matrix with orthonormal rows,
+	// or orthonormal columns if there are more outputs than inputs
+	// (Saxe et al., 2014).  The matrix is the orthonormal factor of a QR
+	// decomposition of normal samples, which LAPACK computes in
+	// O(fanOut * fanIn * min(fanOut, fanIn)) time.
+	class Orthogonal {
+	public:
+	  explicit Orthogonal(uint64_t seed, double gain = 1.0):
+	      rng_(seed), gain_(gain) {
+	  }
+
+	  uint64_t seed() const { return rng_.seed(); }
+	  double gain() const { return gain_; }
+
+	  template <typename Array>
+	  void operator()(Array& weights, uint64_t stream) const {
+	    typedef typename Array::FieldType Field;
+	    typedef arrays::detail::MklAdapter<Field, Field> MklAdapter;
+	    const size_t fanOut = weights.dimensions()[0];
+	    const size_t fanIn = weights.size() / std::max(fanOut, size_t(1));
+	    arrays::detail::RandomKernels::normal(
+		rng_, stream, Field(0), Field(1), weights.size(),
+		weights.data()
+	    );
+	    MklAdapter::orthonormalize(fanOut, fanIn, weights.data());
+	    if (gain_ != 1.0) {
+	      MklAdapter::scale(weights.size(), Field(gain_), weights.data());
+	    }
+	  }
+
+	private:
+	  random::Philox4x32 rng_;
+	  double gain_;
+	};
+
+	// Draws the weights of "layer" with "initializer," using the
+	// layer's id as the stream, and zeros its bias
+	template <typename Layer, typename Initializer>
+	void initialize(Layer& layer, const Initializer& initializer) {
+	  NEURODIDACTIC_TRACE_SPAN("initialize", layer.id());
+	  initializer(layer.weights(), layer.id());
+	  std::fill(layer.bias().begin(), layer.bias().end(),
+		    typename Layer::BiasVectorType::FieldType(0));
+	}
+
+      }
+    }
+  }
+}
+#endif
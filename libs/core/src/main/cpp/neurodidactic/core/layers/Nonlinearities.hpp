@@ -13,10 +13,26 @@ namespace neurodidactic {
 
       namespace nonlinearities {
 
+	// True if Nonlinearity declares IS_NONDECREASING to be true, so
+	// that applying it commutes with taking a maximum
+	template <typename Nonlinearity, typename Enabled = void>
+	struct IsNondecreasing : std::false_type { };
+
+	template <typename Nonlinearity>
+	struct IsNondecreasing<
+	    Nonlinearity,
+	    typename std::enable_if<Nonlinearity::IS_NONDECREASING>::type
+	> : std::true_type { };
+
 	struct Identity {
+	  static constexpr const bool IS_NONDECREASING = true;
+
 	  template <typename Array>
 	  const Array& operator()(const Array& a) const { return a; }
 
+	  template <typename Field>
+	  Field apply(Field x) const { return x; }
+
 	  template <typename Array>
 	  typename Array::ArrayType gradient(const Array& a) const {
 	    typedef typename Array::FieldType Field;
@@ -26,6 +42,11 @@ namespace neurodidactic {
 	};
 
 	struct ReLU {
+	  static constexpr const bool IS_NONDECREASING = true;
+
+	  template <typename Field>
+	  Field apply(Field x) const { return x > Field(0) ? x : Field(0); }
+
 	  template <typename Array,
 		    typename Enabled =
 		        typename std::enable_if<
@@ -45,7 +66,7 @@ namespace neurodidactic {
 		            typename Array::ArrayType
 		        >::type
 		   >
-	  Array gradient(const Array& a) const {
+	  Enabled gradient(const Array& a) const {
 	    typedef typename Array::FieldType Field;
 	    return a.map([](Field x) {
 		return x > Field(0) ? Field(1) : Field(0);
@@ -54,6 +75,13 @@ namespace neurodidactic {
 	};
 
 	struct Sigmoid {
+	  static constexpr const bool IS_NONDECREASING = true;
+
+	  template <typename Field>
+	  Field apply(Field x) const {
+	    return Field(1) / (Field(1) + std::exp(-x));
+	  }
+
 	  template <typename Array,
 		    typename Enabled =
 		        typename std::enable_if<
@@ -80,7 +108,7 @@ namespace neurodidactic {
 		            typename Array::ArrayType
 		        >::type
 		   >
-	  Array gradient(const Array& a) const {
+	  Enabled gradient(const Array& a) const {
 	    typedef typename Array::FieldType Field;
 	    typedef arrays::detail::MklAdapter<Field, Field> MklAdapter;
 
@@ -95,6 +123,11 @@ namespace neurodidactic {
 	};
 
 	struct TanH {
+	  static constexpr const bool IS_NONDECREASING = true;
+
+	  template <typename Field>
+	  Field apply(Field x) const { return std::tanh(x); }
+
 	  template <typename Array,
 		    typename Enabled =
 		        typename std::enable_if<
@@ -121,7 +154,7 @@ namespace neurodidactic {
 		            typename Array::ArrayType
 		        >::type
 		   >
-	  Array gradient(const Array& a) const {
+	  Enabled gradient(const Array& a) const {
 	    typedef typename Array::FieldType Field;
 	    typedef arrays::detail::MklAdapter<Field, Field> MklAdapter;
 
@@ -0,0 +1,122 @@
+#ifndef __NEURODIDACTIC__CORE__LAYERS__PRUNEDFULLYCONNECTEDLAYER_HPP__
+#define __NEURODIDACTIC__CORE__LAYERS__PRUNEDFULLYCONNECTEDLAYER_HPP__
+
+#include <neurodidactic/core/arrays/CsrMatrix.hpp>
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/arrays/MklAllocator.hpp>
+#include <neurodidactic/core/arrays/detail/MklAdapter.hpp>
+#include <neurodidactic/core/layers/FullyConnectedLayer.hpp>
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <sstream>
+
+namespace neurodidactic {
+  namespace core {
+    namespace layers {
+
+      // Inference-only FullyConnectedLayer for pruned networks.  The
+      // weights are kept in CSR form, so forward propagation only touches
+      // the weights that survived pruning.
+      template <typename Field,
+		typename Nonlinearity,
+		typename Allocator = arrays::MklAllocator<Field, 64> >
+      class PrunedFullyConnectedLayer {
+      public:
+	typedef arrays::MdArray<1, Field, Allocator> InputType;
+	typedef arrays::MdArray<1, Field, Allocator> OutputType;
+	typedef arrays::MdArray<2, Field, Allocator> BatchInputType;
+	typedef arrays::MdArray<2, Field, Allocator> BatchOutputType;
+	typedef arrays::CsrMatrix<Field, Allocator> WeightMatrixType;
+	typedef arrays::MdArray<1, Field, Allocator> BiasVectorType;
+
+	// Below this fraction of zero weights, the dense layer's GEMV and
+	// GEMM are faster than the sparse kernels
+	static constexpr const double DEFAULT_MIN_SPARSITY = 0.8;
+
+      public:
+	// Compacts "layer", dropping weights whose magnitude is at most
+	// "threshold"
+	template <typename OtherAllocator>
+	explicit PrunedFullyConnectedLayer(
+	    const FullyConnectedLayer<Field, Nonlinearity, OtherAllocator>&
+		layer,
+	    Field threshold = Field(0),
+	    const Allocator& allocator = Allocator()
+	):
+	    id_(layer.id()), weights_(layer.weights(), threshold, allocator),
+	    bias_(layer.bias().dimensions(), layer.bias().data(), allocator),
+	    f_(layer.nonlinearity()) {
+	}
+
+	PrunedFullyConnectedLayer(
+	    uint32_t id, WeightMatrixType&& weights, BiasVectorType&& bias,
+	    const Nonlinearity& nonlinearity = Nonlinearity()
+	):
+	    id_(id), weights_(std::move(weights)), bias_(std::move(bias)),
+	    f_(nonlinearity) {
+	  if ((bias_.dimensions().size() != 1) ||
+	      (bias_.dimensions()[0] != weights_.numRows())) {
+	    std::ostringstream msg;
+	    msg << "Weights with dimensions " << weights_.dimensions()
+		<< " and bias with dimensions " << bias_.dimensions()
+		<< " do not match";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	}
+
+	PrunedFullyConnectedLayer(const PrunedFullyConnectedLayer&) = default;
+	PrunedFullyConnectedLayer(PrunedFullyConnectedLayer&&) = default;
+
+	// True if enough of the weights of "layer" are zero for the pruned
+	// layer to be faster
+	template <typename OtherAllocator>
+	static bool worthCompacting(
+	    const FullyConnectedLayer<Field, Nonlinearity, OtherAllocator>&
+		layer,
+	    double minSparsity = DEFAULT_MIN_SPARSITY
+	) {
+	  return arrays::sparsity(layer.weights()) >= minSparsity;
+	}
+
+	uint32_t id() const { return id_; }
+	size_t numInputs() const { return weights_.numColumns(); }
+	size_t numOutputs() const { return weights_.numRows(); }
+	const Nonlinearity& nonlinearity() const { return f_; }
+	const WeightMatrixType& weights() const { return weights_; }
+	const BiasVectorType& bias() const { return bias_; }
+
+	OutputType forward(const InputType& input) const {
+	  return f_(weights_.innerProduct(input).addInPlace(bias_));
+	}
+
+	BatchOutputType forward(const BatchInputType& input) const {
+	  typedef arrays::detail::MklAdapter<Field, Field> MklAdapter;
+
+	  BatchOutputType activations(weights_.transposeMatrixProduct(input));
+	  for (Field* p = activations.data();
+	       p != activations.end();
+	       p += numOutputs()) {
+	    MklAdapter::add(numOutputs(), p, bias_.data(), p);
+	  }
+	  return f_(activations);
+	}
+
+	PrunedFullyConnectedLayer& operator=(
+	    const PrunedFullyConnectedLayer&
+	) = default;
+	PrunedFullyConnectedLayer& operator=(
+	    PrunedFullyConnectedLayer&&
+	) = default;
+
+      private:
+	uint32_t id_;
+	WeightMatrixType weights_;
+	BiasVectorType bias_;
+	Nonlinearity f_;
+      };
+
+    }
+  }
+}
+#endif
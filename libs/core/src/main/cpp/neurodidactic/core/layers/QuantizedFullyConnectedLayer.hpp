@@ -0,0 +1,208 @@
+#ifndef __NEURODIDACTIC__CORE__LAYERS__QUANTIZEDFULLYCONNECTEDLAYER_HPP__
+#define __NEURODIDACTIC__CORE__LAYERS__QUANTIZEDFULLYCONNECTEDLAYER_HPP__
+
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/arrays/MklAllocator.hpp>
+#include <neurodidactic/core/arrays/detail/MklAdapter.hpp>
+#include <neurodidactic/core/layers/FullyConnectedLayer.hpp>
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <sstream>
+#include <vector>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace layers {
+
+      // Inference-only FullyConnectedLayer with 8-bit weights.  Weights
+      // are quantized symmetrically with one scale per output (row of the
+      // weight matrix), chosen from the row's largest magnitude when the
+      // layer is built from a trained float layer.  Inputs are quantized
+      // on the fly, one scale per input vector, and the integer products
+      // are turned back into float, offset by the bias and passed through
+      // the nonlinearity in a single pass over the outputs.
+      template <typename Nonlinearity,
+		typename Allocator = arrays::MklAllocator<float, 64> >
+      class QuantizedFullyConnectedLayer {
+      public:
+	typedef typename std::allocator_traits<Allocator>
+			    ::template rebind_alloc<int8_t>
+		WeightAllocator;
+	typedef typename std::allocator_traits<Allocator>
+			    ::template rebind_alloc<uint8_t>
+		InputAllocator;
+	typedef typename std::allocator_traits<Allocator>
+			    ::template rebind_alloc<int32_t>
+		AccumulatorAllocator;
+	typedef arrays::MdArray<1, float, Allocator> InputType;
+	typedef arrays::MdArray<1, float, Allocator> OutputType;
+	typedef arrays::MdArray<2, float, Allocator> BatchInputType;
+	typedef arrays::MdArray<2, float, Allocator> BatchOutputType;
+	typedef arrays::MdArray<2, int8_t, WeightAllocator> WeightMatrixType;
+	typedef arrays::MdArray<1, float, Allocator> ScaleVectorType;
+	typedef arrays::MdArray<1, float, Allocator> BiasVectorType;
+
+	static constexpr const int32_t MAX_QUANTIZED_VALUE = 127;
+
+      public:
+	template <typename OtherAllocator>
+	explicit QuantizedFullyConnectedLayer(
+	    const FullyConnectedLayer<float, Nonlinearity, OtherAllocator>&
+		layer,
+	    const Allocator& allocator = Allocator()
+	):
+	    id_(layer.id()),
+	    weights_(layer.weights().dimensions(), int8_t(0),
+		     WeightAllocator(allocator)),
+	    weightScales_({ (uint32_t)layer.numOutputs() }, 1.0f,
+			  allocator),
+	    bias_(layer.bias().dimensions(), layer.bias().data(), allocator),
+	    f_(layer.nonlinearity()) {
+	  calibrate_(layer.weights().data());
+	}
+
+	QuantizedFullyConnectedLayer(
+	    const QuantizedFullyConnectedLayer&
+	) = default;
+	QuantizedFullyConnectedLayer(QuantizedFullyConnectedLayer&&) = default;
+
+	uint32_t id() const { return id_; }
+	size_t numInputs() const { return weights_.dimensions()[1]; }
+	size_t numOutputs() const { return weights_.dimensions()[0]; }
+	const Nonlinearity& nonlinearity() const { return f_; }
+	const WeightMatrixType& weights() const { return weights_; }
+	const ScaleVectorType& weightScales() const { return weightScales_; }
+	const BiasVectorType& bias() const { return bias_; }
+
+	OutputType forward(const InputType& input) const {
+	  validateInput_(input.dimensions(), 1);
+	  OutputType output({ (uint32_t)numOutputs() }, bias_.allocator());
+	  forward_(1, input.data(), output.data());
+	  return output;
+	}
+
+	BatchOutputType forward(const BatchInputType& input) const {
+	  validateInput_(input.dimensions(), 2);
+	  const size_t batchSize = input.dimensions()[0];
+	  BatchOutputType output(
+	      { (uint32_t)batchSize, (uint32_t)numOutputs() },
+	      bias_.allocator()
+	  );
+	  forward_(batchSize, input.data(), output.data());
+	  return output;
+	}
+
+	QuantizedFullyConnectedLayer& operator=(
+	    const QuantizedFullyConnectedLayer&
+	) = default;
+	QuantizedFullyConnectedLayer& operator=(
+	    QuantizedFullyConnectedLayer&&
+	) = default;
+
+      private:
+	typedef arrays::detail::MklAdapter<int8_t, uint8_t> IntegerAdapter;
+
+	uint32_t id_;
+	WeightMatrixType weights_;
+	ScaleVectorType weightScales_;
+	BiasVectorType bias_;
+	Nonlinearity f_;
+
+	void calibrate_(const float* weights) {
+	  const size_t n = numInputs();
+	  for (size_t i = 0; i < numOutputs(); ++i) {
+	    const float* row = weights + i * n;
+	    float maxMagnitude = 0.0f;
+	    for (size_t j = 0; j < n; ++j) {
+	      maxMagnitude = std::max(maxMagnitude, std::fabs(row[j]));
+	    }
+
+	    const float scale = (maxMagnitude > 0.0f) ?
+		maxMagnitude / MAX_QUANTIZED_VALUE : 1.0f;
+	    int8_t* q = weights_.data() + i * n;
+	    weightScales_.data()[i] = scale;
+	    for (size_t j = 0; j < n; ++j) {
+	      q[j] = int8_t(std::lround(row[j] / scale));
+	    }
+	  }
+	}
+
+	// Quantizes each row of "input" with its own scale into "quantized",
+	// storing the scales in "inputScales"
+	void quantizeInputs_(size_t batchSize, const float* input,
+			     uint8_t* quantized, float* inputScales) const {
+	  const size_t n = numInputs();
+	  for (size_t i = 0; i < batchSize; ++i) {
+	    const float* row = input + i * n;
+	    float maxMagnitude = 0.0f;
+	    for (size_t j = 0; j < n; ++j) {
+	      maxMagnitude = std::max(maxMagnitude, std::fabs(row[j]));
+	    }
+
+	    const float scale = (maxMagnitude > 0.0f) ?
+		maxMagnitude / MAX_QUANTIZED_VALUE : 1.0f;
+	    const float inverseScale = 1.0f / scale;
+	    uint8_t* q = quantized + i * n;
+	    inputScales[i] = scale;
+	    for (size_t j = 0; j < n; ++j) {
+	      q[j] = uint8_t(int32_t(std::lround(row[j] * inverseScale)) +
+			     IntegerAdapter::INPUT_ZERO_POINT);
+	    }
+	  }
+	}
+
+	void forward_(size_t batchSize, const float* input,
+		      float* output) const {
+	  const size_t n = numInputs();
+	  const size_t m = numOutputs();
+	  std::vector<uint8_t, InputAllocator> quantized(
+	      batchSize * n, InputAllocator(bias_.allocator())
+	  );
+	  std::vector<int32_t, AccumulatorAllocator> accumulators(
+	      batchSize * m, AccumulatorAllocator(bias_.allocator())
+	  );
+	  std::vector<float> inputScales(batchSize);
+
+	  quantizeInputs_(batchSize, input, quantized.data(),
+			  inputScales.data());
+	  IntegerAdapter::multiplyMatrixByMatrixTranspose(
+	      batchSize, m, n, quantized.data(), weights_.data(),
+	      accumulators.data()
+	  );
+
+	  // Fused dequantize + bias + nonlinearity
+	  const float* weightScales = weightScales_.data();
+	  const float* bias = bias_.data();
+	  for (size_t i = 0; i < batchSize; ++i) {
+	    const int32_t* acc = accumulators.data() + i * m;
+	    float* out = output + i * m;
+	    const float inputScale = inputScales[i];
+	    for (size_t j = 0; j < m; ++j) {
+	      out[j] = f_.apply(float(acc[j]) * (inputScale * weightScales[j])
+				    + bias[j]);
+	    }
+	  }
+	}
+
+	template <typename DimensionList>
+	void validateInput_(const DimensionList& dimensions,
+			    size_t order) const {
+	  if ((dimensions.size() != order) ||
+	      (dimensions[order - 1] != numInputs())) {
+	    std::ostringstream msg;
+	    msg << "Array \"input\" has dimensions " << dimensions
+		<< ", but its last dimension should be " << numInputs();
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	}
+      };
+
+    }
+  }
+}
+#endif
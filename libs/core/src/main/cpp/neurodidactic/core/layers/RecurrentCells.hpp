@@ -0,0 +1,256 @@
+#ifndef __NEURODIDACTIC__CORE__LAYERS__RECURRENTCELLS_HPP__
+#define __NEURODIDACTIC__CORE__LAYERS__RECURRENTCELLS_HPP__
+
+#include <neurodidactic/core/arrays/detail/MklAdapter.hpp>
+#include <algorithm>
+#include <cmath>
+#include <stddef.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace layers {
+
+      // Cells for RecurrentLayer.  A cell computes one timestep for a
+      // batch of "n" sequences with "h" hidden units each.  Its GATES
+      // gate pre-activations are laid out side by side in rows of
+      // GATES * h, one row per sequence, and it keeps STATE_SIZE * h
+      // values per sequence and timestep for backpropagation.
+      //
+      // The sigmoids and tanhs are computed with MKL vector exponentials
+      // over whole rows of pre-activations, between passes that the
+      // compiler vectorizes, as in Nonlinearities.hpp.
+      // tanh(x) is computed as 2 / (1 + exp(-2x)) - 1, which stays finite
+      // when exp(-2x) overflows.
+      namespace cells {
+
+	// Long short-term memory with input, forget, cell and output
+	// gates, in that order.  The state holds the four activated gates
+	// followed by the cell.
+	template <typename Field>
+	struct LstmCell {
+	  static constexpr const size_t GATES = 4;
+	  static constexpr const size_t STATE_SIZE = 5;
+	  static constexpr const bool SEPARATE_RECURRENT_GRADIENT = false;
+
+	  // Computes the state and hidden output of one timestep from the
+	  // input projections plus the bias, and the recurrent projections,
+	  // which are overwritten.
+	  static void forward(size_t n, size_t h, const Field* inputs,
+			      const Field* bias, Field* recurrent,
+			      const Field* previousState,
+			      const Field* /*previousHidden*/, Field* state,
+			      Field* hidden) {
+	    typedef arrays::detail::MklAdapter<Field, Field> MklAdapter;
+	    const size_t width = GATES * h;
+
+	    for (size_t b = 0; b < n; ++b) {
+	      const Field* x = inputs + b * width;
+	      Field* z = recurrent + b * width;
+	      for (size_t j = 0; j < width; ++j) {
+		z[j] = -(x[j] + z[j] + bias[j]);
+	      }
+	      for (size_t j = 2 * h; j < 3 * h; ++j) {
+		z[j] *= Field(2);
+	      }
+	    }
+	    MklAdapter::exp(n * width, recurrent, recurrent);
+
+	    for (size_t b = 0; b < n; ++b) {
+	      const Field* e = recurrent + b * width;
+	      const Field* c0 = previousState + b * STATE_SIZE * h + 4 * h;
+	      Field* s = state + b * STATE_SIZE * h;
+	      for (size_t j = 0; j < h; ++j) {
+		const Field i = Field(1) / (Field(1) + e[j]);
+		const Field f = Field(1) / (Field(1) + e[h + j]);
+		const Field g =
+		    Field(2) / (Field(1) + e[2 * h + j]) - Field(1);
+		const Field o = Field(1) / (Field(1) + e[3 * h + j]);
+		s[j] = i;
+		s[h + j] = f;
+		s[2 * h + j] = g;
+		s[3 * h + j] = o;
+		s[4 * h + j] = f * c0[j] + i * g;
+	      }
+	    }
+	    outputs_(n, h, state, hidden);
+	  }
+
+	  // Recomputes the hidden output of a timestep from its state
+	  static void hidden(size_t n, size_t h, const Field* state,
+			     const Field* /*previousHidden*/, Field* hidden) {
+	    outputs_(n, h, state, hidden);
+	  }
+
+	  // Computes the gradient of the loss with respect to the gate
+	  // pre-activations of one timestep from "dh," its gradient with
+	  // respect to the hidden output.  "carry" holds the gradient with
+	  // respect to the cell on entry, and that of the previous cell on
+	  // exit.  The recurrent weights share the gate gradient, so
+	  // "recurrentGradient" is not written.
+	  static void backward(size_t n, size_t h, const Field* state,
+			       const Field* previousState,
+			       const Field* /*previousHidden*/,
+			       const Field* dh, Field* carry, Field* gradient,
+			       Field* /*recurrentGradient*/) {
+	    for (size_t b = 0; b < n; ++b) {
+	      const Field* s = state + b * STATE_SIZE * h;
+	      const Field* c0 = previousState + b * STATE_SIZE * h + 4 * h;
+	      const Field* dy = dh + b * h;
+	      Field* dc0 = carry + b * h;
+	      Field* g = gradient + b * GATES * h;
+	      for (size_t j = 0; j < h; ++j) {
+		const Field i = s[j], f = s[h + j], c = s[4 * h + j];
+		const Field u = s[2 * h + j], o = s[3 * h + j];
+		const Field tc = std::tanh(c);
+		const Field dc = dy[j] * o * (Field(1) - tc * tc) + dc0[j];
+		dc0[j] = dc * f;
+		g[j] = dc * u * i * (Field(1) - i);
+		g[h + j] = dc * c0[j] * f * (Field(1) - f);
+		g[2 * h + j] = dc * i * (Field(1) - u * u);
+		g[3 * h + j] = dy[j] * tc * o * (Field(1) - o);
+	      }
+	    }
+	  }
+
+	private:
+	  static void outputs_(size_t n, size_t h, const Field* state,
+			       Field* hidden) {
+	    typedef arrays::detail::MklAdapter<Field, Field> MklAdapter;
+
+	    for (size_t b = 0; b < n; ++b) {
+	      const Field* c = state + b * STATE_SIZE * h + 4 * h;
+	      Field* y = hidden + b * h;
+	      for (size_t j = 0; j < h; ++j) {
+		y[j] = Field(-2) * c[j];
+	      }
+	    }
+	    MklAdapter::exp(n * h, hidden, hidden);
+	    for (size_t b = 0; b < n; ++b) {
+	      const Field* o = state + b * STATE_SIZE * h + 3 * h;
+	      Field* y = hidden + b * h;
+	      for (size_t j = 0; j < h; ++j) {
+		y[j] = o[j] * (Field(2) / (Field(1) + y[j]) - Field(1));
+	      }
+	    }
+	  }
+	};
+
+	// Gated recurrent unit with reset, update and candidate gates, in
+	// that order.  The recurrent projection of the candidate is scaled
+	// by the reset gate after the matrix product, so all three gates
+	// share one product with the previous hidden output:
+	//
+	//   r = sigmoid(W_r x + U_r h' + b_r)
+	//   z = sigmoid(W_z x + U_z h' + b_z)
+	//   n = tanh(W_n x + r * (U_n h') + b_n)
+	//   h = (1 - z) * n + z * h'
+	//
+	// The state holds r, z, n and U_n h'.  The candidate's gradient
+	// with respect to U_n h' differs from that with respect to its
+	// input projection, so the recurrent weights get their own gradient.
+	template <typename Field>
+	struct GruCell {
+	  static constexpr const size_t GATES = 3;
+	  static constexpr const size_t STATE_SIZE = 4;
+	  static constexpr const bool SEPARATE_RECURRENT_GRADIENT = true;
+
+	  static void forward(size_t n, size_t h, const Field* inputs,
+			      const Field* bias, Field* recurrent,
+			      const Field* /*previousState*/,
+			      const Field* previousHidden, Field* state,
+			      Field* hidden) {
+	    typedef arrays::detail::MklAdapter<Field, Field> MklAdapter;
+	    const size_t width = GATES * h;
+
+	    for (size_t b = 0; b < n; ++b) {
+	      const Field* x = inputs + b * width;
+	      const Field* u = recurrent + b * width;
+	      Field* s = state + b * STATE_SIZE * h;
+	      for (size_t j = 0; j < 2 * h; ++j) {
+		s[j] = -(x[j] + u[j] + bias[j]);
+	      }
+	      std::copy_n(u + 2 * h, h, s + 3 * h);
+	    }
+	    for (size_t b = 0; b < n; ++b) {
+	      Field* s = state + b * STATE_SIZE * h;
+	      MklAdapter::exp(2 * h, s, s);
+	    }
+
+	    for (size_t b = 0; b < n; ++b) {
+	      const Field* x = inputs + b * width + 2 * h;
+	      const Field* bn = bias + 2 * h;
+	      Field* s = state + b * STATE_SIZE * h;
+	      Field* y = hidden + b * h;
+	      for (size_t j = 0; j < h; ++j) {
+		const Field r = Field(1) / (Field(1) + s[j]);
+		s[j] = r;
+		s[h + j] = Field(1) / (Field(1) + s[h + j]);
+		y[j] = Field(-2) * (x[j] + bn[j] + r * s[3 * h + j]);
+	      }
+	    }
+	    MklAdapter::exp(n * h, hidden, hidden);
+	    for (size_t b = 0; b < n; ++b) {
+	      const Field* h0 = previousHidden + b * h;
+	      Field* s = state + b * STATE_SIZE * h;
+	      Field* y = hidden + b * h;
+	      for (size_t j = 0; j < h; ++j) {
+		const Field c = Field(2) / (Field(1) + y[j]) - Field(1);
+		const Field z = s[h + j];
+		s[2 * h + j] = c;
+		y[j] = (Field(1) - z) * c + z * h0[j];
+	      }
+	    }
+	  }
+
+	  static void hidden(size_t n, size_t h, const Field* state,
+			     const Field* previousHidden, Field* hidden) {
+	    for (size_t b = 0; b < n; ++b) {
+	      const Field* s = state + b * STATE_SIZE * h;
+	      const Field* h0 = previousHidden + b * h;
+	      Field* y = hidden + b * h;
+	      for (size_t j = 0; j < h; ++j) {
+		const Field z = s[h + j];
+		y[j] = (Field(1) - z) * s[2 * h + j] + z * h0[j];
+	      }
+	    }
+	  }
+
+	  // "carry" holds the part of the gradient with respect to the
+	  // hidden output that flows directly from the next timestep, and
+	  // is added to "dh."  On exit it holds that part for the previous
+	  // timestep.
+	  static void backward(size_t n, size_t h, const Field* state,
+			       const Field* /*previousState*/,
+			       const Field* previousHidden, const Field* dh,
+			       Field* carry, Field* gradient,
+			       Field* recurrentGradient) {
+	    for (size_t b = 0; b < n; ++b) {
+	      const Field* s = state + b * STATE_SIZE * h;
+	      const Field* h0 = previousHidden + b * h;
+	      const Field* dy = dh + b * h;
+	      Field* dh0 = carry + b * h;
+	      Field* g = gradient + b * GATES * h;
+	      Field* gu = recurrentGradient + b * GATES * h;
+	      for (size_t j = 0; j < h; ++j) {
+		const Field r = s[j], z = s[h + j], c = s[2 * h + j];
+		const Field d = dy[j] + dh0[j];
+		const Field dc = d * (Field(1) - z) * (Field(1) - c * c);
+		const Field dr = dc * s[3 * h + j] * r * (Field(1) - r);
+		const Field dz = d * (h0[j] - c) * z * (Field(1) - z);
+		dh0[j] = d * z;
+		g[j] = dr;
+		g[h + j] = dz;
+		g[2 * h + j] = dc;
+		gu[j] = dr;
+		gu[h + j] = dz;
+		gu[2 * h + j] = dc * r;
+	      }
+	    }
+	  }
+	};
+
+      }
+    }
+  }
+}
+#endif
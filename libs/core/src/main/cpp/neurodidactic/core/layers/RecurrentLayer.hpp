@@ -0,0 +1,350 @@
+#ifndef __NEURODIDACTIC__CORE__LAYERS__RECURRENTLAYER_HPP__
+#define __NEURODIDACTIC__CORE__LAYERS__RECURRENTLAYER_HPP__
+
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/arrays/MklAllocator.hpp>
+#include <neurodidactic/core/arrays/detail/MklAdapter.hpp>
+#include <neurodidactic/core/layers/RecurrentCells.hpp>
+#include <neurodidactic/core/profiling/AllocationTelemetry.hpp>
+#include <neurodidactic/core/profiling/Tracer.hpp>
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <algorithm>
+#include <sstream>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace layers {
+
+      // Recurrent layer over a batch of sequences laid out as [time,
+      // batch, inputs], returning the hidden output of every timestep as
+      // [time, batch, hidden].  The hidden output and state start at zero.
+      // The Cell (see RecurrentCells.hpp) defines the gates; the layer
+      // holds input weights of [gates * hidden, inputs], recurrent
+      // weights of [gates * hidden, hidden] and a bias of [gates *
+      // hidden], with the rows of each gate side by side.
+      //
+      // The input projections of all timesteps are computed with one
+      // sgemm before the recurrence starts.  Each timestep then needs one
+      // sgemm of the previous hidden output with the recurrent weights of
+      // all gates at once, followed by the cell's elementwise passes.
+      //
+      // forward(input, forwardState) saves the input and the cell states
+      // of all timesteps, which is all backward() needs: it recomputes
+      // the hidden outputs from the states, runs the recurrence backwards
+      // one sgemm per timestep to find the gradients of the gate
+      // pre-activations, and then computes the weight and input
+      // gradients of all timesteps with one sgemm each.
+      template <typename Field,
+		typename Cell,
+		typename Allocator = arrays::MklAllocator<Field, 64> >
+      class RecurrentLayer {
+      public:
+	typedef arrays::MdArray<3, Field, Allocator> InputType;
+	typedef arrays::MdArray<3, Field, Allocator> OutputType;
+	typedef arrays::MdArray<3, Field, Allocator> StateArrayType;
+	typedef arrays::MdArray<2, Field, Allocator> WeightMatrixType;
+	typedef arrays::MdArray<1, Field, Allocator> BiasVectorType;
+	typedef Cell CellType;
+
+	static constexpr const uint32_t INPUT_WEIGHTS = 0;
+	static constexpr const uint32_t RECURRENT_WEIGHTS = 1;
+	static constexpr const uint32_t BIAS = 2;
+
+      public:
+	RecurrentLayer(uint32_t id, size_t numInputs, size_t numHidden,
+		       const Allocator& allocator = Allocator()):
+	    id_(id),
+	    inputWeights_({ (uint32_t)(Cell::GATES * numHidden),
+			    (uint32_t)numInputs }, allocator),
+	    recurrentWeights_({ (uint32_t)(Cell::GATES * numHidden),
+				(uint32_t)numHidden }, allocator),
+	    bias_({ (uint32_t)(Cell::GATES * numHidden) }, allocator) {
+	}
+
+	RecurrentLayer(uint32_t id, const WeightMatrixType& inputWeights,
+		       const WeightMatrixType& recurrentWeights,
+		       const BiasVectorType& bias,
+		       const Allocator& allocator = Allocator()):
+	    id_(id),
+	    inputWeights_(inputWeights.dimensions(), inputWeights.data(),
+			  allocator),
+	    recurrentWeights_(recurrentWeights.dimensions(),
+			      recurrentWeights.data(), allocator),
+	    bias_(bias.dimensions(), bias.data(), allocator) {
+	  validateShape_();
+	}
+
+	RecurrentLayer(const RecurrentLayer&) = default;
+	RecurrentLayer(RecurrentLayer&&) = default;
+
+	uint32_t id() const { return id_; }
+	size_t numInputs() const { return inputWeights_.dimensions()[1]; }
+	size_t numHidden() const { return recurrentWeights_.dimensions()[1]; }
+	const WeightMatrixType& inputWeights() const { return inputWeights_; }
+	WeightMatrixType& inputWeights() { return inputWeights_; }
+	const WeightMatrixType& recurrentWeights() const {
+	  return recurrentWeights_;
+	}
+	WeightMatrixType& recurrentWeights() { return recurrentWeights_; }
+	const BiasVectorType& bias() const { return bias_; }
+	BiasVectorType& bias() { return bias_; }
+
+	// Keeps only the states of the current and previous timesteps
+	OutputType forward(const InputType& input) const {
+	  NEURODIDACTIC_ALLOCATION_SCOPE("forward", id());
+	  NEURODIDACTIC_TRACE_SPAN("forward", id());
+	  validateInput_(input);
+	  StateArrayType states(stateDimensions_(2, input.dimensions()[1]),
+				inputWeights_.allocator());
+	  return recur_(input, states);
+	}
+
+	template <typename ForwardState>
+	OutputType forward(const InputType& input,
+			   ForwardState& forwardState) const {
+	  NEURODIDACTIC_ALLOCATION_SCOPE("forward", id());
+	  NEURODIDACTIC_TRACE_SPAN("forward", id());
+	  validateInput_(input);
+	  StateArrayType states(
+	      stateDimensions_(input.dimensions()[0], input.dimensions()[1]),
+	      inputWeights_.allocator()
+	  );
+	  OutputType output = recur_(input, states);
+	  forwardState.setInputs(id(), input);
+	  forwardState.setActivations(id(), states);
+	  return std::move(output);
+	}
+
+	template <typename ForwardState, typename Optimizer>
+	InputType backward(const OutputType& lossGradient,
+			   const ForwardState& forwardState,
+			   Optimizer& optimizer) {
+	  NEURODIDACTIC_ALLOCATION_SCOPE("backward", id());
+	  NEURODIDACTIC_TRACE_SPAN("backward", id());
+	  typedef arrays::detail::MklAdapter<Field, Field> MklAdapter;
+
+	  auto inputs = forwardState.inputs(id()).template cast<3>();
+	  auto states = forwardState.activations(id()).template cast<3>();
+	  const uint32_t numSteps = inputs.dimensions()[0];
+	  const uint32_t batchSize = inputs.dimensions()[1];
+	  const size_t h = numHidden();
+	  const size_t width = Cell::GATES * h;
+	  const size_t stateSize = size_t(batchSize) * Cell::STATE_SIZE * h;
+	  const size_t hiddenSize = size_t(batchSize) * h;
+	  const size_t rows = size_t(numSteps) * batchSize;
+	  if (lossGradient.dimensions() !=
+	        typename OutputType::DimensionListType({ numSteps, batchSize,
+							 (uint32_t)h })) {
+	    std::ostringstream msg;
+	    msg << "Array \"lossGradient\" has dimensions "
+		<< lossGradient.dimensions() << ", but it should have "
+		<< "dimensions [ " << numSteps << ", " << batchSize << ", "
+		<< h << " ]";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+
+	  const Allocator& allocator = inputWeights_.allocator();
+	  const StateArrayType zeros(stateDimensions_(1, batchSize), Field(0),
+				     allocator);
+	  OutputType hidden(lossGradient.dimensions(), allocator);
+	  for (size_t t = 0; t < numSteps; ++t) {
+	    Cell::hidden(batchSize, h, states.data() + t * stateSize,
+			 t ? hidden.data() + (t - 1) * hiddenSize
+			   : zeros.data(),
+			 hidden.data() + t * hiddenSize);
+	  }
+
+	  StateArrayType gradient({ numSteps, batchSize, (uint32_t)width },
+				  allocator);
+	  StateArrayType separateRecurrentGradient(
+	      Cell::SEPARATE_RECURRENT_GRADIENT
+		  ? gradient.dimensions()
+		  : typename StateArrayType::DimensionListType({ 1, 1, 1 }),
+	      allocator
+	  );
+	  Field* recurrentGradient = Cell::SEPARATE_RECURRENT_GRADIENT
+	      ? separateRecurrentGradient.data() : gradient.data();
+	  arrays::MdArray<2, Field, Allocator> dh(
+	      { batchSize, (uint32_t)h }, allocator
+	  );
+	  arrays::MdArray<2, Field, Allocator> carry(
+	      { batchSize, (uint32_t)h }, Field(0), allocator
+	  );
+
+	  for (size_t t = numSteps; t-- > 0; ) {
+	    const Field* loss = lossGradient.data() + t * hiddenSize;
+	    if (t + 1 < numSteps) {
+	      MklAdapter::multiplyMatrixByMatrix(
+		  batchSize, h, width,
+		  recurrentGradient + (t + 1) * batchSize * width,
+		  recurrentWeights_.data(), dh.data()
+	      );
+	      MklAdapter::add(hiddenSize, dh.data(), loss, dh.data());
+	    } else {
+	      std::copy_n(loss, hiddenSize, dh.data());
+	    }
+	    Cell::backward(
+		batchSize, h, states.data() + t * stateSize,
+		t ? states.data() + (t - 1) * stateSize : zeros.data(),
+		t ? hidden.data() + (t - 1) * hiddenSize : zeros.data(),
+		dh.data(), carry.data(),
+		gradient.data() + t * batchSize * width,
+		recurrentGradient + t * batchSize * width
+	    );
+	  }
+
+	  WeightMatrixType inputWeightGradient(inputWeights_.dimensions(),
+					       allocator);
+	  WeightMatrixType recurrentWeightGradient(
+	      recurrentWeights_.dimensions(), Field(0), allocator
+	  );
+	  BiasVectorType biasGradient(bias_.dimensions(), Field(0), allocator);
+	  InputType inputGradient(inputs.dimensions(), allocator);
+
+	  MklAdapter::multiplyMatrixTransposeByMatrix(
+	      width, numInputs(), rows, gradient.data(), inputs.data(),
+	      inputWeightGradient.data()
+	  );
+	  if (numSteps > 1) {
+	    MklAdapter::multiplyMatrixTransposeByMatrix(
+		width, h, rows - batchSize,
+		recurrentGradient + batchSize * width, hidden.data(),
+		recurrentWeightGradient.data()
+	    );
+	  }
+	  for (size_t i = 0; i < rows; ++i) {
+	    const Field* g = gradient.data() + i * width;
+	    Field* b = biasGradient.data();
+	    for (size_t j = 0; j < width; ++j) {
+	      b[j] += g[j];
+	    }
+	  }
+	  MklAdapter::multiplyMatrixByMatrix(rows, numInputs(), width,
+					     gradient.data(),
+					     inputWeights_.data(),
+					     inputGradient.data());
+
+	  optimizer.update(id(), INPUT_WEIGHTS, inputWeights_,
+			   inputWeightGradient);
+	  optimizer.update(id(), RECURRENT_WEIGHTS, recurrentWeights_,
+			   recurrentWeightGradient);
+	  optimizer.update(id(), BIAS, bias_, biasGradient);
+	  return std::move(inputGradient);
+	}
+
+	RecurrentLayer& operator=(const RecurrentLayer&) = default;
+	RecurrentLayer& operator=(RecurrentLayer&&) = default;
+
+      private:
+	uint32_t id_;
+	WeightMatrixType inputWeights_;
+	WeightMatrixType recurrentWeights_;
+	BiasVectorType bias_;
+
+	typename StateArrayType::DimensionListType stateDimensions_(
+	    uint32_t numSteps, uint32_t batchSize
+	) const {
+	  return typename StateArrayType::DimensionListType(
+	      { numSteps, batchSize,
+		(uint32_t)(Cell::STATE_SIZE * numHidden()) }
+	  );
+	}
+
+	void validateShape_() const {
+	  const size_t h = recurrentWeights_.dimensions()[1];
+	  const size_t width = Cell::GATES * h;
+	  if ((inputWeights_.dimensions()[0] != width) ||
+	      (recurrentWeights_.dimensions()[0] != width) ||
+	      (bias_.dimensions()[0] != width)) {
+	    std::ostringstream msg;
+	    msg << "Input weights, recurrent weights and bias have "
+		<< "dimensions " << inputWeights_.dimensions() << ", "
+		<< recurrentWeights_.dimensions() << " and "
+		<< bias_.dimensions() << ", but they should have dimensions "
+		<< "[ " << width << ", * ], [ " << width << ", " << h
+		<< " ] and [ " << width << " ]";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	}
+
+	void validateInput_(const InputType& input) const {
+	  if (input.dimensions()[2] != numInputs()) {
+	    std::ostringstream msg;
+	    msg << "Array \"input\" has dimensions " << input.dimensions()
+		<< ", but it should have dimensions [ *, *, " << numInputs()
+		<< " ]";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	}
+
+	// Runs the recurrence over "input," keeping the state of timestep
+	// t in states[t % states.dimensions()[0]]
+	OutputType recur_(const InputType& input,
+			  StateArrayType& states) const {
+	  typedef arrays::detail::MklAdapter<Field, Field> MklAdapter;
+	  const uint32_t numSteps = input.dimensions()[0];
+	  const uint32_t batchSize = input.dimensions()[1];
+	  const size_t h = numHidden();
+	  const size_t width = Cell::GATES * h;
+	  const size_t stateSize = size_t(batchSize) * Cell::STATE_SIZE * h;
+	  const size_t hiddenSize = size_t(batchSize) * h;
+	  const size_t numStates = states.dimensions()[0];
+	  const Allocator& allocator = inputWeights_.allocator();
+
+	  arrays::MdArray<2, Field, Allocator> projections(
+	      { numSteps * batchSize, (uint32_t)width }, allocator
+	  );
+	  MklAdapter::multiplyMatrixByMatrixTranspose(
+	      size_t(numSteps) * batchSize, width, numInputs(), input.data(),
+	      inputWeights_.data(), projections.data()
+	  );
+
+	  const StateArrayType zeros(stateDimensions_(1, batchSize), Field(0),
+				     allocator);
+	  arrays::MdArray<2, Field, Allocator> recurrent(
+	      { batchSize, (uint32_t)width }, Field(0), allocator
+	  );
+	  OutputType output({ numSteps, batchSize, (uint32_t)h }, allocator);
+
+	  for (size_t t = 0; t < numSteps; ++t) {
+	    const Field* previousHidden = zeros.data();
+	    const Field* previousState = zeros.data();
+	    if (t) {
+	      previousHidden = output.data() + (t - 1) * hiddenSize;
+	      previousState =
+		  states.data() + ((t - 1) % numStates) * stateSize;
+	      MklAdapter::multiplyMatrixByMatrixTranspose(
+		  batchSize, width, h, previousHidden,
+		  recurrentWeights_.data(), recurrent.data()
+	      );
+	    }
+	    Cell::forward(batchSize, h,
+			  projections.data() + t * batchSize * width,
+			  bias_.data(), recurrent.data(), previousState,
+			  previousHidden,
+			  states.data() + (t % numStates) * stateSize,
+			  output.data() + t * hiddenSize);
+	  }
+	  return std::move(output);
+	}
+      };
+
+      template <typename Field,
+		typename Allocator = arrays::MklAllocator<Field, 64> >
+      using LstmLayer = RecurrentLayer<Field, cells::LstmCell<Field>,
+				       Allocator>;
+
+      template <typename Field,
+		typename Allocator = arrays::MklAllocator<Field, 64> >
+      using GruLayer = RecurrentLayer<Field, cells::GruCell<Field>,
+				      Allocator>;
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,156 @@
+#ifndef __NEURODIDACTIC__CORE__MEMORY__MEMORYPLANNER_HPP__
+#define __NEURODIDACTIC__CORE__MEMORY__MEMORYPLANNER_HPP__
+
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <pistis/exceptions/NoSuchItem.hpp>
+#include <algorithm>
+#include <sstream>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace memory {
+
+      struct BufferLifetime {
+	size_t size;
+	uint32_t firstUse;
+	uint32_t lastUse;
+
+	BufferLifetime(size_t size_, uint32_t firstUse_, uint32_t lastUse_):
+	    size(size_), firstUse(firstUse_), lastUse(lastUse_) {
+	}
+
+	bool overlaps(const BufferLifetime& other) const {
+	  return (firstUse <= other.lastUse) && (other.firstUse <= lastUse);
+	}
+      };
+
+      class MemoryPlan {
+      public:
+	MemoryPlan(): offsets_(), slabSize_(0), totalBufferSize_(0) { }
+	MemoryPlan(std::vector<size_t>&& offsets, size_t slabSize,
+		   size_t totalBufferSize):
+	    offsets_(std::move(offsets)), slabSize_(slabSize),
+	    totalBufferSize_(totalBufferSize) {
+	}
+	MemoryPlan(const MemoryPlan&) = default;
+	MemoryPlan(MemoryPlan&&) = default;
+
+	size_t numBuffers() const { return offsets_.size(); }
+	size_t slabSize() const { return slabSize_; }
+	size_t totalBufferSize() const { return totalBufferSize_; }
+
+	size_t offset(size_t buffer) const {
+	  if (buffer >= offsets_.size()) {
+	    std::ostringstream msg;
+	    msg << "Buffer " << buffer;
+	    throw pistis::exceptions::NoSuchItem(msg.str(), PISTIS_EX_HERE);
+	  }
+	  return offsets_[buffer];
+	}
+
+	MemoryPlan& operator=(const MemoryPlan&) = default;
+	MemoryPlan& operator=(MemoryPlan&&) = default;
+
+      private:
+	std::vector<size_t> offsets_;
+	size_t slabSize_;
+	size_t totalBufferSize_;
+      };
+
+      // Places buffers largest-first at the lowest offset that does not
+      // collide with an already-placed buffer whose lifetime overlaps its
+      // own, so buffers that are never live together share memory.
+      class MemoryPlanner {
+      public:
+	explicit MemoryPlanner(size_t alignment = 64):
+	    alignment_(alignment), buffers_() {
+	  if (!alignment || (alignment & (alignment - 1))) {
+	    std::ostringstream msg;
+	    msg << "Alignment must be a power of two, but it is "
+		<< alignment;
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	}
+
+	size_t alignment() const { return alignment_; }
+	size_t numBuffers() const { return buffers_.size(); }
+	const BufferLifetime& buffer(size_t n) const { return buffers_[n]; }
+
+	size_t addBuffer(size_t size, uint32_t firstUse, uint32_t lastUse) {
+	  if (lastUse < firstUse) {
+	    std::ostringstream msg;
+	    msg << "Buffer last used at time " << lastUse
+		<< " before its first use at time " << firstUse;
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	  buffers_.emplace_back(size, firstUse, lastUse);
+	  return buffers_.size() - 1;
+	}
+
+	void clear() { buffers_.clear(); }
+
+	MemoryPlan plan() const {
+	  std::vector<size_t> order(buffers_.size());
+	  std::vector<size_t> offsets(buffers_.size(), 0);
+	  std::vector<size_t> placed;
+	  size_t slabSize = 0;
+	  size_t totalSize = 0;
+
+	  for (size_t i = 0; i < order.size(); ++i) {
+	    order[i] = i;
+	  }
+	  std::stable_sort(order.begin(), order.end(),
+			   [this](size_t x, size_t y) {
+			     return buffers_[x].size > buffers_[y].size;
+			   });
+
+	  placed.reserve(buffers_.size());
+	  for (size_t n : order) {
+	    const BufferLifetime& b = buffers_[n];
+	    const size_t size = align_(b.size);
+	    size_t offset = 0;
+
+	    for (size_t p : placed) {
+	      if (b.overlaps(buffers_[p])) {
+		if ((offsets[p] >= offset) && (offsets[p] - offset >= size)) {
+		  break;
+		}
+		offset = std::max(offset,
+				  offsets[p] + align_(buffers_[p].size));
+	      }
+	    }
+
+	    offsets[n] = offset;
+	    slabSize = std::max(slabSize, offset + size);
+	    totalSize += size;
+	    placed.insert(
+		std::upper_bound(placed.begin(), placed.end(), n,
+				 [&offsets](size_t x, size_t y) {
+				   return offsets[x] < offsets[y];
+				 }),
+		n
+	    );
+	  }
+
+	  return MemoryPlan(std::move(offsets), slabSize, totalSize);
+	}
+
+      private:
+	size_t alignment_;
+	std::vector<BufferLifetime> buffers_;
+
+	size_t align_(size_t n) const {
+	  return (n + alignment_ - 1) & ~(alignment_ - 1);
+	}
+      };
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,362 @@
+#ifndef __NEURODIDACTIC__CORE__MEMORY__PLANNEDARENA_HPP__
+#define __NEURODIDACTIC__CORE__MEMORY__PLANNEDARENA_HPP__
+
+#include <neurodidactic/core/memory/MemoryPlanner.hpp>
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalStateError.hpp>
+#include <mkl.h>
+
+#include <limits>
+#include <new>
+#include <sstream>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace memory {
+
+      // Serves the element buffers of one training step out of a single
+      // slab.  The first step after construction (or replan()) is
+      // recorded: every buffer gets its own heap allocation, and the
+      // allocation and release order gives each buffer's lifetime.  At
+      // the end of that step the lifetimes are packed by a MemoryPlanner,
+      // and later steps that allocate the same sequence of buffers get
+      // their memory from the slab instead.  Buffers still alive when the
+      // recorded step ends (e.g. the step's return value) stay on the
+      // heap.  A buffer that outlives its recorded lifetime keeps its
+      // slab range, and a later buffer planned into an overlapping range
+      // goes to the heap instead.  An arena is meant to be used by one
+      // thread at a time.
+      template <typename Field, size_t ALIGNMENT = 64>
+      class PlannedArena {
+      public:
+	static constexpr const size_t MEMORY_ALIGNMENT = ALIGNMENT;
+
+      public:
+	PlannedArena():
+	    planner_(ALIGNMENT), plan_(), schedule_(), recorded_(),
+	    liveRecorded_(), liveSlots_(), slab_(nullptr), inStep_(false),
+	    planned_(false), clock_(0), nextAllocation_(0),
+	    slabAllocations_(0), heapAllocations_(0) {
+	}
+	PlannedArena(const PlannedArena&) = delete;
+	~PlannedArena() noexcept { mkl_free(slab_); }
+
+	bool planned() const { return planned_; }
+	bool inStep() const { return inStep_; }
+	const MemoryPlan& plan() const { return plan_; }
+	size_t slabSize() const { return plan_.slabSize(); }
+	size_t numPlannedBuffers() const { return plan_.numBuffers(); }
+	size_t numScheduledAllocations() const { return schedule_.size(); }
+	size_t liveSlabBuffers() const { return liveSlots_.size(); }
+	size_t slabAllocations() const { return slabAllocations_; }
+	size_t heapAllocations() const { return heapAllocations_; }
+
+	void beginStep() {
+	  if (inStep_) {
+	    throw pistis::exceptions::IllegalStateError(
+		"beginStep() called twice without a call to endStep()",
+		PISTIS_EX_HERE
+	    );
+	  }
+	  if (!liveSlots_.empty()) {
+	    std::ostringstream msg;
+	    msg << liveSlots_.size() << " buffers from the previous step "
+		<< "are still alive and would be overwritten";
+	    throw pistis::exceptions::IllegalStateError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	  inStep_ = true;
+	  clock_ = 0;
+	  nextAllocation_ = 0;
+	}
+
+	void endStep() {
+	  if (!inStep_) {
+	    throw pistis::exceptions::IllegalStateError(
+		"endStep() called without a call to beginStep()",
+		PISTIS_EX_HERE
+	    );
+	  }
+	  inStep_ = false;
+	  if (!planned_) {
+	    buildPlan_();
+	  }
+	}
+
+	void replan() {
+	  if (inStep_ || !liveSlots_.empty()) {
+	    throw pistis::exceptions::IllegalStateError(
+		"Cannot replan while a step is in progress or buffers "
+		"from the slab are still alive",
+		PISTIS_EX_HERE
+	    );
+	  }
+	  mkl_free(slab_);
+	  slab_ = nullptr;
+	  plan_ = MemoryPlan();
+	  schedule_.clear();
+	  planned_ = false;
+	}
+
+	Field* allocate(size_t n) {
+	  const size_t size = n * sizeof(Field);
+
+	  if (!inStep_) {
+	    return heapAllocate_(size);
+	  } else if (planned_) {
+	    const size_t k = nextAllocation_++;
+	    if ((k < schedule_.size()) && schedule_[k].inSlab &&
+		(schedule_[k].size == size) && !overlapsLiveSlot_(k)) {
+	      liveSlots_.push_back(k);
+	      ++slabAllocations_;
+	      return reinterpret_cast<Field*>(slab_ + schedule_[k].offset);
+	    }
+	    return heapAllocate_(size);
+	  } else {
+	    Field* p = heapAllocate_(size);
+	    liveRecorded_[p] = recorded_.size();
+	    recorded_.push_back(RecordedBuffer(size, clock_++));
+	    return p;
+	  }
+	}
+
+	void deallocate(Field* p) noexcept {
+	  const char* q = reinterpret_cast<const char*>(p);
+	  if (slab_ && (q >= slab_) && (q < slab_ + plan_.slabSize())) {
+	    releaseSlot_(size_t(q - slab_));
+	    return;
+	  }
+	  if (!planned_) {
+	    auto i = liveRecorded_.find(p);
+	    if (i != liveRecorded_.end()) {
+	      if (inStep_) {
+		recorded_[i->second].lastUse = clock_++;
+	      }
+	      liveRecorded_.erase(i);
+	    }
+	  }
+	  mkl_free((void*)p);
+	}
+
+	PlannedArena& operator=(const PlannedArena&) = delete;
+
+      private:
+	static constexpr const uint32_t STILL_ALIVE =
+	    std::numeric_limits<uint32_t>::max();
+
+	struct RecordedBuffer {
+	  size_t size;
+	  uint32_t firstUse;
+	  uint32_t lastUse;
+
+	  RecordedBuffer(size_t size_, uint32_t firstUse_):
+	      size(size_), firstUse(firstUse_), lastUse(STILL_ALIVE) {
+	  }
+	};
+
+	struct Slot {
+	  size_t size;
+	  size_t offset;
+	  bool inSlab;
+
+	  Slot(size_t size_, size_t offset_, bool inSlab_):
+	      size(size_), offset(offset_), inSlab(inSlab_) {
+	  }
+	};
+
+	MemoryPlanner planner_;
+	MemoryPlan plan_;
+	std::vector<Slot> schedule_;
+	std::vector<RecordedBuffer> recorded_;
+	std::unordered_map<const Field*, size_t> liveRecorded_;
+	std::vector<size_t> liveSlots_;
+	char* slab_;
+	bool inStep_;
+	bool planned_;
+	uint32_t clock_;
+	size_t nextAllocation_;
+	size_t slabAllocations_;
+	size_t heapAllocations_;
+
+	Field* heapAllocate_(size_t size) {
+	  Field* p = (Field*)mkl_malloc(size, ALIGNMENT);
+	  if (!p) {
+	    throw std::bad_alloc();
+	  }
+	  ++heapAllocations_;
+	  return p;
+	}
+
+	// True if slot k's range of the slab overlaps that of a buffer
+	// still alive, which happens when a caller keeps a buffer past the
+	// last use recorded for it
+	bool overlapsLiveSlot_(size_t k) const {
+	  const Slot& slot = schedule_[k];
+	  for (size_t i : liveSlots_) {
+	    const Slot& live = schedule_[i];
+	    if ((slot.offset < live.offset + live.size) &&
+		(live.offset < slot.offset + slot.size)) {
+	      return true;
+	    }
+	  }
+	  return false;
+	}
+
+	void releaseSlot_(size_t offset) noexcept {
+	  for (size_t i = 0; i < liveSlots_.size(); ++i) {
+	    if (schedule_[liveSlots_[i]].offset == offset) {
+	      liveSlots_[i] = liveSlots_.back();
+	      liveSlots_.pop_back();
+	      return;
+	    }
+	  }
+	}
+
+	void buildPlan_() {
+	  std::vector<size_t> bufferIds;
+
+	  planner_.clear();
+	  bufferIds.reserve(recorded_.size());
+	  for (const RecordedBuffer& b : recorded_) {
+	    if (b.lastUse == STILL_ALIVE) {
+	      bufferIds.push_back(size_t(-1));
+	    } else {
+	      bufferIds.push_back(
+		  planner_.addBuffer(b.size, b.firstUse, b.lastUse)
+	      );
+	    }
+	  }
+
+	  plan_ = planner_.plan();
+	  if (plan_.slabSize()) {
+	    slab_ = (char*)mkl_malloc(plan_.slabSize(), ALIGNMENT);
+	    if (!slab_) {
+	      throw std::bad_alloc();
+	    }
+	  }
+
+	  schedule_.clear();
+	  schedule_.reserve(recorded_.size());
+	  for (size_t i = 0; i < recorded_.size(); ++i) {
+	    if (bufferIds[i] == size_t(-1)) {
+	      schedule_.push_back(Slot(recorded_[i].size, 0, false));
+	    } else {
+	      schedule_.push_back(Slot(recorded_[i].size,
+				       plan_.offset(bufferIds[i]), true));
+	    }
+	  }
+
+	  recorded_.clear();
+	  liveRecorded_.clear();
+	  planned_ = true;
+	}
+      };
+
+      // Allocator that draws element buffers from a PlannedArena and
+      // everything else (ArrayData headers, dimension lists) from the
+      // heap.  A default-constructed allocator has no arena and always
+      // uses the heap.
+      template <typename T, typename Field = T, size_t ALIGNMENT = 64>
+      class PlannedAllocator {
+      public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef ssize_t difference_type;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef PlannedArena<Field, ALIGNMENT> ArenaType;
+
+	static constexpr const size_t MEMORY_ALIGNMENT = ALIGNMENT;
+
+	template <typename U>
+	struct rebind { typedef PlannedAllocator<U, Field, ALIGNMENT> other; };
+
+      public:
+	PlannedAllocator() noexcept: arena_(nullptr) { }
+	explicit PlannedAllocator(ArenaType& arena) noexcept:
+	    arena_(&arena) {
+	}
+
+	template <typename U>
+	PlannedAllocator(
+	    const PlannedAllocator<U, Field, ALIGNMENT>& other
+	) noexcept:
+	    arena_(other.arena()) {
+	}
+
+	ArenaType* arena() const noexcept { return arena_; }
+
+	T* allocate(size_t n, const void* hint = nullptr) {
+	  return allocate_(n, std::is_same<T, Field>());
+	}
+
+	void deallocate(T* p, size_t n) noexcept {
+	  deallocate_(p, std::is_same<T, Field>());
+	}
+
+	size_t max_size() const noexcept { return size_t(-1); }
+
+	template <typename U, typename... Args>
+	void construct(U* p, Args&&... args) {
+	  ::new((void*) p) U(std::forward<Args>(args)...);
+	}
+
+	template <typename U>
+	void destroy(U* p) {
+	  p->~U();
+	}
+
+      private:
+	ArenaType* arena_;
+
+	T* allocate_(size_t n, std::true_type) {
+	  return arena_ ? arena_->allocate(n) : allocate_(n, std::false_type());
+	}
+
+	T* allocate_(size_t n, std::false_type) {
+	  T* p = (T*)mkl_malloc(n * sizeof(T), ALIGNMENT);
+	  if (!p) {
+	    throw std::bad_alloc();
+	  }
+	  return p;
+	}
+
+	void deallocate_(T* p, std::true_type) noexcept {
+	  if (arena_) {
+	    arena_->deallocate(p);
+	  } else {
+	    mkl_free((void*)p);
+	  }
+	}
+
+	void deallocate_(T* p, std::false_type) noexcept {
+	  mkl_free((void*)p);
+	}
+      };
+
+      template <typename T, typename U, typename Field, size_t ALIGNMENT>
+      bool operator==(const PlannedAllocator<T, Field, ALIGNMENT>& left,
+		      const PlannedAllocator<U, Field, ALIGNMENT>& right)
+	  noexcept {
+	return left.arena() == right.arena();
+      }
+
+      template <typename T, typename U, typename Field, size_t ALIGNMENT>
+      bool operator!=(const PlannedAllocator<T, Field, ALIGNMENT>& left,
+		      const PlannedAllocator<U, Field, ALIGNMENT>& right)
+	  noexcept {
+	return left.arena() != right.arena();
+      }
+
+    }
+  }
+}
+#endif
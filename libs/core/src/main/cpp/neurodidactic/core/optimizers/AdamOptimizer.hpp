@@ -0,0 +1,190 @@
+#ifndef __NEURODIDACTIC__CORE__OPTIMIZERS__ADAMOPTIMIZER_HPP__
+#define __NEURODIDACTIC__CORE__OPTIMIZERS__ADAMOPTIMIZER_HPP__
+
+#include <neurodidactic/core/arrays/AnyMdArray.hpp>
+#include <neurodidactic/core/arrays/MklAllocator.hpp>
+#include <neurodidactic/core/arrays/detail/SparseKernels.hpp>
+#include <neurodidactic/core/optimizers/RowUpdates.hpp>
+#include <neurodidactic/core/parallel/Elementwise.hpp>
+#include <neurodidactic/core/parallel/ThreadPool.hpp>
+#include <neurodidactic/core/profiling/Tracer.hpp>
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <cmath>
+#include <sstream>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace optimizers {
+
+      // Adam (Kingma and Ba, 2015).  The first and second moments of each
+      // parameter are created on its first update, and each parameter
+      // counts its own steps for the bias correction.
+      //
+      // updateRows() is lazy: it updates the moments and values of the
+      // rows the gradient touches and leaves every other row alone, rather
+      // than decaying the moments of the whole table.  An embedding row
+      // that is seen rarely therefore keeps its moments from the last time
+      // it was seen, which is what makes sparse updates of large tables
+      // affordable.
+      //
+      // Not safe for concurrent updates of the same parameter.
+      template <typename Field,
+		typename Allocator = arrays::MklAllocator<Field, 64> >
+      class AdamOptimizer {
+      public:
+	explicit AdamOptimizer(Field learningRate, Field beta1 = Field(0.9),
+			       Field beta2 = Field(0.999),
+			       Field epsilon = Field(1e-8)):
+	    learningRate_(learningRate), beta1_(beta1), beta2_(beta2),
+	    epsilon_(epsilon), moments_() {
+	}
+	AdamOptimizer(const AdamOptimizer&) = default;
+	AdamOptimizer(AdamOptimizer&&) = default;
+
+	Field learningRate() const { return learningRate_; }
+	void setLearningRate(Field learningRate) {
+	  learningRate_ = learningRate;
+	}
+	Field beta1() const { return beta1_; }
+	Field beta2() const { return beta2_; }
+	Field epsilon() const { return epsilon_; }
+
+	// Number of updates applied to a parameter so far
+	uint64_t numSteps(uint32_t layerId, uint32_t paramId) const {
+	  auto i = moments_.find(key_(layerId, paramId));
+	  return (i == moments_.end()) ? 0 : i->second.numSteps;
+	}
+
+	template <typename Array, typename Gradient,
+		  typename Enabled =
+		      typename std::enable_if<
+			  arrays::IsMdArray<Array>::value &&
+			      arrays::IsMdArray<Gradient>::value,
+			  int
+		      >::type
+		 >
+	void update(uint32_t layerId, uint32_t paramId, Array& param,
+		    const Gradient& gradient, Enabled = 0) {
+	  NEURODIDACTIC_TRACE_SPAN("update", layerId);
+	  if (param.size() != gradient.size()) {
+	    std::ostringstream msg;
+	    msg << "Gradient for parameter " << paramId << " of layer "
+		<< layerId << " has " << gradient.size()
+		<< " elements, but the parameter has " << param.size();
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+
+	  Moments& moments = momentsFor_(layerId, paramId, param.size());
+	  const Field stepSize = nextStepSize_(moments);
+	  Field* p = param.data();
+	  const Field* g = gradient.data();
+	  Field* m = moments.first.data();
+	  Field* v = moments.second.data();
+	  parallel::parallelFor(
+	      0, param.size(), parallel::DEFAULT_GRAIN_SIZE,
+	      [this, stepSize, p, g, m, v](size_t begin, size_t end) {
+		step_(end - begin, stepSize, g + begin, p + begin, m + begin,
+		      v + begin);
+	      },
+	      parallel::ELEMENTWISE_ALIGNMENT
+	  );
+	}
+
+	template <typename Array, typename SparseRowMatrix>
+	void updateRows(uint32_t layerId, uint32_t paramId, Array& param,
+			const SparseRowMatrix& gradient) {
+	  NEURODIDACTIC_TRACE_SPAN("update", layerId);
+	  validateRowUpdate(layerId, paramId, param, gradient);
+
+	  Moments& moments = momentsFor_(layerId, paramId, param.size());
+	  const Field stepSize = nextStepSize_(moments);
+	  const size_t n = gradient.rowSize();
+	  const uint32_t* indices = gradient.indices();
+	  const Field* g = gradient.values();
+	  Field* p = param.data();
+	  Field* m = moments.first.data();
+	  Field* v = moments.second.data();
+	  parallel::parallelFor(
+	      0, gradient.numNonZeroRows(),
+	      arrays::detail::SparseRowKernels::rowGrainSize(n),
+	      [this, stepSize, n, indices, g, p, m, v](size_t begin,
+						       size_t end) {
+		for (size_t k = begin; k < end; ++k) {
+		  const size_t offset = size_t(indices[k]) * n;
+		  step_(n, stepSize, g + k * n, p + offset, m + offset,
+			v + offset);
+		}
+	      }
+	  );
+	}
+
+	AdamOptimizer& operator=(const AdamOptimizer&) = default;
+	AdamOptimizer& operator=(AdamOptimizer&&) = default;
+
+      private:
+	struct Moments {
+	  uint64_t numSteps;
+	  std::vector<Field, Allocator> first;
+	  std::vector<Field, Allocator> second;
+
+	  explicit Moments(size_t n):
+	      numSteps(0), first(n, Field(0)), second(n, Field(0)) {
+	  }
+	};
+
+	Field learningRate_;
+	Field beta1_;
+	Field beta2_;
+	Field epsilon_;
+	std::unordered_map<uint64_t, Moments> moments_;
+
+	static uint64_t key_(uint32_t layerId, uint32_t paramId) {
+	  return (uint64_t(layerId) << 32) | paramId;
+	}
+
+	Moments& momentsFor_(uint32_t layerId, uint32_t paramId, size_t n) {
+	  auto i = moments_.find(key_(layerId, paramId));
+	  if (i == moments_.end()) {
+	    i = moments_.emplace(key_(layerId, paramId), Moments(n)).first;
+	  } else if (i->second.first.size() != n) {
+	    std::ostringstream msg;
+	    msg << "Parameter " << paramId << " of layer " << layerId
+		<< " has " << n << " elements, but earlier updates had "
+		<< i->second.first.size();
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	  return i->second;
+	}
+
+	// Counts a step and returns the learning rate with the bias
+	// corrections of both moments folded in, as at the end of section 2
+	// of the paper
+	Field nextStepSize_(Moments& moments) const {
+	  const double t = double(++moments.numSteps);
+	  return Field(learningRate_ *
+		       std::sqrt(1.0 - std::pow(double(beta2_), t)) /
+		       (1.0 - std::pow(double(beta1_), t)));
+	}
+
+	void step_(size_t n, Field stepSize, const Field* g, Field* p,
+		   Field* m, Field* v) const {
+	  const Field beta1 = beta1_, beta2 = beta2_, epsilon = epsilon_;
+	  for (size_t i = 0; i < n; ++i) {
+	    m[i] = beta1 * m[i] + (Field(1) - beta1) * g[i];
+	    v[i] = beta2 * v[i] + (Field(1) - beta2) * g[i] * g[i];
+	    p[i] -= stepSize * m[i] / (std::sqrt(v[i]) + epsilon);
+	  }
+	}
+      };
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,48 @@
+#ifndef __NEURODIDACTIC__CORE__OPTIMIZERS__COLUMNUPDATES_HPP__
+#define __NEURODIDACTIC__CORE__OPTIMIZERS__COLUMNUPDATES_HPP__
+
+#include <neurodidactic/core/arrays/SparseVector.hpp>
+#include <neurodidactic/core/arrays/detail/SparseKernels.hpp>
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <sstream>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace optimizers {
+
+      // Optimizers may implement
+      //
+      //   void updateColumns(uint32_t layerId, uint32_t paramId,
+      //                      Array& param, const Vector& rows,
+      //                      const SparseVector& columns);
+      //
+      // to apply a gradient equal to the outer product of the dense
+      // vector "rows" and the SparseVector "columns" to the matrix
+      // "param".  This is the weight gradient of a layer with sparse
+      // inputs, and only the columns of "param" at the nonzeros of
+      // "columns" are affected.  validateColumnUpdate() checks that the
+      // dimensions of the three agree.
+      template <typename Array, typename Vector, typename SparseVector>
+      void validateColumnUpdate(uint32_t layerId, uint32_t paramId,
+				const Array& param, const Vector& rows,
+				const SparseVector& columns) {
+	if ((param.dimensions().size() != 2) ||
+	    (param.dimensions()[0] != rows.size()) ||
+	    (param.dimensions()[1] != columns.size())) {
+	  std::ostringstream msg;
+	  msg << "Column update for parameter " << paramId << " of layer "
+	      << layerId << " is the outer product of vectors of size "
+	      << rows.size() << " and " << columns.size()
+	      << ", but the parameter has dimensions "
+	      << param.dimensions();
+	  throw pistis::exceptions::IllegalValueError(msg.str(),
+						      PISTIS_EX_HERE);
+	}
+      }
+
+    }
+  }
+}
+#endif
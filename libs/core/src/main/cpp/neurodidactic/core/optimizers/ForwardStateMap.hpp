@@ -3,9 +3,11 @@
 
 #include <neurodidactic/core/arrays/AnyMdArray.hpp>
 #include <neurodidactic/core/arrays/AnyMdArrayRef.hpp>
+#include <neurodidactic/core/arrays/MdArray.hpp>
 #include <pistis/exceptions/NoSuchItem.hpp>
 #include <algorithm>
 #include <iterator>
+#include <memory>
 #include <unordered_map>
 #include <utility>
 
@@ -17,14 +19,22 @@ namespace neurodidactic {
       class ForwardStateMap {
       public:
 	typedef arrays::AnyMdArrayRef<Field, Allocator> ArrayRefType;
+	typedef typename std::allocator_traits<Allocator>
+			    ::template rebind_alloc<uint32_t>
+		MaskAllocator;
+
+	// Bits packed 32 to a word, least significant bit first, for
+	// layers whose forward state is one bit per element
+	typedef arrays::MdArray<1, uint32_t, MaskAllocator> MaskType;
 	
       public:
-	ForwardStateMap(): inputMap_(), activationMap_() { }
+	ForwardStateMap(): inputMap_(), activationMap_(), maskMap_() { }
 	ForwardStateMap(const ForwardStateMap&) = default;
 	ForwardStateMap(ForwardStateMap&&) = default;
 
 	size_t numInputs() const { return inputMap_.size(); }
 	size_t numActivations() const { return activationMap_.size(); }
+	size_t numMasks() const { return maskMap_.size(); }
 	std::vector<size_t> inputIds() const {
 	  return extractIds_(inputMap_);
 	}
@@ -32,6 +42,10 @@ namespace neurodidactic {
 	std::vector<size_t> activationIds() const {
 	  return extractIds_(activationMap_);
 	}
+
+	std::vector<size_t> maskIds() const {
+	  return extractIds_(maskMap_);
+	}
 	
 	const ArrayRefType& inputs(size_t id) const {
 	  return retrieve_(inputMap_, id);
@@ -40,6 +54,10 @@ namespace neurodidactic {
 	const ArrayRefType& activations(size_t id) const {
 	  return retrieve_(activationMap_, id);
 	}
+
+	const MaskType& mask(size_t id) const {
+	  return retrieve_(maskMap_, id);
+	}
 	
 	template <typename Array>
 	void setInputs(size_t id, const arrays::AnyMdArray<Array>& inputs) {
@@ -52,9 +70,21 @@ namespace neurodidactic {
 	  set_(activationMap_, id, activations.self().ref());
 	}
 
+	// The map owns its masks, unlike inputs and activations, which are
+	// references to arrays shared with the layers
+	void setMask(size_t id, MaskType&& mask) {
+	  auto i = maskMap_.find(id);
+	  if (i != maskMap_.end()) {
+	    i->second = std::move(mask);
+	  } else {
+	    maskMap_.insert(std::make_pair(id, std::move(mask)));
+	  }
+	}
+
 	void reset() {
 	  inputMap_.clear();
 	  activationMap_.clear();
+	  maskMap_.clear();
 	}
 
 	ForwardStateMap& operator=(const ForwardStateMap&) = default;
@@ -62,13 +92,16 @@ namespace neurodidactic {
 
       private:
 	typedef std::unordered_map<size_t, ArrayRefType> IdToArrayMap;
+	typedef std::unordered_map<size_t, MaskType> IdToMaskMap;
 
       private:
 	IdToArrayMap inputMap_;
 	IdToArrayMap activationMap_;
+	IdToMaskMap maskMap_;
 
-	static const ArrayRefType& retrieve_(const IdToArrayMap& data,
-					     size_t id) {
+	template <typename Map>
+	static const typename Map::mapped_type& retrieve_(const Map& data,
+							  size_t id) {
 	  auto i = data.find(id);
 	  if (i == data.end()) {
 	    std::ostringstream msg;
@@ -89,12 +122,13 @@ namespace neurodidactic {
 	  }
 	}
 
-	static std::vector<size_t> extractIds_(const IdToArrayMap& data) {
+	template <typename Map>
+	static std::vector<size_t> extractIds_(const Map& data) {
 	  std::vector<size_t> ids;
 
 	  ids.reserve(data.size());
 	  std::transform(data.begin(), data.end(), std::back_inserter(ids),
-			 [](const typename IdToArrayMap::value_type& x) {
+			 [](const typename Map::value_type& x) {
 			     return x.first;
 			 });
 	  return ids;
@@ -0,0 +1,529 @@
+#ifndef __NEURODIDACTIC__CORE__OPTIMIZERS__GRADIENTACCUMULATOR_HPP__
+#define __NEURODIDACTIC__CORE__OPTIMIZERS__GRADIENTACCUMULATOR_HPP__
+
+#include <neurodidactic/core/arrays/AnyMdArrayRef.hpp>
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/arrays/MklAllocator.hpp>
+#include <neurodidactic/core/arrays/SparseRowMatrix.hpp>
+#include <neurodidactic/core/arrays/SparseVector.hpp>
+#include <neurodidactic/core/arrays/detail/MklAdapter.hpp>
+#include <neurodidactic/core/optimizers/ColumnUpdates.hpp>
+#include <neurodidactic/core/optimizers/RowUpdates.hpp>
+#include <neurodidactic/core/profiling/Tracer.hpp>
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <algorithm>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace optimizers {
+
+      // Stands in for an optimizer during backpropagation.  Instead of
+      // updating the parameters, update() sums the gradients it receives
+      // so they can be combined with those of other workers and applied
+      // to the parameters later by a real optimizer.
+      template <typename Field,
+		typename Allocator = arrays::MklAllocator<Field, 64> >
+      class GradientAccumulator {
+      public:
+	typedef arrays::AnyMdArrayRef<Field, Allocator> ArrayRefType;
+	typedef arrays::MdArray<1, Field, Allocator> VectorType;
+	typedef arrays::SparseVector<Field, Allocator> SparseVectorType;
+	typedef arrays::SparseRowMatrix<Field, Allocator> SparseRowMatrixType;
+	static constexpr const size_t MAX_ORDER = 4;
+
+      public:
+	GradientAccumulator():
+	    entries_(), index_(), columnUpdates_(), rowUpdates_(),
+	    rowIndex_() {
+	}
+	GradientAccumulator(const GradientAccumulator&) = delete;
+	GradientAccumulator(GradientAccumulator&&) = default;
+
+	size_t numEntries() const { return entries_.size(); }
+	size_t numColumnUpdates() const { return columnUpdates_.size(); }
+	size_t numRowUpdates() const { return rowUpdates_.size(); }
+	uint32_t layerId(size_t n) const { return entries_[n].layerId; }
+	uint32_t paramId(size_t n) const { return entries_[n].paramId; }
+	size_t gradientSize(size_t n) const {
+	  return entries_[n].gradient.size();
+	}
+	const Field* gradient(size_t n) const {
+	  return entries_[n].gradient.data();
+	}
+	Field* gradient(size_t n) { return entries_[n].gradient.data(); }
+	const SparseRowMatrixType& rowGradient(size_t n) const {
+	  return rowUpdates_[n].gradient;
+	}
+
+	template <typename Array, typename Gradient>
+	void update(uint32_t layerId, uint32_t paramId, Array& param,
+		    const Gradient& gradient) {
+	  NEURODIDACTIC_TRACE_SPAN("update", layerId);
+	  typedef arrays::detail::MklAdapter<Field, Field> MklAdapter;
+	  const uint64_t key = key_(layerId, paramId);
+	  auto i = index_.find(key);
+
+	  if (i == index_.end()) {
+	    typename Gradient::ArrayType copy(gradient);
+	    index_.insert(std::make_pair(key, entries_.size()));
+	    entries_.push_back(Entry(layerId, paramId,
+				     ArrayRefType(param.ref()),
+				     ArrayRefType(copy.ref())));
+	  } else {
+	    Entry& entry = entries_[i->second];
+	    if (entry.gradient.size() != gradient.size()) {
+	      std::ostringstream msg;
+	      msg << "Gradient for parameter " << paramId << " of layer "
+		  << layerId << " has " << gradient.size()
+		  << " elements, but earlier gradients had "
+		  << entry.gradient.size();
+	      throw pistis::exceptions::IllegalValueError(msg.str(),
+							  PISTIS_EX_HERE);
+	    }
+	    MklAdapter::add(gradient.size(), entry.gradient.data(),
+			    gradient.data(), entry.gradient.data());
+	  }
+	}
+
+	// Column updates are kept as the two factors of their outer
+	// products and handed to the optimizer's updateColumns() by apply(),
+	// so a sparse input never costs a gradient the size of "param"
+	template <typename Array, typename Vector, typename SparseVector>
+	void updateColumns(uint32_t layerId, uint32_t paramId, Array& param,
+			   const Vector& rows, const SparseVector& columns) {
+	  NEURODIDACTIC_TRACE_SPAN("update", layerId);
+	  validateColumnUpdate(layerId, paramId, param, rows, columns);
+	  columnUpdates_.push_back(ColumnUpdate(
+	      layerId, paramId, ArrayRefType(param.ref()),
+	      VectorType({ (uint32_t)rows.size() }, rows.data(),
+			 param.allocator()),
+	      SparseVectorType(columns.size(), columns.numNonZeros(),
+			       columns.indices(), columns.values(),
+			       param.allocator())
+	  ));
+	}
+
+	// Row updates of the same parameter are summed row by row into one
+	// SparseRowMatrix, which apply() hands to the optimizer's
+	// updateRows().  Only the rows a batch touches are stored, so a lazy
+	// optimizer still only steps those rows.
+	template <typename Array, typename SparseRowMatrix>
+	void updateRows(uint32_t layerId, uint32_t paramId, Array& param,
+			const SparseRowMatrix& gradient) {
+	  NEURODIDACTIC_TRACE_SPAN("update", layerId);
+	  validateRowUpdate(layerId, paramId, param, gradient);
+	  addRows_(layerId, paramId, ArrayRefType(param.ref()), gradient,
+		   param.allocator());
+	}
+
+	bool compatibleWith(const GradientAccumulator& other) const {
+	  if (other.entries_.size() != entries_.size()) {
+	    return false;
+	  }
+	  for (size_t i = 0; i < entries_.size(); ++i) {
+	    const Entry& mine = entries_[i];
+	    const Entry& theirs = other.entries_[i];
+	    if ((mine.layerId != theirs.layerId) ||
+		(mine.paramId != theirs.paramId) ||
+		(mine.gradient.size() != theirs.gradient.size())) {
+	      return false;
+	    }
+	  }
+	  return true;
+	}
+
+	void accumulate(const GradientAccumulator& other) {
+	  typedef arrays::detail::MklAdapter<Field, Field> MklAdapter;
+	  if (!compatibleWith(other)) {
+	    throw pistis::exceptions::IllegalValueError(
+		"Accumulator \"other\" holds gradients for different "
+		"parameters",
+		PISTIS_EX_HERE
+	    );
+	  }
+	  for (size_t i = 0; i < entries_.size(); ++i) {
+	    MklAdapter::add(entries_[i].gradient.size(),
+			    entries_[i].gradient.data(),
+			    other.entries_[i].gradient.data(),
+			    entries_[i].gradient.data());
+	  }
+	  accumulateSparse(other);
+	}
+
+	// Adds the sparse updates of "other" to this accumulator.  Sparse
+	// updates don't take part in compatibleWith(), so accumulators
+	// whose dense gradients were summed some other way (as
+	// DataParallelTrainer does) combine their sparse updates with this.
+	void accumulateSparse(const GradientAccumulator& other) {
+	  columnUpdates_.insert(columnUpdates_.end(),
+				other.columnUpdates_.begin(),
+				other.columnUpdates_.end());
+	  for (const RowUpdate& update : other.rowUpdates_) {
+	    addRows_(update.layerId, update.paramId, update.param,
+		     update.gradient, update.gradient.allocator());
+	  }
+	}
+
+	void scale(Field c) {
+	  typedef arrays::detail::MklAdapter<Field, Field> MklAdapter;
+	  for (Entry& entry : entries_) {
+	    MklAdapter::scale(entry.gradient.size(), c,
+			      entry.gradient.data());
+	  }
+	  for (ColumnUpdate& update : columnUpdates_) {
+	    MklAdapter::scale(update.rows.size(), c, update.rows.data());
+	  }
+	  for (RowUpdate& update : rowUpdates_) {
+	    MklAdapter::scale(
+		update.gradient.numNonZeroRows() * update.gradient.rowSize(),
+		c, update.gradient.values()
+	    );
+	  }
+	}
+
+	void clear() {
+	  for (Entry& entry : entries_) {
+	    std::fill_n(entry.gradient.data(), entry.gradient.size(),
+			Field(0));
+	  }
+	  columnUpdates_.clear();
+	  rowUpdates_.clear();
+	  rowIndex_.clear();
+	}
+
+	void reset() {
+	  entries_.clear();
+	  index_.clear();
+	  columnUpdates_.clear();
+	  rowUpdates_.clear();
+	  rowIndex_.clear();
+	}
+
+	template <typename Optimizer>
+	void apply(Optimizer& optimizer) {
+	  const bool mergeColumns = !takesColumnUpdates_(optimizer, 0);
+	  for (Entry& entry : entries_) {
+	    if ((mergeColumns &&
+		 hasColumnUpdates_(entry.layerId, entry.paramId)) ||
+		rowIndex_.count(key_(entry.layerId, entry.paramId))) {
+	      applyMerged_(entry, mergeColumns, optimizer);
+	      continue;
+	    }
+	    switch (entry.param.order()) {
+	      case 1: apply_<1>(entry, optimizer); break;
+	      case 2: apply_<2>(entry, optimizer); break;
+	      case 3: apply_<3>(entry, optimizer); break;
+	      case 4: apply_<4>(entry, optimizer); break;
+
+	      default: {
+		std::ostringstream msg;
+		msg << "Cannot apply gradients to arrays of order "
+		    << entry.param.order() << " (maximum order is "
+		    << MAX_ORDER << ")";
+		throw pistis::exceptions::IllegalValueError(msg.str(),
+							    PISTIS_EX_HERE);
+	      }
+	    }
+	  }
+	  applyColumns_(optimizer, 0);
+	  applyRows_(optimizer, 0);
+	}
+
+	GradientAccumulator& operator=(const GradientAccumulator&) = delete;
+	GradientAccumulator& operator=(GradientAccumulator&&) = default;
+
+      private:
+	typedef arrays::MdArrayRef<2, Field, Allocator> MatrixRefType;
+
+	struct Entry {
+	  uint32_t layerId;
+	  uint32_t paramId;
+	  ArrayRefType param;
+	  ArrayRefType gradient;
+
+	  Entry(uint32_t layerId_, uint32_t paramId_,
+		const ArrayRefType& param_, const ArrayRefType& gradient_):
+	      layerId(layerId_), paramId(paramId_), param(param_),
+	      gradient(gradient_) {
+	  }
+	};
+
+	// The gradient rows columns^T for a matrix parameter
+	struct ColumnUpdate {
+	  uint32_t layerId;
+	  uint32_t paramId;
+	  ArrayRefType param;
+	  VectorType rows;
+	  SparseVectorType columns;
+
+	  ColumnUpdate(uint32_t layerId_, uint32_t paramId_,
+		       const ArrayRefType& param_, VectorType&& rows_,
+		       SparseVectorType&& columns_):
+	      layerId(layerId_), paramId(paramId_), param(param_),
+	      rows(std::move(rows_)), columns(std::move(columns_)) {
+	  }
+	};
+
+	std::vector<Entry> entries_;
+	std::unordered_map<uint64_t, size_t> index_;
+	// The sum of the row updates of a matrix parameter
+	struct RowUpdate {
+	  uint32_t layerId;
+	  uint32_t paramId;
+	  ArrayRefType param;
+	  SparseRowMatrixType gradient;
+
+	  RowUpdate(uint32_t layerId_, uint32_t paramId_,
+		    const ArrayRefType& param_,
+		    SparseRowMatrixType&& gradient_):
+	      layerId(layerId_), paramId(paramId_), param(param_),
+	      gradient(std::move(gradient_)) {
+	  }
+	};
+
+	std::vector<ColumnUpdate> columnUpdates_;
+	std::vector<RowUpdate> rowUpdates_;
+	std::unordered_map<uint64_t, size_t> rowIndex_;
+
+	static uint64_t key_(uint32_t layerId, uint32_t paramId) {
+	  return (uint64_t(layerId) << 32) | paramId;
+	}
+
+	// Adds "gradient" to the sum of the row updates of parameter
+	// "paramId" of layer "layerId" by merging their (sorted) rows
+	template <typename SparseRowMatrix>
+	void addRows_(uint32_t layerId, uint32_t paramId,
+		      const ArrayRefType& param,
+		      const SparseRowMatrix& gradient,
+		      const Allocator& allocator) {
+	  const uint64_t key = key_(layerId, paramId);
+	  auto i = rowIndex_.find(key);
+	  if (i == rowIndex_.end()) {
+	    i = rowIndex_.insert(std::make_pair(key, rowUpdates_.size()))
+		    .first;
+	    rowUpdates_.push_back(RowUpdate(
+		layerId, paramId, param,
+		SparseRowMatrixType(gradient.numRows(), gradient.rowSize(),
+				    allocator)
+	    ));
+	  }
+
+	  RowUpdate& update = rowUpdates_[i->second];
+	  const SparseRowMatrixType& sum = update.gradient;
+	  if ((sum.numRows() != gradient.numRows()) ||
+	      (sum.rowSize() != gradient.rowSize())) {
+	    std::ostringstream msg;
+	    msg << "Row update for parameter " << paramId << " of layer "
+		<< layerId << " has dimensions [ " << gradient.numRows()
+		<< ", " << gradient.rowSize() << " ], but earlier row "
+		<< "updates had dimensions [ " << sum.numRows() << ", "
+		<< sum.rowSize() << " ]";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+
+	  const size_t rowSize = sum.rowSize();
+	  SparseRowMatrixType merged(sum.numRows(), rowSize,
+				     sum.allocator());
+	  size_t j = 0;
+	  size_t k = 0;
+	  while ((j < sum.numNonZeroRows()) ||
+		 (k < gradient.numNonZeroRows())) {
+	    if ((k == gradient.numNonZeroRows()) ||
+		((j < sum.numNonZeroRows()) &&
+		 (sum.indices()[j] < gradient.indices()[k]))) {
+	      merged.append(sum.indices()[j], sum.row(j));
+	      ++j;
+	    } else if ((j == sum.numNonZeroRows()) ||
+		       (gradient.indices()[k] < sum.indices()[j])) {
+	      merged.append(gradient.indices()[k], gradient.row(k));
+	      ++k;
+	    } else {
+	      merged.append(sum.indices()[j], sum.row(j));
+	      Field* row = merged.row(merged.numNonZeroRows() - 1);
+	      const Field* other = gradient.row(k);
+	      for (size_t n = 0; n < rowSize; ++n) {
+		row[n] += other[n];
+	      }
+	      ++j;
+	      ++k;
+	    }
+	  }
+	  update.gradient = std::move(merged);
+	}
+
+	template <size_t ORDER, typename Optimizer>
+	static void apply_(Entry& entry, Optimizer& optimizer) {
+	  auto param = entry.param.template cast<ORDER>();
+	  auto gradient = entry.gradient.template cast<ORDER>();
+	  optimizer.update(entry.layerId, entry.paramId, param, gradient);
+	}
+
+	// Hands each column update to the optimizer's updateColumns(), which
+	// optimizers only implement when they are linear in the gradient
+	template <typename Optimizer>
+	auto applyColumns_(Optimizer& optimizer, int) ->
+	    decltype(optimizer.updateColumns(
+			 uint32_t(0), uint32_t(0),
+			 std::declval<MatrixRefType&>(),
+			 std::declval<const VectorType&>(),
+			 std::declval<const SparseVectorType&>()
+		     ),
+		     void()) {
+	  for (ColumnUpdate& update : columnUpdates_) {
+	    auto param = update.param.template cast<2>();
+	    optimizer.updateColumns(update.layerId, update.paramId, param,
+				    update.rows, update.columns);
+	  }
+	}
+
+	// Optimizers without updateColumns() get one dense gradient per
+	// parameter, summed from all of its column updates, so they still
+	// take one step per parameter.  Parameters that also have a dense
+	// gradient were stepped by applyMerged_().
+	template <typename Optimizer>
+	void applyColumns_(Optimizer& optimizer, long) {
+	  for (size_t i = 0; i < columnUpdates_.size(); ++i) {
+	    const ColumnUpdate& first = columnUpdates_[i];
+	    const uint64_t key = key_(first.layerId, first.paramId);
+	    if (index_.count(key) || (firstColumnUpdate_(key) < i)) {
+	      continue;
+	    }
+	    auto param = first.param.template cast<2>();
+	    arrays::MdArray<2, Field, Allocator> gradient(
+		param.dimensions(), Field(0), param.allocator()
+	    );
+	    addColumnUpdates_(first.layerId, first.paramId, gradient.data());
+	    optimizer.update(first.layerId, first.paramId, param, gradient);
+	  }
+	}
+
+	template <typename Optimizer>
+	static auto takesColumnUpdates_(Optimizer& /*optimizer*/, int) ->
+	    decltype(std::declval<Optimizer&>().updateColumns(
+			 uint32_t(0), uint32_t(0),
+			 std::declval<MatrixRefType&>(),
+			 std::declval<const VectorType&>(),
+			 std::declval<const SparseVectorType&>()
+		     ),
+		     bool()) {
+	  return true;
+	}
+
+	template <typename Optimizer>
+	static bool takesColumnUpdates_(Optimizer& /*optimizer*/, long) {
+	  return false;
+	}
+
+	size_t firstColumnUpdate_(uint64_t key) const {
+	  size_t i = 0;
+	  while ((i < columnUpdates_.size()) &&
+		 (key_(columnUpdates_[i].layerId,
+		       columnUpdates_[i].paramId) != key)) {
+	    ++i;
+	  }
+	  return i;
+	}
+
+	bool hasColumnUpdates_(uint32_t layerId, uint32_t paramId) const {
+	  return firstColumnUpdate_(key_(layerId, paramId)) <
+		     columnUpdates_.size();
+	}
+
+	// Adds the column updates of a parameter to its dense gradient
+	void addColumnUpdates_(uint32_t layerId, uint32_t paramId,
+			       Field* gradient) const {
+	  for (const ColumnUpdate& update : columnUpdates_) {
+	    if ((update.layerId == layerId) && (update.paramId == paramId)) {
+	      arrays::detail::SparseVectorKernels::addOuterProduct(
+		  update.rows.size(), update.columns.size(), Field(1),
+		  update.rows.data(), update.columns.numNonZeros(),
+		  update.columns.indices(), update.columns.values(), gradient
+	      );
+	    }
+	  }
+	}
+
+	// Steps a parameter once with its dense gradient plus its row
+	// updates and, for optimizers that must not see them separately, its
+	// column updates
+	template <typename Optimizer>
+	void applyMerged_(Entry& entry, bool mergeColumns,
+			  Optimizer& optimizer) {
+	  auto param = entry.param.template cast<2>();
+	  arrays::MdArray<2, Field, Allocator> gradient(
+	      param.dimensions(), entry.gradient.data(), param.allocator()
+	  );
+	  if (mergeColumns) {
+	    addColumnUpdates_(entry.layerId, entry.paramId, gradient.data());
+	  }
+
+	  auto i = rowIndex_.find(key_(entry.layerId, entry.paramId));
+	  if (i != rowIndex_.end()) {
+	    const SparseRowMatrixType& rows = rowUpdates_[i->second].gradient;
+	    if ((rows.numRows() != param.dimensions()[0]) ||
+		(rows.rowSize() != param.dimensions()[1])) {
+	      std::ostringstream msg;
+	      msg << "Row updates for parameter " << entry.paramId
+		  << " of layer " << entry.layerId << " have dimensions [ "
+		  << rows.numRows() << ", " << rows.rowSize() << " ], but "
+		  << "its dense gradient has dimensions "
+		  << param.dimensions();
+	      throw pistis::exceptions::IllegalValueError(msg.str(),
+							  PISTIS_EX_HERE);
+	    }
+	    arrays::detail::SparseRowKernels::addRows(
+		rows.numNonZeroRows(), rows.rowSize(), Field(1),
+		rows.indices(), rows.values(), gradient.data()
+	    );
+	  }
+	  optimizer.update(entry.layerId, entry.paramId, param, gradient);
+	}
+
+	// Hands each parameter's summed row updates to the optimizer's
+	// updateRows(), so an optimizer that is lazy about rows stays lazy.
+	// Parameters that also have a dense gradient were stepped by
+	// applyMerged_().
+	template <typename Optimizer>
+	auto applyRows_(Optimizer& optimizer, int) ->
+	    decltype(optimizer.updateRows(
+			 uint32_t(0), uint32_t(0),
+			 std::declval<MatrixRefType&>(),
+			 std::declval<const SparseRowMatrixType&>()
+		     ),
+		     void()) {
+	  for (RowUpdate& update : rowUpdates_) {
+	    if (index_.count(key_(update.layerId, update.paramId))) {
+	      continue;
+	    }
+	    auto param = update.param.template cast<2>();
+	    optimizer.updateRows(update.layerId, update.paramId, param,
+				 update.gradient);
+	  }
+	}
+
+	// Optimizers without updateRows() get the summed row updates as a
+	// dense gradient
+	template <typename Optimizer>
+	void applyRows_(Optimizer& optimizer, long) {
+	  for (RowUpdate& update : rowUpdates_) {
+	    if (index_.count(key_(update.layerId, update.paramId))) {
+	      continue;
+	    }
+	    auto param = update.param.template cast<2>();
+	    auto gradient = update.gradient.toDense();
+	    optimizer.update(update.layerId, update.paramId, param, gradient);
+	  }
+	}
+      };
+
+    }
+  }
+}
+#endif
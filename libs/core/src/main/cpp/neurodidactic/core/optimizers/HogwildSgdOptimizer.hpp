@@ -0,0 +1,123 @@
+#ifndef __NEURODIDACTIC__CORE__OPTIMIZERS__HOGWILDSGDOPTIMIZER_HPP__
+#define __NEURODIDACTIC__CORE__OPTIMIZERS__HOGWILDSGDOPTIMIZER_HPP__
+
+#include <neurodidactic/core/arrays/AnyMdArray.hpp>
+#include <neurodidactic/core/optimizers/ColumnUpdates.hpp>
+#include <neurodidactic/core/optimizers/RowUpdates.hpp>
+#include <neurodidactic/core/profiling/Tracer.hpp>
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <sstream>
+#include <type_traits>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace optimizers {
+
+      // Stochastic gradient descent for many threads sharing the same
+      // parameters without locks.  Each element is read and written with
+      // relaxed atomic loads and stores, so concurrent updates to the same
+      // element may be lost but never tear.  Elements whose gradient is
+      // zero are not written at all, which keeps threads from contending
+      // for cache lines when the gradients are sparse.
+      template <typename Field>
+      class HogwildSgdOptimizer {
+      public:
+	explicit HogwildSgdOptimizer(Field learningRate):
+	    learningRate_(learningRate) {
+	}
+	HogwildSgdOptimizer(const HogwildSgdOptimizer&) = default;
+
+	Field learningRate() const { return learningRate_; }
+	void setLearningRate(Field learningRate) {
+	  learningRate_ = learningRate;
+	}
+
+	template <typename Array, typename Gradient,
+		  typename Enabled =
+		      typename std::enable_if<
+			  arrays::IsMdArray<Array>::value &&
+			      arrays::IsMdArray<Gradient>::value,
+			  int
+		      >::type
+		 >
+	void update(uint32_t layerId, uint32_t paramId, Array& param,
+		    const Gradient& gradient, Enabled = 0) const {
+	  NEURODIDACTIC_TRACE_SPAN("update", layerId);
+	  if (param.size() != gradient.size()) {
+	    std::ostringstream msg;
+	    msg << "Gradient for parameter " << paramId << " of layer "
+		<< layerId << " has " << gradient.size()
+		<< " elements, but the parameter has " << param.size();
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+
+	  Field* p = param.data();
+	  const Field* g = gradient.data();
+	  for (size_t i = 0; i < param.size(); ++i) {
+	    if (g[i] != Field(0)) {
+	      Field v;
+	      __atomic_load(p + i, &v, __ATOMIC_RELAXED);
+	      v -= learningRate_ * g[i];
+	      __atomic_store(p + i, &v, __ATOMIC_RELAXED);
+	    }
+	  }
+	}
+
+	template <typename Array, typename Vector, typename SparseVector>
+	void updateColumns(uint32_t layerId, uint32_t paramId, Array& param,
+			   const Vector& rows,
+			   const SparseVector& columns) const {
+	  NEURODIDACTIC_TRACE_SPAN("update", layerId);
+	  validateColumnUpdate(layerId, paramId, param, rows, columns);
+
+	  const size_t n = columns.size();
+	  const uint32_t* indices = columns.indices();
+	  const Field* values = columns.values();
+	  Field* row = param.data();
+	  for (size_t i = 0; i < rows.size(); ++i, row += n) {
+	    const Field c = learningRate_ * rows.data()[i];
+	    if (c != Field(0)) {
+	      for (size_t k = 0; k < columns.numNonZeros(); ++k) {
+		Field v;
+		__atomic_load(row + indices[k], &v, __ATOMIC_RELAXED);
+		v -= c * values[k];
+		__atomic_store(row + indices[k], &v, __ATOMIC_RELAXED);
+	      }
+	    }
+	  }
+	}
+
+	template <typename Array, typename SparseRowMatrix>
+	void updateRows(uint32_t layerId, uint32_t paramId, Array& param,
+			const SparseRowMatrix& gradient) const {
+	  NEURODIDACTIC_TRACE_SPAN("update", layerId);
+	  validateRowUpdate(layerId, paramId, param, gradient);
+
+	  const size_t n = gradient.rowSize();
+	  for (size_t k = 0; k < gradient.numNonZeroRows(); ++k) {
+	    const Field* g = gradient.row(k);
+	    Field* p = param.data() + size_t(gradient.indices()[k]) * n;
+	    for (size_t i = 0; i < n; ++i) {
+	      if (g[i] != Field(0)) {
+		Field v;
+		__atomic_load(p + i, &v, __ATOMIC_RELAXED);
+		v -= learningRate_ * g[i];
+		__atomic_store(p + i, &v, __ATOMIC_RELAXED);
+	      }
+	    }
+	  }
+	}
+
+	HogwildSgdOptimizer& operator=(const HogwildSgdOptimizer&) = default;
+
+      private:
+	Field learningRate_;
+      };
+
+    }
+  }
+}
+#endif
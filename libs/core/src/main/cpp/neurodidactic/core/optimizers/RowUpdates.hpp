@@ -0,0 +1,44 @@
+#ifndef __NEURODIDACTIC__CORE__OPTIMIZERS__ROWUPDATES_HPP__
+#define __NEURODIDACTIC__CORE__OPTIMIZERS__ROWUPDATES_HPP__
+
+#include <neurodidactic/core/arrays/SparseRowMatrix.hpp>
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <sstream>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace optimizers {
+
+      // Optimizers may implement
+      //
+      //   void updateRows(uint32_t layerId, uint32_t paramId,
+      //                   Array& param, const SparseRowMatrix& gradient);
+      //
+      // to apply a gradient that is zero outside the rows held by the
+      // SparseRowMatrix "gradient."  This is the weight gradient of an
+      // embedding table, and only the rows of "param" at the gradient's
+      // indices are affected.  validateRowUpdate() checks that the
+      // dimensions of the two agree.
+      template <typename Array, typename SparseRowMatrix>
+      void validateRowUpdate(uint32_t layerId, uint32_t paramId,
+			     const Array& param,
+			     const SparseRowMatrix& gradient) {
+	if ((param.dimensions().size() != 2) ||
+	    (param.dimensions()[0] != gradient.numRows()) ||
+	    (param.dimensions()[1] != gradient.rowSize())) {
+	  std::ostringstream msg;
+	  msg << "Row update for parameter " << paramId << " of layer "
+	      << layerId << " has dimensions [ " << gradient.numRows()
+	      << ", " << gradient.rowSize() << " ], but the parameter has "
+	      << "dimensions " << param.dimensions();
+	  throw pistis::exceptions::IllegalValueError(msg.str(),
+						      PISTIS_EX_HERE);
+	}
+      }
+
+    }
+  }
+}
+#endif
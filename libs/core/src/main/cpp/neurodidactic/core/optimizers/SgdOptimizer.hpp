@@ -0,0 +1,79 @@
+#ifndef __NEURODIDACTIC__CORE__OPTIMIZERS__SGDOPTIMIZER_HPP__
+#define __NEURODIDACTIC__CORE__OPTIMIZERS__SGDOPTIMIZER_HPP__
+
+#include <neurodidactic/core/arrays/AnyMdArray.hpp>
+#include <neurodidactic/core/optimizers/ColumnUpdates.hpp>
+#include <neurodidactic/core/optimizers/RowUpdates.hpp>
+#include <neurodidactic/core/profiling/Tracer.hpp>
+#include <type_traits>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace optimizers {
+
+      template <typename Field>
+      class SgdOptimizer {
+      public:
+	explicit SgdOptimizer(Field learningRate):
+	    learningRate_(learningRate) {
+	}
+	SgdOptimizer(const SgdOptimizer&) = default;
+
+	Field learningRate() const { return learningRate_; }
+	void setLearningRate(Field learningRate) {
+	  learningRate_ = learningRate;
+	}
+
+	template <typename Array, typename Gradient,
+		  typename Enabled =
+		      typename std::enable_if<
+			  arrays::IsMdArray<Array>::value &&
+			      arrays::IsMdArray<Gradient>::value,
+			  int
+		      >::type
+		 >
+	void update(uint32_t layerId, uint32_t paramId, Array& param,
+		    const Gradient& gradient, Enabled = 0) {
+	  NEURODIDACTIC_TRACE_SPAN("update", layerId);
+	  param.scaleAndAddInPlace(-learningRate_, gradient);
+	}
+
+	// Applies the gradient "rows" x "columns"^T, where "columns" is a
+	// SparseVector.  Only the columns of "param" at the nonzeros of
+	// "columns" change.
+	template <typename Array, typename Vector, typename SparseVector>
+	void updateColumns(uint32_t layerId, uint32_t paramId, Array& param,
+			   const Vector& rows, const SparseVector& columns) {
+	  NEURODIDACTIC_TRACE_SPAN("update", layerId);
+	  validateColumnUpdate(layerId, paramId, param, rows, columns);
+	  arrays::detail::SparseVectorKernels::addOuterProduct(
+	      rows.size(), columns.size(), -learningRate_, rows.data(),
+	      columns.numNonZeros(), columns.indices(), columns.values(),
+	      param.data()
+	  );
+	}
+
+	// Applies a gradient that is zero outside the rows held by the
+	// SparseRowMatrix "gradient"
+	template <typename Array, typename SparseRowMatrix>
+	void updateRows(uint32_t layerId, uint32_t paramId, Array& param,
+			const SparseRowMatrix& gradient) {
+	  NEURODIDACTIC_TRACE_SPAN("update", layerId);
+	  validateRowUpdate(layerId, paramId, param, gradient);
+	  arrays::detail::SparseRowKernels::addRows(
+	      gradient.numNonZeroRows(), gradient.rowSize(), -learningRate_,
+	      gradient.indices(), gradient.values(), param.data()
+	  );
+	}
+
+	SgdOptimizer& operator=(const SgdOptimizer&) = default;
+
+      private:
+	Field learningRate_;
+      };
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,60 @@
+#ifndef __NEURODIDACTIC__CORE__PARALLEL__ELEMENTWISE_HPP__
+#define __NEURODIDACTIC__CORE__PARALLEL__ELEMENTWISE_HPP__
+
+#include <neurodidactic/core/parallel/ThreadPool.hpp>
+#include <type_traits>
+#include <stddef.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace parallel {
+
+      // Arrays with fewer elements than this are mapped serially.  Cheap
+      // functions need tens of thousands of elements before splitting the
+      // work pays for waking the pool.
+      static constexpr const size_t DEFAULT_GRAIN_SIZE = 32768;
+
+      // Chunks start on multiples of this many elements, so that each
+      // chunk of a 64-byte aligned float array begins on a cache line and
+      // the compiler's vectorized loop body has no peeled prologue.
+      static constexpr const size_t ELEMENTWISE_ALIGNMENT = 16;
+
+      // Functions passed to map() may declare a
+      //
+      //   static constexpr const size_t GRAIN_SIZE = ...;
+      //
+      // to override DEFAULT_GRAIN_SIZE.  Expensive functions should use a
+      // smaller grain so that they are split up sooner.
+      template <typename Function, typename Enabled = void>
+      struct GrainSize {
+	static constexpr const size_t value = DEFAULT_GRAIN_SIZE;
+      };
+
+      template <typename Function>
+      struct GrainSize<
+	  Function,
+	  typename std::enable_if<(Function::GRAIN_SIZE > 0)>::type
+      > {
+	static constexpr const size_t value = Function::GRAIN_SIZE;
+      };
+
+      // Computes q[i] = f(p[i]) for i in [0, n).  p and q may be the same
+      // array.
+      template <typename T, typename U, typename Function>
+      void elementwise(size_t n, const T* p, U* q, const Function& f,
+		       size_t grainSize = GrainSize<Function>::value) {
+	parallelFor(
+	    0, n, grainSize,
+	    [p, q, &f](size_t begin, size_t end) {
+	      for (size_t i = begin; i < end; ++i) {
+		q[i] = f(p[i]);
+	      }
+	    },
+	    ELEMENTWISE_ALIGNMENT
+	);
+      }
+
+    }
+  }
+}
+#endif
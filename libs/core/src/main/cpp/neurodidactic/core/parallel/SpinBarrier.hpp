@@ -0,0 +1,54 @@
+#ifndef __NEURODIDACTIC__CORE__PARALLEL__SPINBARRIER_HPP__
+#define __NEURODIDACTIC__CORE__PARALLEL__SPINBARRIER_HPP__
+
+#include <atomic>
+#include <thread>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace parallel {
+
+      // Sense-reversing barrier for the short phases of a parallel
+      // computation.  Waiters spin briefly before yielding the processor.
+      class SpinBarrier {
+      public:
+	static constexpr const uint32_t SPINS_BEFORE_YIELD = 1024;
+
+      public:
+	explicit SpinBarrier(size_t numThreads):
+	    numThreads_(numThreads), remaining_(numThreads), sense_(false) {
+	}
+	SpinBarrier(const SpinBarrier&) = delete;
+
+	size_t numThreads() const { return numThreads_; }
+
+	void wait() {
+	  const bool sense = !sense_.load(std::memory_order_relaxed);
+	  if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+	    remaining_.store(numThreads_, std::memory_order_relaxed);
+	    sense_.store(sense, std::memory_order_release);
+	  } else {
+	    uint32_t spins = 0;
+	    while (sense_.load(std::memory_order_acquire) != sense) {
+	      if (++spins >= SPINS_BEFORE_YIELD) {
+		std::this_thread::yield();
+		spins = 0;
+	      }
+	    }
+	  }
+	}
+
+	SpinBarrier& operator=(const SpinBarrier&) = delete;
+
+      private:
+	const size_t numThreads_;
+	alignas(64) std::atomic<size_t> remaining_;
+	alignas(64) std::atomic<bool> sense_;
+      };
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,266 @@
+#ifndef __NEURODIDACTIC__CORE__PARALLEL__THREADPOOL_HPP__
+#define __NEURODIDACTIC__CORE__PARALLEL__THREADPOOL_HPP__
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace parallel {
+
+      // Marks the current thread as already running in parallel with
+      // others.  parallelFor() runs serially on such threads instead of
+      // handing work to a pool, so loops nested inside pool tasks or
+      // inside a trainer's worker threads don't oversubscribe the
+      // machine or deadlock on the pool.
+      class SerialRegion {
+      public:
+	SerialRegion(): previous_(active_()) { active_() = true; }
+	SerialRegion(const SerialRegion&) = delete;
+	~SerialRegion() noexcept { active_() = previous_; }
+
+	static bool active() { return active_(); }
+
+	SerialRegion& operator=(const SerialRegion&) = delete;
+
+      private:
+	bool previous_;
+
+	static bool& active_() {
+	  static thread_local bool active = false;
+	  return active;
+	}
+      };
+
+      // Persistent pool of worker threads for data-parallel loops.  The
+      // thread that calls parallelFor() works alongside the pool, so a
+      // pool of N threads has N - 1 workers.  A pool runs one loop at a
+      // time; a parallelFor() that finds the pool busy runs serially on
+      // the calling thread rather than waiting.
+      class ThreadPool {
+      public:
+	explicit ThreadPool(size_t numThreads):
+	    numThreads_(std::max(numThreads, size_t(1))), busy_(),
+	    mutex_(), workReady_(), generation_(0), stop_(false),
+	    task_(nullptr), numChunks_(0), nextChunk_(0),
+	    chunksDone_(0), activeWorkers_(0), error_(), errorMutex_(),
+	    workers_() {
+	  for (size_t i = 1; i < numThreads_; ++i) {
+	    workers_.emplace_back([this]() { this->workerLoop_(); });
+	  }
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+
+	~ThreadPool() noexcept {
+	  {
+	    std::unique_lock<std::mutex> lock(mutex_);
+	    stop_ = true;
+	    ++generation_;
+	  }
+	  workReady_.notify_all();
+	  for (auto& t : workers_) {
+	    t.join();
+	  }
+	}
+
+	size_t numThreads() const { return numThreads_; }
+
+	// Calls f(chunkBegin, chunkEnd) over [begin, end) in chunks of at
+	// least "grainSize" iterations.  Chunk boundaries fall on
+	// multiples of "alignment" (relative to "begin"), so chunks of
+	// contiguous array elements start on the same SIMD lane and
+	// cache line boundary.  Ranges of no more than one grain run
+	// serially.  The first exception thrown by f is rethrown after
+	// every chunk finishes.
+	template <typename Function>
+	void parallelFor(size_t begin, size_t end, size_t grainSize,
+			 const Function& f, size_t alignment = 1) {
+	  const size_t n = (end > begin) ? end - begin : 0;
+	  const size_t grain = roundUp_(std::max(grainSize, size_t(1)),
+					std::max(alignment, size_t(1)));
+
+	  if ((n <= grain) || (numThreads_ == 1) || SerialRegion::active()) {
+	    if (n) {
+	      f(begin, end);
+	    }
+	    return;
+	  }
+
+	  std::unique_lock<std::mutex> busy(busy_, std::try_to_lock);
+	  if (!busy.owns_lock()) {
+	    f(begin, end);
+	    return;
+	  }
+
+	  // Aim for a few chunks per thread so that uneven chunks
+	  // balance out, but never make chunks smaller than one grain
+	  const size_t targetChunks = numThreads_ * CHUNKS_PER_THREAD;
+	  const size_t chunkSize =
+	      std::max(grain, roundUp_((n + targetChunks - 1) / targetChunks,
+				       grain));
+	  Task<Function> task(begin, end, chunkSize, f);
+
+	  {
+	    std::unique_lock<std::mutex> lock(mutex_);
+	    task_ = &task;
+	    numChunks_ = (n + chunkSize - 1) / chunkSize;
+	    nextChunk_.store(0, std::memory_order_relaxed);
+	    chunksDone_.store(0, std::memory_order_relaxed);
+	    error_ = nullptr;
+	    ++generation_;
+	  }
+	  workReady_.notify_all();
+
+	  {
+	    SerialRegion serial;
+	    runChunks_(&task);
+	  }
+	  while (chunksDone_.load(std::memory_order_acquire) < numChunks_) {
+	    std::this_thread::yield();
+	  }
+
+	  // Workers that woke up late may still hold a pointer to the
+	  // task, so wait for them to let go of it before it goes away
+	  {
+	    std::unique_lock<std::mutex> lock(mutex_);
+	    task_ = nullptr;
+	  }
+	  while (activeWorkers_.load(std::memory_order_acquire)) {
+	    std::this_thread::yield();
+	  }
+	  if (error_) {
+	    std::exception_ptr e = error_;
+	    error_ = nullptr;
+	    std::rethrow_exception(e);
+	  }
+	}
+
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Pool shared by the array operations.  Its size comes from the
+	// NEURODIDACTIC_NUM_THREADS environment variable, or the number
+	// of hardware threads if that is not set.
+	static ThreadPool& defaultPool() {
+	  static ThreadPool pool(defaultNumThreads_());
+	  return pool;
+	}
+
+      private:
+	static constexpr const size_t CHUNKS_PER_THREAD = 4;
+
+	struct TaskBase {
+	  virtual ~TaskBase() noexcept { }
+	  virtual void run(size_t chunk) const = 0;
+	};
+
+	template <typename Function>
+	struct Task : public TaskBase {
+	  size_t begin;
+	  size_t end;
+	  size_t chunkSize;
+	  const Function& f;
+
+	  Task(size_t begin_, size_t end_, size_t chunkSize_,
+	       const Function& f_):
+	      begin(begin_), end(end_), chunkSize(chunkSize_), f(f_) {
+	  }
+
+	  virtual void run(size_t chunk) const override {
+	    const size_t chunkBegin = begin + chunk * chunkSize;
+	    f(chunkBegin, std::min(chunkBegin + chunkSize, end));
+	  }
+	};
+
+	const size_t numThreads_;
+	std::mutex busy_;
+	std::mutex mutex_;
+	std::condition_variable workReady_;
+	uint64_t generation_;
+	bool stop_;
+	const TaskBase* task_;
+	size_t numChunks_;
+	std::atomic<size_t> nextChunk_;
+	std::atomic<size_t> chunksDone_;
+	std::atomic<size_t> activeWorkers_;
+	std::exception_ptr error_;
+	std::mutex errorMutex_;
+	std::vector<std::thread> workers_;
+
+	void workerLoop_() {
+	  SerialRegion serial;
+	  uint64_t lastGeneration = 0;
+
+	  while (true) {
+	    const TaskBase* task = nullptr;
+	    {
+	      std::unique_lock<std::mutex> lock(mutex_);
+	      workReady_.wait(lock, [this, &lastGeneration]() {
+		  return generation_ != lastGeneration;
+	      });
+	      lastGeneration = generation_;
+	      if (stop_) {
+		return;
+	      }
+	      task = task_;
+	      if (task) {
+		activeWorkers_.fetch_add(1, std::memory_order_relaxed);
+	      }
+	    }
+	    if (task) {
+	      runChunks_(task);
+	      activeWorkers_.fetch_sub(1, std::memory_order_release);
+	    }
+	  }
+	}
+
+	void runChunks_(const TaskBase* task) {
+	  size_t chunk;
+
+	  while ((chunk = nextChunk_.fetch_add(1, std::memory_order_relaxed))
+		     < numChunks_) {
+	    try {
+	      task->run(chunk);
+	    } catch(...) {
+	      std::unique_lock<std::mutex> lock(errorMutex_);
+	      if (!error_) {
+		error_ = std::current_exception();
+	      }
+	    }
+	    chunksDone_.fetch_add(1, std::memory_order_release);
+	  }
+	}
+
+	static size_t roundUp_(size_t n, size_t multiple) {
+	  return ((n + multiple - 1) / multiple) * multiple;
+	}
+
+	static size_t defaultNumThreads_() {
+	  const char* value = getenv("NEURODIDACTIC_NUM_THREADS");
+	  if (value && (atoi(value) > 0)) {
+	    return atoi(value);
+	  }
+	  return std::max(std::thread::hardware_concurrency(), 1u);
+	}
+      };
+
+      // Runs f(chunkBegin, chunkEnd) over [begin, end) on the default pool
+      template <typename Function>
+      void parallelFor(size_t begin, size_t end, size_t grainSize,
+		       const Function& f, size_t alignment = 1) {
+	ThreadPool::defaultPool().parallelFor(begin, end, grainSize, f,
+					      alignment);
+      }
+
+    }
+  }
+}
+#endif
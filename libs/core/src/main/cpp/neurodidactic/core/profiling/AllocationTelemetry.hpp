@@ -0,0 +1,332 @@
+#ifndef __NEURODIDACTIC__CORE__PROFILING__ALLOCATIONTELEMETRY_HPP__
+#define __NEURODIDACTIC__CORE__PROFILING__ALLOCATIONTELEMETRY_HPP__
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+// Counts the arrays allocated through ArrayDataPtr::newData() and
+// released when their last reference goes away.  Define
+// NEURODIDACTIC_ALLOCATION_TELEMETRY for the whole build to compile the
+// hooks in; otherwise they and every NEURODIDACTIC_ALLOCATION_SCOPE
+// vanish, and the counters stay at zero.
+#ifdef NEURODIDACTIC_ALLOCATION_TELEMETRY
+#define NEURODIDACTIC_ALLOCATION_SCOPE(...)				\
+  ::neurodidactic::core::profiling::AllocationScope			\
+      neurodidacticAllocationScope_(__VA_ARGS__)
+#else
+#define NEURODIDACTIC_ALLOCATION_SCOPE(...)
+#endif
+
+namespace neurodidactic {
+  namespace core {
+    namespace profiling {
+
+      // Snapshot of the counters for one tag, or for all of them.  Size
+      // class k counts allocations of [2^k, 2^(k+1)) bytes; class 0 also
+      // counts empty arrays.
+      struct AllocationCounters {
+	std::string tag;
+	uint64_t numAllocations;
+	uint64_t numReleases;
+	uint64_t liveArrays;
+	uint64_t liveBytes;
+	uint64_t peakBytes;
+	uint64_t totalBytes;
+	std::vector<uint64_t> allocationsBySizeClass;
+      };
+
+      // Allocation counters, kept per tag.  Allocations are charged to the
+      // innermost AllocationScope active on the allocating thread, or to
+      // UNTAGGED outside of any scope, and releases are charged to the
+      // tag the array was allocated under.  All methods are thread-safe.
+      class AllocationTelemetry {
+      public:
+	static constexpr const size_t MAX_TAGS = 256;
+	static constexpr const size_t NUM_SIZE_CLASSES = 48;
+	static constexpr const uint16_t UNTAGGED = 0;
+
+      public:
+	static constexpr bool enabled() {
+#ifdef NEURODIDACTIC_ALLOCATION_TELEMETRY
+	  return true;
+#else
+	  return false;
+#endif
+	}
+
+	// Returns the tag with the given name, creating it if needed.
+	// Once MAX_TAGS tags exist, new names share the last tag.
+	static uint16_t tag(const std::string& name) {
+	  State& s = state_();
+	  std::unique_lock<std::mutex> lock(s.mutex);
+	  auto i = s.index.find(name);
+	  if (i != s.index.end()) {
+	    return i->second;
+	  }
+	  if (s.names.size() < MAX_TAGS - 1) {
+	    const uint16_t t = uint16_t(s.names.size());
+	    s.names.push_back(name);
+	    s.index.insert(std::make_pair(name, t));
+	    return t;
+	  }
+	  if (s.names.size() == MAX_TAGS - 1) {
+	    s.names.push_back("(other tags)");
+	  }
+	  return uint16_t(MAX_TAGS - 1);
+	}
+
+	// Returns the tag named "region layerId", e.g. "forward 3".  Each
+	// thread remembers the tags it has looked up by the address of
+	// "region," which should be a string literal, so layers pay for
+	// tag() only the first time they run on a thread.
+	static uint16_t layerTag(const char* region, uint32_t layerId) {
+	  LayerTag& cached = layerTags_()[
+	      (((uintptr_t)region >> 3) ^ layerId) % LAYER_TAG_CACHE_SIZE
+	  ];
+	  if ((cached.region != region) || (cached.layerId != layerId)) {
+	    cached.tag = tag(std::string(region) + " " +
+			     std::to_string(layerId));
+	    cached.region = region;
+	    cached.layerId = layerId;
+	  }
+	  return cached.tag;
+	}
+
+	static uint16_t currentTag() { return currentTag_(); }
+
+	static void recordAllocation(uint16_t tag, size_t bytes) {
+	  State& s = state_();
+	  s.total.allocate(bytes);
+	  s.tags[tag].allocate(bytes);
+	}
+
+	static void recordRelease(uint16_t tag, size_t bytes) {
+	  State& s = state_();
+	  s.total.release(bytes);
+	  s.tags[tag].release(bytes);
+	}
+
+	static AllocationCounters totals() {
+	  return state_().total.snapshot("(all)");
+	}
+
+	static AllocationCounters counters(uint16_t tag) {
+	  State& s = state_();
+	  return s.tags[tag].snapshot(tagName_(tag));
+	}
+
+	static AllocationCounters counters(const std::string& name) {
+	  return counters(tag(name));
+	}
+
+	// Returns the counters of every tag that has allocated anything
+	static std::vector<AllocationCounters> countersByTag() {
+	  State& s = state_();
+	  std::vector<AllocationCounters> result;
+	  size_t numTags;
+	  {
+	    std::unique_lock<std::mutex> lock(s.mutex);
+	    numTags = s.names.size();
+	  }
+	  for (size_t t = 0; t < numTags; ++t) {
+	    if (s.tags[t].numAllocations.load(std::memory_order_relaxed)) {
+	      result.push_back(counters(uint16_t(t)));
+	    }
+	  }
+	  return result;
+	}
+
+	// Zeroes the cumulative counters and restarts the peaks from the
+	// bytes that are live now.  Live counts are kept, so arrays that
+	// are still alive are accounted for when they are released.
+	static void reset() {
+	  State& s = state_();
+	  s.total.reset();
+	  for (Counters& c : s.tags) {
+	    c.reset();
+	  }
+	}
+
+	static void write(std::ostream& out) {
+	  std::vector<AllocationCounters> rows = countersByTag();
+	  rows.push_back(totals());
+	  out << std::left << std::setw(40) << "tag" << std::right
+	      << std::setw(12) << "allocs" << std::setw(12) << "releases"
+	      << std::setw(10) << "live" << std::setw(16) << "live bytes"
+	      << std::setw(16) << "peak bytes" << std::setw(18)
+	      << "total bytes" << "\n";
+	  for (const AllocationCounters& c : rows) {
+	    out << std::left << std::setw(40) << c.tag << std::right
+		<< std::setw(12) << c.numAllocations
+		<< std::setw(12) << c.numReleases
+		<< std::setw(10) << c.liveArrays
+		<< std::setw(16) << c.liveBytes
+		<< std::setw(16) << c.peakBytes
+		<< std::setw(18) << c.totalBytes << "\n";
+	  }
+	  out.flush();
+	}
+
+	static size_t sizeClass(size_t bytes) {
+	  if (bytes < 2) {
+	    return 0;
+	  }
+	  return std::min(size_t(63 - __builtin_clzll(bytes)),
+			  NUM_SIZE_CLASSES - 1);
+	}
+
+      private:
+	static constexpr const size_t LAYER_TAG_CACHE_SIZE = 256;
+
+	struct LayerTag {
+	  const char* region;
+	  uint32_t layerId;
+	  uint16_t tag;
+	};
+
+	struct Counters {
+	  std::atomic<uint64_t> numAllocations;
+	  std::atomic<uint64_t> numReleases;
+	  std::atomic<uint64_t> liveArrays;
+	  std::atomic<uint64_t> liveBytes;
+	  std::atomic<uint64_t> peakBytes;
+	  std::atomic<uint64_t> totalBytes;
+	  std::atomic<uint64_t> sizeClasses[NUM_SIZE_CLASSES];
+
+	  Counters():
+	      numAllocations(0), numReleases(0), liveArrays(0),
+	      liveBytes(0), peakBytes(0), totalBytes(0) {
+	    for (auto& c : sizeClasses) {
+	      c.store(0, std::memory_order_relaxed);
+	    }
+	  }
+
+	  void allocate(size_t bytes) {
+	    const std::memory_order relaxed = std::memory_order_relaxed;
+	    numAllocations.fetch_add(1, relaxed);
+	    liveArrays.fetch_add(1, relaxed);
+	    totalBytes.fetch_add(bytes, relaxed);
+	    sizeClasses[sizeClass(bytes)].fetch_add(1, relaxed);
+
+	    const uint64_t live = liveBytes.fetch_add(bytes, relaxed) + bytes;
+	    uint64_t peak = peakBytes.load(relaxed);
+	    while ((live > peak) &&
+		   !peakBytes.compare_exchange_weak(peak, live, relaxed)) {
+	    }
+	  }
+
+	  void release(size_t bytes) {
+	    const std::memory_order relaxed = std::memory_order_relaxed;
+	    numReleases.fetch_add(1, relaxed);
+	    liveArrays.fetch_sub(1, relaxed);
+	    liveBytes.fetch_sub(bytes, relaxed);
+	  }
+
+	  void reset() {
+	    const std::memory_order relaxed = std::memory_order_relaxed;
+	    numAllocations.store(0, relaxed);
+	    numReleases.store(0, relaxed);
+	    totalBytes.store(0, relaxed);
+	    peakBytes.store(liveBytes.load(relaxed), relaxed);
+	    for (auto& c : sizeClasses) {
+	      c.store(0, relaxed);
+	    }
+	  }
+
+	  AllocationCounters snapshot(const std::string& tag) const {
+	    const std::memory_order relaxed = std::memory_order_relaxed;
+	    AllocationCounters c;
+	    c.tag = tag;
+	    c.numAllocations = numAllocations.load(relaxed);
+	    c.numReleases = numReleases.load(relaxed);
+	    c.liveArrays = liveArrays.load(relaxed);
+	    c.liveBytes = liveBytes.load(relaxed);
+	    c.peakBytes = peakBytes.load(relaxed);
+	    c.totalBytes = totalBytes.load(relaxed);
+	    c.allocationsBySizeClass.reserve(NUM_SIZE_CLASSES);
+	    for (const auto& n : sizeClasses) {
+	      c.allocationsBySizeClass.push_back(n.load(relaxed));
+	    }
+	    return c;
+	  }
+	};
+
+	struct State {
+	  Counters total;
+	  Counters tags[MAX_TAGS];
+	  std::mutex mutex;
+	  std::vector<std::string> names;
+	  std::unordered_map<std::string, uint16_t> index;
+
+	  State(): total(), tags(), mutex(), names(1, "(untagged)"),
+		   index() {
+	  }
+	};
+
+	// Never destroyed, so arrays released by static destructors can
+	// still be counted
+	static State& state_() {
+	  static State* state = new State();
+	  return *state;
+	}
+
+	static uint16_t& currentTag_() {
+	  static thread_local uint16_t tag = UNTAGGED;
+	  return tag;
+	}
+
+	// Direct-mapped, so a collision only costs a call to tag()
+	static LayerTag* layerTags_() {
+	  static thread_local LayerTag tags[LAYER_TAG_CACHE_SIZE] = { };
+	  return tags;
+	}
+
+	static std::string tagName_(uint16_t tag) {
+	  State& s = state_();
+	  std::unique_lock<std::mutex> lock(s.mutex);
+	  return (tag < s.names.size()) ? s.names[tag] : std::string();
+	}
+
+	friend class AllocationScope;
+      };
+
+      // Charges the allocations made on this thread during its lifetime
+      // to a tag.  Scopes nest; the innermost one wins.
+      class AllocationScope {
+      public:
+	explicit AllocationScope(uint16_t tag):
+	    previous_(AllocationTelemetry::currentTag_()) {
+	  AllocationTelemetry::currentTag_() = tag;
+	}
+
+	explicit AllocationScope(const std::string& name):
+	    AllocationScope(AllocationTelemetry::tag(name)) {
+	}
+
+	// Tags the scope with layerTag(region, layerId), e.g. "forward 3"
+	AllocationScope(const char* region, uint32_t layerId):
+	    AllocationScope(AllocationTelemetry::layerTag(region, layerId)) {
+	}
+
+	AllocationScope(const AllocationScope&) = delete;
+	~AllocationScope() { AllocationTelemetry::currentTag_() = previous_; }
+
+	AllocationScope& operator=(const AllocationScope&) = delete;
+
+      private:
+	uint16_t previous_;
+      };
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,263 @@
+#ifndef __NEURODIDACTIC__CORE__PROFILING__KERNELACCOUNTING_HPP__
+#define __NEURODIDACTIC__CORE__PROFILING__KERNELACCOUNTING_HPP__
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+// Counts the calls, floating-point (or integer) operations and bytes of
+// every kernel in MklAdapter, and times them.  Define
+// NEURODIDACTIC_KERNEL_ACCOUNTING for the whole build to compile the
+// counting in; otherwise every NEURODIDACTIC_KERNEL_SCOPE vanishes and
+// the counters stay at zero.  Bytes are the compulsory traffic of the
+// operands, as for a roofline model: each input read once and each
+// output written once.
+#ifdef NEURODIDACTIC_KERNEL_ACCOUNTING
+#define NEURODIDACTIC_KERNEL_SCOPE(op, flops, bytes)			\
+  ::neurodidactic::core::profiling::KernelScope			\
+      neurodidacticKernelScope_(op, flops, bytes)
+#else
+#define NEURODIDACTIC_KERNEL_SCOPE(op, flops, bytes)
+#endif
+
+namespace neurodidactic {
+  namespace core {
+    namespace profiling {
+
+      enum class KernelOp {
+	ADD, SUBTRACT, MULTIPLY, DIVIDE, SCALE, AXPY, AXPBY, EXP,
+	DOT, OUTER, GEMV, GEMM, GEMV_BF16, GEMM_BF16, GEMV_F16, GEMM_F16,
+	GEMM_S8U8, QR
+      };
+
+      // Snapshot of the counters for one kernel.  Size class k counts
+      // calls that moved [2^k, 2^(k+1)) bytes.
+      struct KernelCounters {
+	KernelOp op;
+	std::string name;
+	uint64_t numCalls;
+	uint64_t flops;
+	uint64_t bytes;
+	uint64_t nanoseconds;
+	std::vector<uint64_t> callsBySizeClass;
+
+	double seconds() const { return double(nanoseconds) * 1e-9; }
+
+	double gflopsPerSecond() const {
+	  return nanoseconds ? double(flops) / double(nanoseconds) : 0.0;
+	}
+
+	double gbytesPerSecond() const {
+	  return nanoseconds ? double(bytes) / double(nanoseconds) : 0.0;
+	}
+
+	// Operations per byte, the x-axis of a roofline plot
+	double arithmeticIntensity() const {
+	  return bytes ? double(flops) / double(bytes) : 0.0;
+	}
+
+	double nanosecondsPerCall() const {
+	  return numCalls ? double(nanoseconds) / double(numCalls) : 0.0;
+	}
+      };
+
+      // Kernel counters, kept per operation with relaxed atomics.  All
+      // methods are thread-safe.
+      class KernelAccounting {
+      public:
+	static constexpr const size_t NUM_OPS =
+	    size_t(KernelOp::QR) + 1;
+	static constexpr const size_t NUM_SIZE_CLASSES = 48;
+
+      public:
+	static constexpr bool enabled() {
+#ifdef NEURODIDACTIC_KERNEL_ACCOUNTING
+	  return true;
+#else
+	  return false;
+#endif
+	}
+
+	static const char* name(KernelOp op) {
+	  static const char* NAMES[NUM_OPS] = {
+	    "add", "subtract", "multiply", "divide", "scale", "axpy",
+	    "axpby", "exp", "dot", "outer", "gemv", "gemm", "gemv bf16",
+	    "gemm bf16", "gemv f16", "gemm f16", "gemm s8u8", "qr"
+	  };
+	  return NAMES[size_t(op)];
+	}
+
+	static void record(KernelOp op, uint64_t flops, uint64_t bytes,
+			   uint64_t nanoseconds) {
+	  const std::memory_order relaxed = std::memory_order_relaxed;
+	  Counters& c = counters_()[size_t(op)];
+	  c.numCalls.fetch_add(1, relaxed);
+	  c.flops.fetch_add(flops, relaxed);
+	  c.bytes.fetch_add(bytes, relaxed);
+	  c.nanoseconds.fetch_add(nanoseconds, relaxed);
+	  c.sizeClasses[sizeClass(bytes)].fetch_add(1, relaxed);
+	}
+
+	static KernelCounters counters(KernelOp op) {
+	  const std::memory_order relaxed = std::memory_order_relaxed;
+	  const Counters& c = counters_()[size_t(op)];
+	  KernelCounters result;
+	  result.op = op;
+	  result.name = name(op);
+	  result.numCalls = c.numCalls.load(relaxed);
+	  result.flops = c.flops.load(relaxed);
+	  result.bytes = c.bytes.load(relaxed);
+	  result.nanoseconds = c.nanoseconds.load(relaxed);
+	  result.callsBySizeClass.reserve(NUM_SIZE_CLASSES);
+	  for (const auto& n : c.sizeClasses) {
+	    result.callsBySizeClass.push_back(n.load(relaxed));
+	  }
+	  return result;
+	}
+
+	// Returns the counters of every kernel that has been called
+	static std::vector<KernelCounters> countersByOp() {
+	  std::vector<KernelCounters> result;
+	  for (size_t i = 0; i < NUM_OPS; ++i) {
+	    KernelCounters c = counters(KernelOp(i));
+	    if (c.numCalls) {
+	      result.push_back(std::move(c));
+	    }
+	  }
+	  return result;
+	}
+
+	static void reset() {
+	  const std::memory_order relaxed = std::memory_order_relaxed;
+	  for (size_t i = 0; i < NUM_OPS; ++i) {
+	    Counters& c = counters_()[i];
+	    c.numCalls.store(0, relaxed);
+	    c.flops.store(0, relaxed);
+	    c.bytes.store(0, relaxed);
+	    c.nanoseconds.store(0, relaxed);
+	    for (auto& n : c.sizeClasses) {
+	      n.store(0, relaxed);
+	    }
+	  }
+	}
+
+	// Writes the achieved rates of each kernel.  Kernels far below
+	// the machine's bandwidth with few bytes per call are dominated by
+	// call overhead; those near it are memory-bound.
+	static void write(std::ostream& out) {
+	  const std::ios_base::fmtflags flags = out.flags();
+	  const std::streamsize precision = out.precision();
+	  out << std::left << std::setw(12) << "op" << std::right
+	      << std::setw(12) << "calls" << std::setw(12) << "GFLOP"
+	      << std::setw(12) << "GB" << std::setw(12) << "ms"
+	      << std::setw(12) << "GFLOP/s" << std::setw(12) << "GB/s"
+	      << std::setw(10) << "FLOP/B" << std::setw(12) << "ns/call"
+	      << std::setw(14) << "bytes/call" << "\n";
+	  out << std::fixed;
+	  for (const KernelCounters& c : countersByOp()) {
+	    out << std::left << std::setw(12) << c.name << std::right
+		<< std::setw(12) << c.numCalls << std::setprecision(3)
+		<< std::setw(12) << double(c.flops) * 1e-9
+		<< std::setw(12) << double(c.bytes) * 1e-9
+		<< std::setw(12) << c.seconds() * 1e3
+		<< std::setw(12) << c.gflopsPerSecond()
+		<< std::setw(12) << c.gbytesPerSecond()
+		<< std::setw(10) << c.arithmeticIntensity()
+		<< std::setprecision(1)
+		<< std::setw(12) << c.nanosecondsPerCall()
+		<< std::setw(14) << double(c.bytes) / double(c.numCalls)
+		<< "\n";
+	  }
+	  out.flags(flags);
+	  out.precision(precision);
+	  out.flush();
+	}
+
+	// Writes the nonzero size classes of each kernel, one line per
+	// kernel, as "2^k:count" pairs
+	static void writeSizeHistograms(std::ostream& out) {
+	  for (const KernelCounters& c : countersByOp()) {
+	    out << std::left << std::setw(12) << c.name << std::right;
+	    for (size_t k = 0; k < c.callsBySizeClass.size(); ++k) {
+	      if (c.callsBySizeClass[k]) {
+		out << " 2^" << k << ":" << c.callsBySizeClass[k];
+	      }
+	    }
+	    out << "\n";
+	  }
+	  out.flush();
+	}
+
+	static size_t sizeClass(uint64_t bytes) {
+	  if (bytes < 2) {
+	    return 0;
+	  }
+	  return std::min(size_t(63 - __builtin_clzll(bytes)),
+			  NUM_SIZE_CLASSES - 1);
+	}
+
+      private:
+	struct Counters {
+	  std::atomic<uint64_t> numCalls;
+	  std::atomic<uint64_t> flops;
+	  std::atomic<uint64_t> bytes;
+	  std::atomic<uint64_t> nanoseconds;
+	  std::atomic<uint64_t> sizeClasses[NUM_SIZE_CLASSES];
+
+	  Counters(): numCalls(0), flops(0), bytes(0), nanoseconds(0) {
+	    for (auto& c : sizeClasses) {
+	      c.store(0, std::memory_order_relaxed);
+	    }
+	  }
+	};
+
+	struct State {
+	  Counters ops[NUM_OPS];
+	};
+
+	// Never destroyed, so kernels called by static destructors can
+	// still be counted
+	static Counters* counters_() {
+	  static State* state = new State();
+	  return state->ops;
+	}
+      };
+
+      // Times one kernel call and charges it to its operation
+      class KernelScope {
+      public:
+	KernelScope(KernelOp op, uint64_t flops, uint64_t bytes):
+	    op_(op), flops_(flops), bytes_(bytes), start_(Clock::now()) {
+	}
+
+	KernelScope(const KernelScope&) = delete;
+
+	~KernelScope() {
+	  const uint64_t nanoseconds =
+	      std::chrono::duration_cast<std::chrono::nanoseconds>(
+		  Clock::now() - start_
+	      ).count();
+	  KernelAccounting::record(op_, flops_, bytes_, nanoseconds);
+	}
+
+	KernelScope& operator=(const KernelScope&) = delete;
+
+      private:
+	typedef std::chrono::steady_clock Clock;
+
+	KernelOp op_;
+	uint64_t flops_;
+	uint64_t bytes_;
+	Clock::time_point start_;
+      };
+
+    }
+  }
+}
+#endif
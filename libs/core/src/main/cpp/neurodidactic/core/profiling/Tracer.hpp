@@ -0,0 +1,329 @@
+#ifndef __NEURODIDACTIC__CORE__PROFILING__TRACER_HPP__
+#define __NEURODIDACTIC__CORE__PROFILING__TRACER_HPP__
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+// Times the forward and backward passes of the layers, the optimizer
+// updates and the nonlinearities.  Define NEURODIDACTIC_TRACING for the
+// whole build to compile the hooks in; otherwise every
+// NEURODIDACTIC_TRACE_SPAN vanishes.  Compiled-in hooks record nothing
+// until Tracer::enable() is called, and cost one relaxed atomic load
+// each while tracing is disabled.
+#ifdef NEURODIDACTIC_TRACING
+#define NEURODIDACTIC_TRACE_SPAN(...)					\
+  ::neurodidactic::core::profiling::TraceScope				\
+      neurodidacticTraceScope_(__VA_ARGS__)
+#else
+#define NEURODIDACTIC_TRACE_SPAN(...)
+#endif
+
+namespace neurodidactic {
+  namespace core {
+    namespace profiling {
+
+      // One timed region.  Times are in nanoseconds since the tracer
+      // started, and "thread" numbers the recording threads in the order
+      // they recorded their first span.
+      struct TraceSpan {
+	const char* name;
+	uint32_t layerId;
+	uint32_t thread;
+	int64_t begin;
+	int64_t end;
+      };
+
+      // Spans with the same name and layer id, aggregated
+      struct TraceSummary {
+	std::string name;
+	uint32_t layerId;
+	uint64_t numCalls;
+	double totalSeconds;
+	double minSeconds;
+	double maxSeconds;
+
+	double meanSeconds() const {
+	  return numCalls ? totalSeconds / double(numCalls) : 0.0;
+	}
+      };
+
+      // Collects spans in per-thread buffers.  A buffer is a list of
+      // fixed-size blocks that only its own thread appends to, and each
+      // block publishes its size with a release store, so recording
+      // takes no locks and spans can be read while other threads are
+      // still recording.  Span names must be string literals or
+      // otherwise outlive the tracer.
+      class Tracer {
+      public:
+	static constexpr const size_t BLOCK_SIZE = 4096;
+	static constexpr const uint32_t NO_LAYER =
+	    std::numeric_limits<uint32_t>::max();
+
+      public:
+	static constexpr bool compiledIn() {
+#ifdef NEURODIDACTIC_TRACING
+	  return true;
+#else
+	  return false;
+#endif
+	}
+
+	static bool enabled() {
+	  return enabled_().load(std::memory_order_relaxed);
+	}
+
+	static void enable() {
+	  state_();
+	  enabled_().store(true, std::memory_order_relaxed);
+	}
+
+	static void disable() {
+	  enabled_().store(false, std::memory_order_relaxed);
+	}
+
+	static int64_t now() {
+	  const Clock::time_point start = state_().start;
+	  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+	      Clock::now() - start
+	  ).count();
+	}
+
+	static void record(const char* name, uint32_t layerId,
+			   int64_t begin, int64_t end) {
+	  ThreadBuffer& buffer = threadBuffer_();
+	  Block* block = buffer.tail;
+	  size_t n = block->size.load(std::memory_order_relaxed);
+	  if (n == BLOCK_SIZE) {
+	    Block* next = new Block();
+	    block->next.store(next, std::memory_order_release);
+	    buffer.tail = block = next;
+	    n = 0;
+	  }
+	  block->spans[n] = TraceSpan{ name, layerId, buffer.thread,
+				       begin, end };
+	  block->size.store(n + 1, std::memory_order_release);
+	}
+
+	// Returns the spans recorded so far, ordered by starting time
+	static std::vector<TraceSpan> spans() {
+	  std::vector<TraceSpan> result;
+	  for (ThreadBuffer* buffer : buffers_()) {
+	    for (const Block* b = buffer->head; b;
+		 b = b->next.load(std::memory_order_acquire)) {
+	      const size_t n = b->size.load(std::memory_order_acquire);
+	      result.insert(result.end(), b->spans, b->spans + n);
+	    }
+	  }
+	  std::stable_sort(result.begin(), result.end(),
+			   [](const TraceSpan& x, const TraceSpan& y) {
+			     return x.begin < y.begin;
+			   });
+	  return result;
+	}
+
+	// Aggregates the spans by name and layer id, largest total first.
+	// Nested spans are counted in full, so a forward pass includes the
+	// time spent in its nonlinearity.
+	static std::vector<TraceSummary> summary() {
+	  std::map<std::pair<std::string, uint32_t>, TraceSummary> groups;
+	  for (const TraceSpan& span : spans()) {
+	    const double seconds = double(span.end - span.begin) * 1e-9;
+	    auto key = std::make_pair(std::string(span.name), span.layerId);
+	    auto i = groups.find(key);
+	    if (i == groups.end()) {
+	      groups.insert(std::make_pair(
+		  key, TraceSummary{ key.first, span.layerId, 1, seconds,
+				     seconds, seconds }
+	      ));
+	    } else {
+	      TraceSummary& s = i->second;
+	      ++s.numCalls;
+	      s.totalSeconds += seconds;
+	      s.minSeconds = std::min(s.minSeconds, seconds);
+	      s.maxSeconds = std::max(s.maxSeconds, seconds);
+	    }
+	  }
+
+	  std::vector<TraceSummary> result;
+	  for (const auto& g : groups) {
+	    result.push_back(g.second);
+	  }
+	  std::stable_sort(result.begin(), result.end(),
+			   [](const TraceSummary& x, const TraceSummary& y) {
+			     return x.totalSeconds > y.totalSeconds;
+			   });
+	  return result;
+	}
+
+	// Writes the spans in Chrome's trace event format, for
+	// chrome://tracing or ui.perfetto.dev
+	static void writeChromeTrace(std::ostream& out) {
+	  const std::vector<TraceSpan> all = spans();
+	  out << "{\"traceEvents\":[";
+	  for (size_t i = 0; i < all.size(); ++i) {
+	    const TraceSpan& span = all[i];
+	    out << (i ? ",\n" : "\n") << "{\"name\":\""
+		<< spanName_(span.name, span.layerId)
+		<< "\",\"cat\":\"" << span.name
+		<< "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << span.thread
+		<< ",\"ts\":" << microseconds_(span.begin)
+		<< ",\"dur\":" << microseconds_(span.end - span.begin);
+	    if (span.layerId != NO_LAYER) {
+	      out << ",\"args\":{\"layer\":" << span.layerId << "}";
+	    }
+	    out << "}";
+	  }
+	  out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	  out.flush();
+	}
+
+	static void writeSummary(std::ostream& out) {
+	  const std::vector<TraceSummary> rows = summary();
+	  out << std::left << std::setw(40) << "span" << std::right
+	      << std::setw(10) << "calls" << std::setw(14) << "total ms"
+	      << std::setw(14) << "mean us" << std::setw(14) << "min us"
+	      << std::setw(14) << "max us" << "\n";
+	  for (const TraceSummary& s : rows) {
+	    out << std::left << std::setw(40)
+		<< spanName_(s.name.c_str(), s.layerId) << std::right
+		<< std::fixed << std::setprecision(3)
+		<< std::setw(10) << s.numCalls
+		<< std::setw(14) << s.totalSeconds * 1e3
+		<< std::setw(14) << s.meanSeconds() * 1e6
+		<< std::setw(14) << s.minSeconds * 1e6
+		<< std::setw(14) << s.maxSeconds * 1e6 << "\n";
+	  }
+	  out.flush();
+	}
+
+	// Discards the recorded spans.  Must not run while other threads
+	// are recording, e.g. call it between training steps.
+	static void clear() {
+	  for (ThreadBuffer* buffer : buffers_()) {
+	    Block* b = buffer->head->next.load(std::memory_order_relaxed);
+	    while (b) {
+	      Block* next = b->next.load(std::memory_order_relaxed);
+	      delete b;
+	      b = next;
+	    }
+	    buffer->head->next.store(nullptr, std::memory_order_relaxed);
+	    buffer->head->size.store(0, std::memory_order_release);
+	    buffer->tail = buffer->head;
+	  }
+	}
+
+      private:
+	typedef std::chrono::steady_clock Clock;
+
+	struct Block {
+	  TraceSpan spans[BLOCK_SIZE];
+	  std::atomic<size_t> size;
+	  std::atomic<Block*> next;
+
+	  Block(): size(0), next(nullptr) { }
+	};
+
+	// Owned by the tracer rather than by the thread, so the spans of
+	// threads that have exited can still be written out
+	struct ThreadBuffer {
+	  uint32_t thread;
+	  Block* head;
+	  Block* tail;
+
+	  explicit ThreadBuffer(uint32_t thread_):
+	      thread(thread_), head(new Block()), tail(head) {
+	  }
+	};
+
+	struct State {
+	  Clock::time_point start;
+	  std::mutex mutex;
+	  std::vector<ThreadBuffer*> buffers;
+
+	  State(): start(Clock::now()), mutex(), buffers() { }
+	};
+
+	// Never destroyed, so threads that outlive static destruction can
+	// still record
+	static State& state_() {
+	  static State* state = new State();
+	  return *state;
+	}
+
+	static std::atomic<bool>& enabled_() {
+	  static std::atomic<bool> enabled(false);
+	  return enabled;
+	}
+
+	static ThreadBuffer& threadBuffer_() {
+	  static thread_local ThreadBuffer* buffer = nullptr;
+	  if (!buffer) {
+	    State& s = state_();
+	    std::unique_lock<std::mutex> lock(s.mutex);
+	    buffer = new ThreadBuffer(uint32_t(s.buffers.size()));
+	    s.buffers.push_back(buffer);
+	  }
+	  return *buffer;
+	}
+
+	static std::vector<ThreadBuffer*> buffers_() {
+	  State& s = state_();
+	  std::unique_lock<std::mutex> lock(s.mutex);
+	  return s.buffers;
+	}
+
+	static std::string spanName_(const char* name, uint32_t layerId) {
+	  return (layerId == NO_LAYER)
+	      ? std::string(name)
+	      : std::string(name) + " " + std::to_string(layerId);
+	}
+
+	static std::string microseconds_(int64_t nanoseconds) {
+	  std::string result = std::to_string(nanoseconds / 1000) + ".";
+	  const std::string fraction = std::to_string(nanoseconds % 1000);
+	  return result + std::string(3 - fraction.size(), '0') + fraction;
+	}
+      };
+
+      // Records the time between its construction and destruction as a
+      // span, if tracing is enabled when it is constructed
+      class TraceScope {
+      public:
+	explicit TraceScope(const char* name,
+			    uint32_t layerId = Tracer::NO_LAYER):
+	    name_(name), layerId_(layerId),
+	    begin_(Tracer::enabled() ? Tracer::now() : -1) {
+	}
+
+	TraceScope(const TraceScope&) = delete;
+
+	~TraceScope() {
+	  if (begin_ >= 0) {
+	    Tracer::record(name_, layerId_, begin_, Tracer::now());
+	  }
+	}
+
+	TraceScope& operator=(const TraceScope&) = delete;
+
+      private:
+	const char* name_;
+	uint32_t layerId_;
+	int64_t begin_;
+      };
+
+    }
+  }
+}
+#endif
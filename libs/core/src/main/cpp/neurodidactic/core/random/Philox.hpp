@@ -0,0 +1,146 @@
+#ifndef __NEURODIDACTIC__CORE__RANDOM__PHILOX_HPP__
+#define __NEURODIDACTIC__CORE__RANDOM__PHILOX_HPP__
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace random {
+
+      // Philox4x32-10 counter-based generator (Salmon et al., "Parallel
+      // Random Numbers: As Easy as 1, 2, 3," SC 2011).  The generator has
+      // no state beyond its key: block "index" of stream "stream" is a
+      // pure function of the seed, the stream and the index.  A parallel
+      // loop can therefore give every element its own position in a
+      // stream and get the same numbers however the loop is split across
+      // threads, without any generator state per thread.
+      //
+      // Each block is four 32-bit words, and the word at position i of a
+      // stream is word i % 4 of block i / 4.  The rounds are a few 32x32
+      // bit multiplies and xors with no branches, and generate() runs
+      // them on several blocks side by side so they vectorize.
+      class Philox4x32 {
+      public:
+	typedef std::array<uint32_t, 4> BlockType;
+
+	static constexpr const size_t WORDS_PER_BLOCK = 4;
+
+      public:
+	explicit Philox4x32(uint64_t seed):
+	    key0_(uint32_t(seed)), key1_(uint32_t(seed >> 32)) {
+	}
+
+	uint64_t seed() const {
+	  return (uint64_t(key1_) << 32) | key0_;
+	}
+
+	BlockType operator()(uint64_t stream, uint64_t index) const {
+	  return block(uint32_t(index), uint32_t(index >> 32),
+		       uint32_t(stream), uint32_t(stream >> 32));
+	}
+
+	// The ten rounds on one counter
+	BlockType block(uint32_t c0, uint32_t c1, uint32_t c2,
+			uint32_t c3) const {
+	  uint32_t k0 = key0_, k1 = key1_;
+	  for (int r = 0; r < 10; ++r) {
+	    const uint64_t p0 = uint64_t(M0) * c0;
+	    const uint64_t p1 = uint64_t(M1) * c2;
+	    c0 = uint32_t(p1 >> 32) ^ c1 ^ k0;
+	    c2 = uint32_t(p0 >> 32) ^ c3 ^ k1;
+	    c1 = uint32_t(p1);
+	    c3 = uint32_t(p0);
+	    k0 += W0;
+	    k1 += W1;
+	  }
+	  return BlockType{{ c0, c1, c2, c3 }};
+	}
+
+	// Writes words [first, first + n) of "stream" to out[0..n)
+	void generate(uint64_t stream, uint64_t first, size_t n,
+		      uint32_t* out) const {
+	  const size_t wordsPerRun = LANES * WORDS_PER_BLOCK;
+	  uint64_t index = first / WORDS_PER_BLOCK;
+	  size_t skip = first % WORDS_PER_BLOCK;
+
+	  if (skip) {
+	    const BlockType b = (*this)(stream, index++);
+	    for (; (skip < WORDS_PER_BLOCK) && n; ++skip, --n) {
+	      *out++ = b[skip];
+	    }
+	  }
+	  for (; n >= wordsPerRun; n -= wordsPerRun, out += wordsPerRun) {
+	    blocks_(stream, index, out);
+	    index += LANES;
+	  }
+	  while (n) {
+	    const BlockType b = (*this)(stream, index++);
+	    for (size_t i = 0; (i < WORDS_PER_BLOCK) && n; ++i, --n) {
+	      *out++ = b[i];
+	    }
+	  }
+	}
+
+	// Uniform on [0, 1) with the 24 bits a float can hold
+	static float toUniform(uint32_t word) {
+	  return float(word >> 8) * (1.0f / 16777216.0f);
+	}
+
+	// Uniform on (0, 1], which can be passed to log()
+	static float toOpenUniform(uint32_t word) {
+	  return float((word >> 8) + 1) * (1.0f / 16777216.0f);
+	}
+
+      private:
+	static constexpr const uint32_t M0 = 0xD2511F53;
+	static constexpr const uint32_t M1 = 0xCD9E8D57;
+	static constexpr const uint32_t W0 = 0x9E3779B9;
+	static constexpr const uint32_t W1 = 0xBB67AE85;
+
+	// Blocks computed side by side by generate()
+	static constexpr const size_t LANES = 8;
+
+	uint32_t key0_;
+	uint32_t key1_;
+
+	// Writes blocks [index, index + LANES) of "stream" to
+	// out[0..LANES * WORDS_PER_BLOCK).  The counters are kept one word
+	// per array, so each round is the same few operations on LANES
+	// independent lanes and the compiler turns it into vector code.
+	void blocks_(uint64_t stream, uint64_t index, uint32_t* out) const {
+	  uint32_t c0[LANES], c1[LANES], c2[LANES], c3[LANES];
+	  uint32_t k0 = key0_, k1 = key1_;
+
+	  for (size_t l = 0; l < LANES; ++l) {
+	    c0[l] = uint32_t(index + l);
+	    c1[l] = uint32_t((index + l) >> 32);
+	    c2[l] = uint32_t(stream);
+	    c3[l] = uint32_t(stream >> 32);
+	  }
+	  for (int r = 0; r < 10; ++r) {
+	    for (size_t l = 0; l < LANES; ++l) {
+	      const uint64_t p0 = uint64_t(M0) * c0[l];
+	      const uint64_t p1 = uint64_t(M1) * c2[l];
+	      c0[l] = uint32_t(p1 >> 32) ^ c1[l] ^ k0;
+	      c2[l] = uint32_t(p0 >> 32) ^ c3[l] ^ k1;
+	      c1[l] = uint32_t(p1);
+	      c3[l] = uint32_t(p0);
+	    }
+	    k0 += W0;
+	    k1 += W1;
+	  }
+	  for (size_t l = 0; l < LANES; ++l) {
+	    out[WORDS_PER_BLOCK * l] = c0[l];
+	    out[WORDS_PER_BLOCK * l + 1] = c1[l];
+	    out[WORDS_PER_BLOCK * l + 2] = c2[l];
+	    out[WORDS_PER_BLOCK * l + 3] = c3[l];
+	  }
+	}
+      };
+
+    }
+  }
+}
+#endif
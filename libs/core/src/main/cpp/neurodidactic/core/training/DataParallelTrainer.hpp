@@ -0,0 +1,351 @@
+#ifndef __NEURODIDACTIC__CORE__TRAINING__DATAPARALLELTRAINER_HPP__
+#define __NEURODIDACTIC__CORE__TRAINING__DATAPARALLELTRAINER_HPP__
+
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/arrays/MklAllocator.hpp>
+#include <neurodidactic/core/arrays/detail/MklAdapter.hpp>
+#include <neurodidactic/core/optimizers/ForwardStateMap.hpp>
+#include <neurodidactic/core/optimizers/GradientAccumulator.hpp>
+#include <neurodidactic/core/parallel/SpinBarrier.hpp>
+#include <neurodidactic/core/parallel/ThreadPool.hpp>
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <mkl.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace training {
+
+      // Splits each minibatch into one shard per worker thread.  Every
+      // worker runs forward and backward propagation on its shard with
+      // its own ForwardStateMap, collecting gradients in its own
+      // GradientAccumulator.  The accumulators are then summed in place
+      // with a pairwise tree reduction that is split into cache-sized
+      // chunks spread across the workers.  Sparse updates are gathered
+      // from the other workers by the first, and the mean gradient is
+      // handed to the optimizer once.  The calling thread acts as
+      // worker 0.
+      //
+      // The step function is called as
+      //
+      //   Field f(const BatchType& inputs, const BatchType& targets,
+      //           ForwardStateType& forwardState,
+      //           AccumulatorType& gradients)
+      //
+      // and returns the total (not the mean) loss over its shard.  The
+      // workers share the layers, so their step functions must only read
+      // them.  Layers whose training forward pass writes to them, such as
+      // BatchNormLayer, offer one that does not and merge what it found
+      // from forwardStates() after step() returns.
+      template <typename Field,
+		typename Allocator = arrays::MklAllocator<Field, 64> >
+      class DataParallelTrainer {
+      public:
+	typedef arrays::MdArray<2, Field, Allocator> BatchType;
+	typedef optimizers::ForwardStateMap<Field, Allocator>
+		ForwardStateType;
+	typedef optimizers::GradientAccumulator<Field, Allocator>
+		AccumulatorType;
+
+	static constexpr const size_t REDUCTION_CHUNK_SIZE = 4096;
+
+      public:
+	explicit DataParallelTrainer(size_t numThreads,
+				     const Allocator& allocator = Allocator()):
+	    numThreads_(std::max(numThreads, size_t(1))),
+	    allocator_(allocator), barrier_(numThreads_),
+	    forwardStates_(numThreads_), accumulators_(numThreads_),
+	    shardInputs_(numThreads_), shardTargets_(numThreads_),
+	    losses_(numThreads_, Field(0)), errors_(numThreads_),
+	    participants_(), chunks_(), reduce_(false), job_(),
+	    mutex_(), jobReady_(), jobDone_(), generation_(0), busy_(0),
+	    stop_(false), workers_() {
+	  for (size_t i = 1; i < numThreads_; ++i) {
+	    workers_.emplace_back([this, i]() { this->workerLoop_(i); });
+	  }
+	}
+
+	DataParallelTrainer(const DataParallelTrainer&) = delete;
+
+	~DataParallelTrainer() noexcept {
+	  {
+	    std::unique_lock<std::mutex> lock(mutex_);
+	    stop_ = true;
+	    ++generation_;
+	  }
+	  jobReady_.notify_all();
+	  for (auto& t : workers_) {
+	    t.join();
+	  }
+	}
+
+	size_t numThreads() const { return numThreads_; }
+
+	// The forward states of the workers that ran the last step, which
+	// keep their shards' inputs and activations until the next one.
+	// Layers that gather batch statistics, such as BatchNormLayer,
+	// merge them from these once step() returns.
+	std::vector<const ForwardStateType*> forwardStates() const {
+	  std::vector<const ForwardStateType*> states;
+	  states.reserve(participants_.size());
+	  for (size_t w : participants_) {
+	    states.push_back(&forwardStates_[w]);
+	  }
+	  return states;
+	}
+
+	template <typename StepFunction, typename Optimizer>
+	Field step(const BatchType& inputs, const BatchType& targets,
+		   StepFunction stepFunction, Optimizer& optimizer) {
+	  const size_t batchSize = inputs.dimensions()[0];
+	  if (targets.dimensions()[0] != batchSize) {
+	    std::ostringstream msg;
+	    msg << "Array \"targets\" has dimensions "
+		<< targets.dimensions() << ", but its first dimension "
+		<< "should match the batch size of " << batchSize;
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+	  if (!batchSize) {
+	    return Field(0);
+	  }
+
+	  {
+	    // A worker may still be returning from the previous job after
+	    // the last barrier, so wait for all of them before replacing it
+	    std::unique_lock<std::mutex> lock(mutex_);
+	    jobDone_.wait(lock, [this]() { return !busy_; });
+	    std::fill(errors_.begin(), errors_.end(), nullptr);
+	    job_ = [&, this](size_t worker) {
+	      this->runStep_(worker, inputs, targets, stepFunction);
+	    };
+	    busy_ = numThreads_ - 1;
+	    ++generation_;
+	  }
+	  jobReady_.notify_all();
+
+	  if (numThreads_ > 1) {
+	    parallel::SerialRegion serial;
+	    const int mklThreads = mkl_set_num_threads_local(1);
+	    job_(0);
+	    mkl_set_num_threads_local(mklThreads);
+	  } else {
+	    job_(0);
+	  }
+
+	  auto failed = std::find_if(
+	      errors_.begin(), errors_.end(),
+	      [](const std::exception_ptr& e) { return bool(e); }
+	  );
+	  if (failed != errors_.end()) {
+	    std::exception_ptr e = *failed;
+	    std::fill(errors_.begin(), errors_.end(), nullptr);
+	    std::rethrow_exception(e);
+	  }
+	  if (!reduce_) {
+	    throw pistis::exceptions::IllegalValueError(
+		"Workers produced gradients for different parameters",
+		PISTIS_EX_HERE
+	    );
+	  }
+
+	  AccumulatorType& total = accumulators_[participants_.front()];
+	  for (size_t i = 1; i < participants_.size(); ++i) {
+	    total.accumulateSparse(accumulators_[participants_[i]]);
+	  }
+
+	  Field loss(0);
+	  for (Field l : losses_) {
+	    loss += l;
+	  }
+	  total.scale(Field(1) / Field(batchSize));
+	  total.apply(optimizer);
+	  return loss / Field(batchSize);
+	}
+
+	DataParallelTrainer& operator=(const DataParallelTrainer&) = delete;
+
+      private:
+	struct Chunk {
+	  size_t entry;
+	  size_t offset;
+	  size_t size;
+
+	  Chunk(size_t entry_, size_t offset_, size_t size_):
+	      entry(entry_), offset(offset_), size(size_) {
+	  }
+	};
+
+	const size_t numThreads_;
+	Allocator allocator_;
+	parallel::SpinBarrier barrier_;
+	std::vector<ForwardStateType> forwardStates_;
+	std::vector<AccumulatorType> accumulators_;
+	std::vector< std::unique_ptr<BatchType> > shardInputs_;
+	std::vector< std::unique_ptr<BatchType> > shardTargets_;
+	std::vector<Field> losses_;
+	std::vector<std::exception_ptr> errors_;
+	std::vector<size_t> participants_;
+	std::vector<Chunk> chunks_;
+	bool reduce_;
+	std::function<void (size_t)> job_;
+	std::mutex mutex_;
+	std::condition_variable jobReady_;
+	std::condition_variable jobDone_;
+	uint64_t generation_;
+	size_t busy_;
+	bool stop_;
+	std::vector<std::thread> workers_;
+
+	void workerLoop_(size_t worker) {
+	  parallel::SerialRegion serial;
+	  uint64_t lastGeneration = 0;
+	  mkl_set_num_threads_local(1);
+	  while (true) {
+	    {
+	      std::unique_lock<std::mutex> lock(mutex_);
+	      jobReady_.wait(lock, [this, lastGeneration]() {
+		  return generation_ != lastGeneration;
+	      });
+	      lastGeneration = generation_;
+	      if (stop_) {
+		return;
+	      }
+	    }
+	    job_(worker);
+	    {
+	      std::unique_lock<std::mutex> lock(mutex_);
+	      --busy_;
+	    }
+	    jobDone_.notify_all();
+	  }
+	}
+
+	template <typename StepFunction>
+	void runStep_(size_t worker, const BatchType& inputs,
+		      const BatchType& targets, StepFunction& stepFunction) {
+	  const size_t batchSize = inputs.dimensions()[0];
+	  const size_t begin = worker * batchSize / numThreads_;
+	  const size_t end = (worker + 1) * batchSize / numThreads_;
+
+	  losses_[worker] = Field(0);
+	  if (begin < end) {
+	    try {
+	      BatchType& shardInputs =
+		  shard_(shardInputs_[worker], inputs, begin, end);
+	      BatchType& shardTargets =
+		  shard_(shardTargets_[worker], targets, begin, end);
+	      forwardStates_[worker].reset();
+	      accumulators_[worker].clear();
+	      losses_[worker] = stepFunction(shardInputs, shardTargets,
+					     forwardStates_[worker],
+					     accumulators_[worker]);
+	    } catch(...) {
+	      errors_[worker] = std::current_exception();
+	    }
+	  }
+
+	  barrier_.wait();
+	  if (!worker) {
+	    planReduction_(batchSize);
+	  }
+	  barrier_.wait();
+	  if (reduce_) {
+	    for (size_t c = worker; c < chunks_.size(); c += numThreads_) {
+	      reduceChunk_(chunks_[c]);
+	    }
+	  }
+	  barrier_.wait();
+	}
+
+	BatchType& shard_(std::unique_ptr<BatchType>& buffer,
+			  const BatchType& batch, size_t begin,
+			  size_t end) {
+	  const size_t rowSize = batch.leadingDimension();
+	  const uint32_t numRows = end - begin;
+	  if (!buffer || (buffer->dimensions()[0] != numRows) ||
+	      (buffer->leadingDimension() != rowSize)) {
+	    buffer.reset(new BatchType(
+		typename BatchType::DimensionListType(
+		    batch.dimensions().replace(0, numRows)
+		),
+		allocator_
+	    ));
+	  }
+	  std::copy_n(batch.data() + begin * rowSize, numRows * rowSize,
+		      buffer->data());
+	  return *buffer;
+	}
+
+	void planReduction_(size_t batchSize) {
+	  participants_.clear();
+	  for (size_t w = 0; w < numThreads_; ++w) {
+	    const bool hasRows =
+		(w * batchSize / numThreads_) <
+		    ((w + 1) * batchSize / numThreads_);
+	    if (hasRows && !errors_[w]) {
+	      participants_.push_back(w);
+	    }
+	  }
+
+	  reduce_ = !participants_.empty();
+	  for (size_t w : participants_) {
+	    if (!accumulators_[w].compatibleWith(
+		     accumulators_[participants_.front()])) {
+	      reduce_ = false;
+	    }
+	  }
+
+	  chunks_.clear();
+	  if (reduce_) {
+	    const AccumulatorType& first =
+		accumulators_[participants_.front()];
+	    for (size_t i = 0; i < first.numEntries(); ++i) {
+	      for (size_t offset = 0;
+		   offset < first.gradientSize(i);
+		   offset += REDUCTION_CHUNK_SIZE) {
+		chunks_.push_back(Chunk(
+		    i, offset,
+		    std::min(size_t(REDUCTION_CHUNK_SIZE),
+			     first.gradientSize(i) - offset)
+		));
+	      }
+	    }
+	  }
+	}
+
+	void reduceChunk_(const Chunk& chunk) {
+	  typedef arrays::detail::MklAdapter<Field, Field> MklAdapter;
+	  const size_t n = participants_.size();
+
+	  for (size_t stride = 1; stride < n; stride *= 2) {
+	    for (size_t i = 0; i + stride < n; i += 2 * stride) {
+	      Field* p = accumulators_[participants_[i]]
+			     .gradient(chunk.entry) + chunk.offset;
+	      const Field* q = accumulators_[participants_[i + stride]]
+				   .gradient(chunk.entry) + chunk.offset;
+	      MklAdapter::add(chunk.size, p, q, p);
+	    }
+	  }
+	}
+      };
+
+      template <typename Field, typename Allocator>
+      constexpr const size_t
+	  DataParallelTrainer<Field, Allocator>::REDUCTION_CHUNK_SIZE;
+
+    }
+  }
+}
+#endif
@@ -0,0 +1,172 @@
+#ifndef __NEURODIDACTIC__CORE__TRAINING__HOGWILDTRAINER_HPP__
+#define __NEURODIDACTIC__CORE__TRAINING__HOGWILDTRAINER_HPP__
+
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/arrays/MklAllocator.hpp>
+#include <neurodidactic/core/optimizers/ForwardStateMap.hpp>
+#include <neurodidactic/core/parallel/ThreadPool.hpp>
+#include <pistis/exceptions/ExceptionOrigin.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <mkl.h>
+
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+namespace neurodidactic {
+  namespace core {
+    namespace training {
+
+      // Asynchronous ("Hogwild") training.  The samples of an epoch are
+      // split into one contiguous range per thread, and every thread
+      // trains on its own range in minibatches of "updateSize" samples,
+      // handing its gradients straight to the shared optimizer.  There is
+      // no synchronization between threads until the end of the epoch,
+      // so the optimizer must tolerate concurrent calls to update()
+      // (e.g. HogwildSgdOptimizer).  Threads read the weights while
+      // others write them; this is the usual Hogwild trade of
+      // occasionally stale or lost updates for throughput.
+      //
+      // The step function is called as
+      //
+      //   Field f(const BatchType& inputs, const BatchType& targets,
+      //           ForwardStateType& forwardState, Optimizer& optimizer)
+      //
+      // and returns the total loss over its minibatch.
+      template <typename Field,
+		typename Allocator = arrays::MklAllocator<Field, 64> >
+      class HogwildTrainer {
+      public:
+	typedef arrays::MdArray<2, Field, Allocator> BatchType;
+	typedef optimizers::ForwardStateMap<Field, Allocator>
+		ForwardStateType;
+
+      public:
+	explicit HogwildTrainer(size_t numThreads, size_t updateSize = 1,
+				const Allocator& allocator = Allocator()):
+	    numThreads_(std::max(numThreads, size_t(1))),
+	    updateSize_(std::max(updateSize, size_t(1))),
+	    allocator_(allocator) {
+	}
+	HogwildTrainer(const HogwildTrainer&) = delete;
+
+	size_t numThreads() const { return numThreads_; }
+	size_t updateSize() const { return updateSize_; }
+
+	// Trains on every row of "inputs" once and returns the mean loss
+	template <typename StepFunction, typename Optimizer>
+	Field epoch(const BatchType& inputs, const BatchType& targets,
+		    StepFunction stepFunction, Optimizer& optimizer) {
+	  const size_t numSamples = inputs.dimensions()[0];
+	  if (targets.dimensions()[0] != numSamples) {
+	    std::ostringstream msg;
+	    msg << "Array \"targets\" has dimensions "
+		<< targets.dimensions() << ", but its first dimension "
+		<< "should match the number of samples (" << numSamples
+		<< ")";
+	    throw pistis::exceptions::IllegalValueError(msg.str(),
+							PISTIS_EX_HERE);
+	  }
+
+	  std::vector<Field> losses(numThreads_, Field(0));
+	  std::vector<std::exception_ptr> errors(numThreads_);
+	  std::vector<std::thread> threads;
+
+	  threads.reserve(numThreads_ - 1);
+	  for (size_t w = 1; w < numThreads_; ++w) {
+	    threads.emplace_back([&, w]() {
+		parallel::SerialRegion serial;
+		mkl_set_num_threads_local(1);
+		this->run_(w, inputs, targets, stepFunction, optimizer,
+			   losses[w], errors[w]);
+	    });
+	  }
+
+	  if (numThreads_ > 1) {
+	    parallel::SerialRegion serial;
+	    const int mklThreads = mkl_set_num_threads_local(1);
+	    run_(0, inputs, targets, stepFunction, optimizer, losses[0],
+		 errors[0]);
+	    mkl_set_num_threads_local(mklThreads);
+	  } else {
+	    run_(0, inputs, targets, stepFunction, optimizer, losses[0],
+		 errors[0]);
+	  }
+	  for (auto& t : threads) {
+	    t.join();
+	  }
+
+	  for (auto& error : errors) {
+	    if (error) {
+	      std::rethrow_exception(error);
+	    }
+	  }
+
+	  Field loss(0);
+	  for (Field l : losses) {
+	    loss += l;
+	  }
+	  return numSamples ? loss / Field(numSamples) : Field(0);
+	}
+
+	HogwildTrainer& operator=(const HogwildTrainer&) = delete;
+
+      private:
+	const size_t numThreads_;
+	const size_t updateSize_;
+	Allocator allocator_;
+
+	template <typename StepFunction, typename Optimizer>
+	void run_(size_t worker, const BatchType& inputs,
+		  const BatchType& targets, StepFunction& stepFunction,
+		  Optimizer& optimizer, Field& loss,
+		  std::exception_ptr& error) {
+	  const size_t numSamples = inputs.dimensions()[0];
+	  const size_t begin = worker * numSamples / numThreads_;
+	  const size_t end = (worker + 1) * numSamples / numThreads_;
+	  ForwardStateType forwardState;
+	  std::unique_ptr<BatchType> batchInputs;
+	  std::unique_ptr<BatchType> batchTargets;
+
+	  try {
+	    for (size_t i = begin; i < end; i += updateSize_) {
+	      const size_t n = std::min(updateSize_, end - i);
+	      forwardState.reset();
+	      loss += stepFunction(
+		  rows_(batchInputs, inputs, i, n),
+		  rows_(batchTargets, targets, i, n),
+		  forwardState, optimizer
+	      );
+	    }
+	  } catch(...) {
+	    error = std::current_exception();
+	  }
+	}
+
+	BatchType& rows_(std::unique_ptr<BatchType>& buffer,
+			 const BatchType& source, size_t begin,
+			 size_t numRows) {
+	  const size_t rowSize = source.leadingDimension();
+	  if (!buffer || (buffer->dimensions()[0] != numRows) ||
+	      (buffer->leadingDimension() != rowSize)) {
+	    buffer.reset(new BatchType(
+		typename BatchType::DimensionListType(
+		    source.dimensions().replace(0, (uint32_t)numRows)
+		),
+		allocator_
+	    ));
+	  }
+	  std::copy_n(source.data() + begin * rowSize, numRows * rowSize,
+		      buffer->data());
+	  return *buffer;
+	}
+      };
+
+    }
+  }
+}
+#endif
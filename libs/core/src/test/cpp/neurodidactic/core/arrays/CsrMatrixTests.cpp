@@ -0,0 +1,153 @@
+#include <neurodidactic/core/arrays/CsrMatrix.hpp>
+#include <neurodidactic/core/arrays/detail/SparseKernels.hpp>
+#include <neurodidactic/testing/MdArrayVerification.hpp>
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::testing;
+namespace detail = neurodidactic::core::arrays::detail;
+namespace ex = pistis::exceptions;
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<2, float> FloatMatrix;
+  typedef CsrMatrix<float> SparseMatrix;
+
+  const std::vector<float> DENSE_DATA{ 1.0f, 0.0f, 0.0f, 2.0f,
+				       0.0f, 0.0f, 0.0f, 0.0f,
+				       0.0f, -3.0f, 0.5f, 0.0f };
+
+  FloatMatrix createDense() {
+    return FloatMatrix({ 3, 4 }, DENSE_DATA.begin());
+  }
+}
+
+TEST(CsrMatrixTests, CreateFromDense) {
+  const SparseMatrix m(createDense());
+  const std::vector<uint64_t> trueOffsets{ 0, 2, 2, 4 };
+  const std::vector<uint32_t> trueColumns{ 0, 3, 1, 2 };
+  const std::vector<float> trueValues{ 1.0f, 2.0f, -3.0f, 0.5f };
+
+  EXPECT_EQ(SparseMatrix::DimensionListType({ 3, 4 }), m.dimensions());
+  EXPECT_EQ(3, m.numRows());
+  EXPECT_EQ(4, m.numColumns());
+  ASSERT_EQ(4, m.numNonZeros());
+  EXPECT_DOUBLE_EQ(8.0 / 12.0, m.sparsity());
+  EXPECT_EQ(trueOffsets,
+	    std::vector<uint64_t>(m.rowOffsets(), m.rowOffsets() + 4));
+  EXPECT_EQ(trueColumns,
+	    std::vector<uint32_t>(m.columns(), m.columns() + 4));
+  EXPECT_EQ(trueValues, std::vector<float>(m.values(), m.values() + 4));
+  EXPECT_TRUE(verifyMdArray({ 3, 4 }, DENSE_DATA, m.toDense()));
+}
+
+TEST(CsrMatrixTests, CreateWithThreshold) {
+  const SparseMatrix m(createDense(), 0.5f);
+  const std::vector<float> trueValues{ 1.0f, 2.0f, -3.0f };
+
+  ASSERT_EQ(3, m.numNonZeros());
+  EXPECT_EQ(trueValues, std::vector<float>(m.values(), m.values() + 3));
+}
+
+TEST(CsrMatrixTests, CreateEmpty) {
+  const SparseMatrix m(SparseMatrix::DimensionListType({ 2, 5 }));
+
+  EXPECT_EQ(0, m.numNonZeros());
+  EXPECT_DOUBLE_EQ(1.0, m.sparsity());
+  EXPECT_TRUE(verifyMdArray({ 2, 5 }, std::vector<float>(10, 0.0f),
+			    m.toDense()));
+  EXPECT_THROW(SparseMatrix(SparseMatrix::DimensionListType({ 2, 5, 1 })),
+	       ex::IllegalValueError);
+}
+
+TEST(CsrMatrixTests, InnerProduct) {
+  const SparseMatrix m(createDense());
+  const FloatVector v({ 4 }, { 1.0f, 2.0f, 3.0f, 4.0f });
+
+  EXPECT_TRUE(verifyMdArray({ 3 }, { 9.0f, 0.0f, -4.5f },
+			    m.innerProduct(v)));
+  EXPECT_THROW(m.innerProduct(FloatVector({ 3 }, 1.0f)),
+	       ex::IllegalValueError);
+}
+
+TEST(CsrMatrixTests, TransposeMatrixProduct) {
+  FloatMatrix dense({ 37, 50 }, 0.0f);
+  FloatMatrix batch({ 19, 50 }, 0.0f);
+  for (size_t i = 0; i < dense.size(); ++i) {
+    dense.data()[i] = (i % 7) ? 0.0f : std::sin(float(i));
+  }
+  for (size_t i = 0; i < batch.size(); ++i) {
+    batch.data()[i] = std::cos(float(i));
+  }
+
+  const SparseMatrix m(dense);
+  const FloatMatrix result = m.transposeMatrixProduct(batch);
+  ASSERT_EQ(FloatMatrix::DimensionListType({ 19, 37 }), result.dimensions());
+  for (size_t b = 0; b < 19; ++b) {
+    for (size_t i = 0; i < 37; ++i) {
+      float truth = 0.0f;
+      for (size_t j = 0; j < 50; ++j) {
+	truth += dense.data()[i * 50 + j] * batch.data()[b * 50 + j];
+      }
+      EXPECT_NEAR(truth, result.data()[b * 37 + i], 1e-5f);
+    }
+  }
+  EXPECT_THROW(m.transposeMatrixProduct(FloatMatrix({ 2, 49 }, 1.0f)),
+	       ex::IllegalValueError);
+}
+
+TEST(CsrMatrixTests, Sparsity) {
+  EXPECT_DOUBLE_EQ(8.0 / 12.0, sparsity(createDense()));
+  EXPECT_DOUBLE_EQ(0.0, sparsity(FloatVector({ 3 }, 1.0f)));
+}
+
+TEST(CsrMatrixTests, RowChunksBalanceNonZeros) {
+  typedef detail::CsrKernels Kernels;
+  // 1000 rows with 100 nonzeros each, then 99000 empty rows
+  const size_t m = 100000;
+  std::vector<uint64_t> rowOffsets(m + 1);
+  for (size_t i = 0; i <= m; ++i) {
+    rowOffsets[i] = 100 * std::min(i, size_t(1000));
+  }
+
+  // 4 * 100000 units of work make 12 chunks of about 8333 nonzeros.
+  // The last chunk also gets all the empty rows.
+  const size_t numChunks = Kernels::numRowChunks(m, rowOffsets[m], 4);
+  ASSERT_EQ(12, numChunks);
+  EXPECT_EQ(0, Kernels::rowChunkBegin(m, rowOffsets.data(), 0, numChunks));
+  EXPECT_EQ(m, Kernels::rowChunkBegin(m, rowOffsets.data(), numChunks,
+				      numChunks));
+  for (size_t c = 0; c < numChunks; ++c) {
+    const size_t begin =
+	Kernels::rowChunkBegin(m, rowOffsets.data(), c, numChunks);
+    const size_t end =
+	Kernels::rowChunkBegin(m, rowOffsets.data(), c + 1, numChunks);
+    EXPECT_LT(begin, end);
+    EXPECT_NEAR(8333.0, double(rowOffsets[end] - rowOffsets[begin]), 100.0)
+	<< "for chunk " << c;
+  }
+
+  // Every row is visited once
+  std::vector<int> visits(m, 0);
+  std::mutex mutex;
+  Kernels::forRowChunks(m, rowOffsets.data(), 4,
+			[&](size_t begin, size_t end) {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (size_t i = begin; i < end; ++i) {
+      ++visits[i];
+    }
+  });
+  EXPECT_EQ(std::vector<int>(m, 1), visits);
+
+  // Small matrices make one chunk, and empty ones make no calls
+  EXPECT_EQ(1, Kernels::numRowChunks(m, 10, 4));
+  size_t calls = 0;
+  Kernels::forRowChunks(0, rowOffsets.data(), 1,
+			[&](size_t, size_t) { ++calls; });
+  EXPECT_EQ(0, calls);
+}
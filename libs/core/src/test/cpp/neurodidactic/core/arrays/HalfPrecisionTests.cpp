@@ -0,0 +1,117 @@
+#include <neurodidactic/core/arrays/HalfPrecision.hpp>
+#include <neurodidactic/core/arrays/detail/MklAdapter.hpp>
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using namespace neurodidactic::core::arrays;
+
+namespace {
+  template <typename Half>
+  void verifyMatrixProducts(float tolerance) {
+    typedef detail::MklAdapter<Half, Half> Adapter;
+    const size_t m = 3;
+    const size_t n = 70000;  // Longer than one conversion panel
+    std::vector<Half> x(m * n);
+    std::vector<Half> v(n);
+    std::vector<float> expected(m, 0.0f);
+    std::vector<float> y(m);
+
+    for (size_t j = 0; j < n; ++j) {
+      v[j] = Half(float(j % 5) * 0.25f);
+    }
+    for (size_t i = 0; i < m; ++i) {
+      for (size_t j = 0; j < n; ++j) {
+	x[i * n + j] = Half((float(i + 1) - float(j % 3)) * 0.5f);
+	expected[i] += float(x[i * n + j]) * float(v[j]);
+      }
+    }
+
+    Adapter::multiplyMatrixByVector(m, n, x.data(), v.data(), y.data());
+    for (size_t i = 0; i < m; ++i) {
+      EXPECT_NEAR(expected[i], y[i], tolerance * std::fabs(expected[i]));
+    }
+
+    // x (m x n) times the transpose of a 2 x n matrix made of v and -v
+    std::vector<Half> u(2 * n);
+    std::vector<float> z(m * 2);
+    for (size_t j = 0; j < n; ++j) {
+      u[j] = v[j];
+      u[n + j] = Half(-float(v[j]));
+    }
+    Adapter::multiplyMatrixByMatrixTranspose(m, 2, n, x.data(), u.data(),
+					     z.data());
+    for (size_t i = 0; i < m; ++i) {
+      EXPECT_NEAR(expected[i], z[2 * i], tolerance * std::fabs(expected[i]));
+      EXPECT_NEAR(-expected[i], z[2 * i + 1],
+		  tolerance * std::fabs(expected[i]));
+    }
+  }
+}
+
+TEST(HalfPrecisionTests, BFloat16Conversion) {
+  EXPECT_EQ(0x3F80, BFloat16(1.0f).bits());
+  EXPECT_EQ(0xC000, BFloat16(-2.0f).bits());
+  EXPECT_EQ(1.0f, float(BFloat16(1.0f)));
+  EXPECT_EQ(3.140625f, float(BFloat16(3.14159f)));
+
+  // Ties round to even
+  EXPECT_EQ(0x3F80, BFloat16(1.00390625f).bits());
+  EXPECT_EQ(0x3F82, BFloat16(1.01171875f).bits());
+
+  EXPECT_TRUE(std::isinf(float(BFloat16(INFINITY))));
+  EXPECT_TRUE(std::isnan(float(BFloat16(NAN))));
+  EXPECT_FALSE(std::isinf(float(BFloat16(3.0e38f))));
+}
+
+TEST(HalfPrecisionTests, Float16Conversion) {
+  EXPECT_EQ(0x3C00, Float16(1.0f).bits());
+  EXPECT_EQ(0xC000, Float16(-2.0f).bits());
+  EXPECT_EQ(0x7BFF, Float16(65504.0f).bits());
+  EXPECT_EQ(65504.0f, float(Float16(65504.0f)));
+  EXPECT_EQ(0.099975586f, float(Float16(0.1f)));
+
+  // Ties round to even
+  EXPECT_EQ(0x3C00, Float16(1.00048828125f).bits());
+  EXPECT_EQ(0x3C02, Float16(1.00146484375f).bits());
+
+  // Denormals
+  EXPECT_EQ(0x0001, Float16(5.9604645e-8f).bits());
+  EXPECT_EQ(5.9604645e-8f, float(Float16::fromBits(0x0001)));
+  EXPECT_EQ(0x0000, Float16(1.0e-9f).bits());
+  EXPECT_EQ(0x8000, Float16(-0.0f).bits());
+
+  EXPECT_EQ(0x7C00, Float16(70000.0f).bits());
+  EXPECT_EQ(0xFC00, Float16(-INFINITY).bits());
+  EXPECT_TRUE(std::isinf(float(Float16(1.0e10f))));
+  EXPECT_TRUE(std::isnan(float(Float16(NAN))));
+}
+
+TEST(HalfPrecisionTests, ConvertArrays) {
+  std::vector<float> source(100000);
+  std::vector<BFloat16> bf16(source.size());
+  std::vector<Float16> fp16(source.size());
+  std::vector<float> target(source.size());
+
+  for (size_t i = 0; i < source.size(); ++i) {
+    source[i] = float(i % 256) - 128.0f;
+  }
+
+  convert(source.size(), source.data(), bf16.data());
+  convert(bf16.size(), bf16.data(), target.data());
+  EXPECT_EQ(source, target);
+
+  convert(source.size(), source.data(), fp16.data());
+  convert(fp16.size(), fp16.data(), target.data());
+  EXPECT_EQ(source, target);
+}
+
+TEST(HalfPrecisionTests, BFloat16MatrixProducts) {
+  verifyMatrixProducts<BFloat16>(1.0e-4f);
+}
+
+TEST(HalfPrecisionTests, Float16MatrixProducts) {
+  verifyMatrixProducts<Float16>(1.0e-4f);
+}
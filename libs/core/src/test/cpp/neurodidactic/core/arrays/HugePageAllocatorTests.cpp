@@ -0,0 +1,63 @@
+#include <neurodidactic/core/arrays/HugePageAllocator.hpp>
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+
+using namespace neurodidactic::core::arrays;
+
+namespace {
+  typedef HugePageAllocator<float> FloatAllocator;
+}
+
+TEST(HugePageAllocatorTests, SmallAllocationsUseHeap) {
+  FloatAllocator allocator(1024 * 1024);
+  const size_t n = 1000;
+  float* p = allocator.allocate(n);
+
+  ASSERT_NE(nullptr, p);
+  EXPECT_EQ(0, (uintptr_t)p % FloatAllocator::MEMORY_ALIGNMENT);
+  for (size_t i = 0; i < n; ++i) {
+    p[i] = float(i);
+  }
+  allocator.deallocate(p, n);
+}
+
+TEST(HugePageAllocatorTests, LargeAllocationsUseHugePages) {
+  FloatAllocator allocator(1024 * 1024);
+  const size_t n = 3 * 1024 * 1024 / sizeof(float) + 5;
+  float* p = allocator.allocate(n);
+
+  ASSERT_NE(nullptr, p);
+  EXPECT_EQ(0, (uintptr_t)p % FloatAllocator::HUGE_PAGE_SIZE);
+  for (size_t i = 0; i < n; ++i) {
+    ASSERT_EQ(0.0f, p[i]);
+    p[i] = float(i);
+  }
+  EXPECT_EQ(float(n - 1), p[n - 1]);
+  allocator.deallocate(p, n);
+}
+
+TEST(HugePageAllocatorTests, RebindKeepsThreshold) {
+  FloatAllocator allocator(12345);
+  FloatAllocator::rebind<uint32_t>::other rebound(allocator);
+
+  EXPECT_EQ(12345, rebound.threshold());
+  EXPECT_EQ(FloatAllocator::DEFAULT_THRESHOLD, FloatAllocator().threshold());
+  EXPECT_TRUE(allocator == rebound);
+  EXPECT_TRUE(allocator != FloatAllocator());
+}
+
+TEST(HugePageAllocatorTests, UseWithArrays) {
+  typedef MdArray<2, float, FloatAllocator> Matrix;
+  typedef MdArray<1, float, FloatAllocator> Vector;
+  FloatAllocator allocator(64 * 1024);
+
+  Matrix m({ 1024, 256 }, 1.0f, allocator);
+  Vector x({ 256 }, 2.0f, allocator);
+  Vector y = m.innerProduct(x);
+
+  EXPECT_EQ(0, (uintptr_t)m.data() % FloatAllocator::HUGE_PAGE_SIZE);
+  EXPECT_EQ(512.0f, y.data()[0]);
+  EXPECT_EQ(512.0f, y.data()[1023]);
+}
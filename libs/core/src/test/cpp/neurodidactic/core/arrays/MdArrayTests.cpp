@@ -864,3 +864,92 @@ TEST(MdArrayTests, Ref) {
   EXPECT_EQ(a.data(), r.data());
   EXPECT_EQ(a.end(), r.end());
 }
+
+TEST(MdArrayTests, Map) {
+  TestAllocator allocator("TEST_1");
+  TestFloatMatrix small({ 2, 3 }, { 1.0f, -2.0f, 3.0f, -4.0f, 5.0f, -6.0f },
+                        allocator);
+  TestFloatMatrix smallSquares = small.map([](float x) { return x * x; });
+
+  EXPECT_EQ(small.dimensions(), smallSquares.dimensions());
+  for (size_t i = 0; i < small.size(); ++i) {
+    EXPECT_EQ(small.data()[i] * small.data()[i], smallSquares.data()[i]);
+  }
+
+  // Large enough to be split across the thread pool
+  FloatMatrix large({ 300, 1001 }, 0.0f);
+  for (size_t i = 0; i < large.size(); ++i) {
+    large.data()[i] = float(i % 1000);
+  }
+  FloatMatrix doubled = large.map([](float x) { return 2.0f * x; });
+  large.mapInPlace([](float x) { return x + 1.0f; }, 1024);
+
+  for (size_t i = 0; i < large.size(); ++i) {
+    ASSERT_EQ(float(2 * (i % 1000)), doubled.data()[i]) << "at " << i;
+    ASSERT_EQ(float(i % 1000 + 1), large.data()[i]) << "at " << i;
+  }
+
+  TestFloatMatrix wrong({ 3, 2 }, allocator);
+  EXPECT_THROW(small.map([](float x) { return x; }, wrong),
+               pistis::exceptions::IllegalValueError);
+}
+
+TEST(MdArrayTests, WrapExternalData) {
+  std::vector<float> data{ 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f };
+  std::vector<float*> released;
+  {
+    FloatMatrix a = FloatMatrix::wrap(
+	{ 2, 3 }, data.data(),
+	[&released](float* p) { released.push_back(p); }
+    );
+    FloatMatrix::RefType r = a.ref();
+
+    EXPECT_FALSE(a.ownsData());
+    EXPECT_EQ(data.data(), a.data());
+    EXPECT_TRUE(verifyArray({ 2, 3 }, data, a));
+
+    // Operations work in place on the external data
+    a.multiplyInPlace(2.0f);
+    EXPECT_EQ(4.0f, data[1]);
+
+    // Copies own their data
+    FloatMatrix copy(a);
+    EXPECT_TRUE(copy.ownsData());
+    EXPECT_NE(data.data(), copy.data());
+    EXPECT_TRUE(verifyArray({ 2, 3 },
+			    { 2.0f, 4.0f, 6.0f, 8.0f, 10.0f, 12.0f }, copy));
+
+    // The data is released when the last reference goes away
+    a = FloatMatrix({ 1, 1 }, 0.0f);
+    EXPECT_TRUE(released.empty());
+    EXPECT_TRUE(verifyArray({ 2, 3 },
+			    { 2.0f, 4.0f, 6.0f, 8.0f, 10.0f, 12.0f }, r));
+  }
+  ASSERT_EQ(1, released.size());
+  EXPECT_EQ(data.data(), released[0]);
+}
+
+TEST(MdArrayTests, WrapWithoutRelease) {
+  float data[] = { 1.0f, 2.0f, 3.0f };
+  {
+    FloatVector v = FloatVector::wrap({ 3 }, data);
+    EXPECT_FALSE(v.ownsData());
+    v.addInPlace(FloatVector({ 3 }, 1.0f));
+  }
+  EXPECT_EQ(2.0f, data[0]);
+  EXPECT_EQ(4.0f, data[2]);
+  EXPECT_THROW(FloatVector::wrap({ 3 }, nullptr),
+	       pistis::exceptions::IllegalValueError);
+}
+
+TEST(MdArrayTests, WrapWithOwner) {
+  std::shared_ptr<std::vector<float>> buffer =
+      std::make_shared<std::vector<float>>(4, 1.0f);
+  FloatVector::RefType r =
+      FloatVector::RefType::wrap({ 4 }, buffer->data(), buffer);
+
+  EXPECT_EQ(2, buffer.use_count());
+  EXPECT_FALSE(r.ownsData());
+  buffer.reset();
+  EXPECT_TRUE(verifyArray({ 4 }, { 1.0f, 1.0f, 1.0f, 1.0f }, r));
+}
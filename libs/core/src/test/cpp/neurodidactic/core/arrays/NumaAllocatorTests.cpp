@@ -0,0 +1,117 @@
+#include <neurodidactic/core/arrays/NumaAllocator.hpp>
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/layers/FullyConnectedLayer.hpp>
+#include <neurodidactic/core/layers/Nonlinearities.hpp>
+#include <pistis/exceptions/IllegalValueError.hpp>
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <vector>
+#include <stdint.h>
+
+using namespace neurodidactic::core::arrays;
+namespace detail = neurodidactic::core::arrays::detail;
+namespace ex = pistis::exceptions;
+
+namespace {
+  template <typename Allocator>
+  void verifyAllocation(Allocator& allocator, size_t n) {
+    float* p = allocator.allocate(n);
+    ASSERT_NE(nullptr, p);
+    EXPECT_EQ(0, (uintptr_t)p % Allocator::MEMORY_ALIGNMENT);
+    for (size_t i = 0; i < n; ++i) {
+      p[i] = float(i);
+    }
+    EXPECT_EQ(float(n - 1), p[n - 1]);
+    allocator.deallocate(p, n);
+  }
+}
+
+TEST(NumaAllocatorTests, OnlineNodes) {
+  EXPECT_GE(detail::numNumaNodes(), 1);
+  EXPECT_GE(detail::currentNumaNode(), 0);
+}
+
+TEST(NumaAllocatorTests, AllocateWithEachPolicy) {
+  NumaAllocator<float, numa::NodeLocal> local;
+  NumaAllocator<float, numa::Interleaved> interleaved;
+  NumaAllocator<float, numa::FirstTouchByWorker> firstTouch;
+  const size_t large = 3 * 1024 * 1024 + 7;
+
+  verifyAllocation(local, 100);
+  verifyAllocation(local, large);
+  verifyAllocation(interleaved, 100);
+  verifyAllocation(interleaved, large);
+  verifyAllocation(firstTouch, 100);
+  verifyAllocation(firstTouch, large);
+}
+
+TEST(NumaAllocatorTests, FirstTouchMemoryIsZeroed) {
+  NumaAllocator<float, numa::FirstTouchByWorker> allocator;
+  const size_t n = 1024 * 1024;
+  float* p = allocator.allocate(n);
+
+  for (size_t i = 0; i < n; ++i) {
+    ASSERT_EQ(0.0f, p[i]) << "at " << i;
+  }
+  allocator.deallocate(p, n);
+}
+
+TEST(NumaAllocatorTests, RejectNodesThatDoNotExist) {
+  const size_t large = 1024 * 1024;
+  for (int node : { -1, detail::maxNumaNode() + 1, 1024, 5000 }) {
+    NumaAllocator<float, numa::NodeLocal> allocator{ numa::NodeLocal(node) };
+    EXPECT_THROW(allocator.allocate(large), ex::IllegalValueError)
+	<< "for node " << node;
+  }
+
+  NumaAllocator<float, numa::NodeLocal> allocator{
+      numa::NodeLocal(detail::maxNumaNode())
+  };
+  verifyAllocation(allocator, large);
+}
+
+TEST(NumaAllocatorTests, NodeWorkersRunOnTheirNodes) {
+  detail::NumaNodeWorkers& workers = detail::NumaNodeWorkers::instance();
+  std::vector<int> nodes(workers.nodes().size(), -1);
+
+  ASSERT_EQ(detail::onlineNumaNodes(), workers.nodes());
+  workers.run([&nodes](size_t i) { nodes[i] = detail::currentNumaNode(); });
+  EXPECT_EQ(workers.nodes(), nodes);
+
+  EXPECT_THROW(workers.run([](size_t) { throw std::runtime_error("x"); }),
+	       std::runtime_error);
+  workers.run([&nodes](size_t i) { nodes[i] = -1; });
+  EXPECT_EQ(std::vector<int>(nodes.size(), -1), nodes);
+}
+
+TEST(NumaAllocatorTests, RebindKeepsPolicy) {
+  typedef NumaAllocator<float, numa::NodeLocal> FloatAllocator;
+  typedef FloatAllocator::rebind<uint32_t>::other IntAllocator;
+  FloatAllocator allocator{ numa::NodeLocal(0) };
+  IntAllocator rebound(allocator);
+
+  EXPECT_EQ(0, rebound.policy().node());
+  EXPECT_TRUE(allocator == rebound);
+  EXPECT_TRUE(allocator != FloatAllocator(numa::NodeLocal(1)));
+}
+
+TEST(NumaAllocatorTests, UseWithArraysAndLayers) {
+  namespace nl = neurodidactic::core::layers::nonlinearities;
+  typedef NumaAllocator<float, numa::Interleaved> Allocator;
+  typedef MdArray<2, float, Allocator> Matrix;
+  typedef MdArray<1, float, Allocator> Vector;
+  typedef neurodidactic::core::layers::FullyConnectedLayer<
+      float, nl::Identity, Allocator
+  > Layer;
+
+  Matrix big({ 512, 512 }, 2.0f);
+  Vector x({ 512 }, 1.0f);
+  Vector y = big.innerProduct(x);
+  EXPECT_EQ(1024.0f, y.data()[0]);
+  EXPECT_EQ(1024.0f, y.data()[511]);
+
+  Layer layer(1, Matrix({ 2, 512 }, 1.0f), Vector({ 2 }, 0.5f));
+  Vector z = layer.forward(x);
+  EXPECT_EQ(512.5f, z.data()[0]);
+}
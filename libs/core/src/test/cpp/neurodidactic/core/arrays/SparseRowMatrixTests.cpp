@@ -0,0 +1,68 @@
+#include <neurodidactic/core/arrays/SparseRowMatrix.hpp>
+#include <neurodidactic/testing/MdArrayVerification.hpp>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::testing;
+namespace ex = pistis::exceptions;
+
+namespace {
+  typedef SparseRowMatrix<float> FloatSparseRowMatrix;
+}
+
+TEST(SparseRowMatrixTests, Create) {
+  const std::vector<float> first{ 1.0f, 2.0f };
+  const std::vector<float> second{ -1.0f, 0.5f };
+  FloatSparseRowMatrix m(1000000, 2);
+
+  EXPECT_EQ(1000000, m.numRows());
+  EXPECT_EQ(2, m.rowSize());
+  EXPECT_EQ(0, m.numNonZeroRows());
+
+  m.append(17, first.data());
+  m.append(999999, second.data());
+  ASSERT_EQ(2, m.numNonZeroRows());
+  EXPECT_EQ(std::vector<uint32_t>({ 17, 999999 }),
+	    std::vector<uint32_t>(m.indices(), m.indices() + 2));
+  EXPECT_EQ(first, std::vector<float>(m.row(0), m.row(0) + 2));
+  EXPECT_EQ(second, std::vector<float>(m.row(1), m.row(1) + 2));
+
+  m.clear();
+  EXPECT_EQ(0, m.numNonZeroRows());
+}
+
+TEST(SparseRowMatrixTests, AppendRejectsBadIndices) {
+  const std::vector<float> row{ 1.0f, 2.0f };
+  FloatSparseRowMatrix m(5, 2);
+
+  m.append(3, row.data());
+  EXPECT_THROW(m.append(3, row.data()), ex::IllegalValueError);
+  EXPECT_THROW(m.append(1, row.data()), ex::IllegalValueError);
+  EXPECT_THROW(m.append(5, row.data()), ex::IllegalValueError);
+  EXPECT_EQ(1, m.numNonZeroRows());
+}
+
+TEST(SparseRowMatrixTests, SumRows) {
+  const std::vector<uint32_t> indices{ 4, 1, 4, 0, 1 };
+  const std::vector<float> rows{ 1.0f, 2.0f,
+				 3.0f, 4.0f,
+				 5.0f, 6.0f,
+				 7.0f, 8.0f,
+				 9.0f, 10.0f };
+  const FloatSparseRowMatrix m = FloatSparseRowMatrix::sumRows(
+      6, 2, indices.size(), indices.data(), rows.data()
+  );
+
+  ASSERT_EQ(3, m.numNonZeroRows());
+  EXPECT_EQ(std::vector<uint32_t>({ 0, 1, 4 }),
+	    std::vector<uint32_t>(m.indices(), m.indices() + 3));
+  EXPECT_TRUE(verifyMdArray({ 6, 2 },
+			    { 7.0f, 8.0f, 12.0f, 14.0f, 0.0f, 0.0f,
+			      0.0f, 0.0f, 6.0f, 8.0f, 0.0f, 0.0f },
+			    m.toDense()));
+  EXPECT_THROW(FloatSparseRowMatrix::sumRows(4, 2, indices.size(),
+					     indices.data(), rows.data()),
+	       ex::IllegalValueError);
+}
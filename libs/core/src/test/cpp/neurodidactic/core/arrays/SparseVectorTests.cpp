@@ -0,0 +1,77 @@
+#include <neurodidactic/core/arrays/SparseVector.hpp>
+#include <neurodidactic/testing/MdArrayVerification.hpp>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::testing;
+namespace ex = pistis::exceptions;
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef SparseVector<float> FloatSparseVector;
+}
+
+TEST(SparseVectorTests, Create) {
+  const FloatSparseVector v(1000000, { 3, 17, 999999 },
+			    { 1.0f, 0.5f, -2.0f });
+  const std::vector<uint32_t> trueIndices{ 3, 17, 999999 };
+  const std::vector<float> trueValues{ 1.0f, 0.5f, -2.0f };
+
+  EXPECT_EQ(1000000, v.size());
+  ASSERT_EQ(3, v.numNonZeros());
+  EXPECT_EQ(trueIndices,
+	    std::vector<uint32_t>(v.indices(), v.indices() + 3));
+  EXPECT_EQ(trueValues, std::vector<float>(v.values(), v.values() + 3));
+
+  const FloatSparseVector empty(10);
+  EXPECT_EQ(10, empty.size());
+  EXPECT_EQ(0, empty.numNonZeros());
+}
+
+TEST(SparseVectorTests, CreateFromIterators) {
+  const std::vector<uint32_t> indices{ 1, 4 };
+  const std::vector<float> values{ 2.0f, 3.0f };
+  const FloatSparseVector v(5, 2, indices.begin(), values.begin());
+
+  EXPECT_TRUE(verifyMdArray({ 5 }, { 0.0f, 2.0f, 0.0f, 0.0f, 3.0f },
+			    v.toDense()));
+}
+
+TEST(SparseVectorTests, CreateWithInvalidIndices) {
+  EXPECT_THROW(FloatSparseVector(5, { 1, 5 }, { 1.0f, 1.0f }),
+	       ex::IllegalValueError);
+  EXPECT_THROW(FloatSparseVector(5, { 2, 1 }, { 1.0f, 1.0f }),
+	       ex::IllegalValueError);
+  EXPECT_THROW(FloatSparseVector(5, { 2, 2 }, { 1.0f, 1.0f }),
+	       ex::IllegalValueError);
+  EXPECT_THROW(FloatSparseVector(5, { 1, 2 }, { 1.0f }),
+	       ex::IllegalValueError);
+}
+
+TEST(SparseVectorTests, AppendAndClear) {
+  FloatSparseVector v(8);
+
+  v.append(2, 1.0f);
+  v.append(6, -1.0f);
+  EXPECT_THROW(v.append(6, 1.0f), ex::IllegalValueError);
+  EXPECT_TRUE(verifyMdArray({ 8 },
+			    { 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, -1.0f,
+			      0.0f },
+			    v.toDense()));
+
+  v.clear();
+  EXPECT_EQ(0, v.numNonZeros());
+  v.append(0, 3.0f);
+  EXPECT_EQ(1, v.numNonZeros());
+}
+
+TEST(SparseVectorTests, InnerProduct) {
+  const FloatSparseVector v(4, { 0, 3 }, { 2.0f, -1.0f });
+  const FloatVector u({ 4 }, { 1.0f, 2.0f, 3.0f, 4.0f });
+
+  EXPECT_EQ(-2.0f, v.innerProduct(u));
+  EXPECT_THROW(v.innerProduct(FloatVector({ 3 }, 1.0f)),
+	       ex::IllegalValueError);
+}
@@ -0,0 +1,173 @@
+#include <neurodidactic/core/io/BatchPrefetcher.hpp>
+#include <neurodidactic/core/io/DatasetWriter.hpp>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::io;
+namespace ex = pistis::exceptions;
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MappedDataset<float> Dataset;
+  typedef BatchPrefetcher<float> Prefetcher;
+
+  const uint32_t NUM_EXAMPLES = 50;
+
+  class TemporaryFile {
+  public:
+    TemporaryFile(): name_("/tmp/neurodidactic-dataset-XXXXXX") {
+      close(mkstemp(&name_[0]));
+    }
+    ~TemporaryFile() { unlink(name_.c_str()); }
+
+    const std::string& name() const { return name_; }
+
+  private:
+    std::string name_;
+  };
+
+  // Example i has inputs (i, -i) and target 10 * i
+  class TestDatasets {
+  public:
+    TestDatasets() {
+      DatasetWriter<float> inputWriter(inputFile_.name(), 2);
+      DatasetWriter<float> targetWriter(targetFile_.name(), 1);
+      for (uint32_t i = 0; i < NUM_EXAMPLES; ++i) {
+	inputWriter.append(FloatVector({ 2 }, { float(i), -float(i) }));
+	targetWriter.append(FloatVector({ 1 }, { 10.0f * i }));
+      }
+    }
+
+    Dataset inputs() const { return Dataset(inputFile_.name()); }
+    Dataset targets() const { return Dataset(targetFile_.name()); }
+
+  private:
+    TemporaryFile inputFile_;
+    TemporaryFile targetFile_;
+  };
+
+  // Returns the examples in "batch" after checking that its inputs and
+  // targets belong together
+  std::vector<uint32_t> examplesIn(const Prefetcher::Batch& batch) {
+    std::vector<uint32_t> examples;
+    for (uint32_t i = 0; i < batch.inputs.dimensions()[0]; ++i) {
+      const float* row = batch.inputs.data() + 2 * i;
+      EXPECT_EQ(-row[0], row[1]);
+      EXPECT_EQ(10.0f * row[0], batch.targets.data()[i]);
+      examples.push_back(uint32_t(row[0]));
+    }
+    return examples;
+  }
+
+  std::vector<uint32_t> readEpochs(const TestDatasets& datasets,
+				   size_t numWorkers, size_t numEpochs) {
+    Prefetcher prefetcher(datasets.inputs(), datasets.targets(), 8,
+			  numWorkers, 2, true, 17);
+    std::vector<uint32_t> examples;
+    for (size_t i = 0; i < numEpochs * prefetcher.numBatchesPerEpoch();
+	 ++i) {
+      std::vector<uint32_t> batch = examplesIn(prefetcher.next());
+      examples.insert(examples.end(), batch.begin(), batch.end());
+    }
+    return examples;
+  }
+}
+
+TEST(BatchPrefetcherTests, SequentialOrder) {
+  TestDatasets datasets;
+  Prefetcher prefetcher(datasets.inputs(), datasets.targets(), 16, 2, 3,
+			false);
+
+  EXPECT_EQ(16, prefetcher.batchSize());
+  EXPECT_EQ(3, prefetcher.ringSize());
+  EXPECT_EQ(2, prefetcher.numWorkers());
+  EXPECT_EQ(3, prefetcher.numBatchesPerEpoch());
+
+  // The last two examples do not fill a batch and are skipped
+  for (uint64_t epoch = 0; epoch < 2; ++epoch) {
+    for (size_t index = 0; index < 3; ++index) {
+      const Prefetcher::Batch& batch = prefetcher.next();
+      std::vector<uint32_t> expected(16);
+      std::iota(expected.begin(), expected.end(), uint32_t(16 * index));
+
+      EXPECT_EQ(epoch, batch.epoch);
+      EXPECT_EQ(index, batch.index);
+      EXPECT_EQ(Prefetcher::BatchType::DimensionListType({ 16, 2 }),
+		batch.inputs.dimensions());
+      EXPECT_EQ(Prefetcher::BatchType::DimensionListType({ 16, 1 }),
+		batch.targets.dimensions());
+      EXPECT_EQ(expected, examplesIn(batch));
+    }
+  }
+  EXPECT_EQ(6, prefetcher.stats().numBatches);
+}
+
+TEST(BatchPrefetcherTests, ShuffledOrder) {
+  TestDatasets datasets;
+  const std::vector<uint32_t> examples = readEpochs(datasets, 1, 2);
+  const size_t epochSize = examples.size() / 2;
+  std::vector<uint32_t> first(examples.begin(),
+			      examples.begin() + epochSize);
+  std::vector<uint32_t> second(examples.begin() + epochSize,
+			       examples.end());
+
+  // No example repeats within an epoch, and every epoch has its own order
+  EXPECT_EQ(48, epochSize);
+  EXPECT_NE(first, second);
+  std::sort(first.begin(), first.end());
+  std::sort(second.begin(), second.end());
+  EXPECT_EQ(first.end(), std::unique(first.begin(), first.end()));
+  EXPECT_EQ(second.end(), std::unique(second.begin(), second.end()));
+
+  // The order does not depend on the number of workers
+  EXPECT_EQ(examples, readEpochs(datasets, 4, 2));
+}
+
+TEST(BatchPrefetcherTests, HeldBatchIsNotOverwritten) {
+  TestDatasets datasets;
+  Prefetcher prefetcher(datasets.inputs(), datasets.targets(), 10, 2, 2,
+			false);
+  const Prefetcher::Batch& batch = prefetcher.next();
+  std::vector<uint32_t> expected(10);
+  std::iota(expected.begin(), expected.end(), uint32_t(0));
+
+  // Give the workers time to fill every free slot
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(expected, examplesIn(batch));
+
+  std::iota(expected.begin(), expected.end(), uint32_t(10));
+  EXPECT_EQ(expected, examplesIn(prefetcher.next()));
+
+  const Prefetcher::Stats stats = prefetcher.stats();
+  EXPECT_EQ(2, stats.numBatches);
+  EXPECT_LE(stats.numStalls, 2);
+  EXPECT_GE(stats.totalWaitSeconds, stats.maxWaitSeconds);
+  EXPECT_GE(stats.maxWaitSeconds, stats.meanWaitSeconds());
+}
+
+TEST(BatchPrefetcherTests, InvalidArguments) {
+  TestDatasets datasets;
+  EXPECT_THROW(Prefetcher(datasets.inputs(), datasets.targets(), 0),
+	       ex::IllegalValueError);
+  EXPECT_THROW(Prefetcher(datasets.inputs(), datasets.targets(),
+			  NUM_EXAMPLES + 1),
+	       ex::IllegalValueError);
+
+  TemporaryFile shortFile;
+  {
+    DatasetWriter<float> writer(shortFile.name(), 1);
+    writer.append(FloatVector({ 1 }, 0.0f));
+  }
+  EXPECT_THROW(Prefetcher(datasets.inputs(), Dataset(shortFile.name()), 1),
+	       ex::IllegalValueError);
+}
@@ -0,0 +1,171 @@
+#include <neurodidactic/core/io/MappedDataset.hpp>
+#include <neurodidactic/core/io/DatasetWriter.hpp>
+#include <neurodidactic/core/layers/FullyConnectedLayer.hpp>
+#include <neurodidactic/core/layers/Nonlinearities.hpp>
+#include <neurodidactic/testing/MdArrayVerification.hpp>
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using neurodidactic::testing::verifyMdArray;
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::io;
+using namespace neurodidactic::core::layers;
+namespace nl = neurodidactic::core::layers::nonlinearities;
+namespace ex = pistis::exceptions;
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<2, float> FloatMatrix;
+  typedef MappedDataset<float> Dataset;
+
+  class TemporaryFile {
+  public:
+    TemporaryFile(): name_("/tmp/neurodidactic-dataset-XXXXXX") {
+      close(mkstemp(&name_[0]));
+    }
+    ~TemporaryFile() { unlink(name_.c_str()); }
+
+    const std::string& name() const { return name_; }
+
+  private:
+    std::string name_;
+  };
+
+  // Writes 5 examples with 3 features each, where feature j of
+  // example i is 10 * i + j
+  void writeTestDataset(const std::string& filename) {
+    DatasetWriter<float> writer(filename, 3);
+    writer.append(FloatMatrix({ 2, 3 }, { 0.0f, 1.0f, 2.0f,
+					  10.0f, 11.0f, 12.0f }));
+    writer.append(FloatVector({ 3 }, { 20.0f, 21.0f, 22.0f }));
+    writer.append(FloatMatrix({ 2, 3 }, { 30.0f, 31.0f, 32.0f,
+					  40.0f, 41.0f, 42.0f }));
+    EXPECT_EQ(5, writer.numExamples());
+  }
+}
+
+TEST(MappedDatasetTests, WriteAndMap) {
+  TemporaryFile file;
+  writeTestDataset(file.name());
+  Dataset dataset(file.name());
+
+  EXPECT_EQ(5, dataset.numExamples());
+  EXPECT_EQ(3, dataset.numFeatures());
+  EXPECT_EQ(2, dataset.numBatches(3));
+  EXPECT_EQ(5, dataset.numBatches(1));
+  EXPECT_THROW(dataset.numBatches(0), ex::IllegalValueError);
+  EXPECT_EQ(0, dataset.fileSize() % DATASET_DATA_ALIGNMENT);
+  EXPECT_EQ(0, (uintptr_t)dataset.data() % DATASET_DATA_ALIGNMENT);
+  EXPECT_EQ(Dataset::AccessPattern::SEQUENTIAL, dataset.accessPattern());
+}
+
+TEST(MappedDatasetTests, SequentialBatches) {
+  TemporaryFile file;
+  writeTestDataset(file.name());
+  Dataset dataset(file.name());
+
+  const FloatMatrix& first = dataset.batch(0, 2);
+  const FloatMatrix& last = dataset.batch(4, 2);
+  EXPECT_TRUE(verifyMdArray({ 2, 3 }, { 0.0f, 1.0f, 2.0f,
+					10.0f, 11.0f, 12.0f }, first));
+  EXPECT_TRUE(verifyMdArray({ 1, 3 }, { 40.0f, 41.0f, 42.0f }, last));
+
+  // Batches refer to the mapping instead of copying it
+  EXPECT_EQ(dataset.data(), first.data());
+  EXPECT_EQ(dataset.data() + 12, last.data());
+  EXPECT_FALSE(first.ownsData());
+
+  EXPECT_THROW(dataset.batch(5, 1), ex::IllegalValueError);
+  EXPECT_THROW(dataset.batch(0, 0), ex::IllegalValueError);
+}
+
+TEST(MappedDatasetTests, BatchesOutliveDataset) {
+  TemporaryFile file;
+  writeTestDataset(file.name());
+  const FloatMatrix& batch = Dataset(file.name()).batch(1, 2);
+
+  EXPECT_TRUE(verifyMdArray({ 2, 3 }, { 10.0f, 11.0f, 12.0f,
+					20.0f, 21.0f, 22.0f }, batch));
+}
+
+TEST(MappedDatasetTests, GatherBatches) {
+  TemporaryFile file;
+  writeTestDataset(file.name());
+  Dataset dataset(file.name(), Dataset::AccessPattern::RANDOM);
+  const std::vector<uint32_t> indices{ 3, 0, 3 };
+
+  FloatMatrix batch = dataset.gather(indices);
+  EXPECT_TRUE(verifyMdArray({ 3, 3 }, { 30.0f, 31.0f, 32.0f,
+					0.0f, 1.0f, 2.0f,
+					30.0f, 31.0f, 32.0f }, batch));
+  EXPECT_TRUE(batch.ownsData());
+
+  FloatMatrix reused({ 2, 3 }, 0.0f);
+  dataset.gather(indices.begin() + 1, indices.end(), reused);
+  EXPECT_TRUE(verifyMdArray({ 2, 3 }, { 0.0f, 1.0f, 2.0f,
+					30.0f, 31.0f, 32.0f }, reused));
+
+  EXPECT_THROW(dataset.gather(indices.begin(), indices.end(), reused),
+	       ex::IllegalValueError);
+  EXPECT_THROW(dataset.gather(std::vector<uint32_t>{ 1, 5 }),
+	       ex::IllegalValueError);
+  EXPECT_THROW(dataset.gather(std::vector<uint32_t>()),
+	       ex::IllegalValueError);
+}
+
+TEST(MappedDatasetTests, ForwardBatches) {
+  typedef FullyConnectedLayer<float, nl::ReLU> Layer;
+  TemporaryFile file;
+  writeTestDataset(file.name());
+  Dataset dataset(file.name());
+  Layer layer(1, FloatMatrix({ 2, 3 }, { 1.0f, 0.0f, -1.0f,
+					 0.0f, 0.5f, 0.0f }),
+	      FloatVector({ 2 }, { 0.5f, -1.0f }));
+
+  EXPECT_TRUE(verifyMdArray({ 2, 2 }, { 0.0f, 0.0f, 0.0f, 4.5f },
+			    layer.forward(dataset.batch(0, 2))));
+  EXPECT_TRUE(verifyMdArray({ 2, 2 }, { 0.0f, 9.5f, 0.0f, 14.5f },
+			    layer.forward(dataset.batch(2, 2))));
+}
+
+TEST(MappedDatasetTests, WriteInvalidExamples) {
+  TemporaryFile file;
+  EXPECT_THROW(DatasetWriter<float>(file.name(), 0), ex::IllegalValueError);
+  EXPECT_THROW(DatasetWriter<float>("/nonexistent/dataset", 3),
+	       ex::IOError);
+
+  DatasetWriter<float> writer(file.name(), 3);
+  EXPECT_THROW(writer.append(FloatVector({ 2 }, 0.0f)),
+	       ex::IllegalValueError);
+  writer.close();
+  EXPECT_FALSE(writer.isOpen());
+  EXPECT_THROW(writer.append(FloatVector({ 3 }, 0.0f)),
+	       ex::IllegalStateError);
+
+  Dataset empty(file.name());
+  EXPECT_EQ(0, empty.numExamples());
+  EXPECT_EQ(3, empty.numFeatures());
+}
+
+TEST(MappedDatasetTests, MapInvalidFiles) {
+  TemporaryFile file;
+  EXPECT_THROW(Dataset("/nonexistent/dataset"), ex::IOError);
+  EXPECT_THROW(Dataset(file.name()), ex::IOError);
+
+  {
+    std::ofstream out(file.name(), std::ios::binary);
+    out << std::string(256, 'x');
+  }
+  EXPECT_THROW(Dataset(file.name()), ex::IOError);
+
+  writeTestDataset(file.name());
+  EXPECT_THROW(MappedDataset<double>(file.name()), ex::IllegalValueError);
+  truncate(file.name().c_str(), 64);
+  EXPECT_THROW(Dataset(file.name()), ex::IOError);
+}
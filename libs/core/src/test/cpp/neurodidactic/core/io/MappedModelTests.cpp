@@ -0,0 +1,260 @@
+#include <neurodidactic/core/io/MappedModel.hpp>
+#include <neurodidactic/core/io/FullyConnectedLayerIO.hpp>
+#include <neurodidactic/core/io/ModelWriter.hpp>
+#include <neurodidactic/core/layers/Nonlinearities.hpp>
+#include <neurodidactic/core/optimizers/ForwardStateMap.hpp>
+#include <neurodidactic/core/optimizers/SgdOptimizer.hpp>
+#include <neurodidactic/testing/MdArrayVerification.hpp>
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using neurodidactic::testing::verifyMdArray;
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::io;
+using namespace neurodidactic::core::layers;
+using namespace neurodidactic::core::optimizers;
+namespace nl = neurodidactic::core::layers::nonlinearities;
+namespace ex = pistis::exceptions;
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<2, float> FloatMatrix;
+  typedef MdArray<3, int8_t> Int8Array;
+
+  // Creates an empty temporary file that is removed when the
+  // TemporaryFile goes out of scope
+  class TemporaryFile {
+  public:
+    TemporaryFile(): name_("/tmp/neurodidactic-model-XXXXXX") {
+      close(mkstemp(&name_[0]));
+    }
+    ~TemporaryFile() { unlink(name_.c_str()); }
+
+    const std::string& name() const { return name_; }
+
+  private:
+    std::string name_;
+  };
+
+  void writeTestModel(const std::string& filename) {
+    ModelWriter writer;
+    writer.add("matrix", FloatMatrix({ 2, 3 }, { 1.0f, 2.0f, 3.0f,
+						 4.0f, 5.0f, 6.0f }));
+    writer.add("vector", FloatVector({ 1 }, { -1.0f }));
+    writer.add("bytes", Int8Array({ 2, 2, 2 }, int8_t(7)));
+    writer.write(filename);
+  }
+
+  // Rewrites entry "n" of the tensor table of a model file
+  template <typename Function>
+  void patchTensorEntry(const std::string& filename, size_t n,
+			Function patch) {
+    std::fstream file(filename,
+		      std::ios::in | std::ios::out | std::ios::binary);
+    ModelFileHeader header;
+    ModelTensorEntry entry;
+
+    file.read((char*)&header, sizeof(header));
+    const std::streamoff offset =
+	header.tableOffset + n * sizeof(ModelTensorEntry);
+    file.seekg(offset);
+    file.read((char*)&entry, sizeof(entry));
+    patch(entry);
+    file.seekp(offset);
+    file.write((const char*)&entry, sizeof(entry));
+  }
+}
+
+TEST(MappedModelTests, WriteAndMap) {
+  TemporaryFile file;
+  writeTestModel(file.name());
+  MappedModel model(file.name());
+
+  EXPECT_EQ(3, model.numTensors());
+  EXPECT_EQ(std::vector<std::string>({ "matrix", "vector", "bytes" }),
+	    model.names());
+  EXPECT_TRUE(model.contains("vector"));
+  EXPECT_FALSE(model.contains("scalar"));
+  EXPECT_EQ(0, model.fileSize() % MODEL_TENSOR_ALIGNMENT);
+
+  const FloatMatrix& m = model.tensor<2, float>("matrix");
+  const FloatVector& v = model.tensor<1, float>("vector");
+  const Int8Array& b = model.tensor<3, int8_t>("bytes");
+  EXPECT_TRUE(verifyMdArray({ 2, 3 }, { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f },
+			    m));
+  EXPECT_TRUE(verifyMdArray({ 1 }, { -1.0f }, v));
+  EXPECT_EQ(Int8Array::DimensionListType({ 2, 2, 2 }), b.dimensions());
+  EXPECT_EQ(std::vector<int8_t>(8, 7), std::vector<int8_t>(b.begin(), b.end()));
+  EXPECT_EQ(0, (uintptr_t)m.data() % MODEL_TENSOR_ALIGNMENT);
+  EXPECT_EQ(0, (uintptr_t)v.data() % MODEL_TENSOR_ALIGNMENT);
+
+  // Tensors share the mapping instead of copying it
+  EXPECT_EQ(m.data(), (model.tensor<2, float>("matrix").data()));
+}
+
+TEST(MappedModelTests, TensorsOutliveModel) {
+  TemporaryFile file;
+  writeTestModel(file.name());
+  const FloatMatrix& m =
+      MappedModel(file.name()).tensor<2, float>("matrix");
+  FloatMatrix copy(m);
+
+  EXPECT_TRUE(verifyMdArray({ 2, 3 }, { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f },
+			    m));
+  EXPECT_NE(m.data(), copy.data());
+
+  // Copies of the const tensors are arrays of their own that can be
+  // written
+  copy.data()[0] = 7.0f;
+  EXPECT_EQ(1.0f, m.data()[0]);
+}
+
+TEST(MappedModelTests, CopyOnWrite) {
+  TemporaryFile file;
+  writeTestModel(file.name());
+  {
+    MappedModel model(file.name(), MappedModel::Access::COPY_ON_WRITE);
+    FloatVector v = model.mutableTensor<1, float>("vector");
+    v.data()[0] = 5.0f;
+    EXPECT_EQ(5.0f, v.data()[0]);
+  }
+
+  MappedModel model(file.name());
+  EXPECT_TRUE(verifyMdArray({ 1 }, { -1.0f },
+			    model.tensor<1, float>("vector")));
+  EXPECT_THROW((model.mutableTensor<1, float>("vector")),
+	       ex::IllegalStateError);
+}
+
+TEST(MappedModelTests, RequestWrongTensor) {
+  TemporaryFile file;
+  writeTestModel(file.name());
+  MappedModel model(file.name());
+
+  EXPECT_THROW((model.tensor<1, float>("scalar")), ex::NoSuchItem);
+  EXPECT_THROW((model.tensor<1, float>("matrix")), ex::IllegalValueError);
+  EXPECT_THROW((model.tensor<2, double>("matrix")), ex::IllegalValueError);
+}
+
+TEST(MappedModelTests, AddInvalidTensors) {
+  ModelWriter writer;
+  writer.add("x", FloatVector({ 2 }, 0.0f));
+
+  EXPECT_THROW(writer.add("x", FloatVector({ 2 }, 0.0f)),
+	       ex::IllegalValueError);
+  EXPECT_THROW(writer.add("", FloatVector({ 2 }, 0.0f)),
+	       ex::IllegalValueError);
+  EXPECT_THROW(writer.add(std::string(64, 'a'), FloatVector({ 2 }, 0.0f)),
+	       ex::IllegalValueError);
+  EXPECT_THROW(writer.add("y", MdArray<7, float>({ 1, 1, 1, 1, 1, 1, 1 },
+						 0.0f)),
+	       ex::IllegalValueError);
+  EXPECT_THROW(writer.add("z", FloatMatrix({ 2, 0 }, 0.0f)),
+	       ex::IllegalValueError);
+  EXPECT_EQ(1, writer.numTensors());
+}
+
+TEST(MappedModelTests, MapInvalidFiles) {
+  TemporaryFile file;
+  EXPECT_THROW(MappedModel("/nonexistent/model"), ex::IOError);
+  EXPECT_THROW(MappedModel(file.name()), ex::IOError);
+
+  {
+    std::ofstream out(file.name(), std::ios::binary);
+    out << std::string(256, 'x');
+  }
+  EXPECT_THROW(MappedModel(file.name()), ex::IOError);
+
+  // Truncate a valid model
+  writeTestModel(file.name());
+  truncate(file.name().c_str(), 200);
+  EXPECT_THROW(MappedModel(file.name()), ex::IOError);
+}
+
+TEST(MappedModelTests, MapCorruptDimensions) {
+  TemporaryFile file;
+
+  // A zero dimension, with a size that agrees with it
+  writeTestModel(file.name());
+  patchTensorEntry(file.name(), 0, [](ModelTensorEntry& entry) {
+      entry.dimensions[0] = 0;
+      entry.size = 0;
+  });
+  EXPECT_THROW(MappedModel(file.name()), ex::IOError);
+
+  // 2^31 * 2^31 floats are 2^64 bytes, which is zero in 64 bits
+  writeTestModel(file.name());
+  patchTensorEntry(file.name(), 0, [](ModelTensorEntry& entry) {
+      entry.dimensions[0] = uint32_t(1) << 31;
+      entry.dimensions[1] = uint32_t(1) << 31;
+      entry.size = 0;
+  });
+  EXPECT_THROW(MappedModel(file.name()), ex::IOError);
+}
+
+TEST(MappedModelTests, SaveAndLoadFullyConnectedLayer) {
+  typedef FullyConnectedLayer<float, nl::ReLU> Layer;
+  TemporaryFile file;
+  Layer layer(3, FloatMatrix({ 2, 3 }, { 1.0f, 2.0f, 3.0f,
+					 -1.0f, 0.5f, 0.25f }),
+	      FloatVector({ 2 }, { 0.5f, -2.0f }));
+  ModelWriter writer;
+
+  addLayer(writer, "fc1", layer);
+  writer.write(file.name());
+
+  MappedModel model(file.name());
+  const Layer& loaded =
+      loadFullyConnectedLayer<float, nl::ReLU>(model, "fc1", 3);
+  const FloatVector x({ 3 }, { 1.0f, -1.0f, 2.0f });
+
+  EXPECT_EQ(3, loaded.id());
+  EXPECT_TRUE(verifyMdArray({ 2 }, { 5.5f, 0.0f }, loaded.forward(x)));
+  EXPECT_NE((model.tensor<2, float>("fc1.weights").data()),
+	    loaded.weights().data());
+
+  MappedModel copyOnWrite(file.name(), MappedModel::Access::COPY_ON_WRITE);
+  const Layer shared =
+      loadFullyConnectedLayer<float, nl::ReLU>(copyOnWrite, "fc1", 3);
+  EXPECT_EQ((copyOnWrite.tensor<2, float>("fc1.weights").data()),
+	    shared.weights().data());
+  EXPECT_THROW((loadFullyConnectedLayer<float, nl::ReLU>(model, "fc2", 1)),
+	       ex::NoSuchItem);
+}
+
+TEST(MappedModelTests, TrainLoadedLayer) {
+  typedef FullyConnectedLayer<float, nl::Identity> Layer;
+  TemporaryFile file;
+  ModelWriter writer;
+  addLayer(writer, "fc1",
+	   Layer(1, FloatMatrix({ 2, 2 }, { 1.0f, 2.0f, 3.0f, 4.0f }),
+		 FloatVector({ 2 }, 0.0f)));
+  writer.write(file.name());
+
+  for (auto access : { MappedModel::Access::READ_ONLY,
+		       MappedModel::Access::COPY_ON_WRITE }) {
+    MappedModel model(file.name(), access);
+    auto layer = loadFullyConnectedLayer<float, nl::Identity>(model, "fc1",
+							     1);
+    ForwardStateMap<float, FloatVector::AllocatorType> forwardState;
+    SgdOptimizer<float> optimizer(1.0f);
+    const FloatVector x({ 2 }, { 1.0f, -1.0f });
+
+    layer.forward(x, forwardState);
+    layer.backward(FloatVector({ 2 }, { 1.0f, 0.5f }), forwardState,
+		   optimizer);
+    EXPECT_TRUE(verifyMdArray({ 2, 2 }, { 0.0f, 3.0f, 2.5f, 4.5f },
+			      layer.weights()));
+    EXPECT_TRUE(verifyMdArray({ 2 }, { -1.0f, -0.5f }, layer.bias()));
+  }
+
+  MappedModel model(file.name());
+  EXPECT_TRUE(verifyMdArray({ 2, 2 }, { 1.0f, 2.0f, 3.0f, 4.0f },
+			    model.tensor<2, float>("fc1.weights")));
+}
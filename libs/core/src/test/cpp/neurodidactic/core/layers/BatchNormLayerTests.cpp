@@ -0,0 +1,272 @@
+#include <neurodidactic/core/layers/BatchNormLayer.hpp>
+
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/layers/Nonlinearities.hpp>
+#include <neurodidactic/core/optimizers/ForwardStateMap.hpp>
+#include <neurodidactic/core/optimizers/GradientAccumulator.hpp>
+#include <neurodidactic/testing/LayerTesting.hpp>
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+using neurodidactic::testing::expectGradientsNear;
+using neurodidactic::testing::expectNear;
+using neurodidactic::testing::randomArray;
+using neurodidactic::testing::toDouble;
+using neurodidactic::testing::weightedSum;
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::layers;
+using namespace neurodidactic::core::optimizers;
+namespace ex = pistis::exceptions;
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<2, float> FloatMatrix;
+  typedef BatchNormLayer<float> BatchNorm;
+  typedef BatchNormLayer<float, nonlinearities::Sigmoid> SigmoidBatchNorm;
+  typedef ForwardStateMap<float, MklAllocator<float, 64> > ForwardState;
+
+  // Batch normalization of a [batchSize, numFeatures] matrix in double
+  // precision, with two passes for the statistics
+  struct ReferenceBatchNorm {
+    size_t batchSize, numFeatures;
+    bool sigmoid;
+    double epsilon;
+
+    std::vector<double> mean(const std::vector<double>& x) const {
+      std::vector<double> m(numFeatures, 0.0);
+      for (size_t i = 0; i < batchSize; ++i) {
+	for (size_t j = 0; j < numFeatures; ++j) {
+	  m[j] += x[i * numFeatures + j] / batchSize;
+	}
+      }
+      return m;
+    }
+
+    std::vector<double> variance(const std::vector<double>& x) const {
+      const std::vector<double> m = mean(x);
+      std::vector<double> v(numFeatures, 0.0);
+      for (size_t i = 0; i < batchSize; ++i) {
+	for (size_t j = 0; j < numFeatures; ++j) {
+	  const double d = x[i * numFeatures + j] - m[j];
+	  v[j] += d * d / batchSize;
+	}
+      }
+      return v;
+    }
+
+    std::vector<double> forward(const std::vector<double>& x,
+				const std::vector<double>& scale,
+				const std::vector<double>& shift) const {
+      const std::vector<double> m = mean(x);
+      const std::vector<double> v = variance(x);
+      std::vector<double> y(x.size());
+      for (size_t i = 0; i < batchSize; ++i) {
+	for (size_t j = 0; j < numFeatures; ++j) {
+	  const size_t k = i * numFeatures + j;
+	  y[k] = scale[j] * (x[k] - m[j]) / std::sqrt(v[j] + epsilon) +
+		 shift[j];
+	  if (sigmoid) {
+	    y[k] = neurodidactic::testing::sigmoid(y[k]);
+	  }
+	}
+      }
+      return y;
+    }
+  };
+
+  // Compares the gradients from backward() with central differences of
+  // the reference for the loss sum(lossGradient * output)
+  template <typename Layer>
+  void testBackward(const ReferenceBatchNorm& reference, uint32_t seed) {
+    std::mt19937 rng(seed);
+    const uint32_t batchSize = reference.batchSize;
+    const uint32_t numFeatures = reference.numFeatures;
+    const FloatVector scale =
+	randomArray<FloatVector>(rng, { numFeatures }, 0.5f, 2.0f);
+    const FloatVector shift = randomArray<FloatVector>(rng, { numFeatures });
+    const FloatMatrix input =
+	randomArray<FloatMatrix>(rng, { batchSize, numFeatures });
+    const FloatMatrix lossGradient =
+	randomArray<FloatMatrix>(rng, { batchSize, numFeatures });
+    Layer layer(1, scale, shift, FloatVector({ numFeatures }, 0.0f),
+		FloatVector({ numFeatures }, 1.0f));
+    ForwardState forwardState;
+    GradientAccumulator<float> gradients;
+
+    layer.forward(input, forwardState);
+    const FloatMatrix inputGradient =
+	layer.backward(lossGradient, forwardState, gradients);
+    ASSERT_EQ(2, gradients.numEntries());
+    EXPECT_EQ(uint32_t(Layer::SCALE), gradients.paramId(0));
+    EXPECT_EQ(uint32_t(Layer::SHIFT), gradients.paramId(1));
+
+    std::vector<std::vector<double> > parameters{
+      toDouble(input.data(), input.size()),
+      toDouble(scale.data(), scale.size()),
+      toDouble(shift.data(), shift.size())
+    };
+    const std::vector<double> w =
+	toDouble(lossGradient.data(), lossGradient.size());
+    auto loss = [&]() {
+      return weightedSum(w, reference.forward(parameters[0], parameters[1],
+					      parameters[2]));
+    };
+    expectGradientsNear<float>(
+	parameters, loss,
+	{ inputGradient.data(), gradients.gradient(0),
+	  gradients.gradient(1) },
+	1e-4
+    );
+  }
+}
+
+TEST(BatchNormLayerTests, Construct) {
+  BatchNorm layer(3, 4);
+  EXPECT_EQ(3, layer.id());
+  EXPECT_EQ(4, layer.numFeatures());
+  EXPECT_FLOAT_EQ(0.1f, layer.momentum());
+  EXPECT_FLOAT_EQ(1e-5f, layer.epsilon());
+  EXPECT_EQ(std::vector<float>(4, 1.0f),
+	    std::vector<float>(layer.scale().begin(), layer.scale().end()));
+  EXPECT_EQ(std::vector<float>(4, 0.0f),
+	    std::vector<float>(layer.shift().begin(), layer.shift().end()));
+  EXPECT_EQ(std::vector<float>(4, 0.0f),
+	    std::vector<float>(layer.runningMean().begin(),
+			       layer.runningMean().end()));
+  EXPECT_EQ(std::vector<float>(4, 1.0f),
+	    std::vector<float>(layer.runningVariance().begin(),
+			       layer.runningVariance().end()));
+
+  const FloatVector ones({ 4 }, 1.0f);
+  EXPECT_THROW(BatchNorm(3, ones, FloatVector({ 3 }, 0.0f), ones, ones),
+	       ex::IllegalValueError);
+  EXPECT_THROW(BatchNorm(3, ones, ones, ones, FloatVector({ 5 }, 1.0f)),
+	       ex::IllegalValueError);
+}
+
+TEST(BatchNormLayerTests, TrainingForward) {
+  std::mt19937 rng(1);
+  const ReferenceBatchNorm reference{ 6, 5, false, 1e-5 };
+  const FloatVector scale = randomArray<FloatVector>(rng, { 5 }, 0.5f, 2.0f);
+  const FloatVector shift = randomArray<FloatVector>(rng, { 5 });
+  FloatMatrix input = randomArray<FloatMatrix>(rng, { 6, 5 });
+  // A large mean with a small spread must not lose its variance
+  for (size_t i = 0; i < 6; ++i) {
+    input.data()[i * 5 + 2] += 1000.0f;
+  }
+  BatchNorm layer(1, scale, shift, FloatVector({ 5 }, 0.0f),
+		  FloatVector({ 5 }, 1.0f));
+  ForwardState forwardState;
+
+  const std::vector<double> x = toDouble(input.data(), input.size());
+  const FloatMatrix output = layer.forward(input, forwardState);
+  ASSERT_EQ(input.dimensions(), output.dimensions());
+  expectNear(reference.forward(x, toDouble(scale.data(), 5),
+			       toDouble(shift.data(), 5)),
+	     output.data(), 1e-3);
+  EXPECT_EQ(1, forwardState.numInputs());
+  EXPECT_EQ(1, forwardState.numActivations());
+
+  // The running averages move a tenth of the way toward the batch
+  // statistics, with the variance unbiased
+  std::vector<double> mean = reference.mean(x);
+  std::vector<double> variance = reference.variance(x);
+  for (size_t j = 0; j < 5; ++j) {
+    mean[j] *= 0.1;
+    variance[j] = 0.9 + 0.1 * variance[j] * 6.0 / 5.0;
+  }
+  expectNear(mean, layer.runningMean().data(), 1e-4);
+  expectNear(variance, layer.runningVariance().data(), 1e-4);
+}
+
+TEST(BatchNormLayerTests, TrainingForwardOverManyFeatures) {
+  // Enough features to split the statistics across several tasks
+  std::mt19937 rng(2);
+  const ReferenceBatchNorm reference{ 64, 2000, true, 1e-5 };
+  const FloatMatrix input = randomArray<FloatMatrix>(rng, { 64, 2000 });
+  SigmoidBatchNorm layer(1, 2000);
+  ForwardState forwardState;
+
+  expectNear(reference.forward(toDouble(input.data(), input.size()),
+			       std::vector<double>(2000, 1.0),
+			       std::vector<double>(2000, 0.0)),
+	     layer.forward(input, forwardState).data(), 1e-5);
+}
+
+TEST(BatchNormLayerTests, InferenceForward) {
+  typedef BatchNormLayer<float, nonlinearities::ReLU> ReLUBatchNorm;
+  ReLUBatchNorm layer(1, FloatVector({ 2 }, { 2.0f, 1.0f }),
+		      FloatVector({ 2 }, { 1.0f, -1.0f }),
+		      FloatVector({ 2 }, { 3.0f, -2.0f }),
+		      FloatVector({ 2 }, { 4.0f, 0.25f }),
+		      nonlinearities::ReLU(), 0.1f, 0.0f);
+  const FloatMatrix input({ 3, 2 }, { 3.0f, -2.0f, 5.0f, -1.0f,
+				      0.0f, -3.0f });
+
+  const FloatMatrix output = layer.forward(input);
+  const std::vector<float> truth{ 1.0f, 0.0f, 3.0f, 1.0f, 0.0f, 0.0f };
+  EXPECT_EQ(truth, std::vector<float>(output.begin(), output.end()));
+  EXPECT_EQ(std::vector<float>({ 3.0f, -2.0f }),
+	    std::vector<float>(layer.runningMean().begin(),
+			       layer.runningMean().end()));
+}
+
+TEST(BatchNormLayerTests, ForwardRejectsBadInputs) {
+  BatchNorm layer(1, 3);
+  ForwardState forwardState;
+  EXPECT_THROW(layer.forward(FloatMatrix({ 2, 4 }, 0.0f)),
+	       ex::IllegalValueError);
+  EXPECT_THROW(layer.forward(FloatMatrix({ 2, 2 }, 0.0f), forwardState),
+	       ex::IllegalValueError);
+  EXPECT_EQ(0, forwardState.numInputs());
+}
+
+TEST(BatchNormLayerTests, Backward) {
+  testBackward<BatchNorm>(ReferenceBatchNorm{ 5, 4, false, 1e-5 }, 3);
+}
+
+TEST(BatchNormLayerTests, BackwardThroughNonlinearity) {
+  testBackward<SigmoidBatchNorm>(ReferenceBatchNorm{ 5, 4, true, 1e-5 },
+				 4);
+}
+
+TEST(BatchNormLayerTests, BackwardRejectsBadLossGradient) {
+  BatchNorm layer(1, 3);
+  ForwardState forwardState;
+  GradientAccumulator<float> gradients;
+
+  layer.forward(FloatMatrix({ 2, 3 }, 1.0f), forwardState);
+  EXPECT_THROW(layer.backward(FloatMatrix({ 3, 3 }, 0.0f), forwardState,
+			      gradients),
+	       ex::IllegalValueError);
+  EXPECT_EQ(0, gradients.numEntries());
+}
+
+TEST(BatchNormLayerTests, FoldIntoFullyConnectedLayer) {
+  typedef FullyConnectedLayer<float, nonlinearities::Identity> Linear;
+  typedef BatchNormLayer<float, nonlinearities::ReLU> ReLUBatchNorm;
+  std::mt19937 rng(5);
+  const Linear linear(7, randomArray<FloatMatrix>(rng, { 4, 3 }),
+		      randomArray<FloatVector>(rng, { 4 }));
+  const ReLUBatchNorm batchNorm(
+      8, randomArray<FloatVector>(rng, { 4 }, 0.5f, 2.0f),
+      randomArray<FloatVector>(rng, { 4 }),
+      randomArray<FloatVector>(rng, { 4 }),
+      randomArray<FloatVector>(rng, { 4 }, 0.5f, 2.0f)
+  );
+  const FloatMatrix input = randomArray<FloatMatrix>(rng, { 5, 3 });
+
+  const FullyConnectedLayer<float, nonlinearities::ReLU> folded =
+      foldBatchNorm(linear, batchNorm);
+  EXPECT_EQ(7, folded.id());
+  const FloatMatrix truth = batchNorm.forward(linear.forward(input));
+  const FloatMatrix output = folded.forward(input);
+  ASSERT_EQ(truth.dimensions(), output.dimensions());
+  expectNear(toDouble(truth.data(), truth.size()), output.data(), 1e-5);
+
+  EXPECT_THROW(foldBatchNorm(linear, ReLUBatchNorm(8, 5)),
+	       ex::IllegalValueError);
+}
@@ -0,0 +1,391 @@
+#include <neurodidactic/core/layers/Convolution2dLayer.hpp>
+
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/layers/Nonlinearities.hpp>
+#include <neurodidactic/core/optimizers/ForwardStateMap.hpp>
+#include <neurodidactic/core/optimizers/GradientAccumulator.hpp>
+#include <neurodidactic/testing/LayerTesting.hpp>
+#include <neurodidactic/testing/MdArrayVerification.hpp>
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+using neurodidactic::testing::expectNear;
+using neurodidactic::testing::randomArray;
+using neurodidactic::testing::verifyMdArray;
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::layers;
+using namespace neurodidactic::core::optimizers;
+namespace nl = neurodidactic::core::layers::nonlinearities;
+namespace ex = pistis::exceptions;
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<4, float> FloatArray4;
+  typedef Convolution2dLayer<float, nl::Identity> Convolution2dIdLayer;
+  typedef Convolution2dLayer<float, nl::ReLU> Convolution2dReLULayer;
+  typedef ForwardStateMap<float, MklAllocator<float, 64> > ForwardState;
+  typedef detail::Convolution2dGeometry Geometry;
+  typedef detail::ConvolutionKernels ConvolutionKernels;
+
+  // 2x2 max pooling with stride 2 of each [height, width] plane
+  FloatArray4 maxPool2x2(const FloatArray4& a) {
+    const uint32_t h = a.dimensions()[2], w = a.dimensions()[3];
+    FloatArray4 pooled({ a.dimensions()[0], a.dimensions()[1], h / 2,
+			 w / 2 });
+    float* dest = pooled.data();
+    for (size_t plane = 0; plane < a.dimensions()[0] * a.dimensions()[1];
+	 ++plane) {
+      const float* src = a.data() + plane * h * w;
+      for (uint32_t p = 0; p < h / 2; ++p) {
+	for (uint32_t q = 0; q < w / 2; ++q) {
+	  const float* x = src + 2 * p * w + 2 * q;
+	  *dest++ = std::max(std::max(x[0], x[1]),
+			     std::max(x[w], x[w + 1]));
+	}
+      }
+    }
+    return pooled;
+  }
+
+  // Not monotone, so forwardAndPool() must apply it before pooling
+  struct Negate {
+    template <typename Field>
+    Field apply(Field x) const { return -x; }
+
+    template <typename Array>
+    typename Array::ArrayType operator()(const Array& a) const {
+      return a.multiply(typename Array::FieldType(-1));
+    }
+  };
+
+  // Direct convolution, one product of a pixel and a weight at a time
+  struct ReferenceConvolution {
+    size_t batchSize, inputChannels, outputChannels, height, width;
+    size_t kernelHeight, kernelWidth, stride, padding;
+
+    size_t outputHeight() const {
+      return (height + 2 * padding - kernelHeight) / stride + 1;
+    }
+
+    size_t outputWidth() const {
+      return (width + 2 * padding - kernelWidth) / stride + 1;
+    }
+
+    // Calls f(output, input, weight) with the indices of every product
+    // of an input pixel and a weight in the convolution
+    template <typename Function>
+    void forEachProduct(Function f) const {
+      const size_t p0 = outputHeight(), q0 = outputWidth();
+      for (size_t n = 0; n < batchSize; ++n) {
+	for (size_t k = 0; k < outputChannels; ++k) {
+	  for (size_t p = 0; p < p0; ++p) {
+	    for (size_t q = 0; q < q0; ++q) {
+	      const size_t output =
+		  ((n * outputChannels + k) * p0 + p) * q0 + q;
+	      for (size_t c = 0; c < inputChannels; ++c) {
+		for (size_t r = 0; r < kernelHeight; ++r) {
+		  for (size_t s = 0; s < kernelWidth; ++s) {
+		    const int64_t y = int64_t(p * stride + r) - padding;
+		    const int64_t x = int64_t(q * stride + s) - padding;
+		    if ((y >= 0) && (y < int64_t(height)) && (x >= 0) &&
+			(x < int64_t(width))) {
+		      const size_t input =
+			  ((n * inputChannels + c) * height + y) * width + x;
+		      const size_t weight =
+			  ((k * inputChannels + c) * kernelHeight + r)
+			      * kernelWidth + s;
+		      f(output, input, weight);
+		    }
+		  }
+		}
+	      }
+	    }
+	  }
+	}
+      }
+    }
+
+    std::vector<float> forward(const float* input, const float* weights,
+			       const float* bias) const {
+      std::vector<float> result(
+	  batchSize * outputChannels * outputHeight() * outputWidth(), 0.0f
+      );
+      const size_t planeSize = outputHeight() * outputWidth();
+      for (size_t i = 0; i < result.size(); ++i) {
+	result[i] = bias[(i / planeSize) % outputChannels];
+      }
+      forEachProduct([&](size_t output, size_t in, size_t w) {
+	  result[output] += input[in] * weights[w];
+      });
+      return result;
+    }
+  };
+}
+
+TEST(Convolution2dLayerTests, Geometry) {
+  const Geometry g{ 3, 5, 4, 3, 2, 2, 1 };
+  EXPECT_EQ(3, g.outputHeight());
+  EXPECT_EQ(3, g.outputWidth());
+  EXPECT_EQ(60, g.imageSize());
+  EXPECT_EQ(18, g.columnRows());
+  EXPECT_EQ(9, g.columnColumns());
+  EXPECT_TRUE(g.fits());
+  EXPECT_FALSE((Geometry{ 1, 2, 2, 5, 5, 1, 1 }).fits());
+  EXPECT_FALSE((Geometry{ 1, 2, 2, 1, 1, 0, 0 }).fits());
+}
+
+TEST(Convolution2dLayerTests, ImageToColumns) {
+  const Geometry g{ 1, 3, 3, 2, 2, 1, 0 };
+  const std::vector<float> image{ 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+  std::vector<float> columns(g.columnRows() * g.columnColumns(), -1.0f);
+
+  ConvolutionKernels::imageToColumns(g, image.data(), columns.data());
+  EXPECT_EQ(std::vector<float>({ 1, 2, 4, 5,
+				 2, 3, 5, 6,
+				 4, 5, 7, 8,
+				 5, 6, 8, 9 }),
+	    columns);
+}
+
+TEST(Convolution2dLayerTests, ImageToColumnsWithStrideAndPadding) {
+  const Geometry g{ 1, 3, 3, 2, 2, 2, 1 };
+  const std::vector<float> image{ 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+  std::vector<float> columns(g.columnRows() * g.columnColumns(), -1.0f);
+
+  ConvolutionKernels::imageToColumns(g, image.data(), columns.data());
+  EXPECT_EQ(std::vector<float>({ 0, 0, 0, 5,
+				 0, 0, 4, 6,
+				 0, 2, 0, 8,
+				 1, 3, 7, 9 }),
+	    columns);
+}
+
+TEST(Convolution2dLayerTests, ImageToColumnsForRows) {
+  std::mt19937 rng(5);
+  std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+  const Geometry g{ 2, 7, 5, 3, 2, 2, 1 };
+  const size_t width = g.outputWidth();
+  std::vector<float> image(g.imageSize());
+  std::vector<float> all(g.columnRows() * g.columnColumns());
+  std::vector<float> rows(g.columnRows() * 2 * width, -1.0f);
+  for (float& v : image) v = uniform(rng);
+
+  ConvolutionKernels::imageToColumns(g, image.data(), all.data());
+  ConvolutionKernels::imageToColumns(g, image.data(), 1, 3, rows.data());
+  for (size_t r = 0; r < g.columnRows(); ++r) {
+    const float* truth = all.data() + r * g.columnColumns() + width;
+    EXPECT_EQ(std::vector<float>(truth, truth + 2 * width),
+	      std::vector<float>(rows.data() + r * 2 * width,
+				 rows.data() + (r + 1) * 2 * width))
+	<< "at column row " << r;
+  }
+}
+
+TEST(Convolution2dLayerTests, MaxPool2x2) {
+  const std::vector<float> tiles{ 1, 5, 2, 0, 9,
+				  3, 4, 8, 7, 9,
+				  6, 1, 0, 2, 9,
+				 -1, -2, -3, -4, -5,
+				 -6, -7, -8, -9, -9,
+				  9, 9, 9, 9, 9 };
+  std::vector<float> pooled(4, 0.0f);
+
+  ConvolutionKernels::maxPool2x2(2, tiles.data(), 15, 5, 1, 2,
+				 pooled.data(), 2);
+  EXPECT_EQ(std::vector<float>({ 5, 8, -1, -3 }), pooled);
+}
+
+TEST(Convolution2dLayerTests, AddColumnsToImageIsAdjoint) {
+  // <imageToColumns(x), y> == <x, addColumnsToImage(y)>
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+  const Geometry g{ 2, 5, 6, 3, 2, 2, 1 };
+  std::vector<float> x(g.imageSize());
+  std::vector<float> y(g.columnRows() * g.columnColumns());
+  std::vector<float> columns(y.size()), image(x.size(), 0.0f);
+  for (float& v : x) v = uniform(rng);
+  for (float& v : y) v = uniform(rng);
+
+  ConvolutionKernels::imageToColumns(g, x.data(), columns.data());
+  ConvolutionKernels::addColumnsToImage(g, y.data(), image.data());
+
+  double left = 0.0, right = 0.0;
+  for (size_t i = 0; i < y.size(); ++i) {
+    left += double(columns[i]) * y[i];
+  }
+  for (size_t i = 0; i < x.size(); ++i) {
+    right += double(x[i]) * image[i];
+  }
+  EXPECT_NEAR(left, right, 1e-4);
+}
+
+TEST(Convolution2dLayerTests, Construct) {
+  Convolution2dIdLayer layer(3, 2, 4, 3, 5, 2, 1);
+  EXPECT_EQ(3, layer.id());
+  EXPECT_EQ(2, layer.inputChannels());
+  EXPECT_EQ(4, layer.outputChannels());
+  EXPECT_EQ(3, layer.kernelHeight());
+  EXPECT_EQ(5, layer.kernelWidth());
+  EXPECT_EQ(2, layer.stride());
+  EXPECT_EQ(1, layer.padding());
+  EXPECT_EQ(FloatArray4::DimensionListType({ 4, 2, 3, 5 }),
+	    layer.weights().dimensions());
+  EXPECT_EQ(FloatVector::DimensionListType({ 4 }),
+	    layer.bias().dimensions());
+
+  EXPECT_THROW(Convolution2dIdLayer(3, 2, 4, 3, 3, 0, 0),
+	       ex::IllegalValueError);
+  EXPECT_THROW(Convolution2dIdLayer(3, FloatArray4({ 4, 2, 3, 3 }, 0.0f),
+				    FloatVector({ 3 }, 0.0f)),
+	       ex::IllegalValueError);
+}
+
+TEST(Convolution2dLayerTests, Forward) {
+  std::mt19937 rng(11);
+  const ReferenceConvolution reference{ 2, 2, 3, 5, 4, 3, 3, 2, 1 };
+  const FloatArray4 weights = randomArray<FloatArray4>(rng, { 3, 2, 3, 3 });
+  const FloatVector bias = randomArray<FloatVector>(rng, { 3 });
+  const FloatArray4 input = randomArray<FloatArray4>(rng, { 2, 2, 5, 4 });
+  Convolution2dIdLayer layer(1, weights, bias, 2, 1);
+
+  const FloatArray4 output = layer.forward(input);
+  ASSERT_EQ(FloatArray4::DimensionListType({ 2, 3, 3, 2 }),
+	    output.dimensions());
+  expectNear(reference.forward(input.data(), weights.data(), bias.data()),
+	     output.data(), 1e-4);
+}
+
+TEST(Convolution2dLayerTests, ForwardWithReLU) {
+  const FloatArray4 weights({ 1, 1, 2, 2 }, { 1.0f, -1.0f, -1.0f, 1.0f });
+  const FloatVector bias({ 1 }, { 0.5f });
+  const FloatArray4 input({ 1, 1, 2, 3 },
+			  { 1.0f, 2.0f, 4.0f, 3.0f, 1.0f, 6.0f });
+  Convolution2dReLULayer layer(1, weights, bias);
+
+  EXPECT_TRUE(verifyMdArray({ 1, 1, 1, 2 }, { 0.0f, 3.5f },
+			    layer.forward(input)));
+}
+
+TEST(Convolution2dLayerTests, ForwardAndPool) {
+  std::mt19937 rng(17);
+  const FloatArray4 weights = randomArray<FloatArray4>(rng, { 3, 2, 3, 2 });
+  const FloatVector bias = randomArray<FloatVector>(rng, { 3 });
+  const FloatArray4 input = randomArray<FloatArray4>(rng, { 2, 2, 7, 8 });
+  Convolution2dReLULayer layer(1, weights, bias, 1, 1);
+
+  const FloatArray4 output = layer.forwardAndPool(input);
+  const FloatArray4 truth = maxPool2x2(layer.forward(input));
+  ASSERT_EQ(FloatArray4::DimensionListType({ 2, 3, 3, 4 }),
+	    output.dimensions());
+  expectNear(std::vector<float>(truth.begin(), truth.end()), output.data(),
+	     1e-4);
+}
+
+TEST(Convolution2dLayerTests, ForwardAndPoolInBands) {
+  // Wide enough that each image is convolved in several bands of rows,
+  // the last of which is shorter than the others
+  std::mt19937 rng(19);
+  const FloatArray4 weights = randomArray<FloatArray4>(rng, { 3, 2, 3, 3 });
+  const FloatVector bias = randomArray<FloatVector>(rng, { 3 });
+  const FloatArray4 input =
+      randomArray<FloatArray4>(rng, { 2, 2, 25, 300 });
+  Convolution2dLayer<float, nl::Sigmoid> layer(1, weights, bias, 1, 1);
+
+  const FloatArray4 output = layer.forwardAndPool(input);
+  const FloatArray4 truth = maxPool2x2(layer.forward(input));
+  ASSERT_EQ(FloatArray4::DimensionListType({ 2, 3, 12, 150 }),
+	    output.dimensions());
+  expectNear(std::vector<float>(truth.begin(), truth.end()), output.data(),
+	     1e-4);
+}
+
+TEST(Convolution2dLayerTests, ForwardAndPoolWithNonmonotoneNonlinearity) {
+  std::mt19937 rng(23);
+  const FloatArray4 weights = randomArray<FloatArray4>(rng, { 3, 2, 3, 3 });
+  const FloatVector bias = randomArray<FloatVector>(rng, { 3 });
+  const FloatArray4 input = randomArray<FloatArray4>(rng, { 2, 2, 8, 8 });
+  Convolution2dLayer<float, Negate> layer(1, weights, bias, 1, 1);
+
+  EXPECT_FALSE(nl::IsNondecreasing<Negate>::value);
+  EXPECT_TRUE(nl::IsNondecreasing<nl::ReLU>::value);
+  const FloatArray4 output = layer.forwardAndPool(input);
+  const FloatArray4 truth = maxPool2x2(layer.forward(input));
+  ASSERT_EQ(FloatArray4::DimensionListType({ 2, 3, 4, 4 }),
+	    output.dimensions());
+  expectNear(std::vector<float>(truth.begin(), truth.end()), output.data(),
+	     1e-4);
+}
+
+TEST(Convolution2dLayerTests, ForwardRejectsBadInputs) {
+  Convolution2dIdLayer layer(1, 2, 3, 3, 3, 1, 0);
+  EXPECT_THROW(layer.forward(FloatArray4({ 1, 3, 5, 5 }, 0.0f)),
+	       ex::IllegalValueError);
+  EXPECT_THROW(layer.forward(FloatArray4({ 1, 2, 2, 5 }, 0.0f)),
+	       ex::IllegalValueError);
+  EXPECT_THROW(layer.forwardAndPool(FloatArray4({ 1, 3, 5, 5 }, 0.0f)),
+	       ex::IllegalValueError);
+}
+
+TEST(Convolution2dLayerTests, Backward) {
+  std::mt19937 rng(13);
+  const ReferenceConvolution reference{ 2, 3, 2, 6, 5, 3, 2, 2, 1 };
+  const FloatArray4 weights = randomArray<FloatArray4>(rng, { 2, 3, 3, 2 });
+  const FloatVector bias = randomArray<FloatVector>(rng, { 2 });
+  const FloatArray4 input = randomArray<FloatArray4>(rng, { 2, 3, 6, 5 });
+  Convolution2dIdLayer layer(5, weights, bias, 2, 1);
+  ForwardState forwardState;
+  GradientAccumulator<float> gradients;
+
+  const FloatArray4 output = layer.forward(input, forwardState);
+  const FloatArray4 lossGradient =
+      randomArray<FloatArray4>(rng, output.dimensions());
+  const FloatArray4 inputGradient =
+      layer.backward(lossGradient, forwardState, gradients);
+
+  std::vector<float> trueWeightGradient(weights.size(), 0.0f);
+  std::vector<float> trueBiasGradient(bias.size(), 0.0f);
+  std::vector<float> trueInputGradient(input.size(), 0.0f);
+  const size_t planeSize = reference.outputHeight() * reference.outputWidth();
+  for (size_t i = 0; i < lossGradient.size(); ++i) {
+    trueBiasGradient[(i / planeSize) % 2] += lossGradient.data()[i];
+  }
+  reference.forEachProduct([&](size_t out, size_t in, size_t w) {
+      trueWeightGradient[w] += lossGradient.data()[out] * input.data()[in];
+      trueInputGradient[in] += lossGradient.data()[out] * weights.data()[w];
+  });
+
+  ASSERT_EQ(input.dimensions(), inputGradient.dimensions());
+  expectNear(trueInputGradient, inputGradient.data(), 1e-4);
+  ASSERT_EQ(2, gradients.numEntries());
+  EXPECT_EQ(5, gradients.layerId(0));
+  EXPECT_EQ(0, gradients.paramId(0));
+  ASSERT_EQ(weights.size(), gradients.gradientSize(0));
+  expectNear(trueWeightGradient, gradients.gradient(0), 1e-4);
+  EXPECT_EQ(1, gradients.paramId(1));
+  ASSERT_EQ(bias.size(), gradients.gradientSize(1));
+  expectNear(trueBiasGradient, gradients.gradient(1), 1e-4);
+}
+
+TEST(Convolution2dLayerTests, BackwardAppliesNonlinearityGradient) {
+  const FloatArray4 weights({ 1, 1, 1, 1 }, { 1.0f });
+  const FloatVector bias({ 1 }, { 0.0f });
+  const FloatArray4 input({ 1, 1, 1, 2 }, { -1.0f, 2.0f });
+  Convolution2dReLULayer layer(1, weights, bias);
+  ForwardState forwardState;
+  GradientAccumulator<float> gradients;
+
+  layer.forward(input, forwardState);
+  const FloatArray4 inputGradient = layer.backward(
+      FloatArray4({ 1, 1, 1, 2 }, { 3.0f, 5.0f }), forwardState, gradients
+  );
+  EXPECT_TRUE(verifyMdArray({ 1, 1, 1, 2 }, { 0.0f, 5.0f },
+			    inputGradient));
+  expectNear(std::vector<float>({ 10.0f }), gradients.gradient(0), 1e-4);
+  expectNear(std::vector<float>({ 5.0f }), gradients.gradient(1), 1e-4);
+
+  EXPECT_THROW(layer.backward(FloatArray4({ 1, 1, 2, 1 }, 1.0f),
+			      forwardState, gradients),
+	       ex::IllegalValueError);
+}
@@ -0,0 +1,167 @@
+#include <neurodidactic/core/layers/DropoutLayer.hpp>
+
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/optimizers/ForwardStateMap.hpp>
+#include <neurodidactic/core/optimizers/GradientAccumulator.hpp>
+#include <neurodidactic/core/parallel/ThreadPool.hpp>
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::layers;
+using namespace neurodidactic::core::optimizers;
+namespace ex = pistis::exceptions;
+namespace parallel = neurodidactic::core::parallel;
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<2, float> FloatMatrix;
+  typedef DropoutLayer<float> Dropout;
+  typedef ForwardStateMap<float, MklAllocator<float, 64> > ForwardState;
+
+  FloatMatrix randomMatrix(std::mt19937& rng, uint32_t rows,
+			   uint32_t columns) {
+    std::uniform_real_distribution<float> uniform(0.5f, 1.0f);
+    FloatMatrix a(FloatMatrix::DimensionListType({ rows, columns }));
+    for (float* p = a.data(); p != a.end(); ++p) {
+      *p = uniform(rng);
+    }
+    return a;
+  }
+
+  bool maskBit(const ForwardState::MaskType& mask, size_t i) {
+    return (mask.data()[i / 32] >> (i % 32)) & 1;
+  }
+
+  std::vector<uint32_t> maskWords(const ForwardState::MaskType& mask) {
+    return std::vector<uint32_t>(mask.data(), mask.data() + mask.size());
+  }
+}
+
+TEST(DropoutLayerTests, Construct) {
+  Dropout layer(3, 0.25f, 17);
+  EXPECT_EQ(3, layer.id());
+  EXPECT_EQ(0.25f, layer.rate());
+  EXPECT_EQ(17, layer.seed());
+  EXPECT_EQ(0, layer.numCalls());
+
+  EXPECT_NO_THROW(Dropout(3, 0.0f, 17));
+  EXPECT_THROW(Dropout(3, 1.0f, 17), ex::IllegalValueError);
+  EXPECT_THROW(Dropout(3, -0.5f, 17), ex::IllegalValueError);
+}
+
+TEST(DropoutLayerTests, InferenceIsIdentity) {
+  const Dropout layer(1, 0.5f, 17);
+  const FloatVector input({ 3 }, { 1.0f, -2.0f, 3.0f });
+  const FloatVector output = layer.forward(input);
+  EXPECT_EQ(std::vector<float>(input.begin(), input.end()),
+	    std::vector<float>(output.begin(), output.end()));
+}
+
+TEST(DropoutLayerTests, TrainingForward) {
+  // 1000 x 37 so the last mask word is only partly used
+  std::mt19937 rng(1);
+  const FloatMatrix input = randomMatrix(rng, 1000, 37);
+  const Dropout layer(1, 0.25f, 17);
+  ForwardState forwardState;
+
+  const FloatMatrix output = layer.forward(input, forwardState);
+  ASSERT_EQ(input.dimensions(), output.dimensions());
+  EXPECT_EQ(1, layer.numCalls());
+  ASSERT_EQ(1, forwardState.numMasks());
+  const ForwardState::MaskType& mask = forwardState.mask(1);
+  ASSERT_EQ((input.size() + 31) / 32, mask.size());
+
+  size_t numDropped = 0;
+  for (size_t i = 0; i < input.size(); ++i) {
+    if (maskBit(mask, i)) {
+      ASSERT_FLOAT_EQ(input.data()[i] / 0.75f, output.data()[i])
+	  << "at index " << i;
+    } else {
+      ASSERT_EQ(0.0f, output.data()[i]) << "at index " << i;
+      ++numDropped;
+    }
+  }
+  EXPECT_NEAR(0.25, double(numDropped) / input.size(), 0.01);
+  EXPECT_EQ(0, mask.data()[mask.size() - 1] >> (input.size() % 32));
+}
+
+TEST(DropoutLayerTests, ZeroRateKeepsEverything) {
+  std::mt19937 rng(2);
+  const FloatMatrix input = randomMatrix(rng, 10, 10);
+  const Dropout layer(1, 0.0f, 17);
+  ForwardState forwardState;
+
+  const FloatMatrix output = layer.forward(input, forwardState);
+  EXPECT_EQ(std::vector<float>(input.begin(), input.end()),
+	    std::vector<float>(output.begin(), output.end()));
+}
+
+TEST(DropoutLayerTests, MasksDependOnSeedIdAndCall) {
+  const FloatVector input({ 256 }, 1.0f);
+  ForwardState forwardState;
+  auto draw = [&](const Dropout& layer) {
+    layer.forward(input, forwardState);
+    return maskWords(forwardState.mask(layer.id()));
+  };
+
+  const Dropout layer(1, 0.5f, 17);
+  const std::vector<uint32_t> first = draw(layer);
+  const std::vector<uint32_t> second = draw(layer);
+  EXPECT_NE(first, second);
+  EXPECT_EQ(first, draw(Dropout(1, 0.5f, 17)));
+  EXPECT_NE(first, draw(Dropout(2, 0.5f, 17)));
+  EXPECT_NE(first, draw(Dropout(1, 0.5f, 18)));
+}
+
+TEST(DropoutLayerTests, MaskDoesNotDependOnThreads) {
+  // Large enough that parallelFor() splits the work
+  const FloatVector input({ 1 << 20 }, 1.0f);
+  ForwardState parallelState, serialState;
+
+  Dropout(1, 0.5f, 17).forward(input, parallelState);
+  {
+    parallel::SerialRegion serial;
+    Dropout(1, 0.5f, 17).forward(input, serialState);
+  }
+  EXPECT_TRUE(maskWords(parallelState.mask(1)) ==
+	      maskWords(serialState.mask(1)));
+}
+
+TEST(DropoutLayerTests, Backward) {
+  std::mt19937 rng(3);
+  const FloatMatrix input = randomMatrix(rng, 50, 20);
+  const FloatMatrix lossGradient = randomMatrix(rng, 50, 20);
+  Dropout layer(1, 0.5f, 17);
+  ForwardState forwardState;
+  GradientAccumulator<float> gradients;
+
+  layer.forward(input, forwardState);
+  const FloatMatrix inputGradient =
+      layer.backward(lossGradient, forwardState, gradients);
+  ASSERT_EQ(lossGradient.dimensions(), inputGradient.dimensions());
+  EXPECT_EQ(0, gradients.numEntries());
+
+  const ForwardState::MaskType& mask = forwardState.mask(1);
+  for (size_t i = 0; i < lossGradient.size(); ++i) {
+    const float truth =
+	maskBit(mask, i) ? lossGradient.data()[i] * 2.0f : 0.0f;
+    ASSERT_EQ(truth, inputGradient.data()[i]) << "at index " << i;
+  }
+}
+
+TEST(DropoutLayerTests, BackwardRejectsBadLossGradient) {
+  Dropout layer(1, 0.5f, 17);
+  ForwardState forwardState;
+  GradientAccumulator<float> gradients;
+
+  layer.forward(FloatMatrix({ 4, 16 }, 1.0f), forwardState);
+  EXPECT_THROW(layer.backward(FloatMatrix({ 5, 16 }, 1.0f), forwardState,
+			      gradients),
+	       ex::IllegalValueError);
+  EXPECT_THROW(layer.backward(FloatMatrix({ 4, 16 }, 1.0f), ForwardState(),
+			      gradients),
+	       ex::NoSuchItem);
+}
@@ -0,0 +1,110 @@
+#include <neurodidactic/core/layers/EmbeddingLayer.hpp>
+
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/optimizers/AdamOptimizer.hpp>
+#include <neurodidactic/core/optimizers/ForwardStateMap.hpp>
+#include <neurodidactic/core/optimizers/SgdOptimizer.hpp>
+#include <neurodidactic/testing/MdArrayVerification.hpp>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using neurodidactic::testing::verifyMdArray;
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::layers;
+using namespace neurodidactic::core::optimizers;
+namespace ex = pistis::exceptions;
+
+namespace {
+  typedef MdArray<2, float> FloatMatrix;
+  typedef EmbeddingLayer<float> FloatEmbeddingLayer;
+  typedef FloatEmbeddingLayer::InputType IndexVector;
+  typedef ForwardStateMap<float, MklAllocator<float, 64> > ForwardState;
+
+  const std::vector<float> TABLE{ 1.0f, 2.0f,
+				  3.0f, 4.0f,
+				  5.0f, 6.0f,
+				  7.0f, 8.0f };
+}
+
+TEST(EmbeddingLayerTests, Construct) {
+  const FloatEmbeddingLayer empty(2, 1000, 16);
+  EXPECT_EQ(2, empty.id());
+  EXPECT_EQ(1000, empty.numRows());
+  EXPECT_EQ(16, empty.dimension());
+
+  const FloatEmbeddingLayer layer(3, FloatMatrix({ 4, 2 }, TABLE.begin()));
+  EXPECT_EQ(4, layer.numRows());
+  EXPECT_EQ(2, layer.dimension());
+  EXPECT_TRUE(verifyMdArray({ 4, 2 }, TABLE, layer.weights()));
+}
+
+TEST(EmbeddingLayerTests, Forward) {
+  const FloatEmbeddingLayer layer(1, FloatMatrix({ 4, 2 }, TABLE.begin()));
+  const IndexVector indices({ 3 }, { 2u, 0u, 2u });
+  ForwardState forwardState;
+
+  EXPECT_TRUE(verifyMdArray({ 3, 2 }, { 5.0f, 6.0f, 1.0f, 2.0f, 5.0f, 6.0f },
+			    layer.forward(indices)));
+  EXPECT_TRUE(verifyMdArray({ 3, 2 }, { 5.0f, 6.0f, 1.0f, 2.0f, 5.0f, 6.0f },
+			    layer.forward(indices, forwardState)));
+  EXPECT_EQ(0, forwardState.numInputs());
+  EXPECT_EQ(0, forwardState.numActivations());
+
+  EXPECT_THROW(layer.forward(IndexVector({ 2 }, { 1u, 4u })),
+	       ex::IllegalValueError);
+}
+
+TEST(EmbeddingLayerTests, WeightGradient) {
+  const FloatEmbeddingLayer layer(1, FloatMatrix({ 4, 2 }, TABLE.begin()));
+  const IndexVector indices({ 3 }, { 2u, 0u, 2u });
+  const FloatMatrix lossGradient({ 3, 2 },
+				 { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f });
+
+  const FloatEmbeddingLayer::GradientType gradient =
+      layer.weightGradient(indices, lossGradient);
+  ASSERT_EQ(2, gradient.numNonZeroRows());
+  EXPECT_EQ(0, gradient.indices()[0]);
+  EXPECT_EQ(2, gradient.indices()[1]);
+  EXPECT_TRUE(verifyMdArray({ 4, 2 },
+			    { 3.0f, 4.0f, 0.0f, 0.0f, 6.0f, 8.0f, 0.0f, 0.0f },
+			    gradient.toDense()));
+
+  EXPECT_THROW(layer.weightGradient(indices, FloatMatrix({ 2, 2 }, 0.0f)),
+	       ex::IllegalValueError);
+}
+
+TEST(EmbeddingLayerTests, Backward) {
+  FloatEmbeddingLayer layer(1, FloatMatrix({ 4, 2 }, TABLE.begin()));
+  const IndexVector indices({ 3 }, { 2u, 0u, 2u });
+  const FloatMatrix lossGradient({ 3, 2 },
+				 { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f });
+  ForwardState forwardState;
+  SgdOptimizer<float> optimizer(0.5f);
+
+  layer.forward(indices, forwardState);
+  layer.backward(lossGradient, forwardState, optimizer, indices);
+  EXPECT_TRUE(verifyMdArray({ 4, 2 },
+			    { -0.5f, 0.0f, 3.0f, 4.0f,
+			      2.0f, 2.0f, 7.0f, 8.0f },
+			    layer.weights()));
+}
+
+TEST(EmbeddingLayerTests, BackwardWithLazyAdam) {
+  // The first step of Adam moves every touched element by the learning
+  // rate against the sign of its gradient
+  FloatEmbeddingLayer layer(1, FloatMatrix({ 4, 2 }, TABLE.begin()));
+  const IndexVector indices({ 2 }, { 3u, 1u });
+  const FloatMatrix lossGradient({ 2, 2 }, { 1.0f, -2.0f, -3.0f, 4.0f });
+  ForwardState forwardState;
+  AdamOptimizer<float> optimizer(0.25f);
+
+  layer.backward(lossGradient, forwardState, optimizer, indices);
+  EXPECT_EQ(1, optimizer.numSteps(1, FloatEmbeddingLayer::WEIGHTS));
+  const std::vector<float> truth{ 1.0f, 2.0f, 3.25f, 3.75f,
+				  5.0f, 6.0f, 6.75f, 8.25f };
+  for (size_t i = 0; i < truth.size(); ++i) {
+    EXPECT_NEAR(truth[i], layer.weights().data()[i], 1e-5)
+	<< "at index " << i;
+  }
+}
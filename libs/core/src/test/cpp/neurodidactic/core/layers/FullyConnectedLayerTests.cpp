@@ -6,6 +6,8 @@
 #include <neurodidactic/core/arrays/MdArray.hpp>
 #include <neurodidactic/core/layers/Nonlinearities.hpp>
 #include <neurodidactic/core/optimizers/ForwardStateMap.hpp>
+#include <neurodidactic/core/optimizers/GradientAccumulator.hpp>
+#include <neurodidactic/core/optimizers/SgdOptimizer.hpp>
 
 #include <pistis/testing/Allocator.hpp>
 #include <neurodidactic/testing/MdArrayVerification.hpp>
@@ -14,7 +16,7 @@
 using neurodidactic::testing::verifyMdArray;
 using namespace neurodidactic::core::arrays;
 using namespace neurodidactic::core::layers;
-using namespace neurodidactic::core::optimiziers;
+using namespace neurodidactic::core::optimizers;
 
 namespace nl = neurodidactic::core::layers::nonlinearities;
 
@@ -30,6 +32,10 @@ namespace {
   typedef FullyConnectedLayer<float, nl::Identity> FullyConnectedIdLayer;
   typedef FullyConnectedLayer<float, nl::ReLU> FullyConnectedReLULayer;
 
+  const std::vector<float> LAYER_WEIGHTS{ 1.0f, 2.0f, 3.0f,
+                                         -1.0f, 0.5f, 0.25f };
+  const std::vector<float> LAYER_BIAS{ 0.5f, -2.0f };
+
   class NamedNonlinearity {
   public:
     NamedNonlinearity(const std::string& name): name_(name) { }
@@ -58,7 +64,7 @@ TEST(FullyConnectedLayerTests, CreateUninitialized) {
   const std::string NONLINEARITY_NAME("TEST_NONLINEARITY");
   NamedFloatAllocator allocator(ALLOCATOR_NAME);
   NamedNonlinearity nonlinearity(NONLINEARITY_NAME);
-  FullyConnectedLayer<float, NamedNonlinearity> layer(
+  FullyConnectedLayer<float, NamedNonlinearity, NamedFloatAllocator> layer(
       LAYER_ID, NUM_INPUTS, NUM_OUTPUTS, nonlinearity, allocator
   );
 
@@ -83,12 +89,14 @@ TEST(FullyConnectedLayerTests, CreateInitialized) {
   const size_t NUM_OUTPUTS = 2;
   const std::string WEIGHTS_ALLOCATOR_NAME("TEST_WEIGHTS_ALLOCATOR");
   const std::string BIAS_ALLOCATOR_NAME("TEST_BIAS_ALLOCATOR");
+  const std::string LAYER_ALLOCATOR_NAME("TEST_LAYER_ALLOCATOR");
   const std::string NONLINEARITY_NAME("TEST_NONLINEARITY");
   const FloatMatrixWithNamedAllocator::DimensionListType
       WEIGHTS_DIMENSIONS{ 2, 3 };
   const FloatVectorWithNamedAllocator::DimensionListType BIAS_DIMENSIONS{ 2 };
-  const std::vector<float> LAYER_WEIGHTS{ };
-  const std::vecotr<float> LAYER_BIAS{ };
+  const std::vector<float> LAYER_WEIGHTS{ 1.0f, 2.0f, 3.0f,
+                                         -1.0f, 0.5f, 0.25f };
+  const std::vector<float> LAYER_BIAS{ 0.5f, -2.0f };
   NamedFloatAllocator weightsAllocator(WEIGHTS_ALLOCATOR_NAME);
   NamedFloatAllocator biasAllocator(BIAS_ALLOCATOR_NAME);
   NamedFloatAllocator layerAllocator(LAYER_ALLOCATOR_NAME);
@@ -104,14 +112,14 @@ TEST(FullyConnectedLayerTests, CreateInitialized) {
   EXPECT_EQ(LAYER_ID, layer.id());
   EXPECT_EQ(WEIGHTS_DIMENSIONS[1], layer.numInputs());
   EXPECT_EQ(WEIGHTS_DIMENSIONS[0], layer.numOutputs());
-  EXPECT_EQ(NONLINEARITY_NAME, layer.nonlinearity.name());
+  EXPECT_EQ(NONLINEARITY_NAME, layer.nonlinearity().name());
 
   EXPECT_EQ(LAYER_ALLOCATOR_NAME, layer.weights().allocator().name());
-  EXPECT_TRUE(verifyMdArray(WEIGHTS_DIMENSIONS, LAYER_WEIGHTS.begin(),
+  EXPECT_TRUE(verifyMdArray(WEIGHTS_DIMENSIONS, LAYER_WEIGHTS,
 			    layer.weights()));
   
   EXPECT_EQ(LAYER_ALLOCATOR_NAME, layer.bias().allocator().name());
-  EXPECT_TRUE(verifyMdArray(BIAS_DIMENSIONS, LAYER_BIAS.begin(),
+  EXPECT_TRUE(verifyMdArray(BIAS_DIMENSIONS, LAYER_BIAS,
 			    layer.bias()));
 }
 
@@ -119,9 +127,16 @@ TEST(FullyConnectedLayerTests, CreateInitialized) {
 
 // }
 
-// TEST(FullyConnectedLayerTests, ForwardComputation) {
+TEST(FullyConnectedLayerTests, ForwardComputation) {
+  FullyConnectedIdLayer idLayer(1, FloatMatrix({ 2, 3 }, LAYER_WEIGHTS.begin()),
+                                FloatVector({ 2 }, LAYER_BIAS.begin()));
+  FullyConnectedReLULayer reluLayer(2, FloatMatrix({ 2, 3 }, LAYER_WEIGHTS.begin()),
+                                    FloatVector({ 2 }, LAYER_BIAS.begin()));
+  FloatVector x({ 3 }, { 1.0f, -1.0f, 2.0f });
 
-// }
+  EXPECT_TRUE(verifyMdArray({ 2 }, { 5.5f, -3.0f }, idLayer.forward(x)));
+  EXPECT_TRUE(verifyMdArray({ 2 }, { 5.5f, 0.0f }, reluLayer.forward(x)));
+}
 
 // TEST(FullyConnectedLayerTests, LossGradientComputation) {
 
@@ -135,7 +150,100 @@ TEST(FullyConnectedLayerTests, CreateInitialized) {
 
 // }
 
-// TEST(FullyConnectedLayerTests, Backpropagation) {
+TEST(FullyConnectedLayerTests, Backpropagation) {
+  FullyConnectedReLULayer layer(2, FloatMatrix({ 2, 3 }, LAYER_WEIGHTS.begin()),
+                                FloatVector({ 2 }, LAYER_BIAS.begin()));
+  ForwardStateMap<float, FloatVector::AllocatorType> forwardState;
+  GradientAccumulator<float> gradients;
+  FloatVector x({ 3 }, { 1.0f, -1.0f, 2.0f });
+  FloatVector g({ 2 }, { 1.0f, 2.0f });
+
+  layer.forward(x, forwardState);
+  FloatVector dx = layer.backward(g, forwardState, gradients);
+
+  EXPECT_TRUE(verifyMdArray({ 3 }, { 1.0f, 2.0f, 3.0f }, dx));
+  ASSERT_EQ(2, gradients.numEntries());
+  EXPECT_TRUE(verifyMdArray(
+      { 2, 3 }, { 1.0f, -1.0f, 2.0f, 0.0f, 0.0f, 0.0f },
+      FloatMatrix({ 2, 3 }, gradients.gradient(0))
+  ));
+  EXPECT_TRUE(verifyMdArray({ 2 }, { 1.0f, 0.0f },
+                            FloatVector({ 2 }, gradients.gradient(1))));
+}
 
-// }
+TEST(FullyConnectedLayerTests, BatchForwardComputation) {
+  FullyConnectedIdLayer layer(1, FloatMatrix({ 2, 3 }, LAYER_WEIGHTS.begin()),
+                              FloatVector({ 2 }, LAYER_BIAS.begin()));
+  FloatMatrix x({ 2, 3 }, { 1.0f, -1.0f, 2.0f, 0.0f, 1.0f, 0.0f });
+
+  EXPECT_TRUE(verifyMdArray({ 2, 2 }, { 5.5f, -3.0f, 2.5f, -1.5f },
+                            layer.forward(x)));
+  EXPECT_THROW(layer.forward(FloatMatrix({ 2, 2 }, 1.0f)),
+               pistis::exceptions::IllegalValueError);
+}
+
+TEST(FullyConnectedLayerTests, BatchBackpropagation) {
+  FullyConnectedIdLayer layer(1, FloatMatrix({ 2, 3 }, LAYER_WEIGHTS.begin()),
+                              FloatVector({ 2 }, LAYER_BIAS.begin()));
+  ForwardStateMap<float, FloatVector::AllocatorType> forwardState;
+  GradientAccumulator<float> gradients;
+  FloatMatrix x({ 2, 3 }, { 1.0f, -1.0f, 2.0f, 0.0f, 1.0f, 0.0f });
+  FloatMatrix g({ 2, 2 }, { 1.0f, 2.0f, 0.5f, -1.0f });
+
+  layer.forward(x, forwardState);
+  FloatMatrix dx = layer.backward(g, forwardState, gradients);
+
+  EXPECT_TRUE(verifyMdArray({ 2, 3 },
+                            { -1.0f, 3.0f, 3.5f, 1.5f, 0.5f, 1.25f }, dx));
+  ASSERT_EQ(2, gradients.numEntries());
+  EXPECT_TRUE(verifyMdArray(
+      { 2, 3 }, { 1.0f, -0.5f, 2.0f, 2.0f, -3.0f, 4.0f },
+      FloatMatrix({ 2, 3 }, gradients.gradient(0))
+  ));
+  EXPECT_TRUE(verifyMdArray({ 2 }, { 1.5f, 1.0f },
+                            FloatVector({ 2 }, gradients.gradient(1))));
+}
+
+TEST(FullyConnectedLayerTests, SparseForwardComputation) {
+  FullyConnectedIdLayer layer(1, FloatMatrix({ 2, 3 }, LAYER_WEIGHTS.begin()),
+                              FloatVector({ 2 }, LAYER_BIAS.begin()));
+  SparseVector<float> x(3, { 0, 2 }, { 1.0f, 2.0f });
 
+  EXPECT_TRUE(verifyMdArray({ 2 }, { 7.5f, -2.5f }, layer.forward(x)));
+  EXPECT_TRUE(verifyMdArray({ 2 }, { 0.5f, -2.0f },
+                            layer.forward(SparseVector<float>(3))));
+  EXPECT_THROW(layer.forward(SparseVector<float>(4, { 3 }, { 1.0f })),
+               pistis::exceptions::IllegalValueError);
+}
+
+TEST(FullyConnectedLayerTests, SparseBackpropagation) {
+  FullyConnectedReLULayer layer(2, FloatMatrix({ 2, 3 }, LAYER_WEIGHTS.begin()),
+                                FloatVector({ 2 }, LAYER_BIAS.begin()));
+  ForwardStateMap<float, FloatVector::AllocatorType> forwardState;
+  GradientAccumulator<float> gradients;
+  SparseVector<float> x(3, { 0, 2 }, { 1.0f, 2.0f });
+  FloatVector g({ 2 }, { 1.0f, 2.0f });
+
+  layer.forward(x, forwardState);
+  layer.backward(g, forwardState, gradients, x);
+
+  ASSERT_EQ(1, gradients.numEntries());
+  EXPECT_EQ(1, gradients.numColumnUpdates());
+  EXPECT_TRUE(verifyMdArray({ 2 }, { 1.0f, 0.0f },
+                            FloatVector({ 2 }, gradients.gradient(0))));
+
+  FullyConnectedReLULayer copy(layer);
+  SgdOptimizer<float> optimizer(0.5f);
+  gradients.apply(optimizer);
+  EXPECT_TRUE(verifyMdArray({ 2, 3 },
+                            { 0.5f, 2.0f, 2.0f, -1.0f, 0.5f, 0.25f },
+                            layer.weights()));
+  EXPECT_TRUE(verifyMdArray({ 2 }, { 0.0f, -2.0f }, layer.bias()));
+
+  layer = copy;
+  layer.backward(g, forwardState, optimizer, x);
+  EXPECT_TRUE(verifyMdArray({ 2, 3 },
+                            { 0.5f, 2.0f, 2.0f, -1.0f, 0.5f, 0.25f },
+                            layer.weights()));
+  EXPECT_TRUE(verifyMdArray({ 2 }, { 0.0f, -2.0f }, layer.bias()));
+}
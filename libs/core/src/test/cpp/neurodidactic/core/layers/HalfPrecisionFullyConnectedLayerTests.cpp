@@ -0,0 +1,98 @@
+#include <neurodidactic/core/layers/HalfPrecisionFullyConnectedLayer.hpp>
+#include <neurodidactic/core/layers/Nonlinearities.hpp>
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::layers;
+namespace nl = neurodidactic::core::layers::nonlinearities;
+namespace ex = pistis::exceptions;
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<2, float> FloatMatrix;
+  typedef FullyConnectedLayer<float, nl::ReLU> FloatLayer;
+
+  FloatLayer createFloatLayer() {
+    FloatMatrix weights({ 5, 8 }, 0.0f);
+    for (size_t i = 0; i < weights.size(); ++i) {
+      weights.data()[i] = 0.3f * std::sin(float(i));
+    }
+    return FloatLayer(7, std::move(weights),
+		      FloatVector({ 5 }, { 0.1f, -0.1f, 0.2f, 0.0f, 0.5f }));
+  }
+
+  template <typename Half>
+  void verifyLayer(float tolerance) {
+    typedef HalfPrecisionFullyConnectedLayer<Half, nl::ReLU> HalfLayer;
+    FloatLayer reference = createFloatLayer();
+    HalfLayer layer(reference);
+    FloatMatrix batch({ 3, 8 }, 0.0f);
+
+    for (size_t i = 0; i < batch.size(); ++i) {
+      batch.data()[i] = std::cos(float(i) * 0.7f);
+    }
+
+    EXPECT_EQ(7, layer.id());
+    EXPECT_EQ(8, layer.numInputs());
+    EXPECT_EQ(5, layer.numOutputs());
+
+    FloatMatrix expected = reference.forward(batch);
+    FloatMatrix actual = layer.forward(batch);
+    ASSERT_EQ(expected.dimensions(), actual.dimensions());
+    for (size_t i = 0; i < expected.size(); ++i) {
+      EXPECT_NEAR(expected.data()[i], actual.data()[i], tolerance);
+    }
+
+    FloatVector x({ 8 }, batch.data());
+    FloatVector y = layer.forward(x);
+    FloatVector z = reference.forward(x);
+    for (size_t i = 0; i < y.size(); ++i) {
+      EXPECT_NEAR(z.data()[i], y.data()[i], tolerance);
+    }
+
+    EXPECT_THROW(layer.forward(FloatMatrix({ 3, 7 }, 1.0f)),
+		 ex::IllegalValueError);
+  }
+}
+
+TEST(HalfPrecisionFullyConnectedLayerTests, BFloat16Forward) {
+  verifyLayer<BFloat16>(0.05f);
+}
+
+TEST(HalfPrecisionFullyConnectedLayerTests, Float16Forward) {
+  verifyLayer<Float16>(0.005f);
+}
+
+TEST(HalfPrecisionFullyConnectedLayerTests, CreateFromHalfWeights) {
+  typedef HalfPrecisionFullyConnectedLayer<BFloat16, nl::Identity> HalfLayer;
+  HalfLayer layer(1, HalfLayer::WeightMatrixType({ 2, 2 }, BFloat16(0.5f)),
+		  HalfLayer::BiasVectorType({ 2 }, { 1.0f, -1.0f }));
+  FloatVector y = layer.forward(FloatVector({ 2 }, { 2.0f, 4.0f }));
+
+  EXPECT_EQ(4.0f, y.data()[0]);
+  EXPECT_EQ(2.0f, y.data()[1]);
+  EXPECT_THROW(HalfLayer(1,
+			 HalfLayer::WeightMatrixType({ 2, 2 }, BFloat16()),
+			 HalfLayer::BiasVectorType({ 3 }, 0.0f)),
+	       ex::IllegalValueError);
+}
+
+TEST(HalfPrecisionFullyConnectedLayerTests, FloatInputsKeepFullPrecision) {
+  // 1 + 2^-12 needs more mantissa bits than either half type has, but
+  // the weights (one-half) are exact, so the results are too
+  typedef HalfPrecisionFullyConnectedLayer<BFloat16, nl::Identity> HalfLayer;
+  HalfLayer layer(1, HalfLayer::WeightMatrixType({ 2, 2 }, BFloat16(0.5f)),
+		  HalfLayer::BiasVectorType({ 2 }, 0.0f));
+  const float x = 1.0f + std::ldexp(1.0f, -12);
+
+  FloatVector y = layer.forward(FloatVector({ 2 }, { x, x }));
+  EXPECT_EQ(x, y.data()[0]);
+  EXPECT_EQ(x, y.data()[1]);
+
+  FloatMatrix z = layer.forward(FloatMatrix({ 3, 2 }, x));
+  for (size_t i = 0; i < z.size(); ++i) {
+    EXPECT_EQ(x, z.data()[i]) << "at " << i;
+  }
+}
@@ -0,0 +1,143 @@
+#include <neurodidactic/core/layers/Initializers.hpp>
+
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/layers/FullyConnectedLayer.hpp>
+#include <neurodidactic/core/layers/Nonlinearities.hpp>
+#include <neurodidactic/core/parallel/ThreadPool.hpp>
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::layers;
+using namespace neurodidactic::core::layers::initializers;
+namespace parallel = neurodidactic::core::parallel;
+
+namespace {
+  typedef MdArray<2, float> FloatMatrix;
+  typedef FullyConnectedLayer<float, nonlinearities::ReLU> Layer;
+
+  std::vector<float> toVector(const FloatMatrix& m) {
+    return std::vector<float>(m.begin(), m.end());
+  }
+
+  template <typename Initializer>
+  FloatMatrix draw(const Initializer& init, uint32_t rows,
+		   uint32_t columns, uint64_t stream) {
+    FloatMatrix w(FloatMatrix::DimensionListType({ rows, columns }));
+    init(w, stream);
+    return w;
+  }
+
+  void expectMoments(const FloatMatrix& w, double variance) {
+    double sum = 0.0, sumOfSquares = 0.0;
+    for (const float* p = w.data(); p != w.end(); ++p) {
+      sum += *p;
+      sumOfSquares += double(*p) * *p;
+    }
+    const double n = double(w.size());
+    EXPECT_NEAR(0.0, sum / n, 0.02 * std::sqrt(variance));
+    EXPECT_NEAR(variance, sumOfSquares / n, 0.02 * variance);
+  }
+
+  // Checks that w w' (or w' w if w is tall) is gain^2 times the identity
+  void expectOrthogonal(const FloatMatrix& w, double gain) {
+    const size_t m = w.dimensions()[0];
+    const size_t n = w.dimensions()[1];
+    const bool tall = m > n;
+    const size_t size = tall ? n : m;
+    for (size_t i = 0; i < size; ++i) {
+      for (size_t j = 0; j < size; ++j) {
+	double dot = 0.0;
+	for (size_t k = 0; k < (tall ? m : n); ++k) {
+	  dot += tall ? double(w.data()[k * n + i]) * w.data()[k * n + j]
+		      : double(w.data()[i * n + k]) * w.data()[j * n + k];
+	}
+	EXPECT_NEAR((i == j) ? gain * gain : 0.0, dot, 1e-5)
+	    << "at (" << i << ", " << j << ")";
+      }
+    }
+  }
+}
+
+TEST(InitializersTests, XavierUniform) {
+  const XavierUniform init(17);
+  EXPECT_EQ(17, init.seed());
+  const FloatMatrix w = draw(init, 256, 512, 1);
+  const float limit = std::sqrt(6.0f / 768.0f);
+
+  for (const float* p = w.data(); p != w.end(); ++p) {
+    ASSERT_GE(*p, -limit);
+    ASSERT_LT(*p, limit);
+  }
+  expectMoments(w, limit * limit / 3.0);
+
+  const FloatMatrix scaled = draw(XavierUniform(17, 2.0), 256, 512, 1);
+  EXPECT_NEAR(2.0f * w.data()[10], scaled.data()[10], 1e-6);
+}
+
+TEST(InitializersTests, HeNormal) {
+  const FloatMatrix w = draw(HeNormal(17), 512, 256, 1);
+  const double variance = 2.0 / 256.0;
+  expectMoments(w, variance);
+
+  size_t beyondTwoSigma = 0;
+  for (const float* p = w.data(); p != w.end(); ++p) {
+    beyondTwoSigma += std::fabs(*p) > 2.0 * std::sqrt(variance);
+  }
+  EXPECT_NEAR(0.0455, double(beyondTwoSigma) / w.size(), 0.003);
+}
+
+TEST(InitializersTests, NormalSamplesComeInPairs) {
+  // An odd number of elements gets the first half of the last pair.
+  // The fan-ins differ, so compare the samples divided by their
+  // standard deviations.
+  const FloatMatrix odd = draw(HeNormal(17), 3, 5, 2);
+  const FloatMatrix even = draw(HeNormal(17), 4, 4, 2);
+  for (size_t i = 0; i < odd.size(); ++i) {
+    EXPECT_NEAR(even.data()[i] / std::sqrt(2.0 / 4.0),
+		odd.data()[i] / std::sqrt(2.0 / 5.0), 1e-5)
+	<< "at index " << i;
+  }
+}
+
+TEST(InitializersTests, SameSeedAndStreamGiveSameWeights) {
+  // Large enough that parallelFor() splits the work
+  const FloatMatrix parallelUniform = draw(XavierUniform(17), 512, 512, 3);
+  const FloatMatrix parallelNormal = draw(HeNormal(17), 512, 512, 3);
+  parallel::SerialRegion serial;
+  EXPECT_TRUE(toVector(parallelUniform) ==
+	      toVector(draw(XavierUniform(17), 512, 512, 3)));
+  EXPECT_TRUE(toVector(parallelNormal) ==
+	      toVector(draw(HeNormal(17), 512, 512, 3)));
+
+  EXPECT_FALSE(toVector(parallelUniform) ==
+	       toVector(draw(XavierUniform(17), 512, 512, 4)));
+  EXPECT_FALSE(toVector(parallelUniform) ==
+	       toVector(draw(XavierUniform(18), 512, 512, 3)));
+}
+
+TEST(InitializersTests, Orthogonal) {
+  expectOrthogonal(draw(Orthogonal(17), 4, 7, 1), 1.0);
+  expectOrthogonal(draw(Orthogonal(17), 7, 4, 1), 1.0);
+  expectOrthogonal(draw(Orthogonal(17), 6, 6, 1), 1.0);
+  expectOrthogonal(draw(Orthogonal(17, 2.0), 5, 3, 1), 2.0);
+
+  EXPECT_TRUE(toVector(draw(Orthogonal(17), 7, 4, 1)) ==
+	      toVector(draw(Orthogonal(17), 7, 4, 1)));
+}
+
+TEST(InitializersTests, InitializeLayer) {
+  Layer layer(3, 20, 10);
+  Layer other(4, 20, 10);
+  const XavierUniform init(17);
+
+  initialize(layer, init);
+  initialize(other, init);
+  EXPECT_TRUE(toVector(layer.weights()) ==
+	      toVector(draw(init, 10, 20, 3)));
+  EXPECT_FALSE(toVector(layer.weights()) == toVector(other.weights()));
+  EXPECT_EQ(std::vector<float>(10, 0.0f),
+	    std::vector<float>(layer.bias().begin(), layer.bias().end()));
+}
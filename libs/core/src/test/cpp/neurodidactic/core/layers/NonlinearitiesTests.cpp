@@ -131,3 +131,18 @@ TEST(NonlinearitiesTests, TanH) {
   EXPECT_TRUE(verifyArray({3}, TRUE_GRADIENT, F.gradient(u)));
 }
 
+
+TEST(NonlinearitiesTests, ScalarApply) {
+  const std::vector<float> INPUT = { 2.0f, -2.0f, 0.0f, 0.75f };
+  FloatVector u({4}, INPUT.begin());
+  FloatVector relu = nl::ReLU()(u);
+  FloatVector sigmoid = nl::Sigmoid()(u);
+  FloatVector tanh = nl::TanH()(u);
+
+  for (size_t i = 0; i < INPUT.size(); ++i) {
+    EXPECT_EQ(INPUT[i], nl::Identity().apply(INPUT[i]));
+    EXPECT_EQ(relu.data()[i], nl::ReLU().apply(INPUT[i]));
+    EXPECT_NEAR(sigmoid.data()[i], nl::Sigmoid().apply(INPUT[i]), 1e-6);
+    EXPECT_NEAR(tanh.data()[i], nl::TanH().apply(INPUT[i]), 1e-6);
+  }
+}
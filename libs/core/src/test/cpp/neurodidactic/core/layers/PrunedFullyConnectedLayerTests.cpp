@@ -0,0 +1,92 @@
+#include <neurodidactic/core/layers/PrunedFullyConnectedLayer.hpp>
+#include <neurodidactic/core/layers/Nonlinearities.hpp>
+#include <neurodidactic/testing/MdArrayVerification.hpp>
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::layers;
+using namespace neurodidactic::testing;
+namespace nl = neurodidactic::core::layers::nonlinearities;
+namespace ex = pistis::exceptions;
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<2, float> FloatMatrix;
+  typedef FullyConnectedLayer<float, nl::ReLU> DenseLayer;
+  typedef PrunedFullyConnectedLayer<float, nl::ReLU> PrunedLayer;
+
+  // Keeps every fifth weight, so 80% of the weights are zero
+  DenseLayer createDenseLayer() {
+    FloatMatrix weights({ 6, 20 }, 0.0f);
+    for (size_t i = 0; i < weights.size(); i += 5) {
+      weights.data()[i] = std::sin(float(i + 1));
+    }
+    return DenseLayer(3, std::move(weights),
+		      FloatVector({ 6 }, { 0.1f, -0.1f, 0.2f, 0.0f, 0.5f,
+					   -0.3f }));
+  }
+}
+
+TEST(PrunedFullyConnectedLayerTests, CreateFromDenseLayer) {
+  const DenseLayer dense = createDenseLayer();
+  const PrunedLayer layer(dense);
+
+  EXPECT_EQ(3, layer.id());
+  EXPECT_EQ(20, layer.numInputs());
+  EXPECT_EQ(6, layer.numOutputs());
+  EXPECT_EQ(24, layer.weights().numNonZeros());
+  EXPECT_TRUE(verifyMdArray(
+      dense.weights().dimensions(),
+      std::vector<float>(dense.weights().begin(), dense.weights().end()),
+      layer.weights().toDense()
+  ));
+  EXPECT_TRUE(verifyMdArray(
+      dense.bias().dimensions(),
+      std::vector<float>(dense.bias().begin(), dense.bias().end()),
+      layer.bias()
+  ));
+
+  EXPECT_TRUE(PrunedLayer::worthCompacting(dense));
+  EXPECT_FALSE(PrunedLayer::worthCompacting(dense, 0.9));
+}
+
+TEST(PrunedFullyConnectedLayerTests, CreateWithMismatchedBias) {
+  EXPECT_THROW(PrunedLayer(1, PrunedLayer::WeightMatrixType(
+			       PrunedLayer::WeightMatrixType::DimensionListType(
+				   { 4, 3 }
+			       )
+			   ),
+			   FloatVector({ 3 }, 0.0f)),
+	       ex::IllegalValueError);
+}
+
+TEST(PrunedFullyConnectedLayerTests, Forward) {
+  const DenseLayer dense = createDenseLayer();
+  const PrunedLayer layer(dense);
+  FloatMatrix batch({ 11, 20 }, 0.0f);
+
+  for (size_t i = 0; i < batch.size(); ++i) {
+    batch.data()[i] = std::cos(float(i) * 0.3f);
+  }
+
+  const FloatMatrix expected = dense.forward(batch);
+  const FloatMatrix actual = layer.forward(batch);
+  ASSERT_EQ(expected.dimensions(), actual.dimensions());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_NEAR(expected.data()[i], actual.data()[i], 1e-5f);
+  }
+
+  const FloatVector x({ 20 }, batch.data() + 20);
+  const FloatVector y = layer.forward(x);
+  const FloatVector z = dense.forward(x);
+  ASSERT_EQ(z.dimensions(), y.dimensions());
+  for (size_t i = 0; i < y.size(); ++i) {
+    EXPECT_NEAR(z.data()[i], y.data()[i], 1e-5f);
+  }
+
+  EXPECT_THROW(layer.forward(FloatMatrix({ 2, 19 }, 1.0f)),
+	       ex::IllegalValueError);
+}
@@ -0,0 +1,111 @@
+#include <neurodidactic/core/layers/QuantizedFullyConnectedLayer.hpp>
+#include <neurodidactic/core/layers/Nonlinearities.hpp>
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <stdint.h>
+
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::layers;
+namespace nl = neurodidactic::core::layers::nonlinearities;
+namespace ex = pistis::exceptions;
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<2, float> FloatMatrix;
+
+  template <typename Nonlinearity>
+  FullyConnectedLayer<float, Nonlinearity> createFloatLayer() {
+    FloatMatrix weights({ 6, 16 }, 0.0f);
+    for (size_t i = 0; i < weights.size(); ++i) {
+      weights.data()[i] = 0.3f * std::sin(float(i));
+    }
+    // One all-zero row exercises the degenerate weight scale
+    std::fill_n(weights.data() + 3 * 16, 16, 0.0f);
+    return FullyConnectedLayer<float, Nonlinearity>(
+	7, std::move(weights),
+	FloatVector({ 6 }, { 0.1f, -0.1f, 0.2f, 0.0f, 0.5f, -0.3f })
+    );
+  }
+}
+
+TEST(QuantizedFullyConnectedLayerTests, IntegerKernel) {
+  typedef neurodidactic::core::arrays::detail::MklAdapter<int8_t, uint8_t>
+	  MklAdapter;
+  const uint8_t x[] = { 128, 130, 120,  // -> 0, 2, -8
+			255, 128, 0 };  // -> 127, 0, -128
+  const int8_t w[] = { 1, -1, 2,
+		       -3, 0, 5 };
+  int32_t y[4];
+
+  MklAdapter::multiplyMatrixByMatrixTranspose(2, 2, 3, x, w, y);
+  EXPECT_EQ(-18, y[0]);
+  EXPECT_EQ(-40, y[1]);
+  EXPECT_EQ(-129, y[2]);
+  EXPECT_EQ(-1021, y[3]);
+}
+
+TEST(QuantizedFullyConnectedLayerTests, Calibration) {
+  auto reference = createFloatLayer<nl::Identity>();
+  QuantizedFullyConnectedLayer<nl::Identity> layer(reference);
+
+  EXPECT_EQ(7, layer.id());
+  EXPECT_EQ(16, layer.numInputs());
+  EXPECT_EQ(6, layer.numOutputs());
+  ASSERT_EQ(reference.weights().dimensions(), layer.weights().dimensions());
+  ASSERT_EQ(reference.bias().dimensions(), layer.bias().dimensions());
+  EXPECT_EQ(1.0f, layer.weightScales().data()[3]);
+
+  for (size_t i = 0; i < layer.numOutputs(); ++i) {
+    const float scale = layer.weightScales().data()[i];
+    int32_t maxMagnitude = 0;
+    for (size_t j = 0; j < layer.numInputs(); ++j) {
+      const size_t k = i * layer.numInputs() + j;
+      const int32_t q = layer.weights().data()[k];
+      maxMagnitude = std::max(maxMagnitude, std::abs(q));
+      EXPECT_NEAR(reference.weights().data()[k], q * scale,
+		  0.5f * scale + 1e-6f);
+    }
+    EXPECT_EQ((i == 3) ? 0 : 127, maxMagnitude);
+  }
+}
+
+TEST(QuantizedFullyConnectedLayerTests, ForwardMatchesFloatLayer) {
+  auto reference = createFloatLayer<nl::ReLU>();
+  QuantizedFullyConnectedLayer<nl::ReLU> layer(reference);
+  FloatMatrix batch({ 4, 16 }, 0.0f);
+
+  for (size_t i = 0; i < batch.size(); ++i) {
+    batch.data()[i] = std::cos(float(i) * 0.7f);
+  }
+  // An all-zero input row yields just the bias
+  std::fill_n(batch.data() + 2 * 16, 16, 0.0f);
+
+  FloatMatrix expected = reference.forward(batch);
+  FloatMatrix actual = layer.forward(batch);
+  ASSERT_EQ(expected.dimensions(), actual.dimensions());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_NEAR(expected.data()[i], actual.data()[i], 0.03f);
+  }
+  for (size_t j = 0; j < layer.numOutputs(); ++j) {
+    EXPECT_EQ(std::max(reference.bias().data()[j], 0.0f),
+	      actual.data()[2 * 6 + j]);
+  }
+
+  FloatVector x({ 16 }, batch.data() + 16);
+  FloatVector y = layer.forward(x);
+  ASSERT_EQ(6, y.size());
+  for (size_t i = 0; i < y.size(); ++i) {
+    EXPECT_EQ(actual.data()[6 + i], y.data()[i]);
+  }
+}
+
+TEST(QuantizedFullyConnectedLayerTests, ForwardWithWrongInputSize) {
+  QuantizedFullyConnectedLayer<nl::Sigmoid> layer(
+      createFloatLayer<nl::Sigmoid>()
+  );
+  EXPECT_THROW(layer.forward(FloatMatrix({ 3, 15 }, 1.0f)),
+	       ex::IllegalValueError);
+  EXPECT_THROW(layer.forward(FloatVector({ 17 }, 1.0f)),
+	       ex::IllegalValueError);
+}
@@ -0,0 +1,259 @@
+#include <neurodidactic/core/layers/RecurrentLayer.hpp>
+
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/optimizers/ForwardStateMap.hpp>
+#include <neurodidactic/core/optimizers/GradientAccumulator.hpp>
+#include <neurodidactic/testing/LayerTesting.hpp>
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <functional>
+#include <random>
+#include <vector>
+
+using neurodidactic::testing::expectGradientsNear;
+using neurodidactic::testing::expectNear;
+using neurodidactic::testing::randomArray;
+using neurodidactic::testing::sigmoid;
+using neurodidactic::testing::toDouble;
+using neurodidactic::testing::weightedSum;
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::layers;
+using namespace neurodidactic::core::optimizers;
+namespace ex = pistis::exceptions;
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<2, float> FloatMatrix;
+  typedef MdArray<3, float> FloatArray3;
+  typedef LstmLayer<float> Lstm;
+  typedef GruLayer<float> Gru;
+  typedef ForwardStateMap<float, MklAllocator<float, 64> > ForwardState;
+
+  // Straightforward LSTM or GRU in double precision, one hidden unit at
+  // a time
+  struct ReferenceRecurrence {
+    bool gru;
+    size_t numSteps, batchSize, numInputs, numHidden;
+
+    size_t gates() const { return gru ? 3 : 4; }
+
+    std::vector<double> forward(const std::vector<double>& x,
+				const std::vector<double>& inputWeights,
+				const std::vector<double>& recurrentWeights,
+				const std::vector<double>& bias) const {
+      const size_t h = numHidden;
+      std::vector<double> output(numSteps * batchSize * h);
+      std::vector<double> hidden(batchSize * h, 0.0);
+      std::vector<double> cell(batchSize * h, 0.0);
+      std::vector<double> z(gates() * h), u(gates() * h);
+
+      for (size_t t = 0; t < numSteps; ++t) {
+	for (size_t b = 0; b < batchSize; ++b) {
+	  const double* in = &x[(t * batchSize + b) * numInputs];
+	  double* y = &hidden[b * h];
+	  for (size_t g = 0; g < gates() * h; ++g) {
+	    z[g] = bias[g];
+	    u[g] = 0.0;
+	    for (size_t i = 0; i < numInputs; ++i) {
+	      z[g] += inputWeights[g * numInputs + i] * in[i];
+	    }
+	    for (size_t i = 0; i < h; ++i) {
+	      u[g] += recurrentWeights[g * h + i] * y[i];
+	    }
+	  }
+	  for (size_t j = 0; j < h; ++j) {
+	    if (gru) {
+	      const double r = sigmoid(z[j] + u[j]);
+	      const double s = sigmoid(z[h + j] + u[h + j]);
+	      const double n = std::tanh(z[2 * h + j] + r * u[2 * h + j]);
+	      u[j] = (1.0 - s) * n + s * y[j];
+	    } else {
+	      double& c = cell[b * h + j];
+	      const double i = sigmoid(z[j] + u[j]);
+	      const double f = sigmoid(z[h + j] + u[h + j]);
+	      c = f * c + i * std::tanh(z[2 * h + j] + u[2 * h + j]);
+	      u[j] = sigmoid(z[3 * h + j] + u[3 * h + j]) * std::tanh(c);
+	    }
+	  }
+	  std::copy_n(u.begin(), h, y);
+	}
+	std::copy(hidden.begin(), hidden.end(),
+		  output.begin() + t * batchSize * h);
+      }
+      return output;
+    }
+  };
+
+  template <typename Layer>
+  void testForward(const ReferenceRecurrence& reference, uint32_t seed) {
+    std::mt19937 rng(seed);
+    const uint32_t width = reference.gates() * reference.numHidden;
+    const FloatMatrix inputWeights = randomArray<FloatMatrix>(
+	rng, { width, (uint32_t)reference.numInputs }
+    );
+    const FloatMatrix recurrentWeights = randomArray<FloatMatrix>(
+	rng, { width, (uint32_t)reference.numHidden }
+    );
+    const FloatVector bias = randomArray<FloatVector>(rng, { width });
+    const FloatArray3 input = randomArray<FloatArray3>(
+	rng, { (uint32_t)reference.numSteps, (uint32_t)reference.batchSize,
+	       (uint32_t)reference.numInputs }
+    );
+    Layer layer(1, inputWeights, recurrentWeights, bias);
+    ForwardState forwardState;
+
+    const std::vector<double> truth = reference.forward(
+	toDouble(input.data(), input.size()),
+	toDouble(inputWeights.data(), inputWeights.size()),
+	toDouble(recurrentWeights.data(), recurrentWeights.size()),
+	toDouble(bias.data(), bias.size())
+    );
+    const FloatArray3 output = layer.forward(input);
+    ASSERT_EQ(FloatArray3::DimensionListType(
+		  { (uint32_t)reference.numSteps,
+		    (uint32_t)reference.batchSize,
+		    (uint32_t)reference.numHidden }
+	      ),
+	      output.dimensions());
+    expectNear(truth, output.data(), 1e-5);
+    expectNear(truth, layer.forward(input, forwardState).data(), 1e-5);
+    EXPECT_EQ(1, forwardState.numInputs());
+    EXPECT_EQ(1, forwardState.numActivations());
+  }
+
+  // Compares the gradients from backward() with central differences of
+  // the reference for the loss sum(lossGradient * output)
+  template <typename Layer>
+  void testBackward(const ReferenceRecurrence& reference, uint32_t seed) {
+    std::mt19937 rng(seed);
+    const uint32_t width = reference.gates() * reference.numHidden;
+    const uint32_t numSteps = reference.numSteps;
+    const uint32_t batchSize = reference.batchSize;
+    const FloatMatrix inputWeights = randomArray<FloatMatrix>(
+	rng, { width, (uint32_t)reference.numInputs }
+    );
+    const FloatMatrix recurrentWeights = randomArray<FloatMatrix>(
+	rng, { width, (uint32_t)reference.numHidden }
+    );
+    const FloatVector bias = randomArray<FloatVector>(rng, { width });
+    const FloatArray3 input = randomArray<FloatArray3>(
+	rng, { numSteps, batchSize, (uint32_t)reference.numInputs }
+    );
+    const FloatArray3 lossGradient = randomArray<FloatArray3>(
+	rng, { numSteps, batchSize, (uint32_t)reference.numHidden }
+    );
+    Layer layer(1, inputWeights, recurrentWeights, bias);
+    ForwardState forwardState;
+    GradientAccumulator<float> gradients;
+
+    layer.forward(input, forwardState);
+    const FloatArray3 inputGradient =
+	layer.backward(lossGradient, forwardState, gradients);
+    ASSERT_EQ(3, gradients.numEntries());
+    EXPECT_EQ(uint32_t(Layer::INPUT_WEIGHTS), gradients.paramId(0));
+    EXPECT_EQ(uint32_t(Layer::RECURRENT_WEIGHTS), gradients.paramId(1));
+    EXPECT_EQ(uint32_t(Layer::BIAS), gradients.paramId(2));
+
+    std::vector<std::vector<double> > parameters{
+      toDouble(input.data(), input.size()),
+      toDouble(inputWeights.data(), inputWeights.size()),
+      toDouble(recurrentWeights.data(), recurrentWeights.size()),
+      toDouble(bias.data(), bias.size())
+    };
+    const std::vector<double> w =
+	toDouble(lossGradient.data(), lossGradient.size());
+    auto loss = [&]() {
+      return weightedSum(w, reference.forward(parameters[0], parameters[1],
+					      parameters[2], parameters[3]));
+    };
+    expectGradientsNear<float>(
+	parameters, loss,
+	{ inputGradient.data(), gradients.gradient(0), gradients.gradient(1),
+	  gradients.gradient(2) },
+	1e-4
+    );
+  }
+}
+
+TEST(RecurrentLayerTests, Construct) {
+  Lstm lstm(3, 5, 2);
+  EXPECT_EQ(3, lstm.id());
+  EXPECT_EQ(5, lstm.numInputs());
+  EXPECT_EQ(2, lstm.numHidden());
+  EXPECT_EQ(FloatMatrix::DimensionListType({ 8, 5 }),
+	    lstm.inputWeights().dimensions());
+  EXPECT_EQ(FloatMatrix::DimensionListType({ 8, 2 }),
+	    lstm.recurrentWeights().dimensions());
+  EXPECT_EQ(FloatVector::DimensionListType({ 8 }),
+	    lstm.bias().dimensions());
+
+  Gru gru(4, 5, 2);
+  EXPECT_EQ(FloatMatrix::DimensionListType({ 6, 5 }),
+	    gru.inputWeights().dimensions());
+  EXPECT_EQ(FloatMatrix::DimensionListType({ 6, 2 }),
+	    gru.recurrentWeights().dimensions());
+
+  EXPECT_THROW(Gru(4, FloatMatrix({ 6, 5 }, 0.0f),
+		   FloatMatrix({ 6, 3 }, 0.0f), FloatVector({ 6 }, 0.0f)),
+	       ex::IllegalValueError);
+  EXPECT_THROW(Gru(4, FloatMatrix({ 6, 5 }, 0.0f),
+		   FloatMatrix({ 6, 2 }, 0.0f), FloatVector({ 5 }, 0.0f)),
+	       ex::IllegalValueError);
+}
+
+TEST(RecurrentLayerTests, LstmForward) {
+  testForward<Lstm>(ReferenceRecurrence{ false, 4, 3, 5, 6 }, 1);
+}
+
+TEST(RecurrentLayerTests, GruForward) {
+  testForward<Gru>(ReferenceRecurrence{ true, 4, 3, 5, 6 }, 2);
+}
+
+TEST(RecurrentLayerTests, ForwardSaturatesGates) {
+  // Pre-activations far beyond the range of exp() must still give
+  // finite gates
+  const FloatMatrix inputWeights({ 4, 1 }, { 100.0f, -100.0f, -100.0f,
+					     100.0f });
+  const FloatMatrix recurrentWeights({ 4, 1 }, 0.0f);
+  const FloatVector bias({ 4 }, 0.0f);
+  Lstm layer(1, inputWeights, recurrentWeights, bias);
+
+  const FloatArray3 output =
+      layer.forward(FloatArray3({ 2, 1, 1 }, { 1.0f, 1.0f }));
+  EXPECT_NEAR(-std::tanh(1.0), output.data()[0], 1e-6);
+  EXPECT_NEAR(-std::tanh(1.0), output.data()[1], 1e-6);
+}
+
+TEST(RecurrentLayerTests, ForwardRejectsBadInputs) {
+  Lstm layer(1, 3, 2);
+  EXPECT_THROW(layer.forward(FloatArray3({ 2, 1, 4 }, 0.0f)),
+	       ex::IllegalValueError);
+}
+
+TEST(RecurrentLayerTests, LstmBackward) {
+  testBackward<Lstm>(ReferenceRecurrence{ false, 4, 2, 3, 2 }, 3);
+}
+
+TEST(RecurrentLayerTests, GruBackward) {
+  testBackward<Gru>(ReferenceRecurrence{ true, 4, 2, 3, 2 }, 4);
+}
+
+TEST(RecurrentLayerTests, BackwardOverOneStep) {
+  testBackward<Gru>(ReferenceRecurrence{ true, 1, 2, 3, 2 }, 5);
+}
+
+TEST(RecurrentLayerTests, BackwardRejectsBadLossGradient) {
+  std::mt19937 rng(6);
+  Lstm layer(1, randomArray<FloatMatrix>(rng, { 8, 3 }),
+	     randomArray<FloatMatrix>(rng, { 8, 2 }),
+	     randomArray<FloatVector>(rng, { 8 }));
+  ForwardState forwardState;
+  GradientAccumulator<float> gradients;
+
+  layer.forward(FloatArray3({ 2, 1, 3 }, 0.0f), forwardState);
+  EXPECT_THROW(layer.backward(FloatArray3({ 2, 1, 3 }, 0.0f), forwardState,
+			      gradients),
+	       ex::IllegalValueError);
+  EXPECT_EQ(0, gradients.numEntries());
+}
@@ -0,0 +1,103 @@
+#include <neurodidactic/core/memory/MemoryPlanner.hpp>
+#include <gtest/gtest.h>
+
+using namespace neurodidactic::core::memory;
+namespace ex = pistis::exceptions;
+
+namespace {
+  ::testing::AssertionResult verifyNoConflicts(const MemoryPlanner& planner,
+					       const MemoryPlan& plan) {
+    for (size_t i = 0; i < planner.numBuffers(); ++i) {
+      const BufferLifetime& bi = planner.buffer(i);
+      if ((plan.offset(i) % planner.alignment()) ||
+	  (plan.offset(i) + bi.size > plan.slabSize())) {
+	return ::testing::AssertionFailure()
+	    << "Buffer " << i << " has offset " << plan.offset(i)
+	    << ", which is misaligned or outside the slab";
+      }
+      for (size_t j = i + 1; j < planner.numBuffers(); ++j) {
+	const BufferLifetime& bj = planner.buffer(j);
+	const bool disjoint = (plan.offset(i) + bi.size <= plan.offset(j)) ||
+			      (plan.offset(j) + bj.size <= plan.offset(i));
+	if (bi.overlaps(bj) && !disjoint) {
+	  return ::testing::AssertionFailure()
+	      << "Buffers " << i << " and " << j << " are live at the "
+	      << "same time but share memory";
+	}
+      }
+    }
+    return ::testing::AssertionSuccess();
+  }
+}
+
+TEST(MemoryPlannerTests, EmptyPlan) {
+  MemoryPlanner planner;
+  MemoryPlan plan = planner.plan();
+
+  EXPECT_EQ(0, plan.numBuffers());
+  EXPECT_EQ(0, plan.slabSize());
+  EXPECT_EQ(0, plan.totalBufferSize());
+}
+
+TEST(MemoryPlannerTests, ReuseMemoryOfDeadBuffers) {
+  MemoryPlanner planner(64);
+
+  planner.addBuffer(1024, 0, 2);
+  planner.addBuffer(1024, 1, 3);
+  planner.addBuffer(1024, 3, 5);
+  planner.addBuffer(1024, 4, 6);
+
+  MemoryPlan plan = planner.plan();
+  EXPECT_EQ(4, plan.numBuffers());
+  EXPECT_EQ(4096, plan.totalBufferSize());
+  EXPECT_EQ(2048, plan.slabSize());
+  EXPECT_EQ(plan.offset(0), plan.offset(2));
+  EXPECT_TRUE(verifyNoConflicts(planner, plan));
+}
+
+TEST(MemoryPlannerTests, AlignBuffers) {
+  MemoryPlanner planner(64);
+
+  planner.addBuffer(10, 0, 1);
+  planner.addBuffer(100, 0, 1);
+  planner.addBuffer(1, 1, 2);
+
+  MemoryPlan plan = planner.plan();
+  EXPECT_EQ(64 + 128 + 64, plan.totalBufferSize());
+  EXPECT_EQ(64 + 128 + 64, plan.slabSize());
+  EXPECT_TRUE(verifyNoConflicts(planner, plan));
+}
+
+TEST(MemoryPlannerTests, FillGapsBetweenBuffers) {
+  MemoryPlanner planner(64);
+
+  planner.addBuffer(4096, 0, 10);
+  planner.addBuffer(2048, 0, 2);
+  planner.addBuffer(4096, 0, 10);
+  planner.addBuffer(1024, 5, 6);
+  planner.addBuffer(1024, 5, 6);
+
+  MemoryPlan plan = planner.plan();
+  EXPECT_EQ(4096 + 4096 + 2048, plan.slabSize());
+  EXPECT_TRUE(verifyNoConflicts(planner, plan));
+}
+
+TEST(MemoryPlannerTests, ManyBuffers) {
+  MemoryPlanner planner(32);
+
+  for (uint32_t i = 0; i < 200; ++i) {
+    planner.addBuffer(32 * (1 + (i * 7919) % 97), i, i + (i * 31) % 13);
+  }
+
+  MemoryPlan plan = planner.plan();
+  EXPECT_LT(plan.slabSize(), plan.totalBufferSize());
+  EXPECT_TRUE(verifyNoConflicts(planner, plan));
+}
+
+TEST(MemoryPlannerTests, InvalidArguments) {
+  EXPECT_THROW(MemoryPlanner(48), ex::IllegalValueError);
+
+  MemoryPlanner planner;
+  EXPECT_THROW(planner.addBuffer(16, 3, 2), ex::IllegalValueError);
+  EXPECT_THROW(planner.plan().offset(0), ex::NoSuchItem);
+}
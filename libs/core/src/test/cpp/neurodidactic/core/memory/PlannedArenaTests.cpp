@@ -0,0 +1,138 @@
+#include <neurodidactic/core/memory/PlannedArena.hpp>
+
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <gtest/gtest.h>
+
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::memory;
+namespace ex = pistis::exceptions;
+
+namespace {
+  typedef PlannedArena<float> FloatArena;
+  typedef PlannedAllocator<float> FloatPlannedAllocator;
+  typedef MdArray<1, float, FloatPlannedAllocator> PlannedVector;
+  typedef MdArray<2, float, FloatPlannedAllocator> PlannedMatrix;
+
+  PlannedVector runStep(const PlannedMatrix& w, const PlannedVector& x) {
+    PlannedVector a =
+	w.innerProduct(x).map([](float v) { return v > 0.0f ? v : 0.0f; });
+    PlannedVector g = a.multiply(2.0f);
+    return w.transposeInnerProduct(g);
+  }
+}
+
+TEST(PlannedArenaTests, RecordThenPlan) {
+  FloatArena arena;
+  FloatPlannedAllocator allocator(arena);
+  PlannedMatrix w({ 4, 3 }, { 1.0f, -1.0f, 0.5f,
+			      2.0f, 0.0f, -3.0f,
+			      0.0f, 1.0f, 1.0f,
+			      -1.0f, -1.0f, -1.0f }, allocator);
+  PlannedVector x({ 3 }, { 1.0f, 2.0f, 3.0f }, allocator);
+
+  EXPECT_FALSE(arena.planned());
+  arena.beginStep();
+  PlannedVector first = runStep(w, x);
+  arena.endStep();
+
+  EXPECT_TRUE(arena.planned());
+  EXPECT_EQ(4, arena.numScheduledAllocations());
+  EXPECT_EQ(3, arena.numPlannedBuffers());
+  EXPECT_LT(arena.slabSize(), arena.plan().totalBufferSize());
+  EXPECT_EQ(0, arena.slabAllocations());
+
+  for (int i = 0; i < 3; ++i) {
+    const size_t slabAllocations = arena.slabAllocations();
+    arena.beginStep();
+    PlannedVector result = runStep(w, x);
+    arena.endStep();
+
+    EXPECT_EQ(slabAllocations + 3, arena.slabAllocations());
+    EXPECT_EQ(0, arena.liveSlabBuffers());
+    ASSERT_EQ(first.size(), result.size());
+    for (size_t j = 0; j < result.size(); ++j) {
+      EXPECT_EQ(first[j], result[j]);
+    }
+  }
+}
+
+TEST(PlannedArenaTests, MismatchedStepFallsBackToHeap) {
+  FloatArena arena;
+  FloatPlannedAllocator allocator(arena);
+
+  arena.beginStep();
+  {
+    PlannedVector a({ 16 }, 1.0f, allocator);
+    PlannedVector b = a.multiply(2.0f);
+  }
+  arena.endStep();
+
+  const size_t heapAllocations = arena.heapAllocations();
+  arena.beginStep();
+  {
+    PlannedVector a({ 32 }, 1.0f, allocator);
+    PlannedVector b = a.multiply(2.0f);
+    EXPECT_EQ(2.0f, b[31]);
+  }
+  arena.endStep();
+  EXPECT_EQ(heapAllocations + 2, arena.heapAllocations());
+  EXPECT_EQ(0, arena.slabAllocations());
+}
+
+TEST(PlannedArenaTests, RefuseToOverwriteLiveBuffers) {
+  FloatArena arena;
+  FloatPlannedAllocator allocator(arena);
+
+  arena.beginStep();
+  {
+    PlannedVector a({ 16 }, 1.0f, allocator);
+  }
+  arena.endStep();
+
+  arena.beginStep();
+  PlannedVector kept({ 16 }, 1.0f, allocator);
+  arena.endStep();
+
+  EXPECT_EQ(1, arena.liveSlabBuffers());
+  EXPECT_THROW(arena.beginStep(), ex::IllegalStateError);
+  EXPECT_THROW(arena.replan(), ex::IllegalStateError);
+}
+
+TEST(PlannedArenaTests, KeepBuffersPastTheirRecordedLifetime) {
+  FloatArena arena;
+  FloatPlannedAllocator allocator(arena);
+
+  arena.beginStep();
+  {
+    PlannedVector a({ 16 }, 1.0f, allocator);
+  }
+  {
+    PlannedVector b({ 16 }, 2.0f, allocator);
+  }
+  arena.endStep();
+  ASSERT_EQ(16 * sizeof(float), arena.slabSize());
+
+  // "a" was dead when "b" was recorded, so they share a slab range, but
+  // now "a" lives on while "b" is in use
+  const size_t heapAllocations = arena.heapAllocations();
+  arena.beginStep();
+  {
+    PlannedVector a({ 16 }, 1.0f, allocator);
+    PlannedVector b({ 16 }, 2.0f, allocator);
+    EXPECT_NE(a.data(), b.data());
+    EXPECT_EQ(1.0f, a[15]);
+    EXPECT_EQ(2.0f, b[15]);
+    EXPECT_EQ(1, arena.liveSlabBuffers());
+  }
+  arena.endStep();
+  EXPECT_EQ(1, arena.slabAllocations());
+  EXPECT_EQ(heapAllocations + 1, arena.heapAllocations());
+  EXPECT_EQ(0, arena.liveSlabBuffers());
+}
+
+TEST(PlannedArenaTests, AllocatorWithoutArena) {
+  PlannedVector a({ 8 }, 3.0f);
+
+  EXPECT_EQ(nullptr, a.allocator().arena());
+  EXPECT_EQ(3.0f, a[7]);
+}
@@ -0,0 +1,111 @@
+#include <neurodidactic/core/optimizers/AdamOptimizer.hpp>
+
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/arrays/SparseRowMatrix.hpp>
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::optimizers;
+namespace ex = pistis::exceptions;
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<2, float> FloatMatrix;
+  typedef SparseRowMatrix<float> FloatSparseRowMatrix;
+
+  // Textbook Adam for one element, in double precision
+  struct ReferenceAdam {
+    double learningRate, beta1, beta2, epsilon;
+    double m, v;
+    int t;
+
+    double step(double p, double g) {
+      ++t;
+      m = beta1 * m + (1.0 - beta1) * g;
+      v = beta2 * v + (1.0 - beta2) * g * g;
+      const double a = learningRate * std::sqrt(1.0 - std::pow(beta2, t)) /
+		       (1.0 - std::pow(beta1, t));
+      return p - a * m / (std::sqrt(v) + epsilon);
+    }
+  };
+}
+
+TEST(AdamOptimizerTests, Create) {
+  AdamOptimizer<float> optimizer(0.01f);
+  EXPECT_FLOAT_EQ(0.01f, optimizer.learningRate());
+  EXPECT_FLOAT_EQ(0.9f, optimizer.beta1());
+  EXPECT_FLOAT_EQ(0.999f, optimizer.beta2());
+  EXPECT_FLOAT_EQ(1e-8f, optimizer.epsilon());
+  EXPECT_EQ(0, optimizer.numSteps(1, 0));
+
+  optimizer.setLearningRate(0.5f);
+  EXPECT_FLOAT_EQ(0.5f, optimizer.learningRate());
+}
+
+TEST(AdamOptimizerTests, Update) {
+  const std::vector<std::vector<float> > gradients{
+    { 1.0f, -2.0f, 0.0f }, { 0.5f, -1.0f, 3.0f }, { -1.0f, 0.25f, 3.0f }
+  };
+  FloatVector param({ 3 }, { 1.0f, 2.0f, 3.0f });
+  AdamOptimizer<float> optimizer(0.1f, 0.8f, 0.9f, 1e-6f);
+  std::vector<ReferenceAdam> reference(3,
+				       ReferenceAdam{ 0.1, 0.8, 0.9, 1e-6,
+						      0.0, 0.0, 0 });
+  std::vector<double> truth{ 1.0, 2.0, 3.0 };
+
+  for (const auto& g : gradients) {
+    optimizer.update(1, 0, param, FloatVector({ 3 }, g.data()));
+    for (size_t i = 0; i < truth.size(); ++i) {
+      truth[i] = reference[i].step(truth[i], g[i]);
+    }
+  }
+  EXPECT_EQ(3, optimizer.numSteps(1, 0));
+  for (size_t i = 0; i < truth.size(); ++i) {
+    EXPECT_NEAR(truth[i], param.data()[i], 1e-5) << "at index " << i;
+  }
+
+  EXPECT_THROW(optimizer.update(1, 0, param, FloatVector({ 2 }, 1.0f)),
+	       ex::IllegalValueError);
+  FloatVector other({ 2 }, 0.0f);
+  EXPECT_THROW(optimizer.update(1, 0, other, FloatVector({ 2 }, 1.0f)),
+	       ex::IllegalValueError);
+}
+
+TEST(AdamOptimizerTests, UpdateRowsIsLazy) {
+  // Row 0 is updated twice, row 2 once and row 1 never.  Rows keep their
+  // moments between the updates that touch them.
+  FloatMatrix param({ 3, 2 }, { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f });
+  AdamOptimizer<float> optimizer(0.1f, 0.8f, 0.9f, 1e-6f);
+  const std::vector<float> g0{ 1.0f, -1.0f }, g2{ 2.0f, 0.5f };
+  FloatSparseRowMatrix first(3, 2), second(3, 2);
+  first.append(0, g0.data());
+  second.append(0, g0.data());
+  second.append(2, g2.data());
+
+  optimizer.updateRows(1, 0, param, first);
+  optimizer.updateRows(1, 0, param, second);
+  EXPECT_EQ(2, optimizer.numSteps(1, 0));
+
+  const ReferenceAdam initial{ 0.1, 0.8, 0.9, 1e-6, 0.0, 0.0, 0 };
+  std::vector<ReferenceAdam> reference(6, initial);
+  std::vector<double> truth{ 1.0, 2.0, 3.0, 4.0, 5.0, 6.0 };
+  for (int step = 0; step < 2; ++step) {
+    truth[0] = reference[0].step(truth[0], g0[0]);
+    truth[1] = reference[1].step(truth[1], g0[1]);
+  }
+  // The step count is shared by the whole table, so row 2's single
+  // update is bias corrected as the second step
+  reference[4].t = reference[5].t = 1;
+  truth[4] = reference[4].step(truth[4], g2[0]);
+  truth[5] = reference[5].step(truth[5], g2[1]);
+
+  for (size_t i = 0; i < truth.size(); ++i) {
+    EXPECT_NEAR(truth[i], param.data()[i], 1e-5) << "at index " << i;
+  }
+
+  EXPECT_THROW(optimizer.updateRows(1, 0, param, FloatSparseRowMatrix(4, 2)),
+	       ex::IllegalValueError);
+}
@@ -82,6 +82,27 @@ TEST(ForwardStateMapTests, SetActivation) {
   EXPECT_TRUE(forwardState.activations(V_ID).cast<1>().refersTo(v2));
 }
 
+TEST(ForwardStateMapTests, SetMask) {
+  static const size_t ID = 4;
+  FloatForwardState forwardState;
+
+  EXPECT_EQ(0, forwardState.numMasks());
+  forwardState.setMask(ID, FloatForwardState::MaskType({ 2 }, { 5, 7 }));
+  EXPECT_EQ(1, forwardState.numMasks());
+  EXPECT_EQ(std::vector<size_t>{ ID }, forwardState.maskIds());
+  EXPECT_EQ(5, forwardState.mask(ID).data()[0]);
+  EXPECT_EQ(7, forwardState.mask(ID).data()[1]);
+
+  forwardState.setMask(ID, FloatForwardState::MaskType({ 1 }, { 9 }));
+  EXPECT_EQ(1, forwardState.numMasks());
+  EXPECT_EQ(1, forwardState.mask(ID).size());
+  EXPECT_EQ(9, forwardState.mask(ID).data()[0]);
+  EXPECT_THROW(forwardState.mask(ID + 1), ex::NoSuchItem);
+
+  forwardState.reset();
+  EXPECT_EQ(0, forwardState.numMasks());
+}
+
 TEST(ForwardStateMapTests, Reset) {
   static const size_t V_ID = 3;
   static const size_t M_ID = 9;
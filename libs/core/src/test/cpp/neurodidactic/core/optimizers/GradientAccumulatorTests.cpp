@@ -0,0 +1,238 @@
+#include <neurodidactic/core/optimizers/GradientAccumulator.hpp>
+
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/arrays/SparseRowMatrix.hpp>
+#include <neurodidactic/core/arrays/SparseVector.hpp>
+#include <neurodidactic/core/optimizers/AdamOptimizer.hpp>
+#include <neurodidactic/core/optimizers/SgdOptimizer.hpp>
+#include <neurodidactic/testing/MdArrayVerification.hpp>
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using neurodidactic::testing::verifyMdArray;
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::optimizers;
+namespace ex = pistis::exceptions;
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<2, float> FloatMatrix;
+  typedef GradientAccumulator<float> FloatAccumulator;
+}
+
+TEST(GradientAccumulatorTests, AccumulateGradients) {
+  FloatMatrix w({ 2, 2 }, { 1.0f, 2.0f, 3.0f, 4.0f });
+  FloatVector b({ 2 }, { 1.0f, -1.0f });
+  FloatAccumulator gradients;
+
+  gradients.update(3, 0, w, FloatMatrix({ 2, 2 }, { 1.0f, 1.0f, 2.0f, 2.0f }));
+  gradients.update(3, 1, b, FloatVector({ 2 }, { 0.5f, 0.5f }));
+  gradients.update(3, 0, w, FloatMatrix({ 2, 2 }, { 1.0f, 0.0f, 1.0f, 0.0f }));
+
+  ASSERT_EQ(2, gradients.numEntries());
+  EXPECT_EQ(3, gradients.layerId(0));
+  EXPECT_EQ(0, gradients.paramId(0));
+  EXPECT_EQ(1, gradients.paramId(1));
+  EXPECT_TRUE(verifyMdArray({ 2, 2 }, { 2.0f, 1.0f, 3.0f, 2.0f },
+			    FloatMatrix({ 2, 2 }, gradients.gradient(0))));
+  EXPECT_TRUE(verifyMdArray({ 2 }, { 0.5f, 0.5f },
+			    FloatVector({ 2 }, gradients.gradient(1))));
+
+  EXPECT_THROW(gradients.update(3, 1, b, FloatVector({ 3 }, 1.0f)),
+	       ex::IllegalValueError);
+
+  gradients.scale(2.0f);
+  EXPECT_TRUE(verifyMdArray({ 2 }, { 1.0f, 1.0f },
+			    FloatVector({ 2 }, gradients.gradient(1))));
+
+  gradients.clear();
+  ASSERT_EQ(2, gradients.numEntries());
+  EXPECT_TRUE(verifyMdArray({ 2 }, { 0.0f, 0.0f },
+			    FloatVector({ 2 }, gradients.gradient(1))));
+}
+
+TEST(GradientAccumulatorTests, AccumulateColumnUpdates) {
+  FloatMatrix w({ 2, 3 }, 0.0f);
+  FloatAccumulator gradients;
+  FloatAccumulator other;
+  SgdOptimizer<float> optimizer(1.0f);
+  const SparseVector<float> columns(3, { 0, 2 }, { 1.0f, 2.0f });
+
+  gradients.updateColumns(3, 0, w, FloatVector({ 2 }, { 1.0f, -1.0f }),
+			  columns);
+  gradients.update(3, 0, w, FloatMatrix({ 2, 3 }, 1.0f));
+  other.update(3, 0, w, FloatMatrix({ 2, 3 }, 0.0f));
+  other.updateColumns(3, 0, w, FloatVector({ 2 }, { 0.0f, 1.0f }),
+		      SparseVector<float>(3, { 1 }, { 1.0f }));
+
+  ASSERT_EQ(1, gradients.numEntries());
+  EXPECT_EQ(1, gradients.numColumnUpdates());
+  EXPECT_TRUE(verifyMdArray({ 2, 3 }, { 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f },
+			    FloatMatrix({ 2, 3 }, gradients.gradient(0))));
+  EXPECT_THROW(gradients.updateColumns(3, 0, w, FloatVector({ 3 }, 1.0f),
+				       columns),
+	       ex::IllegalValueError);
+
+  gradients.accumulate(other);
+  EXPECT_EQ(2, gradients.numColumnUpdates());
+  gradients.scale(-1.0f);
+  gradients.apply(optimizer);
+  EXPECT_TRUE(verifyMdArray({ 2, 3 }, { 2.0f, 1.0f, 3.0f, 0.0f, 2.0f, -1.0f },
+			    w));
+
+  gradients.clear();
+  EXPECT_EQ(0, gradients.numColumnUpdates());
+}
+
+TEST(GradientAccumulatorTests, SumColumnUpdatesForOptimizersWithout) {
+  // AdamOptimizer has no updateColumns(), so it gets the column updates
+  // of each parameter as one dense gradient and takes one step
+  FloatMatrix w({ 2, 3 }, 0.0f);
+  FloatAccumulator gradients;
+  AdamOptimizer<float> optimizer(0.5f);
+  const SparseVector<float> columns(3, { 0, 2 }, { 1.0f, 2.0f });
+
+  gradients.updateColumns(3, 0, w, FloatVector({ 2 }, { 1.0f, 1.0f }),
+			  columns);
+  gradients.updateColumns(3, 0, w, FloatVector({ 2 }, { -1.0f, 1.0f }),
+			  columns);
+  gradients.apply(optimizer);
+
+  const std::vector<float> expected{ 0.0f, 0.0f, 0.0f, -0.5f, 0.0f, -0.5f };
+  EXPECT_EQ(1, optimizer.numSteps(3, 0));
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_NEAR(expected[i], w.data()[i], 1e-5) << "at " << i;
+  }
+}
+
+TEST(GradientAccumulatorTests, MergeColumnUpdatesIntoDenseGradients) {
+  // A parameter with both kinds of gradient still takes one Adam step,
+  // on their sum
+  FloatMatrix w({ 2, 3 }, 0.0f);
+  FloatAccumulator gradients;
+  AdamOptimizer<float> optimizer(0.5f);
+
+  gradients.update(3, 0, w, FloatMatrix({ 2, 3 }, 1.0f));
+  gradients.updateColumns(3, 0, w, FloatVector({ 2 }, { 1.0f, 1.0f }),
+			  SparseVector<float>(3, { 0 }, { -2.0f }));
+  gradients.apply(optimizer);
+
+  const std::vector<float> expected{ 0.5f, -0.5f, -0.5f, 0.5f, -0.5f, -0.5f };
+  EXPECT_EQ(1, optimizer.numSteps(3, 0));
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_NEAR(expected[i], w.data()[i], 1e-5) << "at " << i;
+  }
+}
+
+TEST(GradientAccumulatorTests, AccumulateRowUpdates) {
+  FloatMatrix w({ 4, 2 }, 0.0f);
+  FloatAccumulator gradients;
+  FloatAccumulator other;
+  const std::vector<float> row{ 1.0f, -1.0f };
+  SparseRowMatrix<float> first(4, 2);
+  SparseRowMatrix<float> second(4, 2);
+  first.append(0, row.data());
+  first.append(2, row.data());
+  second.append(2, row.data());
+  second.append(3, row.data());
+
+  gradients.updateRows(3, 0, w, first);
+  gradients.updateRows(3, 0, w, second);
+  other.updateRows(3, 0, w, second);
+  gradients.accumulateSparse(other);
+
+  EXPECT_EQ(0, gradients.numEntries());
+  ASSERT_EQ(1, gradients.numRowUpdates());
+  const SparseRowMatrix<float>& sum = gradients.rowGradient(0);
+  ASSERT_EQ(3, sum.numNonZeroRows());
+  EXPECT_EQ(std::vector<uint32_t>({ 0, 2, 3 }),
+	    std::vector<uint32_t>(sum.indices(), sum.indices() + 3));
+  EXPECT_EQ(std::vector<float>({ 1.0f, -1.0f, 3.0f, -3.0f, 2.0f, -2.0f }),
+	    std::vector<float>(sum.values(), sum.values() + 6));
+  EXPECT_THROW(gradients.updateRows(3, 0, w, SparseRowMatrix<float>(2, 2)),
+	       ex::IllegalValueError);
+
+  gradients.clear();
+  EXPECT_EQ(0, gradients.numRowUpdates());
+}
+
+TEST(GradientAccumulatorTests, ApplyRowUpdatesLazily) {
+  // A dense gradient would let Adam's momentum move row 0 again in the
+  // second step, though only row 2 is updated then
+  FloatMatrix w({ 3, 2 }, 1.0f);
+  FloatAccumulator gradients;
+  AdamOptimizer<float> optimizer(0.1f);
+  const std::vector<float> row{ 1.0f, -1.0f };
+  SparseRowMatrix<float> first(3, 2);
+  SparseRowMatrix<float> second(3, 2);
+  first.append(0, row.data());
+  second.append(2, row.data());
+
+  gradients.updateRows(3, 0, w, first);
+  gradients.apply(optimizer);
+  const std::vector<float> afterFirst(w.data(), w.data() + 2);
+  EXPECT_NE(1.0f, afterFirst[0]);
+
+  gradients.clear();
+  gradients.updateRows(3, 0, w, second);
+  gradients.apply(optimizer);
+  EXPECT_EQ(afterFirst, std::vector<float>(w.data(), w.data() + 2));
+  EXPECT_EQ(1.0f, w.data()[2]);
+  EXPECT_EQ(1.0f, w.data()[3]);
+  EXPECT_NE(1.0f, w.data()[4]);
+}
+
+TEST(GradientAccumulatorTests, MergeRowUpdatesIntoDenseGradients) {
+  // Tied weights, such as an embedding table that is also an output
+  // layer, get one Adam step on the sum of both gradients
+  FloatMatrix w({ 2, 2 }, 0.0f);
+  FloatAccumulator gradients;
+  AdamOptimizer<float> optimizer(0.5f);
+  const std::vector<float> row{ -2.0f, 1.0f };
+  SparseRowMatrix<float> rows(2, 2);
+  rows.append(1, row.data());
+
+  gradients.update(3, 0, w, FloatMatrix({ 2, 2 }, 1.0f));
+  gradients.updateRows(3, 0, w, rows);
+  gradients.apply(optimizer);
+
+  const std::vector<float> expected{ -0.5f, -0.5f, 0.5f, -0.5f };
+  EXPECT_EQ(1, optimizer.numSteps(3, 0));
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_NEAR(expected[i], w.data()[i], 1e-5) << "at " << i;
+  }
+}
+
+TEST(GradientAccumulatorTests, CombineAccumulators) {
+  FloatVector b({ 3 }, 0.0f);
+  FloatAccumulator first;
+  FloatAccumulator second;
+  FloatAccumulator other;
+
+  first.update(1, 1, b, FloatVector({ 3 }, { 1.0f, 2.0f, 3.0f }));
+  second.update(1, 1, b, FloatVector({ 3 }, { 3.0f, 2.0f, 1.0f }));
+  other.update(2, 1, b, FloatVector({ 3 }, { 3.0f, 2.0f, 1.0f }));
+
+  EXPECT_TRUE(first.compatibleWith(second));
+  EXPECT_FALSE(first.compatibleWith(other));
+
+  first.accumulate(second);
+  EXPECT_TRUE(verifyMdArray({ 3 }, { 4.0f, 4.0f, 4.0f },
+			    FloatVector({ 3 }, first.gradient(0))));
+  EXPECT_THROW(first.accumulate(other), ex::IllegalValueError);
+}
+
+TEST(GradientAccumulatorTests, ApplyGradients) {
+  FloatMatrix w({ 2, 2 }, { 1.0f, 2.0f, 3.0f, 4.0f });
+  FloatVector b({ 2 }, { 1.0f, -1.0f });
+  FloatAccumulator gradients;
+  SgdOptimizer<float> optimizer(0.5f);
+
+  gradients.update(3, 0, w, FloatMatrix({ 2, 2 }, { 1.0f, 1.0f, 2.0f, 2.0f }));
+  gradients.update(3, 1, b, FloatVector({ 2 }, { 2.0f, -2.0f }));
+  gradients.apply(optimizer);
+
+  EXPECT_TRUE(verifyMdArray({ 2, 2 }, { 0.5f, 1.5f, 2.0f, 3.0f }, w));
+  EXPECT_TRUE(verifyMdArray({ 2 }, { 0.0f, 0.0f }, b));
+}
@@ -0,0 +1,86 @@
+#include <neurodidactic/core/optimizers/HogwildSgdOptimizer.hpp>
+
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/arrays/SparseRowMatrix.hpp>
+#include <neurodidactic/core/arrays/SparseVector.hpp>
+#include <neurodidactic/testing/MdArrayVerification.hpp>
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+using neurodidactic::testing::verifyMdArray;
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::optimizers;
+namespace ex = pistis::exceptions;
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<2, float> FloatMatrix;
+}
+
+TEST(HogwildSgdOptimizerTests, Update) {
+  FloatMatrix w({ 2, 2 }, { 1.0f, 2.0f, 3.0f, 4.0f });
+  HogwildSgdOptimizer<float> optimizer(0.5f);
+
+  optimizer.update(1, 0, w, FloatMatrix({ 2, 2 }, { 2.0f, 0.0f, -2.0f, 4.0f }));
+  EXPECT_TRUE(verifyMdArray({ 2, 2 }, { 0.0f, 2.0f, 4.0f, 2.0f }, w));
+
+  EXPECT_THROW(optimizer.update(1, 0, w, FloatVector({ 3 }, 1.0f)),
+	       ex::IllegalValueError);
+}
+
+TEST(HogwildSgdOptimizerTests, UpdateColumns) {
+  FloatMatrix w({ 2, 3 }, { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f });
+  HogwildSgdOptimizer<float> optimizer(0.5f);
+  const SparseVector<float> columns(3, { 1 }, { 2.0f });
+
+  optimizer.updateColumns(1, 0, w, FloatVector({ 2 }, { 1.0f, -1.0f }),
+			  columns);
+  EXPECT_TRUE(verifyMdArray({ 2, 3 },
+			    { 1.0f, 1.0f, 3.0f, 4.0f, 6.0f, 6.0f }, w));
+
+  EXPECT_THROW(optimizer.updateColumns(1, 0, w, FloatVector({ 3 }, 1.0f),
+				       columns),
+	       ex::IllegalValueError);
+}
+
+TEST(HogwildSgdOptimizerTests, UpdateRows) {
+  FloatMatrix w({ 3, 2 }, { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f });
+  HogwildSgdOptimizer<float> optimizer(0.5f);
+  const std::vector<float> row{ 2.0f, -2.0f };
+  SparseRowMatrix<float> rows(3, 2);
+  rows.append(1, row.data());
+
+  optimizer.updateRows(1, 0, w, rows);
+  EXPECT_TRUE(verifyMdArray({ 3, 2 },
+			    { 1.0f, 2.0f, 2.0f, 5.0f, 5.0f, 6.0f }, w));
+
+  EXPECT_THROW(optimizer.updateRows(1, 0, w, SparseRowMatrix<float>(3, 3)),
+	       ex::IllegalValueError);
+}
+
+TEST(HogwildSgdOptimizerTests, ConcurrentUpdatesToDisjointElements) {
+  const uint32_t numThreads = 4;
+  const uint32_t numSteps = 1000;
+  FloatVector param({ numThreads }, 0.0f);
+  HogwildSgdOptimizer<float> optimizer(1.0f);
+  std::vector<std::thread> threads;
+
+  for (uint32_t t = 0; t < numThreads; ++t) {
+    threads.emplace_back([&, t]() {
+	FloatVector gradient({ numThreads }, 0.0f);
+	gradient.data()[t] = -1.0f;
+	for (uint32_t i = 0; i < numSteps; ++i) {
+	  optimizer.update(1, 1, param, gradient);
+	}
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  EXPECT_TRUE(verifyMdArray({ numThreads },
+			    std::vector<float>(numThreads, float(numSteps)),
+			    param));
+}
@@ -0,0 +1,156 @@
+#include <neurodidactic/core/parallel/ThreadPool.hpp>
+#include <neurodidactic/core/parallel/Elementwise.hpp>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace neurodidactic::core::parallel;
+
+namespace {
+  struct ExpensiveFunction {
+    static constexpr const size_t GRAIN_SIZE = 256;
+    float operator()(float x) const { return x * 3.0f; }
+  };
+}
+
+TEST(ThreadPoolTests, ParallelForCoversRangeOnce) {
+  ThreadPool pool(4);
+  std::vector<std::atomic<int>> counts(10007);
+  for (auto& c : counts) {
+    c.store(0);
+  }
+
+  pool.parallelFor(3, counts.size(), 100,
+		   [&counts](size_t begin, size_t end) {
+		     for (size_t i = begin; i < end; ++i) {
+		       counts[i].fetch_add(1);
+		     }
+		   });
+
+  for (size_t i = 0; i < counts.size(); ++i) {
+    ASSERT_EQ((i < 3) ? 0 : 1, counts[i].load()) << "at " << i;
+  }
+}
+
+TEST(ThreadPoolTests, ChunksAreAligned) {
+  ThreadPool pool(3);
+  std::mutex mutex;
+  std::vector< std::pair<size_t, size_t> > chunks;
+
+  pool.parallelFor(0, 5000, 10,
+		   [&](size_t begin, size_t end) {
+		     std::unique_lock<std::mutex> lock(mutex);
+		     chunks.push_back(std::make_pair(begin, end));
+		   },
+		   16);
+
+  EXPECT_GT(chunks.size(), 1);
+  for (const auto& c : chunks) {
+    EXPECT_EQ(0, c.first % 16);
+    EXPECT_TRUE((c.second == 5000) || (c.second % 16 == 0));
+  }
+}
+
+TEST(ThreadPoolTests, SmallRangesRunSerially) {
+  ThreadPool pool(4);
+  size_t numCalls = 0;
+  std::thread::id caller;
+
+  pool.parallelFor(0, 100, 100, [&](size_t begin, size_t end) {
+      ++numCalls;
+      caller = std::this_thread::get_id();
+      EXPECT_EQ(0, begin);
+      EXPECT_EQ(100, end);
+  });
+  EXPECT_EQ(1, numCalls);
+  EXPECT_EQ(std::this_thread::get_id(), caller);
+
+  pool.parallelFor(5, 5, 1, [&](size_t, size_t) { ++numCalls; });
+  EXPECT_EQ(1, numCalls);
+}
+
+TEST(ThreadPoolTests, NestedLoopsRunSerially) {
+  ThreadPool pool(4);
+  std::atomic<size_t> total(0);
+
+  pool.parallelFor(0, 64, 1, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+	pool.parallelFor(0, 1000, 1, [&](size_t b, size_t e) {
+	    EXPECT_TRUE(SerialRegion::active());
+	    total.fetch_add(e - b);
+	});
+      }
+  });
+  EXPECT_EQ(64000, total.load());
+  EXPECT_FALSE(SerialRegion::active());
+}
+
+TEST(ThreadPoolTests, PropagateExceptions) {
+  ThreadPool pool(4);
+  std::atomic<size_t> done(0);
+
+  EXPECT_THROW(
+      pool.parallelFor(0, 1000, 10, [&](size_t begin, size_t end) {
+	  if ((begin <= 500) && (500 < end)) {
+	    throw std::runtime_error("Chunk failed");
+	  }
+	  done.fetch_add(end - begin);
+      }),
+      std::runtime_error
+  );
+  EXPECT_LT(done.load(), 1000);
+
+  // The pool is still usable afterwards
+  done.store(0);
+  pool.parallelFor(0, 1000, 10, [&](size_t begin, size_t end) {
+      done.fetch_add(end - begin);
+  });
+  EXPECT_EQ(1000, done.load());
+}
+
+TEST(ThreadPoolTests, ConcurrentCallers) {
+  ThreadPool pool(3);
+  std::vector<std::thread> callers;
+  std::atomic<size_t> total(0);
+
+  for (size_t t = 0; t < 4; ++t) {
+    callers.emplace_back([&]() {
+	for (size_t n = 0; n < 50; ++n) {
+	  pool.parallelFor(0, 4096, 64, [&](size_t begin, size_t end) {
+	      total.fetch_add(end - begin);
+	  });
+	}
+    });
+  }
+  for (auto& t : callers) {
+    t.join();
+  }
+  EXPECT_EQ(4 * 50 * 4096, total.load());
+}
+
+TEST(ThreadPoolTests, Elementwise) {
+  std::vector<float> x(100000);
+  std::vector<float> y(x.size());
+  for (size_t i = 0; i < x.size(); ++i) {
+    x[i] = float(i % 17);
+  }
+
+  EXPECT_EQ(256, size_t(GrainSize<ExpensiveFunction>::value));
+  EXPECT_EQ(DEFAULT_GRAIN_SIZE,
+	    size_t(GrainSize< std::negate<float> >::value));
+
+  elementwise(x.size(), x.data(), y.data(), ExpensiveFunction());
+  for (size_t i = 0; i < x.size(); ++i) {
+    ASSERT_EQ(3.0f * x[i], y[i]) << "at " << i;
+  }
+
+  elementwise(x.size(), y.data(), y.data(), std::negate<float>());
+  for (size_t i = 0; i < x.size(); ++i) {
+    ASSERT_EQ(-3.0f * x[i], y[i]) << "at " << i;
+  }
+}
@@ -0,0 +1,177 @@
+#include <neurodidactic/core/profiling/AllocationTelemetry.hpp>
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/layers/FullyConnectedLayer.hpp>
+#include <neurodidactic/core/layers/Nonlinearities.hpp>
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::layers;
+using namespace neurodidactic::core::profiling;
+namespace nl = neurodidactic::core::layers::nonlinearities;
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<2, float> FloatMatrix;
+}
+
+TEST(AllocationTelemetryTests, SizeClasses) {
+  EXPECT_EQ(0, AllocationTelemetry::sizeClass(0));
+  EXPECT_EQ(0, AllocationTelemetry::sizeClass(1));
+  EXPECT_EQ(1, AllocationTelemetry::sizeClass(2));
+  EXPECT_EQ(1, AllocationTelemetry::sizeClass(3));
+  EXPECT_EQ(10, AllocationTelemetry::sizeClass(1024));
+  EXPECT_EQ(10, AllocationTelemetry::sizeClass(2047));
+  EXPECT_EQ(AllocationTelemetry::NUM_SIZE_CLASSES - 1,
+	    AllocationTelemetry::sizeClass(~size_t(0)));
+}
+
+TEST(AllocationTelemetryTests, RecordAllocations) {
+  const uint16_t tag = AllocationTelemetry::tag("record allocations");
+  EXPECT_EQ(tag, AllocationTelemetry::tag("record allocations"));
+  EXPECT_NE(uint16_t(AllocationTelemetry::UNTAGGED), tag);
+
+  const AllocationCounters before = AllocationTelemetry::totals();
+  AllocationTelemetry::recordAllocation(tag, 100);
+  AllocationTelemetry::recordAllocation(tag, 120);
+  AllocationTelemetry::recordRelease(tag, 100);
+  AllocationTelemetry::recordAllocation(tag, 4096);
+
+  const AllocationCounters counters = AllocationTelemetry::counters(tag);
+  EXPECT_EQ("record allocations", counters.tag);
+  EXPECT_EQ(3, counters.numAllocations);
+  EXPECT_EQ(1, counters.numReleases);
+  EXPECT_EQ(2, counters.liveArrays);
+  EXPECT_EQ(4216, counters.liveBytes);
+  EXPECT_EQ(4216, counters.peakBytes);
+  EXPECT_EQ(4316, counters.totalBytes);
+  EXPECT_EQ(size_t(AllocationTelemetry::NUM_SIZE_CLASSES),
+	    counters.allocationsBySizeClass.size());
+  EXPECT_EQ(2, counters.allocationsBySizeClass[6]);
+  EXPECT_EQ(1, counters.allocationsBySizeClass[12]);
+
+  const AllocationCounters after = AllocationTelemetry::totals();
+  EXPECT_EQ(before.numAllocations + 3, after.numAllocations);
+  EXPECT_EQ(before.totalBytes + 4316, after.totalBytes);
+
+  AllocationTelemetry::recordRelease(tag, 120);
+  AllocationTelemetry::recordRelease(tag, 4096);
+  EXPECT_EQ(0, AllocationTelemetry::counters(tag).liveBytes);
+  EXPECT_EQ(4216, AllocationTelemetry::counters(tag).peakBytes);
+
+  bool listed = false;
+  for (const AllocationCounters& c : AllocationTelemetry::countersByTag()) {
+    listed = listed || (c.tag == "record allocations");
+  }
+  EXPECT_TRUE(listed);
+
+  std::ostringstream report;
+  AllocationTelemetry::write(report);
+  EXPECT_NE(std::string::npos, report.str().find("record allocations"));
+}
+
+TEST(AllocationTelemetryTests, Reset) {
+  const uint16_t tag = AllocationTelemetry::tag("reset");
+  AllocationTelemetry::recordAllocation(tag, 64);
+  AllocationTelemetry::recordAllocation(tag, 64);
+  AllocationTelemetry::recordRelease(tag, 64);
+  AllocationTelemetry::reset();
+
+  AllocationCounters counters = AllocationTelemetry::counters(tag);
+  EXPECT_EQ(0, counters.numAllocations);
+  EXPECT_EQ(0, counters.totalBytes);
+  EXPECT_EQ(1, counters.liveArrays);
+  EXPECT_EQ(64, counters.liveBytes);
+  EXPECT_EQ(64, counters.peakBytes);
+
+  AllocationTelemetry::recordRelease(tag, 64);
+  counters = AllocationTelemetry::counters(tag);
+  EXPECT_EQ(0, counters.liveArrays);
+  EXPECT_EQ(0, counters.liveBytes);
+}
+
+TEST(AllocationTelemetryTests, ScopesNest) {
+  const uint16_t outer = AllocationTelemetry::tag("outer");
+  EXPECT_EQ(uint16_t(AllocationTelemetry::UNTAGGED),
+	    AllocationTelemetry::currentTag());
+  {
+    AllocationScope scope("outer");
+    EXPECT_EQ(outer, AllocationTelemetry::currentTag());
+    {
+      AllocationScope inner("inner", 3);
+      EXPECT_EQ(AllocationTelemetry::tag("inner 3"),
+		AllocationTelemetry::currentTag());
+    }
+    EXPECT_EQ(outer, AllocationTelemetry::currentTag());
+  }
+  EXPECT_EQ(uint16_t(AllocationTelemetry::UNTAGGED),
+	    AllocationTelemetry::currentTag());
+}
+
+TEST(AllocationTelemetryTests, LayerTags) {
+  const char* region = "layer tags";
+  const std::string copy(region);
+  const uint16_t tag = AllocationTelemetry::layerTag(region, 12);
+
+  EXPECT_EQ(AllocationTelemetry::tag("layer tags 12"), tag);
+  EXPECT_EQ(tag, AllocationTelemetry::layerTag(region, 12));
+  EXPECT_EQ(tag, AllocationTelemetry::layerTag(copy.c_str(), 12));
+  EXPECT_NE(tag, AllocationTelemetry::layerTag(region, 13));
+
+  // Fill the cache with copies of the region at other addresses, which
+  // evict each other but still find the same tag
+  const std::vector<std::string> copies(1024, copy);
+  for (const std::string& c : copies) {
+    EXPECT_EQ(tag, AllocationTelemetry::layerTag(c.c_str(), 12));
+  }
+  EXPECT_EQ(tag, AllocationTelemetry::layerTag(region, 12));
+}
+
+TEST(AllocationTelemetryTests, CountArrayAllocations) {
+  const size_t bytes = 6 * sizeof(float);
+  float external[6];
+  std::unique_ptr<FloatMatrix> array;
+  {
+    AllocationScope scope("arrays");
+    array.reset(new FloatMatrix({ 2, 3 }, 1.0f));
+    FloatMatrix copy(*array);
+    FloatMatrix wrapped = FloatMatrix::wrap({ 2, 3 }, external);
+  }
+
+  AllocationCounters counters = AllocationTelemetry::counters("arrays");
+  if (AllocationTelemetry::enabled()) {
+    // The wrapped array does not allocate its data
+    EXPECT_EQ(2, counters.numAllocations);
+    EXPECT_EQ(1, counters.numReleases);
+    EXPECT_EQ(bytes, counters.liveBytes);
+    EXPECT_EQ(2 * bytes, counters.peakBytes);
+  } else {
+    EXPECT_EQ(0, counters.numAllocations);
+  }
+
+  // Released outside the scope, but charged to it
+  array.reset();
+  counters = AllocationTelemetry::counters("arrays");
+  EXPECT_EQ(0, counters.liveArrays);
+  EXPECT_EQ(0, counters.liveBytes);
+}
+
+TEST(AllocationTelemetryTests, CountLayerAllocations) {
+  FullyConnectedLayer<float, nl::ReLU> layer(
+      41, FloatMatrix({ 2, 3 }, 1.0f), FloatVector({ 2 }, 0.0f)
+  );
+  const FloatVector x({ 3 }, { 1.0f, 2.0f, 3.0f });
+  layer.forward(x);
+
+  const AllocationCounters counters =
+      AllocationTelemetry::counters("forward 41");
+  if (AllocationTelemetry::enabled()) {
+    EXPECT_LT(0, counters.numAllocations);
+    EXPECT_EQ(counters.numAllocations, counters.numReleases);
+  } else {
+    EXPECT_EQ(0, counters.numAllocations);
+  }
+}
@@ -0,0 +1,85 @@
+#include <neurodidactic/core/profiling/KernelAccounting.hpp>
+#include <neurodidactic/core/arrays/detail/MklAdapter.hpp>
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace neurodidactic::core::profiling;
+
+namespace {
+  typedef neurodidactic::core::arrays::detail::MklAdapter<float, float>
+      MklAdapter;
+}
+
+TEST(KernelAccountingTests, SizeClasses) {
+  EXPECT_EQ(0, KernelAccounting::sizeClass(0));
+  EXPECT_EQ(0, KernelAccounting::sizeClass(1));
+  EXPECT_EQ(2, KernelAccounting::sizeClass(4));
+  EXPECT_EQ(12, KernelAccounting::sizeClass(4096));
+  EXPECT_EQ(12, KernelAccounting::sizeClass(8191));
+  EXPECT_EQ(KernelAccounting::NUM_SIZE_CLASSES - 1,
+	    KernelAccounting::sizeClass(~uint64_t(0)));
+}
+
+TEST(KernelAccountingTests, RecordCalls) {
+  KernelAccounting::reset();
+  KernelAccounting::record(KernelOp::GEMM, 2000, 400, 100);
+  KernelAccounting::record(KernelOp::GEMM, 4000, 800, 300);
+
+  const KernelCounters c = KernelAccounting::counters(KernelOp::GEMM);
+  EXPECT_EQ("gemm", c.name);
+  EXPECT_EQ(2, c.numCalls);
+  EXPECT_EQ(6000, c.flops);
+  EXPECT_EQ(1200, c.bytes);
+  EXPECT_EQ(400, c.nanoseconds);
+  EXPECT_DOUBLE_EQ(15.0, c.gflopsPerSecond());
+  EXPECT_DOUBLE_EQ(3.0, c.gbytesPerSecond());
+  EXPECT_DOUBLE_EQ(5.0, c.arithmeticIntensity());
+  EXPECT_DOUBLE_EQ(200.0, c.nanosecondsPerCall());
+  EXPECT_EQ(1, c.callsBySizeClass[8]);
+  EXPECT_EQ(1, c.callsBySizeClass[9]);
+
+  const std::vector<KernelCounters> byOp = KernelAccounting::countersByOp();
+  ASSERT_EQ(1, byOp.size());
+  EXPECT_EQ(KernelOp::GEMM, byOp[0].op);
+
+  std::ostringstream table;
+  KernelAccounting::write(table);
+  EXPECT_NE(std::string::npos, table.str().find("gemm"));
+  EXPECT_EQ(std::string::npos, table.str().find("gemv"));
+
+  std::ostringstream histograms;
+  KernelAccounting::writeSizeHistograms(histograms);
+  EXPECT_NE(std::string::npos, histograms.str().find("2^8:1 2^9:1"));
+
+  KernelAccounting::reset();
+  EXPECT_EQ(0, KernelAccounting::counters(KernelOp::GEMM).numCalls);
+  EXPECT_TRUE(KernelAccounting::countersByOp().empty());
+}
+
+TEST(KernelAccountingTests, CountAdapterCalls) {
+  const size_t m = 3, n = 4, k = 5;
+  std::vector<float> x(m * k, 1.0f), u(k * n, 1.0f), y(m * n, 0.0f);
+
+  KernelAccounting::reset();
+  MklAdapter::add(m * k, x.data(), x.data(), x.data());
+  MklAdapter::multiplyMatrixByMatrix(m, n, k, x.data(), u.data(),
+				     y.data());
+
+  const KernelCounters add = KernelAccounting::counters(KernelOp::ADD);
+  const KernelCounters gemm = KernelAccounting::counters(KernelOp::GEMM);
+  if (KernelAccounting::enabled()) {
+    EXPECT_EQ(1, add.numCalls);
+    EXPECT_EQ(m * k, add.flops);
+    EXPECT_EQ(3 * m * k * sizeof(float), add.bytes);
+    EXPECT_EQ(1, gemm.numCalls);
+    EXPECT_EQ(2 * m * n * k, gemm.flops);
+    EXPECT_EQ((m * k + k * n + m * n) * sizeof(float), gemm.bytes);
+  } else {
+    EXPECT_EQ(0, add.numCalls);
+    EXPECT_EQ(0, gemm.numCalls);
+  }
+  KernelAccounting::reset();
+}
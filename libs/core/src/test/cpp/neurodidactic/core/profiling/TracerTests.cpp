@@ -0,0 +1,204 @@
+#include <neurodidactic/core/profiling/Tracer.hpp>
+#include <neurodidactic/core/arrays/MdArray.hpp>
+#include <neurodidactic/core/layers/FullyConnectedLayer.hpp>
+#include <neurodidactic/core/layers/Nonlinearities.hpp>
+#include <neurodidactic/core/optimizers/ForwardStateMap.hpp>
+#include <neurodidactic/core/optimizers/SgdOptimizer.hpp>
+#include <gtest/gtest.h>
+
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::layers;
+using namespace neurodidactic::core::optimizers;
+using namespace neurodidactic::core::profiling;
+namespace nl = neurodidactic::core::layers::nonlinearities;
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<2, float> FloatMatrix;
+
+  // Starts each test with tracing enabled and no spans recorded
+  class TracerTests : public ::testing::Test {
+  protected:
+    void SetUp() override {
+      Tracer::clear();
+      Tracer::enable();
+    }
+
+    void TearDown() override {
+      Tracer::disable();
+      Tracer::clear();
+    }
+  };
+
+  size_t countSpans(const std::vector<TraceSpan>& spans,
+		    const std::string& name, uint32_t layerId) {
+    size_t n = 0;
+    for (const TraceSpan& span : spans) {
+      if ((name == span.name) && (span.layerId == layerId)) {
+	++n;
+      }
+    }
+    return n;
+  }
+}
+
+TEST_F(TracerTests, RecordSpans) {
+  {
+    TraceScope outer("outer", 7);
+    TraceScope inner("inner");
+  }
+
+  const std::vector<TraceSpan> spans = Tracer::spans();
+  ASSERT_EQ(2, spans.size());
+  EXPECT_EQ(std::string("outer"), spans[0].name);
+  EXPECT_EQ(7, spans[0].layerId);
+  EXPECT_EQ(std::string("inner"), spans[1].name);
+  EXPECT_EQ(uint32_t(Tracer::NO_LAYER), spans[1].layerId);
+  EXPECT_LE(spans[0].begin, spans[1].begin);
+  EXPECT_LE(spans[1].begin, spans[1].end);
+  EXPECT_LE(spans[1].end, spans[0].end);
+  EXPECT_EQ(spans[0].thread, spans[1].thread);
+}
+
+TEST_F(TracerTests, DisabledTracerRecordsNothing) {
+  Tracer::disable();
+  {
+    TraceScope scope("ignored", 1);
+  }
+  EXPECT_TRUE(Tracer::spans().empty());
+
+  Tracer::enable();
+  {
+    TraceScope scope("recorded", 1);
+  }
+  EXPECT_EQ(1, Tracer::spans().size());
+}
+
+TEST_F(TracerTests, RecordManyBlocks) {
+  const size_t numSpans = 2 * Tracer::BLOCK_SIZE + 10;
+  for (size_t i = 0; i < numSpans; ++i) {
+    Tracer::record("span", uint32_t(i), int64_t(i), int64_t(i + 1));
+  }
+
+  const std::vector<TraceSpan> spans = Tracer::spans();
+  ASSERT_EQ(numSpans, spans.size());
+  for (size_t i = 0; i < numSpans; ++i) {
+    EXPECT_EQ(i, spans[i].layerId);
+  }
+
+  Tracer::clear();
+  EXPECT_TRUE(Tracer::spans().empty());
+}
+
+TEST_F(TracerTests, RecordFromManyThreads) {
+  const size_t numThreads = 4;
+  const size_t spansPerThread = 1000;
+  std::vector<std::thread> threads;
+
+  for (size_t i = 0; i < numThreads; ++i) {
+    threads.emplace_back([i, spansPerThread]() {
+	for (size_t j = 0; j < spansPerThread; ++j) {
+	  TraceScope scope("work", uint32_t(i));
+	}
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  const std::vector<TraceSpan> spans = Tracer::spans();
+  ASSERT_EQ(numThreads * spansPerThread, spans.size());
+  for (size_t i = 1; i < spans.size(); ++i) {
+    EXPECT_LE(spans[i - 1].begin, spans[i].begin);
+  }
+
+  // Every worker has its own buffer and its own thread number
+  std::set<uint32_t> threadNumbers;
+  for (size_t i = 0; i < numThreads; ++i) {
+    EXPECT_EQ(spansPerThread, countSpans(spans, "work", uint32_t(i)));
+  }
+  for (const TraceSpan& span : spans) {
+    threadNumbers.insert(span.thread);
+  }
+  EXPECT_EQ(numThreads, threadNumbers.size());
+}
+
+TEST_F(TracerTests, Summary) {
+  Tracer::record("forward", 1, 0, 1000);
+  Tracer::record("forward", 1, 2000, 5000);
+  Tracer::record("forward", 2, 5000, 5500);
+  Tracer::record("update", 1, 6000, 16000);
+
+  const std::vector<TraceSummary> summary = Tracer::summary();
+  ASSERT_EQ(3, summary.size());
+
+  EXPECT_EQ("update", summary[0].name);
+  EXPECT_EQ(1, summary[0].numCalls);
+  EXPECT_DOUBLE_EQ(10e-6, summary[0].totalSeconds);
+
+  EXPECT_EQ("forward", summary[1].name);
+  EXPECT_EQ(1, summary[1].layerId);
+  EXPECT_EQ(2, summary[1].numCalls);
+  EXPECT_DOUBLE_EQ(4e-6, summary[1].totalSeconds);
+  EXPECT_DOUBLE_EQ(2e-6, summary[1].meanSeconds());
+  EXPECT_DOUBLE_EQ(1e-6, summary[1].minSeconds);
+  EXPECT_DOUBLE_EQ(3e-6, summary[1].maxSeconds);
+
+  EXPECT_EQ("forward", summary[2].name);
+  EXPECT_EQ(2, summary[2].layerId);
+  EXPECT_EQ(1, summary[2].numCalls);
+
+  std::ostringstream table;
+  Tracer::writeSummary(table);
+  EXPECT_NE(std::string::npos, table.str().find("forward 1"));
+  EXPECT_NE(std::string::npos, table.str().find("update 1"));
+}
+
+TEST_F(TracerTests, WriteChromeTrace) {
+  Tracer::record("forward", 3, 1500, 4250);
+  Tracer::record("idle", Tracer::NO_LAYER, 5000, 6000);
+
+  std::ostringstream trace;
+  Tracer::writeChromeTrace(trace);
+
+  const uint32_t thread = Tracer::spans()[0].thread;
+  const std::string threadId = std::to_string(thread);
+  const std::string truth =
+      "{\"traceEvents\":[\n"
+      "{\"name\":\"forward 3\",\"cat\":\"forward\",\"ph\":\"X\","
+      "\"pid\":1,\"tid\":" + threadId + ",\"ts\":1.500,\"dur\":2.750,"
+      "\"args\":{\"layer\":3}},\n"
+      "{\"name\":\"idle\",\"cat\":\"idle\",\"ph\":\"X\","
+      "\"pid\":1,\"tid\":" + threadId + ",\"ts\":5.000,\"dur\":1.000}\n"
+      "],\"displayTimeUnit\":\"ms\"}\n";
+  EXPECT_EQ(truth, trace.str());
+}
+
+TEST_F(TracerTests, TraceLayer) {
+  FullyConnectedLayer<float, nl::ReLU> layer(
+      42, FloatMatrix({ 2, 3 }, 1.0f), FloatVector({ 2 }, 0.0f)
+  );
+  ForwardStateMap<float, MklAllocator<float, 64> > forwardState;
+  SgdOptimizer<float> optimizer(0.1f);
+  const FloatVector x({ 3 }, { 1.0f, 2.0f, 3.0f });
+
+  FloatVector y = layer.forward(x, forwardState);
+  layer.backward(y, forwardState, optimizer);
+
+  const std::vector<TraceSpan> spans = Tracer::spans();
+  if (Tracer::compiledIn()) {
+    EXPECT_EQ(1, countSpans(spans, "forward", 42));
+    EXPECT_EQ(1, countSpans(spans, "backward", 42));
+    EXPECT_EQ(1, countSpans(spans, "nonlinearity", 42));
+    EXPECT_EQ(1, countSpans(spans, "nonlinearity gradient", 42));
+    EXPECT_EQ(2, countSpans(spans, "update", 42));
+  } else {
+    EXPECT_TRUE(spans.empty());
+  }
+}
@@ -0,0 +1,49 @@
+#include <neurodidactic/core/random/Philox.hpp>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace neurodidactic::core::random;
+
+namespace {
+  typedef Philox4x32::BlockType Block;
+}
+
+TEST(PhiloxTests, KnownAnswers) {
+  // From the known-answer tests that ship with Random123
+  EXPECT_EQ(Block({{ 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 }}),
+	    Philox4x32(0).block(0, 0, 0, 0));
+  EXPECT_EQ(Block({{ 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd }}),
+	    Philox4x32(~uint64_t(0)).block(~0u, ~0u, ~0u, ~0u));
+  EXPECT_EQ(Block({{ 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 }}),
+	    Philox4x32(0x299f31d0a4093822ull).block(0x243f6a88, 0x85a308d3,
+						    0x13198a2e, 0x03707344));
+}
+
+TEST(PhiloxTests, Seed) {
+  EXPECT_EQ(0x0123456789abcdefull, Philox4x32(0x0123456789abcdefull).seed());
+}
+
+TEST(PhiloxTests, StreamsAndIndices) {
+  const Philox4x32 rng(42);
+  const Block b = rng(0x0000000500000003ull, 0x0000000200000001ull);
+  EXPECT_EQ(rng.block(1, 2, 3, 5), b);
+  EXPECT_NE(rng(0, 0), rng(0, 1));
+  EXPECT_NE(rng(0, 0), rng(1, 0));
+  EXPECT_NE(rng(0, 0), Philox4x32(43)(0, 0));
+}
+
+TEST(PhiloxTests, Generate) {
+  const Philox4x32 rng(7);
+  std::vector<uint32_t> all(100);
+  rng.generate(9, 0, all.size(), all.data());
+  for (size_t i = 0; i < all.size(); ++i) {
+    EXPECT_EQ(rng(9, i / 4)[i % 4], all[i]) << "at word " << i;
+  }
+
+  // Any run of words matches the same words of the whole stream
+  std::vector<uint32_t> part(70);
+  rng.generate(9, 3, part.size(), part.data());
+  EXPECT_EQ(std::vector<uint32_t>(all.begin() + 3, all.begin() + 73), part);
+}
@@ -0,0 +1,288 @@
+#include <neurodidactic/core/training/DataParallelTrainer.hpp>
+
+#include <neurodidactic/core/arrays/SparseVector.hpp>
+#include <neurodidactic/core/layers/BatchNormLayer.hpp>
+#include <neurodidactic/core/layers/FullyConnectedLayer.hpp>
+#include <neurodidactic/core/layers/Nonlinearities.hpp>
+#include <neurodidactic/core/optimizers/SgdOptimizer.hpp>
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::layers;
+using namespace neurodidactic::core::optimizers;
+using namespace neurodidactic::core::training;
+namespace nl = neurodidactic::core::layers::nonlinearities;
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<2, float> FloatMatrix;
+  typedef FullyConnectedLayer<float, nl::Identity> LinearLayer;
+  typedef DataParallelTrainer<float> FloatTrainer;
+
+  FloatMatrix patternMatrix(uint32_t rows, uint32_t columns, float scale) {
+    FloatMatrix m({ rows, columns }, 0.0f);
+    for (size_t i = 0; i < m.size(); ++i) {
+      m.data()[i] = scale * std::sin(float(i + 1) * 0.37f);
+    }
+    return std::move(m);
+  }
+
+  LinearLayer createLayer() {
+    return LinearLayer(1, patternMatrix(3, 4, 0.5f),
+		       FloatVector({ 3 }, { 0.1f, -0.2f, 0.3f }));
+  }
+
+  float sumSquares(const FloatMatrix& m) {
+    float total = 0.0f;
+    for (auto p = m.begin(); p != m.end(); ++p) {
+      total += *p * *p;
+    }
+    return total;
+  }
+
+  struct SumOfSquaresStep {
+    LinearLayer& layer;
+
+    float operator()(const FloatMatrix& inputs, const FloatMatrix& targets,
+		     FloatTrainer::ForwardStateType& forwardState,
+		     FloatTrainer::AccumulatorType& gradients) const {
+      FloatMatrix error =
+	  layer.forward(inputs, forwardState).subtract(targets);
+      layer.backward(error, forwardState, gradients);
+      return 0.5f * sumSquares(error);
+    }
+  };
+
+  struct FailingStep {
+    float operator()(const FloatMatrix&, const FloatMatrix&,
+		     FloatTrainer::ForwardStateType&,
+		     FloatTrainer::AccumulatorType&) const {
+      throw std::runtime_error("Step failed");
+    }
+  };
+
+  // Fails on every thread but the calling thread while "fail" is set
+  struct FlakyStep {
+    SumOfSquaresStep step;
+    std::thread::id caller;
+    const bool& fail;
+
+    float operator()(const FloatMatrix& inputs, const FloatMatrix& targets,
+		     FloatTrainer::ForwardStateType& forwardState,
+		     FloatTrainer::AccumulatorType& gradients) const {
+      if (fail && (std::this_thread::get_id() != caller)) {
+	throw std::runtime_error("Step failed");
+      }
+      return step(inputs, targets, forwardState, gradients);
+    }
+  };
+
+  // Leaves the running averages of the layer alone, as steps that run
+  // concurrently must
+  struct BatchNormStep {
+    BatchNormLayer<float>& layer;
+
+    float operator()(const FloatMatrix& inputs, const FloatMatrix& targets,
+		     FloatTrainer::ForwardStateType& forwardState,
+		     FloatTrainer::AccumulatorType& gradients) const {
+      FloatMatrix error =
+	  layer.forwardShard(inputs, forwardState).subtract(targets);
+      layer.backward(error, forwardState, gradients);
+      return 0.5f * sumSquares(error);
+    }
+  };
+
+  // Feeds each sample to the layer as a SparseVector of its nonzeros
+  struct SparseInputStep {
+    LinearLayer& layer;
+
+    float operator()(const FloatMatrix& inputs, const FloatMatrix& targets,
+		     FloatTrainer::ForwardStateType& forwardState,
+		     FloatTrainer::AccumulatorType& gradients) const {
+      const size_t numInputs = inputs.dimensions()[1];
+      const size_t numOutputs = targets.dimensions()[1];
+      float loss = 0.0f;
+      for (size_t i = 0; i < inputs.dimensions()[0]; ++i) {
+	SparseVector<float> x(numInputs);
+	for (size_t j = 0; j < numInputs; ++j) {
+	  if (inputs.data()[i * numInputs + j] > 0.0f) {
+	    x.append(j, inputs.data()[i * numInputs + j]);
+	  }
+	}
+	FloatVector error = layer.forward(x, forwardState).subtract(
+	    FloatVector({ (uint32_t)numOutputs },
+			targets.data() + i * numOutputs)
+	);
+	layer.backward(error, forwardState, gradients, x);
+	loss += 0.5f * error.innerProduct(error);
+      }
+      return loss;
+    }
+  };
+
+  void trainSteps(size_t numThreads, LinearLayer& layer, size_t numSteps,
+		  std::vector<float>& losses) {
+    FloatTrainer trainer(numThreads);
+    SgdOptimizer<float> optimizer(0.1f);
+    FloatMatrix inputs = patternMatrix(7, 4, 1.0f);
+    FloatMatrix targets = patternMatrix(7, 3, 2.0f);
+
+    for (size_t i = 0; i < numSteps; ++i) {
+      losses.push_back(
+	  trainer.step(inputs, targets, SumOfSquaresStep{ layer }, optimizer)
+      );
+    }
+  }
+}
+
+TEST(DataParallelTrainerTests, MatchSingleThreadedTraining) {
+  LinearLayer serialLayer = createLayer();
+  LinearLayer parallelLayer = createLayer();
+  std::vector<float> serialLosses;
+  std::vector<float> parallelLosses;
+
+  trainSteps(1, serialLayer, 5, serialLosses);
+  trainSteps(3, parallelLayer, 5, parallelLosses);
+
+  ASSERT_EQ(serialLosses.size(), parallelLosses.size());
+  for (size_t i = 0; i < serialLosses.size(); ++i) {
+    EXPECT_NEAR(serialLosses[i], parallelLosses[i], 1e-4);
+  }
+  EXPECT_LT(serialLosses.back(), serialLosses.front());
+
+  for (size_t i = 0; i < serialLayer.weights().size(); ++i) {
+    EXPECT_NEAR(serialLayer.weights().data()[i],
+		parallelLayer.weights().data()[i], 1e-5);
+  }
+  for (size_t i = 0; i < serialLayer.bias().size(); ++i) {
+    EXPECT_NEAR(serialLayer.bias().data()[i],
+		parallelLayer.bias().data()[i], 1e-5);
+  }
+}
+
+TEST(DataParallelTrainerTests, MatchFullBatchGradient) {
+  LinearLayer layer = createLayer();
+  LinearLayer reference = createLayer();
+  FloatMatrix inputs = patternMatrix(5, 4, 1.0f);
+  FloatMatrix targets = patternMatrix(5, 3, 2.0f);
+  SgdOptimizer<float> optimizer(0.1f);
+  FloatTrainer trainer(4);
+
+  trainer.step(inputs, targets, SumOfSquaresStep{ layer }, optimizer);
+
+  FloatTrainer::ForwardStateType forwardState;
+  FloatTrainer::AccumulatorType gradients;
+  FloatMatrix error =
+      reference.forward(inputs, forwardState).subtract(targets);
+  reference.backward(error, forwardState, gradients);
+  gradients.scale(1.0f / 5.0f);
+  gradients.apply(optimizer);
+
+  for (size_t i = 0; i < layer.weights().size(); ++i) {
+    EXPECT_NEAR(reference.weights().data()[i], layer.weights().data()[i],
+		1e-5);
+  }
+}
+
+TEST(DataParallelTrainerTests, GatherSparseUpdates) {
+  LinearLayer layer = createLayer();
+  LinearLayer reference = createLayer();
+  FloatMatrix inputs = patternMatrix(7, 4, 1.0f);
+  FloatMatrix targets = patternMatrix(7, 3, 2.0f);
+  SgdOptimizer<float> optimizer(0.1f);
+  FloatTrainer trainer(3);
+  FloatTrainer serialTrainer(1);
+
+  for (size_t i = 0; i < 3; ++i) {
+    const float loss = trainer.step(inputs, targets,
+				    SparseInputStep{ layer }, optimizer);
+    const float referenceLoss =
+	serialTrainer.step(inputs, targets, SparseInputStep{ reference },
+			   optimizer);
+    EXPECT_NEAR(referenceLoss, loss, 1e-4);
+  }
+  for (size_t i = 0; i < layer.weights().size(); ++i) {
+    EXPECT_NEAR(reference.weights().data()[i], layer.weights().data()[i],
+		1e-5);
+  }
+  EXPECT_NE(createLayer().weights().data()[0], layer.weights().data()[0]);
+}
+
+TEST(DataParallelTrainerTests, MoreThreadsThanSamples) {
+  LinearLayer layer = createLayer();
+  LinearLayer reference = createLayer();
+  std::vector<float> losses;
+  std::vector<float> referenceLosses;
+
+  trainSteps(16, layer, 2, losses);
+  trainSteps(1, reference, 2, referenceLosses);
+  EXPECT_NEAR(referenceLosses.back(), losses.back(), 1e-4);
+}
+
+TEST(DataParallelTrainerTests, PropagateWorkerExceptions) {
+  FloatTrainer trainer(3);
+  SgdOptimizer<float> optimizer(0.1f);
+  FloatMatrix inputs({ 6, 2 }, 1.0f);
+  FloatMatrix targets({ 6, 1 }, 1.0f);
+
+  EXPECT_THROW(trainer.step(inputs, targets, FailingStep(), optimizer),
+	       std::runtime_error);
+}
+
+TEST(DataParallelTrainerTests, RecoverFromWorkerExceptions) {
+  LinearLayer layer = createLayer();
+  LinearLayer reference = createLayer();
+  std::vector<float> referenceLosses;
+  FloatTrainer trainer(3);
+  SgdOptimizer<float> optimizer(0.1f);
+  FloatMatrix inputs = patternMatrix(7, 4, 1.0f);
+  FloatMatrix targets = patternMatrix(7, 3, 2.0f);
+  bool fail = true;
+  const FlakyStep step{ SumOfSquaresStep{ layer },
+			std::this_thread::get_id(), fail };
+
+  // Both workers fail, but the step throws once and leaves the layer as
+  // it was.  The next step starts over with every worker.
+  EXPECT_THROW(trainer.step(inputs, targets, step, optimizer),
+	       std::runtime_error);
+  fail = false;
+  const float loss = trainer.step(inputs, targets, step, optimizer);
+
+  trainSteps(1, reference, 1, referenceLosses);
+  EXPECT_NEAR(referenceLosses.back(), loss, 1e-4);
+  for (size_t i = 0; i < layer.weights().size(); ++i) {
+    EXPECT_NEAR(reference.weights().data()[i], layer.weights().data()[i],
+		1e-5);
+  }
+}
+
+TEST(DataParallelTrainerTests, MergeBatchStatisticsFromWorkers) {
+  // Seven samples split into shards of two, two and three
+  const FloatMatrix inputs = patternMatrix(7, 3, 1.0f);
+  const FloatMatrix targets = patternMatrix(7, 3, 2.0f);
+  BatchNormLayer<float> serial(2, 3);
+  BatchNormLayer<float> shared(2, 3);
+  FloatTrainer::ForwardStateType forwardState;
+  FloatTrainer trainer(3);
+  SgdOptimizer<float> optimizer(0.1f);
+
+  serial.forward(inputs, forwardState);
+  trainer.step(inputs, targets, BatchNormStep{ shared }, optimizer);
+  EXPECT_EQ(std::vector<float>(3, 0.0f),
+	    std::vector<float>(shared.runningMean().begin(),
+			       shared.runningMean().end()));
+
+  const auto states = trainer.forwardStates();
+  EXPECT_EQ(3, states.size());
+  shared.updateRunningStatistics(states.begin(), states.end());
+  for (size_t j = 0; j < 3; ++j) {
+    EXPECT_NEAR(serial.runningMean().data()[j],
+		shared.runningMean().data()[j], 1e-6f);
+    EXPECT_NEAR(serial.runningVariance().data()[j],
+		shared.runningVariance().data()[j], 1e-6f);
+  }
+}
@@ -0,0 +1,129 @@
+#include <neurodidactic/core/training/HogwildTrainer.hpp>
+
+#include <neurodidactic/core/layers/FullyConnectedLayer.hpp>
+#include <neurodidactic/core/layers/Nonlinearities.hpp>
+#include <neurodidactic/core/optimizers/HogwildSgdOptimizer.hpp>
+#include <neurodidactic/core/optimizers/SgdOptimizer.hpp>
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <stdexcept>
+
+using namespace neurodidactic::core::arrays;
+using namespace neurodidactic::core::layers;
+using namespace neurodidactic::core::optimizers;
+using namespace neurodidactic::core::training;
+namespace nl = neurodidactic::core::layers::nonlinearities;
+
+namespace {
+  typedef MdArray<1, float> FloatVector;
+  typedef MdArray<2, float> FloatMatrix;
+  typedef FullyConnectedLayer<float, nl::Identity> LinearLayer;
+  typedef HogwildTrainer<float> FloatTrainer;
+
+  FloatMatrix patternMatrix(uint32_t rows, uint32_t columns, float scale) {
+    FloatMatrix m({ rows, columns }, 0.0f);
+    for (size_t i = 0; i < m.size(); ++i) {
+      m.data()[i] = scale * std::sin(float(i + 1) * 0.37f);
+    }
+    return std::move(m);
+  }
+
+  LinearLayer createLayer() {
+    return LinearLayer(1, FloatMatrix({ 3, 4 }, 0.0f),
+		       FloatVector({ 3 }, 0.0f));
+  }
+
+  struct SquaredErrorStep {
+    LinearLayer& layer;
+
+    template <typename Optimizer>
+    float operator()(const FloatMatrix& inputs, const FloatMatrix& targets,
+		     FloatTrainer::ForwardStateType& forwardState,
+		     Optimizer& optimizer) const {
+      FloatMatrix error =
+	  layer.forward(inputs, forwardState).subtract(targets);
+      float loss = 0.0f;
+      for (size_t i = 0; i < error.size(); ++i) {
+	loss += error.data()[i] * error.data()[i];
+      }
+      layer.backward(error, forwardState, optimizer);
+      return 0.5f * loss;
+    }
+  };
+
+  struct FailingStep {
+    template <typename Optimizer>
+    float operator()(const FloatMatrix&, const FloatMatrix&,
+		     FloatTrainer::ForwardStateType&, Optimizer&) const {
+      throw std::runtime_error("Step failed");
+    }
+  };
+
+  // Targets are a fixed linear function of the inputs, so a linear layer
+  // can fit them exactly
+  FloatMatrix linearTargets(const FloatMatrix& inputs) {
+    LinearLayer truth(0, patternMatrix(3, 4, 0.5f),
+		      FloatVector({ 3 }, { 0.1f, -0.2f, 0.3f }));
+    return truth.forward(inputs);
+  }
+}
+
+TEST(HogwildTrainerTests, SingleThreadMatchesSequentialSgd) {
+  LinearLayer layer = createLayer();
+  LinearLayer reference = createLayer();
+  FloatMatrix inputs = patternMatrix(6, 4, 1.0f);
+  FloatMatrix targets = linearTargets(inputs);
+  HogwildSgdOptimizer<float> optimizer(0.05f);
+  SgdOptimizer<float> referenceOptimizer(0.05f);
+  FloatTrainer trainer(1, 2);
+
+  const float loss = trainer.epoch(inputs, targets, SquaredErrorStep{ layer },
+				   optimizer);
+
+  FloatTrainer::ForwardStateType forwardState;
+  float referenceLoss = 0.0f;
+  for (uint32_t i = 0; i < 6; i += 2) {
+    FloatMatrix x({ 2, 4 }, inputs.data() + i * 4);
+    FloatMatrix t({ 2, 3 }, targets.data() + i * 3);
+    forwardState.reset();
+    referenceLoss += SquaredErrorStep{ reference }(x, t, forwardState,
+						   referenceOptimizer);
+  }
+
+  EXPECT_NEAR(referenceLoss / 6.0f, loss, 1e-5);
+  for (size_t i = 0; i < layer.weights().size(); ++i) {
+    EXPECT_NEAR(reference.weights().data()[i], layer.weights().data()[i],
+		1e-5);
+  }
+  for (size_t i = 0; i < layer.bias().size(); ++i) {
+    EXPECT_NEAR(reference.bias().data()[i], layer.bias().data()[i], 1e-5);
+  }
+}
+
+TEST(HogwildTrainerTests, ConvergesWithManyThreads) {
+  LinearLayer layer = createLayer();
+  FloatMatrix inputs = patternMatrix(64, 4, 1.0f);
+  FloatMatrix targets = linearTargets(inputs);
+  HogwildSgdOptimizer<float> optimizer(0.05f);
+  FloatTrainer trainer(4);
+
+  const float initialLoss =
+      trainer.epoch(inputs, targets, SquaredErrorStep{ layer }, optimizer);
+  float loss = initialLoss;
+  for (size_t i = 0; i < 50; ++i) {
+    loss = trainer.epoch(inputs, targets, SquaredErrorStep{ layer },
+			 optimizer);
+  }
+  EXPECT_LT(loss, 0.01f * initialLoss);
+}
+
+TEST(HogwildTrainerTests, PropagateWorkerExceptions) {
+  FloatTrainer trainer(3);
+  HogwildSgdOptimizer<float> optimizer(0.1f);
+  FloatMatrix inputs({ 6, 2 }, 1.0f);
+  FloatMatrix targets({ 6, 1 }, 1.0f);
+
+  EXPECT_THROW(trainer.epoch(inputs, targets, FailingStep(), optimizer),
+	       std::runtime_error);
+}
@@ -0,0 +1,80 @@
+#ifndef __NEURODIDACTIC__TESTING__LAYERTESTING_HPP__
+#define __NEURODIDACTIC__TESTING__LAYERTESTING_HPP__
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace neurodidactic {
+  namespace testing {
+
+    // An array of the given dimensions filled with values drawn
+    // uniformly from [low, high)
+    template <typename Array>
+    Array randomArray(std::mt19937& rng,
+		      const typename Array::DimensionListType& dimensions,
+		      typename Array::FieldType low = -1,
+		      typename Array::FieldType high = 1) {
+      typedef typename Array::FieldType Field;
+      std::uniform_real_distribution<Field> uniform(low, high);
+      Array a(dimensions);
+      for (Field* p = a.data(); p != a.end(); ++p) {
+	*p = uniform(rng);
+      }
+      return a;
+    }
+
+    template <typename Field>
+    std::vector<double> toDouble(const Field* p, size_t n) {
+      return std::vector<double>(p, p + n);
+    }
+
+    inline double sigmoid(double x) { return 1.0 / (1.0 + std::exp(-x)); }
+
+    template <typename T, typename Field>
+    void expectNear(const std::vector<T>& truth, const Field* data,
+		    double tolerance) {
+      for (size_t i = 0; i < truth.size(); ++i) {
+	EXPECT_NEAR(truth[i], data[i], tolerance) << "at index " << i;
+      }
+    }
+
+    // sum(w * output), the loss whose gradient with respect to "output"
+    // is "w"
+    inline double weightedSum(const std::vector<double>& w,
+			      const std::vector<double>& output) {
+      double sum = 0.0;
+      for (size_t i = 0; i < output.size(); ++i) {
+	sum += w[i] * output[i];
+      }
+      return sum;
+    }
+
+    // Compares computed[p], the gradient of loss() with respect to
+    // parameters[p], with central differences of loss(), which reads
+    // "parameters"
+    template <typename Field, typename Loss>
+    void expectGradientsNear(std::vector< std::vector<double> >& parameters,
+			     Loss loss,
+			     const std::vector<const Field*>& computed,
+			     double tolerance, double eps = 1e-6) {
+      for (size_t p = 0; p < parameters.size(); ++p) {
+	std::vector<double> truth(parameters[p].size());
+	for (size_t i = 0; i < truth.size(); ++i) {
+	  const double v = parameters[p][i];
+	  parameters[p][i] = v + eps;
+	  const double above = loss();
+	  parameters[p][i] = v - eps;
+	  const double below = loss();
+	  parameters[p][i] = v;
+	  truth[i] = (above - below) / (2 * eps);
+	}
+	SCOPED_TRACE(p);
+	expectNear(truth, computed[p], tolerance);
+      }
+    }
+
+  }
+}
+#endif